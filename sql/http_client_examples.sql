@@ -120,3 +120,184 @@ WITH
 SELECT
   HTTP_UTILS.GET_HEADER_VALUE(T.RESPONSE_HEADERS, 'age') AS HEADER_VALUE
 FROM T;
+
+SELECT
+  STATUS_CODE,
+  FILE_SIZE,
+  CHECKSUM,
+  TOTAL_TIME
+FROM HTTP_UTILS.HTTP_DOWNLOAD_TO_FILE (
+  'https://www.cbr-xml-daily.ru/daily_utf8.xml',
+  '/var/lib/firebird/import/daily_utf8.xml'
+);
+
+SELECT
+  STATUS_CODE,
+  STATUS_TEXT,
+  FILE_SIZE,
+  TOTAL_TIME
+FROM HTTP_UTILS.HTTP_UPLOAD_FROM_FILE (
+  'PUT',
+  'https://example.com/upload/report.csv',
+  '/var/lib/firebird/export/report.csv',
+  'text/csv'
+);
+
+SELECT
+  STATUS_CODE,
+  CONTENT_LENGTH,
+  RANGE_COUNT,
+  RESUMED_SIZE,
+  RETRY_COUNT,
+  TOTAL_TIME
+FROM HTTP_UTILS.HTTP_PARALLEL_DOWNLOAD (
+  'https://example.com/exports/full_dump.csv.gz',
+  '/var/lib/firebird/import/full_dump.csv.gz',
+  NULL,
+  NULL,
+  8
+);
+
+SELECT
+  STATUS_CODE,
+  VALUE_PATH,
+  VALUE_TEXT
+FROM HTTP_UTILS.HTTP_REQUEST_JSON (
+  'GET',
+  'https://www.cbr-xml-daily.ru/latest.js',
+  '$.date
+$.rates.USD
+$.rates.EUR'
+);
+
+SELECT
+  STATUS_CODE,
+  LINE_NUMBER,
+  LINE
+FROM HTTP_UTILS.HTTP_STREAM_LINES (
+  'GET',
+  'https://jsonplaceholder.typicode.com/comments'
+);
+
+SELECT
+  EVENT_NUMBER,
+  EVENT_ID,
+  EVENT_TYPE,
+  EVENT_DATA
+FROM HTTP_UTILS.HTTP_SSE_SUBSCRIBE (
+  'https://stream.wikimedia.org/v2/stream/recentchange',
+  NULL,
+  NULL,
+  NULL,
+  100,
+  30,
+  600
+);
+
+SELECT
+  PAGE_NUMBER,
+  STATUS_CODE,
+  ITEM_COUNT,
+  RESPONSE_BODY
+FROM HTTP_UTILS.HTTP_PAGINATE (
+  'https://api.github.com/repos/FirebirdSQL/firebird/releases?per_page=20',
+  'User-Agent: http_client_udr',
+  NULL,
+  'LINK',
+  NULL,
+  NULL,
+  '$[*]'
+);
+
+SELECT PARAMETER_NAMES
+FROM HTTP_UTILS.HTTP_TEMPLATE_REGISTER (
+  'create_comment',
+  'POST',
+  'https://jsonplaceholder.typicode.com/posts/{{post_id}}/comments',
+  '{"name": {{name}}, "body": "Comment from {{name}}: {{text}}"}',
+  'application/json'
+);
+
+SELECT STATUS_CODE, RESPONSE_BODY
+FROM HTTP_UTILS.HTTP_TEMPLATE_EXECUTE (
+  'create_comment',
+  '{"post_id": 1, "name": "John", "text": "Hello \"world\""}'
+);
+
+SELECT REMOVED
+FROM HTTP_UTILS.HTTP_TEMPLATE_UNREGISTER ('create_comment');
+
+SELECT STAT_NAME, STAT_VALUE
+FROM HTTP_UTILS.HTTP_STATS;
+
+SELECT READY_CONNECTIONS, NEW_CONNECTIONS
+FROM HTTP_UTILS.HTTP_PRECONNECT('https://api.github.com/zen', 4);
+
+SELECT STATUS_CODE, RESPONSE_BODY
+FROM HTTP_UTILS.HTTP_GET(
+  'https://api.github.com/zen',
+  NULL,
+  'UDR_HEDGE=AUTO'
+);
+
+SELECT STATUS_CODE, RESPONSE_BODY
+FROM HTTP_UTILS.HTTP_GET('upstream://orders/v1/orders?limit=10');
+
+SELECT GROUP_NAME, URL, OUTSTANDING_REQUESTS, LATENCY, EJECTED
+FROM HTTP_UTILS.HTTP_UPSTREAMS;
+
+SELECT TRACE_TIME, ATTACHMENT_ID, METHOD, URL, STATUS_CODE, ERROR_MESSAGE, TOTAL_TIME
+FROM HTTP_UTILS.HTTP_TRACE_DUMP
+WHERE STATUS_CODE >= 500 OR CURL_CODE <> 0;
+
+EXECUTE PROCEDURE HTTP_UTILS.HTTP_BULK_SINK_REGISTER(
+  'search_log',
+  'http://localhost:9200/_bulk',
+  'NDJSON',
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  '$.items[*]'
+);
+
+SELECT RECORD_ID
+FROM HTTP_UTILS.HTTP_BULK_APPEND(
+  'search_log',
+  '{"index": {"_index": "orders"}}' || ASCII_CHAR(10) || '{"order_id": 1, "state": "paid"}'
+);
+
+SELECT RECORDS, BATCHES, STATUS_CODE, ERROR_MESSAGE
+FROM HTTP_UTILS.HTTP_BULK_FLUSH('search_log');
+
+SELECT RECORD_ID, STATUS_CODE, RESULT, ERROR_MESSAGE
+FROM HTTP_UTILS.HTTP_BULK_RESULTS('search_log');
+
+SELECT REQUEST_ID
+FROM HTTP_UTILS.HTTP_OUTBOX_ENQUEUE(
+  'POST',
+  'https://hooks.example.com/orders',
+  '{"order_id": 1, "state": "paid"}',
+  'application/json'
+);
+
+SELECT REQUEST_ID, URL, ATTEMPTS, NEXT_ATTEMPT_TIME, LAST_ERROR
+FROM HTTP_UTILS.HTTP_OUTBOX_PENDING;
+
+SELECT STATUS_CODE, BODY_INLINE, CAST(RESPONSE_TEXT AS VARCHAR(8191) CHARACTER SET UTF8) AS RESPONSE_TEXT, RESPONSE_BODY
+FROM HTTP_UTILS.HTTP_REQUEST_INLINE('GET', 'https://api.github.com/zen');
+
+SELECT STATUS_CODE, STATUS_TEXT, RESPONSE_HEADERS_TEXT
+FROM HTTP_UTILS.HTTP_REQUEST_INLINE(
+  'HEAD',
+  'https://api.github.com/zen',
+  NULL,
+  NULL,
+  NULL,
+  'UDR_RESPONSE_HEADERS=ETag,Last-Modified'
+);
+
+SELECT STATUS_CODE, RESPONSE_BODY
+FROM HTTP_UTILS.HTTP_REQUEST_TEXT(
+  'POST',
+  'https://httpbin.org/post',
+  (SELECT '{"order_id": ' || 1 || '}' FROM RDB$DATABASE),
+  'application/json'
+);
@@ -469,6 +469,703 @@ BEGIN
     HEADER_NAME          VARCHAR(256)
   )
   RETURNS VARCHAR(8191);
+
+  /**
+   * Downloads a resource directly to a file on the server.
+   *
+   * The received data is written to a temporary file in the target directory,
+   * which is atomically renamed to FILE_NAME after a successful (2xx) response.
+   * Access to the file is restricted by the FileAccess parameter of http_client_udr.conf.
+   *
+   * Input parameters:
+   *
+   * - `URL` - URL address.
+   * - `FILE_NAME` - name of the file on the server.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   * - `SYNC_MODE` - when the file data is flushed to disk. Possible values are 'NONE', 'CLOSE', 'INTERVAL'.
+   * - `OVERWRITE` - whether an existing file can be replaced.
+   *
+   * Output parameters:
+   *
+   * - `STATUS_CODE` - response status code.
+   * - `STATUS_TEXT` - response status text.
+   * - `RESPONSE_TYPE` - response content type. Contains the values of the `Content-Type` header.
+   * - `RESPONSE_HEADERS` - response headers.
+   * - `FILE_SIZE` - size of the saved file. NULL if the file was not saved.
+   * - `CHECKSUM` - SHA-256 checksum of the saved file in hex. NULL if the file was not saved.
+   * - `NAMELOOKUP_TIME` - time in seconds until the name resolving was completed.
+   * - `CONNECT_TIME` - time in seconds until the connect to the remote host was completed.
+   * - `STARTTRANSFER_TIME` - time in seconds until the first byte was received.
+   * - `TOTAL_TIME` - total time of the download in seconds.
+   */
+  PROCEDURE HTTP_DOWNLOAD_TO_FILE (
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL,
+    SYNC_MODE            VARCHAR(10) DEFAULT 'CLOSE',
+    OVERWRITE            BOOLEAN DEFAULT FALSE
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    FILE_SIZE            BIGINT,
+    CHECKSUM             VARCHAR(64),
+    NAMELOOKUP_TIME      DOUBLE PRECISION,
+    CONNECT_TIME         DOUBLE PRECISION,
+    STARTTRANSFER_TIME   DOUBLE PRECISION,
+    TOTAL_TIME           DOUBLE PRECISION
+  );
+
+  /**
+   * Sends the content of a file on the server as the request body.
+   *
+   * The file is read piece by piece directly into the transfer buffer,
+   * so the memory usage does not depend on the file size.
+   * The request is sent with the exact Content-Length of the file.
+   * Access to the file is restricted by the FileAccess parameter of http_client_udr.conf.
+   *
+   * Input parameters:
+   *
+   * - `METHOD` - HTTP method. Possible values are 'POST', 'PUT', 'PATCH'.
+   * - `URL` - URL address.
+   * - `FILE_NAME` - name of the file on the server.
+   * - `REQUEST_TYPE` - request content type. Sets the value of the `Content-Type` header.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   *
+   * Output parameters:
+   *
+   * - `STATUS_CODE` - response status code.
+   * - `STATUS_TEXT` - response status text.
+   * - `RESPONSE_TYPE` - response content type. Contains the values of the `Content-Type` header.
+   * - `RESPONSE_BODY` - response body.
+   * - `RESPONSE_HEADERS` - response headers.
+   * - `FILE_SIZE` - size of the sent file.
+   * - `TOTAL_TIME` - total time of the request in seconds.
+   */
+  PROCEDURE HTTP_UPLOAD_FROM_FILE (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191) NOT NULL,
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    FILE_SIZE            BIGINT,
+    TOTAL_TIME           DOUBLE PRECISION
+  );
+
+  /**
+   * Downloads a resource over several connections at once, each connection receives its own byte ranges.
+   *
+   * If FILE_NAME is specified, the resource is saved to the file on the server,
+   * otherwise it is returned in RESPONSE_BODY. An interrupted download to a file
+   * continues from the ranges already received when the procedure is called again.
+   * If the server does not support ranges, the resource is downloaded with a single request.
+   *
+   * Input parameters:
+   *
+   * - `URL` - URL address.
+   * - `FILE_NAME` - name of the file on the server. If NULL, the resource is returned in RESPONSE_BODY.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   * - `CONNECTIONS` - number of simultaneous connections.
+   * - `RANGE_SIZE` - size of one range in bytes. If NULL, it is chosen by the size of the resource.
+   * - `MAX_RETRIES` - how many times a failed range is requested again.
+   * - `OVERWRITE` - whether an existing file can be replaced.
+   *
+   * Output parameters:
+   *
+   * - `STATUS_CODE` - response status code.
+   * - `STATUS_TEXT` - response status text.
+   * - `RESPONSE_TYPE` - response content type. Contains the values of the `Content-Type` header.
+   * - `RESPONSE_BODY` - the resource, if FILE_NAME is NULL.
+   * - `RESPONSE_HEADERS` - response headers.
+   * - `CONTENT_LENGTH` - size of the resource.
+   * - `RANGE_COUNT` - number of ranges.
+   * - `RESUMED_SIZE` - number of bytes received by a previous call.
+   * - `RETRY_COUNT` - number of repeated range requests.
+   * - `TOTAL_TIME` - total time of the download in seconds.
+   */
+  PROCEDURE HTTP_PARALLEL_DOWNLOAD (
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL,
+    CONNECTIONS          SMALLINT DEFAULT 4,
+    RANGE_SIZE           BIGINT DEFAULT NULL,
+    MAX_RETRIES          SMALLINT DEFAULT 3,
+    OVERWRITE            BOOLEAN DEFAULT FALSE
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    CONTENT_LENGTH       BIGINT,
+    RANGE_COUNT          INTEGER,
+    RESUMED_SIZE         BIGINT,
+    RETRY_COUNT          INTEGER,
+    TOTAL_TIME           DOUBLE PRECISION
+  );
+
+  /**
+   * Sends an HTTP request and returns only the values of the given JSON paths from the response.
+   *
+   * The response is parsed as it is received, the body is not kept unless KEEP_BODY is TRUE.
+   * One row is returned for each found value. If nothing is found, one row with the response status is returned.
+   *
+   * Input parameters:
+   *
+   * - `METHOD` - HTTP method. Possible values are 'GET', 'HEAD', 'POST', 'PUT', 'PATCH', 'DELETE', 'OPTIONS', 'TRACE'.
+   * - `URL` - URL address.
+   * - `PATHS` - JSON paths, one per line. For example `$.items[*].id`.
+   * - `REQUEST_BODY` - HTTP request body.
+   * - `REQUEST_TYPE` - request content type. Sets the value of the `Content-Type` header.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   * - `KEEP_BODY` - whether the response body is returned in RESPONSE_BODY.
+   *
+   * Output parameters:
+   *
+   * - `STATUS_CODE` - response status code.
+   * - `STATUS_TEXT` - response status text.
+   * - `RESPONSE_TYPE` - response content type. Contains the values of the `Content-Type` header.
+   * - `JSON_PATH` - the path from PATHS that matched the value.
+   * - `VALUE_PATH` - the location of the value in the document, for example `$.items[3].id`.
+   * - `VALUE_TYPE` - JSON type of the value: STRING, NUMBER, BOOLEAN, NULL, OBJECT, ARRAY.
+   * - `VALUE_TEXT` - the value. Strings are decoded, objects and arrays are returned as JSON text.
+   * - `RESPONSE_BODY` - response body, only in the first row and only if KEEP_BODY is TRUE.
+   * - `RESPONSE_HEADERS` - response headers, only in the first row.
+   */
+  PROCEDURE HTTP_REQUEST_JSON (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    PATHS                VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB DEFAULT NULL,
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL,
+    KEEP_BODY            BOOLEAN DEFAULT FALSE
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    JSON_PATH            VARCHAR(1024),
+    VALUE_PATH           VARCHAR(8191),
+    VALUE_TYPE           VARCHAR(10),
+    VALUE_TEXT           VARCHAR(8191),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  );
+
+  /**
+   * Sends an HTTP request and returns the response line by line while it is being received.
+   *
+   * Rows are returned as soon as the lines arrive. The transfer is advanced only when the next row is fetched,
+   * so the whole response is never kept in memory.
+   *
+   * Input parameters:
+   *
+   * - `METHOD` - HTTP method. Possible values are 'GET', 'HEAD', 'POST', 'PUT', 'PATCH', 'DELETE', 'OPTIONS', 'TRACE'.
+   * - `URL` - URL address.
+   * - `REQUEST_BODY` - HTTP request body.
+   * - `REQUEST_TYPE` - request content type. Sets the value of the `Content-Type` header.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   * - `DELIMITER` - record delimiter. By default, a line feed (CR before it is removed).
+   *
+   * Output parameters:
+   *
+   * - `STATUS_CODE` - response status code.
+   * - `LINE_NUMBER` - number of the line, starting from 1.
+   * - `LINE` - the line without the delimiter. NULL if the line is longer than VARCHAR(8191).
+   * - `LINE_BLOB` - the line, if it does not fit into LINE.
+   */
+  PROCEDURE HTTP_STREAM_LINES (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB DEFAULT NULL,
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL,
+    DELIMITER            VARCHAR(10) DEFAULT NULL
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    LINE_NUMBER          BIGINT,
+    LINE                 VARCHAR(8191),
+    LINE_BLOB            BLOB SUB_TYPE TEXT
+  );
+
+  /**
+   * Subscribes to a stream of Server-Sent Events (text/event-stream) and returns one row per event as it arrives.
+   *
+   * The connection is kept open. If it is lost, the procedure reconnects and sends the Last-Event-ID header,
+   * so the server can resume the stream after the last received event.
+   *
+   * Input parameters:
+   *
+   * - `URL` - URL address of the event stream.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   * - `LAST_EVENT_ID` - identifier of the last event received earlier. The stream is resumed after this event.
+   * - `MAX_EVENTS` - maximum number of events after which the subscription ends.
+   * - `IDLE_TIMEOUT` - the subscription ends if there are no events during this number of seconds.
+   * - `MAX_DURATION` - maximum duration of the subscription in seconds.
+   * - `MAX_RECONNECTS` - how many times in a row the lost connection is reestablished. The default is 3.
+   *
+   * Output parameters:
+   *
+   * - `EVENT_NUMBER` - number of the event, starting from 1.
+   * - `EVENT_ID` - identifier of the last event (the id field).
+   * - `EVENT_TYPE` - type of the event (the event field), 'message' by default.
+   * - `EVENT_DATA` - event data. NULL if the data is longer than VARCHAR(8191).
+   * - `EVENT_DATA_BLOB` - event data, if it does not fit into EVENT_DATA.
+   * - `RECONNECT_COUNT` - number of reconnections since the start of the subscription.
+   */
+  PROCEDURE HTTP_SSE_SUBSCRIBE (
+    URL                  VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL,
+    LAST_EVENT_ID        VARCHAR(1024) DEFAULT NULL,
+    MAX_EVENTS           INTEGER DEFAULT NULL,
+    IDLE_TIMEOUT         INTEGER DEFAULT NULL,
+    MAX_DURATION         INTEGER DEFAULT NULL,
+    MAX_RECONNECTS       SMALLINT DEFAULT 3
+  )
+  RETURNS (
+    EVENT_NUMBER         BIGINT,
+    EVENT_ID             VARCHAR(1024),
+    EVENT_TYPE           VARCHAR(256),
+    EVENT_DATA           VARCHAR(8191),
+    EVENT_DATA_BLOB      BLOB SUB_TYPE TEXT,
+    RECONNECT_COUNT      INTEGER
+  );
+
+  /**
+   * Requests all pages of a paginated collection and returns one row per page.
+   *
+   * The request for the next page is sent in the background while the current page is being processed.
+   *
+   * Input parameters:
+   *
+   * - `URL` - URL address of the first page.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   * - `PAGINATION` - how the next page is found: 'LINK' (default), 'CURSOR', 'OFFSET' or 'PAGE'.
+   * - `PAGE_PARAMETER` - query parameter that receives the cursor, offset or page number.
+   * - `CURSOR_PATH` - JSON path of the next cursor or URL for CURSOR pagination.
+   * - `ITEMS_PATH` - JSON path of the items of a page, for example `$.items[*]`. Required for OFFSET and PAGE pagination.
+   * - `PAGE_SIZE` - number of items per page. Required for OFFSET pagination.
+   * - `MAX_PAGES` - maximum number of pages.
+   *
+   * Output parameters:
+   *
+   * - `PAGE_NUMBER` - number of the page, starting from 1.
+   * - `PAGE_URL` - URL address of the page.
+   * - `STATUS_CODE` - response status code.
+   * - `STATUS_TEXT` - response status text.
+   * - `RESPONSE_TYPE` - response content type. Contains the values of the `Content-Type` header.
+   * - `RESPONSE_BODY` - response body.
+   * - `RESPONSE_HEADERS` - response headers.
+   * - `ITEM_COUNT` - number of items found by ITEMS_PATH.
+   * - `TOTAL_TIME` - total time of the page request in seconds.
+   */
+  PROCEDURE HTTP_PAGINATE (
+    URL                  VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL,
+    PAGINATION           VARCHAR(10) DEFAULT 'LINK',
+    PAGE_PARAMETER       VARCHAR(256) DEFAULT NULL,
+    CURSOR_PATH          VARCHAR(1024) DEFAULT NULL,
+    ITEMS_PATH           VARCHAR(1024) DEFAULT NULL,
+    PAGE_SIZE            INTEGER DEFAULT NULL,
+    MAX_PAGES            INTEGER DEFAULT NULL
+  )
+  RETURNS (
+    PAGE_NUMBER          INTEGER,
+    PAGE_URL             VARCHAR(8191),
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    ITEM_COUNT           INTEGER,
+    TOTAL_TIME           DOUBLE PRECISION
+  );
+
+  /**
+   * Registers a request template that can then be sent with HTTP_TEMPLATE_EXECUTE.
+   *
+   * The URL and the body may contain {{name}} placeholders. The template is compiled once:
+   * the header list is built and the texts are split into literal parts and parameters.
+   * Registering a template with the same name replaces it.
+   *
+   * Input parameters:
+   *
+   * - `NAME` - name of the template.
+   * - `METHOD` - HTTP method. Possible values are 'GET', 'HEAD', 'POST', 'PUT', 'PATCH', 'DELETE', 'OPTIONS', 'TRACE'.
+   * - `URL` - URL address with placeholders. The values are URL-encoded.
+   * - `REQUEST_BODY` - HTTP request body with placeholders. The values are escaped by REQUEST_TYPE.
+   * - `REQUEST_TYPE` - request content type. Sets the value of the `Content-Type` header.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   *
+   * Output parameters:
+   *
+   * - `PARAMETER_NAMES` - names of the template parameters, one per line.
+   */
+  PROCEDURE HTTP_TEMPLATE_REGISTER (
+    NAME                 VARCHAR(63) NOT NULL,
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE TEXT DEFAULT NULL,
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    PARAMETER_NAMES      VARCHAR(8191)
+  );
+
+  /**
+   * Sends the request of a registered template.
+   *
+   * Input parameters:
+   *
+   * - `NAME` - name of the template.
+   * - `PARAMS` - values of the template parameters as a JSON object, for example {"id": 10, "name": "John"}.
+   *
+   * Output parameters:
+   *
+   * - `STATUS_CODE` - response status code.
+   * - `STATUS_TEXT` - response status text.
+   * - `RESPONSE_TYPE` - response content type. Contains the values of the `Content-Type` header.
+   * - `RESPONSE_BODY` - response body.
+   * - `RESPONSE_HEADERS` - response headers.
+   */
+  PROCEDURE HTTP_TEMPLATE_EXECUTE (
+    NAME                 VARCHAR(63) NOT NULL,
+    PARAMS               VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  );
+
+  /**
+   * Removes a registered template of the current database.
+   *
+   * Input parameters:
+   *
+   * - `NAME` - name of the template.
+   *
+   * Output parameters:
+   *
+   * - `REMOVED` - FALSE if there was no template with this name.
+   */
+  PROCEDURE HTTP_TEMPLATE_UNREGISTER (
+    NAME                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    REMOVED              BOOLEAN
+  );
+
+  /**
+   * Returns the counters of the library in the server process.
+   *
+   * The counters are accumulated since the library was loaded
+   * and are common to all databases and attachments of the process.
+   *
+   * Output parameters:
+   *
+   * - `STAT_NAME` - name of the counter.
+   * - `STAT_VALUE` - value of the counter.
+   */
+  PROCEDURE HTTP_STATS
+  RETURNS (
+    STAT_NAME            VARCHAR(63),
+    STAT_VALUE           BIGINT
+  );
+
+  PROCEDURE HTTP_PRECONNECT (
+    URL                  VARCHAR(8191) NOT NULL,
+    CONNECTIONS          SMALLINT NOT NULL DEFAULT 1,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    READY_CONNECTIONS    SMALLINT,
+    NEW_CONNECTIONS      SMALLINT
+  );
+
+  /**
+   * Returns the state of the members of the upstream groups defined
+   * by the Upstream parameters of the configuration file.
+   *
+   * Output parameters:
+   *
+   * - `GROUP_NAME` - name of the group.
+   * - `URL` - base URL of the member.
+   * - `WEIGHT` - weight of the member.
+   * - `OUTSTANDING_REQUESTS` - requests in progress.
+   * - `LATENCY` - average time to the first byte of the response, in milliseconds.
+   * - `FAILURES` - consecutive failed requests.
+   * - `EJECTED` - the member gets no requests until its eject time passes.
+   * - `REQUESTS` - requests sent to the member.
+   */
+  PROCEDURE HTTP_UPSTREAMS
+  RETURNS (
+    GROUP_NAME           VARCHAR(63),
+    URL                  VARCHAR(8191),
+    WEIGHT               INTEGER,
+    OUTSTANDING_REQUESTS INTEGER,
+    LATENCY              DOUBLE PRECISION,
+    FAILURES             INTEGER,
+    EJECTED              BOOLEAN,
+    REQUESTS             BIGINT
+  );
+
+  /**
+   * Returns the recent requests of the server process kept in the trace buffer
+   * (TraceBufferSize parameter), oldest first. Reading does not stop the requests.
+   *
+   * URLs are recorded without user info and with the values of query parameters hidden.
+   * WIRE_TRACE holds the headers exchanged by the requests sampled with the
+   * TraceWireSampleRate parameter.
+   */
+  PROCEDURE HTTP_TRACE_DUMP
+  RETURNS (
+    ID                   BIGINT,
+    TRACE_TIME           TIMESTAMP,
+    ATTACHMENT_ID        BIGINT,
+    METHOD               VARCHAR(16),
+    URL                  VARCHAR(1024),
+    STATUS_CODE          SMALLINT,
+    CURL_CODE            INTEGER,
+    ERROR_MESSAGE        VARCHAR(256),
+    NAMELOOKUP_TIME      DOUBLE PRECISION,
+    CONNECT_TIME         DOUBLE PRECISION,
+    APPCONNECT_TIME      DOUBLE PRECISION,
+    STARTTRANSFER_TIME   DOUBLE PRECISION,
+    TOTAL_TIME           DOUBLE PRECISION,
+    REQUEST_SIZE         BIGINT,
+    RESPONSE_SIZE        BIGINT,
+    WIRE_TRACE           BLOB SUB_TYPE TEXT
+  );
+
+  /**
+   * Registers a bulk sink. Records appended to the sink with HTTP_BULK_APPEND are sent
+   * with POST to the URL in batches: as NDJSON lines or as the elements of a JSON array.
+   *
+   * Input parameters:
+   *
+   * - `NAME` - name of the sink.
+   * - `URL` - URL of the bulk API.
+   * - `FORMAT` - 'NDJSON' or 'JSON_ARRAY'.
+   * - `REQUEST_TYPE` - request content type, by default application/x-ndjson or application/json.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   * - `MAX_RECORDS` - records in a batch, 1000 by default.
+   * - `MAX_BYTES` - size of a batch in bytes, 1048576 by default.
+   * - `MAX_AGE` - time in milliseconds after which an appended record is sent, 1000 by default.
+   * - `ENVELOPE` - JSON_ARRAY only, the text around the array, which takes the place of {{records}}.
+   * - `RESULT_PATH` - JSONPath of the per-record results in the response, for example $.items[*].
+   */
+  PROCEDURE HTTP_BULK_SINK_REGISTER (
+    NAME                 VARCHAR(63) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    FORMAT               VARCHAR(10) NOT NULL DEFAULT 'NDJSON',
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL,
+    MAX_RECORDS          INTEGER DEFAULT NULL,
+    MAX_BYTES            INTEGER DEFAULT NULL,
+    MAX_AGE              INTEGER DEFAULT NULL,
+    ENVELOPE             VARCHAR(8191) DEFAULT NULL,
+    RESULT_PATH          VARCHAR(1024) DEFAULT NULL
+  );
+
+  /**
+   * Appends a record to a bulk sink and returns its ID. The record is sent in the background
+   * and is not undone when the transaction is rolled back.
+   */
+  PROCEDURE HTTP_BULK_APPEND (
+    SINK                 VARCHAR(63) NOT NULL,
+    PAYLOAD              VARCHAR(8191) NOT NULL
+  )
+  RETURNS (
+    RECORD_ID            BIGINT
+  );
+
+  /**
+   * Sends the records appended to a bulk sink so far.
+   *
+   * Output parameters:
+   *
+   * - `RECORDS` - records sent.
+   * - `BATCHES` - requests made.
+   * - `STATUS_CODE` - response status code of the last request.
+   * - `ERROR_MESSAGE` - error of the last failed request.
+   */
+  PROCEDURE HTTP_BULK_FLUSH (
+    SINK                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    RECORDS              INTEGER,
+    BATCHES              INTEGER,
+    STATUS_CODE          SMALLINT,
+    ERROR_MESSAGE        VARCHAR(1024)
+  );
+
+  /**
+   * Returns the outcome of the last records sent by a bulk sink, oldest first.
+   *
+   * Output parameters:
+   *
+   * - `RECORD_ID` - ID returned by HTTP_BULK_APPEND.
+   * - `STATUS_CODE` - response status code of the batch.
+   * - `RESULT` - result of the record selected by RESULT_PATH.
+   * - `ERROR_MESSAGE` - error of the batch.
+   */
+  PROCEDURE HTTP_BULK_RESULTS (
+    SINK                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    RECORD_ID            BIGINT,
+    STATUS_CODE          SMALLINT,
+    RESULT               BLOB SUB_TYPE TEXT,
+    ERROR_MESSAGE        VARCHAR(1024)
+  );
+
+  /**
+   * Puts a request into the durable outbox and returns its ID. The request is written to disk
+   * before the procedure returns and is sent in the background, also after a restart of the server.
+   * It is not undone when the transaction is rolled back.
+   *
+   * Input parameters:
+   *
+   * - `METHOD` - HTTP method.
+   * - `URL` - URL address.
+   * - `REQUEST_BODY` - HTTP request body. Not allowed for the GET and HEAD methods.
+   * - `REQUEST_TYPE` - request content type.
+   * - `HEADERS` - HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   */
+  PROCEDURE HTTP_OUTBOX_ENQUEUE (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB DEFAULT NULL,
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    REQUEST_ID           BIGINT
+  );
+
+  /**
+   * Returns the requests of the database in the outbox that are not delivered yet.
+   *
+   * Output parameters:
+   *
+   * - `REQUEST_ID` - ID returned by HTTP_OUTBOX_ENQUEUE.
+   * - `METHOD` - HTTP method.
+   * - `URL` - URL address.
+   * - `ATTEMPTS` - attempts made.
+   * - `ENQUEUE_TIME` - time the request was put into the outbox.
+   * - `NEXT_ATTEMPT_TIME` - time of the next attempt.
+   * - `LAST_ERROR` - error of the last attempt.
+   */
+  PROCEDURE HTTP_OUTBOX_PENDING
+  RETURNS (
+    REQUEST_ID           BIGINT,
+    METHOD               VARCHAR(7),
+    URL                  VARCHAR(8191),
+    ATTEMPTS             INTEGER,
+    ENQUEUE_TIME         TIMESTAMP,
+    NEXT_ATTEMPT_TIME    TIMESTAMP,
+    LAST_ERROR           VARCHAR(1024)
+  );
+
+  /**
+   * Sends an HTTP request like HTTP_REQUEST. A response body up to InlineBodySize bytes is returned
+   * in RESPONSE_TEXT, so no BLOB is created for it, a larger body is returned in RESPONSE_BODY.
+   * The response headers are returned the same way in RESPONSE_HEADERS_TEXT or RESPONSE_HEADERS.
+   *
+   * Output parameters:
+   *
+   * - `STATUS_CODE` - response status code.
+   * - `STATUS_TEXT` - response status text.
+   * - `RESPONSE_TYPE` - response content type.
+   * - `RESPONSE_TEXT` - response body that fits InlineBodySize, the bytes as received (CHARACTER SET OCTETS).
+   * - `RESPONSE_BODY` - response body that does not fit InlineBodySize.
+   * - `RESPONSE_HEADERS_TEXT` - response headers that fit InlineBodySize.
+   * - `RESPONSE_HEADERS` - response headers that do not fit InlineBodySize.
+   * - `BODY_INLINE` - TRUE if the body is returned in RESPONSE_TEXT.
+   */
+  PROCEDURE HTTP_REQUEST_INLINE (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB DEFAULT NULL,
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_TEXT        VARCHAR(8191) CHARACTER SET OCTETS,
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS_TEXT VARCHAR(8191),
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    BODY_INLINE          BOOLEAN
+  );
+
+  /**
+   * Sends an HTTP request like HTTP_REQUEST with the body given as a string. No BLOB is created
+   * for the body, it is passed to the CURL library as is.
+   *
+   * Input parameters:
+   *
+   * - `METHOD` - HTTP method.
+   * - `URL` - URL address.
+   * - `REQUEST_TEXT` - HTTP request body.
+   * - `REQUEST_TYPE` - request body content type.
+   * - `HEADERS` - other HTTP request headers. Each heading must be on a new line, that is, headings are separated by a newline character.
+   * - `OPTIONS` - CURL library options.
+   */
+  PROCEDURE HTTP_REQUEST_TEXT (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_TEXT         VARCHAR(8191) DEFAULT NULL,
+    REQUEST_TYPE         VARCHAR(256) DEFAULT NULL,
+    HEADERS              VARCHAR(8191) DEFAULT NULL,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  );
 END^
 
 RECREATE PACKAGE BODY HTTP_UTILS
@@ -889,6 +1586,372 @@ BEGIN
   RETURNS VARCHAR(8191)
   EXTERNAL NAME 'http_client_udr!getHeaderValue'
   ENGINE UDR;
+
+  PROCEDURE HTTP_DOWNLOAD_TO_FILE (
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    SYNC_MODE            VARCHAR(10),
+    OVERWRITE            BOOLEAN
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    FILE_SIZE            BIGINT,
+    CHECKSUM             VARCHAR(64),
+    NAMELOOKUP_TIME      DOUBLE PRECISION,
+    CONNECT_TIME         DOUBLE PRECISION,
+    STARTTRANSFER_TIME   DOUBLE PRECISION,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!downloadToFile'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_UPLOAD_FROM_FILE (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191) NOT NULL,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    FILE_SIZE            BIGINT,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!uploadFromFile'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_PARALLEL_DOWNLOAD (
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    CONNECTIONS          SMALLINT,
+    RANGE_SIZE           BIGINT,
+    MAX_RETRIES          SMALLINT,
+    OVERWRITE            BOOLEAN
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    CONTENT_LENGTH       BIGINT,
+    RANGE_COUNT          INTEGER,
+    RESUMED_SIZE         BIGINT,
+    RETRY_COUNT          INTEGER,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!parallelDownload'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_REQUEST_JSON (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    PATHS                VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    KEEP_BODY            BOOLEAN
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    JSON_PATH            VARCHAR(1024),
+    VALUE_PATH           VARCHAR(8191),
+    VALUE_TYPE           VARCHAR(10),
+    VALUE_TEXT           VARCHAR(8191),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!requestJson'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_STREAM_LINES (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    DELIMITER            VARCHAR(10)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    LINE_NUMBER          BIGINT,
+    LINE                 VARCHAR(8191),
+    LINE_BLOB            BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!streamLines'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_SSE_SUBSCRIBE (
+    URL                  VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    LAST_EVENT_ID        VARCHAR(1024),
+    MAX_EVENTS           INTEGER,
+    IDLE_TIMEOUT         INTEGER,
+    MAX_DURATION         INTEGER,
+    MAX_RECONNECTS       SMALLINT
+  )
+  RETURNS (
+    EVENT_NUMBER         BIGINT,
+    EVENT_ID             VARCHAR(1024),
+    EVENT_TYPE           VARCHAR(256),
+    EVENT_DATA           VARCHAR(8191),
+    EVENT_DATA_BLOB      BLOB SUB_TYPE TEXT,
+    RECONNECT_COUNT      INTEGER
+  )
+  EXTERNAL NAME 'http_client_udr!sseSubscribe'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_PAGINATE (
+    URL                  VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    PAGINATION           VARCHAR(10),
+    PAGE_PARAMETER       VARCHAR(256),
+    CURSOR_PATH          VARCHAR(1024),
+    ITEMS_PATH           VARCHAR(1024),
+    PAGE_SIZE            INTEGER,
+    MAX_PAGES            INTEGER
+  )
+  RETURNS (
+    PAGE_NUMBER          INTEGER,
+    PAGE_URL             VARCHAR(8191),
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    ITEM_COUNT           INTEGER,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!paginate'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_TEMPLATE_REGISTER (
+    NAME                 VARCHAR(63) NOT NULL,
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE TEXT,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    PARAMETER_NAMES      VARCHAR(8191)
+  )
+  EXTERNAL NAME 'http_client_udr!registerTemplate'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_TEMPLATE_EXECUTE (
+    NAME                 VARCHAR(63) NOT NULL,
+    PARAMS               VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!executeTemplate'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_TEMPLATE_UNREGISTER (
+    NAME                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    REMOVED              BOOLEAN
+  )
+  EXTERNAL NAME 'http_client_udr!unregisterTemplate'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_STATS
+  RETURNS (
+    STAT_NAME            VARCHAR(63),
+    STAT_VALUE           BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!getStatistics'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_PRECONNECT (
+    URL                  VARCHAR(8191) NOT NULL,
+    CONNECTIONS          SMALLINT NOT NULL,
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    READY_CONNECTIONS    SMALLINT,
+    NEW_CONNECTIONS      SMALLINT
+  )
+  EXTERNAL NAME 'http_client_udr!preconnect'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_UPSTREAMS
+  RETURNS (
+    GROUP_NAME           VARCHAR(63),
+    URL                  VARCHAR(8191),
+    WEIGHT               INTEGER,
+    OUTSTANDING_REQUESTS INTEGER,
+    LATENCY              DOUBLE PRECISION,
+    FAILURES             INTEGER,
+    EJECTED              BOOLEAN,
+    REQUESTS             BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!getUpstreams'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_TRACE_DUMP
+  RETURNS (
+    ID                   BIGINT,
+    TRACE_TIME           TIMESTAMP,
+    ATTACHMENT_ID        BIGINT,
+    METHOD               VARCHAR(16),
+    URL                  VARCHAR(1024),
+    STATUS_CODE          SMALLINT,
+    CURL_CODE            INTEGER,
+    ERROR_MESSAGE        VARCHAR(256),
+    NAMELOOKUP_TIME      DOUBLE PRECISION,
+    CONNECT_TIME         DOUBLE PRECISION,
+    APPCONNECT_TIME      DOUBLE PRECISION,
+    STARTTRANSFER_TIME   DOUBLE PRECISION,
+    TOTAL_TIME           DOUBLE PRECISION,
+    REQUEST_SIZE         BIGINT,
+    RESPONSE_SIZE        BIGINT,
+    WIRE_TRACE           BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!dumpTrace'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_BULK_SINK_REGISTER (
+    NAME                 VARCHAR(63) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    FORMAT               VARCHAR(10) NOT NULL,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    MAX_RECORDS          INTEGER,
+    MAX_BYTES            INTEGER,
+    MAX_AGE              INTEGER,
+    ENVELOPE             VARCHAR(8191),
+    RESULT_PATH          VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!registerBulkSink'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_BULK_APPEND (
+    SINK                 VARCHAR(63) NOT NULL,
+    PAYLOAD              VARCHAR(8191) NOT NULL
+  )
+  RETURNS (
+    RECORD_ID            BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!appendBulkRecord'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_BULK_FLUSH (
+    SINK                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    RECORDS              INTEGER,
+    BATCHES              INTEGER,
+    STATUS_CODE          SMALLINT,
+    ERROR_MESSAGE        VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!flushBulkSink'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_BULK_RESULTS (
+    SINK                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    RECORD_ID            BIGINT,
+    STATUS_CODE          SMALLINT,
+    RESULT               BLOB SUB_TYPE TEXT,
+    ERROR_MESSAGE        VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!getBulkResults'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_OUTBOX_ENQUEUE (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    REQUEST_ID           BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!enqueueOutboxRequest'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_OUTBOX_PENDING
+  RETURNS (
+    REQUEST_ID           BIGINT,
+    METHOD               VARCHAR(7),
+    URL                  VARCHAR(8191),
+    ATTEMPTS             INTEGER,
+    ENQUEUE_TIME         TIMESTAMP,
+    NEXT_ATTEMPT_TIME    TIMESTAMP,
+    LAST_ERROR           VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!getOutboxPending'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_REQUEST_INLINE (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_TEXT        VARCHAR(8191) CHARACTER SET OCTETS,
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS_TEXT VARCHAR(8191),
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    BODY_INLINE          BOOLEAN
+  )
+  EXTERNAL NAME 'http_client_udr!sendHttpRequestInline'
+  ENGINE UDR;
+
+  PROCEDURE HTTP_REQUEST_TEXT (
+    METHOD               D_HTTP_METHOD NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_TEXT         VARCHAR(8191),
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!sendHttpRequestText'
+  ENGINE UDR;
 END
 ^
 
@@ -0,0 +1,467 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			BulkSink.cpp
+ *	DESCRIPTION:	Coalescing of small records into batched requests.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "BulkSink.h"
+#include "ConnectionPool.h"
+#include "RequestTrace.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+namespace
+{
+    // requests of the flusher thread have no statement timeout, a batch that takes longer is failed
+    constexpr long BULK_DEFAULT_TIMEOUT_MS = 60000;
+
+    const char* const BULK_STOPPED_ERROR = "The bulk sinks are stopped, the library is being unloaded.";
+
+    size_t appendResponse(void* ptr, size_t size, size_t nmemb, void* stream)
+    {
+        const size_t length = size * nmemb;
+        static_cast<std::string*>(stream)->append(static_cast<const char*>(ptr), length);
+        return length;
+    }
+
+    bool isRetryable(long statusCode)
+    {
+        return statusCode == 0 || statusCode == 429 || statusCode >= 500;
+    }
+}
+
+BulkSink::BulkSink(BulkSinkSettings settings)
+    : m_settings(std::move(settings))
+    , m_results(std::make_shared<BulkResultLog>())
+{
+    if (m_settings.format == BulkFormat::JsonArray && !m_settings.envelope.empty() &&
+        m_settings.envelope.find("{{records}}") == std::string::npos)
+    {
+        throw std::runtime_error("The envelope of a bulk sink must contain the {{records}} placeholder.");
+    }
+    if (!m_settings.resultPath.empty())
+        m_resultPaths.emplace_back(m_settings.resultPath);
+    // the request fails at registration rather than in the flusher thread
+    Endpoint endpoint(m_settings.url);
+}
+
+bool BulkSink::isFull() const
+{
+    return m_records.size() >= m_settings.maxRecords || m_bytes >= m_settings.maxBytes;
+}
+
+uint64_t BulkSink::append(std::string payload)
+{
+    if (m_settings.format == BulkFormat::Ndjson) {
+        // each record ends with a single line feed
+        while (!payload.empty() && (payload.back() == '\n' || payload.back() == '\r'))
+            payload.pop_back();
+    }
+    if (payload.empty())
+        throw std::runtime_error("The record of a bulk sink can not be empty.");
+
+    uint64_t id = 0;
+    bool deadlineChanged = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed)
+            throw std::runtime_error("The bulk sink has been registered again, the record is not accepted.");
+        if (m_bytes + payload.size() > m_settings.maxBytes * BULK_BUFFER_BATCHES)
+            throw std::runtime_error("The buffer of the bulk sink is full, the records are not sent fast enough.");
+        // the first record starts the age limit, the one reaching a limit makes the sink due
+        const bool wasEmpty = m_records.empty();
+        const bool wasFull = isFull();
+        m_bytes += payload.size() + 1;
+        id = m_nextId++;
+        m_records.push_back({ id, std::move(payload), std::chrono::steady_clock::now(), 0 });
+        deadlineChanged = wasEmpty || (!wasFull && isFull());
+    }
+    auto& registry = BulkSinkRegistry::instance();
+    registry.addAppend();
+    if (deadlineChanged)
+        registry.notify();
+    return id;
+}
+
+void BulkSink::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+}
+
+void BulkSink::continueFrom(BulkSink& previous)
+{
+    std::lock_guard<std::mutex> previousLock(previous.m_mutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // record IDs do not start again at 1, so the results of both sinks can not be confused
+    m_nextId = previous.m_nextId;
+    m_results = previous.m_results;
+}
+
+std::chrono::steady_clock::time_point BulkSink::getDeadline() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_records.empty())
+        return std::chrono::steady_clock::time_point::max();
+    // a closed sink gets no more records, so it does not wait for the age limit
+    const auto deadline = isFull() || m_closed ? std::chrono::steady_clock::time_point::min() :
+        m_records.front().time + m_settings.maxAge;
+    return std::max(deadline, m_retryTime);
+}
+
+size_t BulkSink::buildBody(size_t maxCount, std::string& body) const
+{
+    const bool array = m_settings.format == BulkFormat::JsonArray;
+    const size_t limit = std::min<size_t>(maxCount, m_settings.maxRecords);
+    size_t count = 0;
+    size_t size = 0;
+    for (const auto& record : m_records) {
+        // a record larger than the limit is sent alone
+        if (count == limit || (count > 0 && size + record.payload.size() + 1 > m_settings.maxBytes))
+            break;
+        size += record.payload.size() + 1;
+        ++count;
+    }
+
+    std::string prefix("[");
+    std::string suffix("]");
+    if (array && !m_settings.envelope.empty()) {
+        const auto pos = m_settings.envelope.find("{{records}}");
+        prefix = m_settings.envelope.substr(0, pos) + "[";
+        suffix = "]" + m_settings.envelope.substr(pos + std::strlen("{{records}}"));
+    }
+    body.clear();
+    body.reserve(size + (array ? prefix.size() + suffix.size() : 0));
+    if (array)
+        body += prefix;
+    for (size_t i = 0; i < count; ++i) {
+        if (array && i > 0)
+            body.push_back(',');
+        body += m_records[i].payload;
+        if (!array)
+            body.push_back('\n');
+    }
+    if (array)
+        body += suffix;
+    return count;
+}
+
+long BulkSink::send(const std::string& body, std::string& response, std::string& error) const
+{
+    const Endpoint endpoint(m_settings.url);
+    PooledCurl curl(CurlHandlePool::instance(), endpoint.getKey());
+    if (!curl) {
+        error = "Can't initialize CURL.";
+        return 0;
+    }
+    if (m_settings.privateDns)
+        curl.discard();
+
+    char curlErrorBuffer[CURL_ERROR_SIZE];
+    memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+    endpoint.apply(curl);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, BULK_DEFAULT_TIMEOUT_MS);
+
+    std::shared_ptr<const DnsLists> dnsLists;
+    try {
+        if (m_settings.configure)
+            dnsLists = m_settings.configure(curl);
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return 0;
+    }
+    TransferTrace trace(RequestTrace::instance(), curl);
+
+    if (m_settings.headers)
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, m_settings.headers.get());
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(body.size()));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.data());
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, appendResponse);
+
+    const CURLcode curlResult = curl_easy_perform(curl);
+    // requests of the flusher thread belong to no attachment
+    trace.record(0, "POST", curl, curlResult, curlErrorBuffer);
+    if (curlResult != CURLE_OK) {
+        error.assign(curlErrorBuffer);
+        if (error.empty())
+            error.assign(curl_easy_strerror(curlResult));
+        return 0;
+    }
+    long statusCode = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
+    if (statusCode < 200 || statusCode >= 300)
+        error = "HTTP status " + std::to_string(statusCode);
+    return statusCode;
+}
+
+std::vector<std::string> BulkSink::parseResults(const std::string& response) const
+{
+    std::vector<std::string> items;
+    if (m_resultPaths.empty())
+        return items;
+    try {
+        JsonStreamParser parser(m_resultPaths, [&items](size_t, const std::string&, JsonType type, std::string& value) {
+            if (type == JsonType::String)
+                items.push_back(escapeJsonString(value));
+            else
+                items.push_back(std::move(value));
+        });
+        parser.parse(response.data(), response.size());
+        parser.finish();
+    }
+    catch (const std::runtime_error&) {
+        // a response that can not be parsed leaves the records without results
+        items.clear();
+    }
+    return items;
+}
+
+void BulkSink::finishBatch(size_t count, long statusCode, const std::vector<std::string>& items, const std::string& error)
+{
+    std::lock_guard<std::mutex> resultsLock(m_results->mutex);
+    auto& results = m_results->results;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& record = m_records.front();
+        // results follow the order of the records, a response with a different number of them is not mapped
+        const bool hasItem = items.size() == count;
+        results.push_back({ record.id, statusCode, hasItem, hasItem ? items[i] : std::string(), error });
+        m_bytes -= record.payload.size() + 1;
+        m_records.pop_front();
+    }
+    while (results.size() > BULK_MAX_RESULTS)
+        results.pop_front();
+}
+
+BulkFlushResult BulkSink::flush(bool force)
+{
+    BulkFlushResult result;
+    auto& registry = BulkSinkRegistry::instance();
+    std::lock_guard<std::mutex> sendLock(m_sendMutex);
+    size_t remaining = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!force && std::chrono::steady_clock::now() < m_retryTime)
+            return result;
+        // records appended meanwhile wait for the next flush
+        remaining = m_records.size();
+    }
+    std::string body;
+    while (remaining > 0) {
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            count = buildBody(remaining, body);
+        }
+        std::string response;
+        std::string error;
+        const long statusCode = send(body, response, error);
+        registry.addBatch();
+        ++result.batches;
+        result.statusCode = statusCode;
+
+        if (error.empty()) {
+            const auto items = parseResults(response);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            finishBatch(count, statusCode, items, error);
+            result.records += static_cast<unsigned int>(count);
+        }
+        else {
+            result.error = error;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (isRetryable(statusCode) && m_records.front().attempts + 1 < BULK_SEND_ATTEMPTS) {
+                // the batch is sent again later, the following records keep their order behind it
+                for (size_t i = 0; i < count; ++i)
+                    ++m_records[i].attempts;
+                m_retryTime = std::chrono::steady_clock::now() + BULK_RETRY_DELAY * m_records.front().attempts;
+                break;
+            }
+            finishBatch(count, statusCode, std::vector<std::string>(), error);
+            registry.addFailed(count);
+        }
+        remaining -= count;
+    }
+    return result;
+}
+
+std::vector<BulkResult> BulkSink::getResults() const
+{
+    std::shared_ptr<BulkResultLog> log;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        log = m_results;
+    }
+    std::lock_guard<std::mutex> resultsLock(log->mutex);
+    return std::vector<BulkResult>(log->results.cbegin(), log->results.cend());
+}
+
+
+BulkSinkRegistry& BulkSinkRegistry::instance()
+{
+    static BulkSinkRegistry* const registry = new BulkSinkRegistry();
+    return *registry;
+}
+
+BulkSinkRegistry::BulkSinkRegistry()
+{
+}
+
+void BulkSinkRegistry::requestStop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+}
+
+void BulkSinkRegistry::join()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+std::shared_ptr<BulkSink> BulkSinkRegistry::put(const std::string& key, std::shared_ptr<BulkSink> sink)
+{
+    std::shared_ptr<BulkSink> previous;
+    bool started = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& current = m_sinks[key];
+        previous = std::move(current);
+        if (previous) {
+            // an attachment holding the previous sink can no longer append to it
+            previous->close();
+            sink->continueFrom(*previous);
+            m_retired.push_back(previous);
+        }
+        current = std::move(sink);
+        if (!m_thread.joinable() && !m_stop) {
+            m_thread = std::thread(&BulkSinkRegistry::run, this);
+            started = true;
+        }
+    }
+    if (started)
+        Runtime::instance().addService(*this);
+    m_wakeUp.notify_all();
+    return previous;
+}
+
+std::shared_ptr<BulkSink> BulkSinkRegistry::get(const std::string& key) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_sinks.find(key);
+    return it != m_sinks.cend() ? it->second : nullptr;
+}
+
+std::future<BulkFlushResult> BulkSinkRegistry::requestFlush(std::shared_ptr<BulkSink> sink)
+{
+    std::promise<BulkFlushResult> promise;
+    auto result = promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop)
+            throw std::runtime_error(BULK_STOPPED_ERROR);
+        m_flushRequests.emplace_back(std::move(sink), std::move(promise));
+    }
+    m_wakeUp.notify_all();
+    return result;
+}
+
+void BulkSinkRegistry::notify()
+{
+    {
+        // the flusher thread holds the mutex from checking the sinks until it waits
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wakeUp.notify_all();
+}
+
+void BulkSinkRegistry::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        if (!m_flushRequests.empty()) {
+            auto request = std::move(m_flushRequests.front());
+            m_flushRequests.pop_front();
+            lock.unlock();
+            try {
+                request.second.set_value(request.first->flush(true));
+            }
+            catch (...) {
+                request.second.set_exception(std::current_exception());
+            }
+            lock.lock();
+            continue;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        std::vector<std::shared_ptr<BulkSink>> due;
+        for (const auto& sink : m_sinks) {
+            const auto sinkDeadline = sink.second->getDeadline();
+            if (sinkDeadline <= now)
+                due.push_back(sink.second);
+            else
+                deadline = std::min(deadline, sinkDeadline);
+        }
+        for (auto it = m_retired.begin(); it != m_retired.end(); ) {
+            // a closed sink gets no more records, it is released once they are sent
+            const auto sinkDeadline = (*it)->getDeadline();
+            if (sinkDeadline == std::chrono::steady_clock::time_point::max()) {
+                it = m_retired.erase(it);
+                continue;
+            }
+            if (sinkDeadline <= now)
+                due.push_back(*it);
+            else
+                deadline = std::min(deadline, sinkDeadline);
+            ++it;
+        }
+        if (due.empty()) {
+            if (deadline == std::chrono::steady_clock::time_point::max())
+                m_wakeUp.wait(lock);
+            else
+                m_wakeUp.wait_until(lock, deadline);
+            continue;
+        }
+        lock.unlock();
+        for (const auto& sink : due) {
+            try {
+                sink->flush(false);
+            }
+            catch (const std::exception&) {
+                // the records stay in the buffer, the sink is flushed again later
+            }
+        }
+        lock.lock();
+    }
+    // statements waiting for a flush get an error rather than wait until they are cancelled
+    for (auto& request : m_flushRequests) {
+        request.second.set_exception(std::make_exception_ptr(std::runtime_error(BULK_STOPPED_ERROR)));
+    }
+    m_flushRequests.clear();
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#ifndef BULK_SINK_H
+#define BULK_SINK_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Runtime.h"
+#include "DnsResolver.h"
+#include "JsonStream.h"
+#include "RequestTemplate.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <cstdint>
+#include <curl/curl.h>
+
+constexpr unsigned int DEFAULT_BULK_MAX_RECORDS = 1000;
+constexpr size_t DEFAULT_BULK_MAX_BYTES = 1024 * 1024;
+constexpr std::chrono::milliseconds DEFAULT_BULK_MAX_AGE{ 1000 };
+// records waiting to be sent, as a multiple of the size of a batch
+constexpr size_t BULK_BUFFER_BATCHES = 16;
+// sending of a batch that failed with a transport error, 429 or 5xx is repeated
+constexpr unsigned int BULK_SEND_ATTEMPTS = 3;
+constexpr std::chrono::seconds BULK_RETRY_DELAY{ 1 };
+// results of the records kept for HTTP_BULK_RESULTS
+constexpr size_t BULK_MAX_RESULTS = 10000;
+// How often a statement waiting for a flush by the flusher thread checks its own cancellation.
+constexpr std::chrono::milliseconds BULK_FLUSH_WAIT_INTERVAL{ 100 };
+
+enum class BulkFormat
+{
+    Ndjson,      // one record per line
+    JsonArray    // records as elements of an array, optionally inside an envelope
+};
+
+struct BulkSinkSettings
+{
+    std::string url;
+    BulkFormat format = BulkFormat::Ndjson;
+    // text with the {{records}} placeholder for the array, JsonArray only
+    std::string envelope;
+    std::unique_ptr<curl_slist, CurlSlistDeleter> headers;
+    unsigned int maxRecords = DEFAULT_BULK_MAX_RECORDS;
+    size_t maxBytes = DEFAULT_BULK_MAX_BYTES;
+    std::chrono::milliseconds maxAge = DEFAULT_BULK_MAX_AGE;
+    // path of the per-record results in the response, they follow the order of the records
+    std::string resultPath;
+    // handles with addresses of the options are not returned to the pool
+    bool privateDns = false;
+    // sets the CURL options of the sink for each batch, the DNS lists returned live until the batch is sent
+    std::function<std::shared_ptr<const DnsLists>(CURL*)> configure;
+};
+
+struct BulkResult
+{
+    uint64_t recordId;
+    long statusCode;             // HTTP status of the batch, 0 if there was no response
+    bool hasItem;
+    std::string item;            // per-record result selected by the result path
+    std::string error;
+};
+
+// Results of the records of a sink, shared with the sink registered again under its name.
+struct BulkResultLog
+{
+    std::mutex mutex;
+    std::deque<BulkResult> results;
+};
+
+struct BulkFlushResult
+{
+    unsigned int records = 0;    // records sent in batches that succeeded
+    unsigned int batches = 0;
+    long statusCode = 0;         // HTTP status of the last batch
+    std::string error;           // error of the last failed batch
+};
+
+/*
+ * Buffer of records sent to a bulk API as one request body. Records are appended by
+ * any attachment and sent by the flusher thread of the registry when the sink reaches
+ * the number, size or age limit, or when HTTP_BULK_FLUSH asks for it. Batches of a sink
+ * are sent one at a time in the order of the records.
+ */
+class BulkSink final
+{
+public:
+    explicit BulkSink(BulkSinkSettings settings);
+
+    // Returns the ID of the record, throws if the buffer is full or the sink is closed.
+    uint64_t append(std::string payload);
+
+    // Rejects the records appended later, those already buffered are still sent.
+    void close();
+
+    // Takes over the record IDs and the results of the sink replaced by this one, so the results
+    // of its retried batches are returned with those of this sink. Called before the first append.
+    void continueFrom(BulkSink& previous);
+
+    // Sends the records appended so far. Records of a batch to be retried stay in the buffer
+    // and the sink is not flushed by the flusher thread until the retry delay passes.
+    BulkFlushResult flush(bool force);
+
+    // Time at which the sink has to be flushed, max() if there are no records.
+    std::chrono::steady_clock::time_point getDeadline() const;
+
+    std::vector<BulkResult> getResults() const;
+
+private:
+    struct Record
+    {
+        uint64_t id;
+        std::string payload;
+        std::chrono::steady_clock::time_point time;
+        unsigned int attempts;
+    };
+
+    // The caller holds the mutex.
+    bool isFull() const;
+    // Builds the body of the next batch from the first records, the caller holds the mutex.
+    size_t buildBody(size_t maxCount, std::string& body) const;
+    long send(const std::string& body, std::string& response, std::string& error) const;
+    std::vector<std::string> parseResults(const std::string& response) const;
+    // Removes a batch that is finished from the buffer, the caller holds the mutex.
+    void finishBatch(size_t count, long statusCode, const std::vector<std::string>& items, const std::string& error);
+
+    const BulkSinkSettings m_settings;
+    std::vector<JsonPath> m_resultPaths;
+
+    mutable std::mutex m_mutex;
+    std::deque<Record> m_records;
+    size_t m_bytes = 0;
+    uint64_t m_nextId = 1;
+    bool m_closed = false;
+    std::chrono::steady_clock::time_point m_retryTime;
+    std::shared_ptr<BulkResultLog> m_results;
+
+    // one batch of the sink is sent at a time
+    std::mutex m_sendMutex;
+};
+
+/*
+ * Sinks of all attachments of the process, the key includes the database.
+ * The flusher thread is started with the first sink.
+ */
+class BulkSinkRegistry final : public RuntimeService
+{
+public:
+    static BulkSinkRegistry& instance();
+
+    // Returns the sink replaced by the new one. It is closed and flushed by the flusher thread,
+    // with the retries of failed batches, until its buffer is empty.
+    std::shared_ptr<BulkSink> put(const std::string& key, std::shared_ptr<BulkSink> sink);
+    std::shared_ptr<BulkSink> get(const std::string& key) const;
+
+    // Sends the records of the sink appended so far by the flusher thread, so a statement waiting
+    // for the result can be cancelled. The flush is completed even if nobody waits for it.
+    std::future<BulkFlushResult> requestFlush(std::shared_ptr<BulkSink> sink);
+
+    // Wakes the flusher thread up, the deadline of a sink has changed.
+    void notify();
+
+    void requestStop() override;
+    void join() override;
+
+    uint64_t getAppendCount() const
+    {
+        return m_appendCount;
+    }
+
+    uint64_t getBatchCount() const
+    {
+        return m_batchCount;
+    }
+
+    uint64_t getFailedCount() const
+    {
+        return m_failedCount;
+    }
+
+    void addAppend()
+    {
+        ++m_appendCount;
+    }
+
+    void addBatch()
+    {
+        ++m_batchCount;
+    }
+
+    void addFailed(uint64_t records)
+    {
+        m_failedCount += records;
+    }
+
+private:
+    BulkSinkRegistry();
+
+    void run();
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<BulkSink>> m_sinks;
+    // replaced sinks that still have records to send
+    std::vector<std::shared_ptr<BulkSink>> m_retired;
+    // flushes asked for by statements, done before the sinks that are due
+    std::deque<std::pair<std::shared_ptr<BulkSink>, std::promise<BulkFlushResult>>> m_flushRequests;
+    std::condition_variable m_wakeUp;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    std::atomic<uint64_t> m_appendCount{ 0 };
+    std::atomic<uint64_t> m_batchCount{ 0 };
+    std::atomic<uint64_t> m_failedCount{ 0 };
+};
+
+#endif // BULK_SINK_H
@@ -0,0 +1,74 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			CertificateCache.cpp
+ *	DESCRIPTION:	Cache of certificate and key files.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "CertificateCache.h"
+#include <fstream>
+#include <sstream>
+
+CertificateCache& CertificateCache::instance()
+{
+    static CertificateCache cache;
+    return cache;
+}
+
+std::shared_ptr<const std::string> CertificateCache::get(const std::string& fileName)
+{
+    const auto now = std::chrono::steady_clock::now();
+    FileStamp stamp;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(fileName);
+        if (it != m_entries.end()) {
+            Entry& entry = it->second;
+            if (now - entry.checkTime < CERTIFICATE_CHECK_INTERVAL) {
+                ++m_hitCount;
+                return entry.content;
+            }
+            if (getFileStamp(fileName, stamp) && stamp == entry.stamp) {
+                entry.checkTime = now;
+                ++m_hitCount;
+                return entry.content;
+            }
+        }
+    }
+
+    // the file is new or has changed, it is read outside the lock
+    if (!getFileStamp(fileName, stamp))
+        return nullptr;
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open())
+        return nullptr;
+    std::ostringstream content;
+    content << file.rdbuf();
+    if (file.bad())
+        return nullptr;
+    std::shared_ptr<const std::string> result(new std::string(content.str()));
+    ++m_loadCount;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[fileName] = { result, stamp, now };
+    return result;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef CERTIFICATE_CACHE_H
+#define CERTIFICATE_CACHE_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "FileUtils.h"
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+
+// How often a cached file is checked for changes.
+constexpr std::chrono::seconds CERTIFICATE_CHECK_INTERVAL{ 1 };
+
+/*
+ * Contents of client certificates and keys of all attachments of the process, and of CA bundles
+ * with libcurl older than 7.87.0, which can not cache the parsed trust store itself.
+ * A file is read when it is used for the first time and again after it changes,
+ * so requests pass the data to libcurl from memory instead of reading the file.
+ */
+class CertificateCache final
+{
+public:
+    static CertificateCache& instance();
+
+    // Returns the contents of the file or nullptr if the file can not be read.
+    std::shared_ptr<const std::string> get(const std::string& fileName);
+
+    // number of reads of files and of requests served from the cache
+    uint64_t getLoadCount() const
+    {
+        return m_loadCount;
+    }
+
+    uint64_t getHitCount() const
+    {
+        return m_hitCount;
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const std::string> content;
+        FileStamp stamp;
+        std::chrono::steady_clock::time_point checkTime;
+    };
+
+    CertificateCache() = default;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::atomic<uint64_t> m_loadCount{ 0 };
+    std::atomic<uint64_t> m_hitCount{ 0 };
+};
+
+#endif // CERTIFICATE_CACHE_H
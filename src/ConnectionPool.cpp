@@ -0,0 +1,223 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			ConnectionPool.cpp
+ *	DESCRIPTION:	Reuse of connections between requests.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "ConnectionPool.h"
+#include "StringUtils.h"
+#include "CurlCompat.h"
+#include <stdexcept>
+#include <iterator>
+
+namespace
+{
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    std::string percentDecode(const std::string& value)
+    {
+        std::string result;
+        result.reserve(value.size());
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (value[i] == '%' && i + 2 < value.size() && hexValue(value[i + 1]) >= 0 && hexValue(value[i + 2]) >= 0) {
+                result.push_back(static_cast<char>(hexValue(value[i + 1]) * 16 + hexValue(value[i + 2])));
+                i += 2;
+            }
+            else {
+                result.push_back(value[i]);
+            }
+        }
+        return result;
+    }
+}
+
+Endpoint::Endpoint(const std::string& url)
+{
+    const auto schemeEnd = url.find("://");
+    if (schemeEnd == std::string::npos) {
+        // libcurl guesses the scheme
+        m_url = url;
+        m_key = url.substr(0, url.find('/'));
+        toLower(m_key);
+        return;
+    }
+    std::string scheme = url.substr(0, schemeEnd);
+    toLower(scheme);
+    const auto authorityStart = schemeEnd + 3;
+    auto authorityEnd = url.find_first_of("/?#", authorityStart);
+    if (authorityEnd == std::string::npos)
+        authorityEnd = url.size();
+
+    const std::string unixSuffix = "+unix";
+    if (scheme.size() > unixSuffix.size() &&
+        scheme.compare(scheme.size() - unixSuffix.size(), unixSuffix.size(), unixSuffix) == 0)
+    {
+        m_unixSocket = percentDecode(url.substr(authorityStart, authorityEnd - authorityStart));
+        if (m_unixSocket.empty())
+            throw std::runtime_error("The socket path is missing in the URL " + url + ".");
+        if (m_unixSocket[0] == '@') {
+            m_abstractSocket = true;
+            m_unixSocket.erase(0, 1);
+        }
+        scheme.erase(scheme.size() - unixSuffix.size());
+        // the host is used only for the Host header and TLS
+        m_url = scheme + "://localhost" + url.substr(authorityEnd);
+        m_key = scheme + "://" + (m_abstractSocket ? "@" : "") + m_unixSocket;
+        return;
+    }
+
+    m_url = url;
+    // user info is not a part of the key, connections do not depend on it
+    std::string authority = url.substr(authorityStart, authorityEnd - authorityStart);
+    const auto atPos = authority.rfind('@');
+    if (atPos != std::string::npos)
+        authority.erase(0, atPos + 1);
+    toLower(authority);
+    m_key = scheme + "://" + authority;
+}
+
+void Endpoint::apply(CURL* curl) const
+{
+    curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+    if (m_unixSocket.empty())
+        return;
+#if CURL_AT_LEAST_VERSION(7,53,0)
+    if (m_abstractSocket) {
+        curl_easy_setopt(curl, CURLOPT_ABSTRACT_UNIX_SOCKET, m_unixSocket.c_str());
+        return;
+    }
+#endif
+#if CURL_AT_LEAST_VERSION(7,40,0)
+    curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, m_unixSocket.c_str());
+#endif
+}
+
+
+CurlHandlePool& CurlHandlePool::instance()
+{
+    static CurlHandlePool* const pool = new CurlHandlePool();
+    return *pool;
+}
+
+CurlHandlePool::CurlHandlePool()
+{
+}
+
+void CurlHandlePool::cleanup(const IdleHandle& handle)
+{
+    // the connections of the multi handle are closed first
+    if (handle.multi)
+        curl_multi_cleanup(handle.multi);
+    curl_easy_cleanup(handle.curl);
+}
+
+void CurlHandlePool::configure(size_t maxIdleHandles, std::chrono::seconds idleTimeout)
+{
+    std::deque<IdleHandle> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_maxIdleHandles = maxIdleHandles;
+        m_idleTimeout = idleTimeout;
+        while (m_idleHandles.size() > m_maxIdleHandles) {
+            removed.push_back(m_idleHandles.front());
+            m_idleHandles.pop_front();
+        }
+    }
+    for (const auto& handle : removed)
+        cleanup(handle);
+}
+
+CURL* CurlHandlePool::acquire(const std::string& key, CURLM*& multi)
+{
+    CURL* curl = nullptr;
+    multi = nullptr;
+    std::deque<IdleHandle> expired;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        removeExpired(expired);
+        // the most recently used handle has the best chance of a live connection
+        for (auto it = m_idleHandles.rbegin(); it != m_idleHandles.rend(); ++it) {
+            if (it->key == key) {
+                curl = it->curl;
+                multi = it->multi;
+                m_idleHandles.erase(std::next(it).base());
+                break;
+            }
+        }
+    }
+    // connections are closed outside the lock
+    for (const auto& handle : expired)
+        cleanup(handle);
+
+    if (curl) {
+        ++m_reuseCount;
+        return curl;
+    }
+    curl = Runtime::instance().createHandle();
+    if (curl)
+        ++m_createCount;
+    return curl;
+}
+
+void CurlHandlePool::release(const std::string& key, CURL* curl, CURLM* multi)
+{
+    // live connections, TLS sessions and the DNS cache survive the reset
+    curl_easy_reset(curl);
+    Runtime::setDefaults(curl);
+
+    std::deque<IdleHandle> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_maxIdleHandles > 0) {
+            m_idleHandles.push_back({ key, curl, multi, std::chrono::steady_clock::now() });
+            curl = nullptr;
+        }
+        removeExpired(removed);
+        while (m_idleHandles.size() > m_maxIdleHandles) {
+            removed.push_back(m_idleHandles.front());
+            m_idleHandles.pop_front();
+        }
+    }
+    if (curl)
+        cleanup({ key, curl, multi, std::chrono::steady_clock::time_point() });
+    for (const auto& handle : removed)
+        cleanup(handle);
+}
+
+void CurlHandlePool::removeExpired(std::deque<IdleHandle>& expired)
+{
+    const auto expireTime = std::chrono::steady_clock::now() - m_idleTimeout;
+    while (!m_idleHandles.empty() && m_idleHandles.front().releaseTime < expireTime) {
+        expired.push_back(m_idleHandles.front());
+        m_idleHandles.pop_front();
+    }
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Runtime.h"
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <curl/curl.h>
+
+constexpr size_t DEFAULT_CONNECTION_POOL_SIZE = 32;
+constexpr std::chrono::seconds DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT{ 60 };
+
+/*
+ * Address of a request. URLs of the http+unix and https+unix schemes address
+ * a server listening on a Unix domain socket, the percent-encoded socket path
+ * takes the place of the host:
+ *
+ *   http+unix://%2Frun%2Focr.sock/api/v1/recognize
+ *
+ * A socket name starting with @ is an abstract socket (Linux).
+ */
+class Endpoint final
+{
+public:
+    explicit Endpoint(const std::string& url);
+
+    // URL passed to libcurl
+    const std::string& getUrl() const
+    {
+        return m_url;
+    }
+
+    const std::string& getUnixSocket() const
+    {
+        return m_unixSocket;
+    }
+
+    // Connections to endpoints with the same key may be reused.
+    const std::string& getKey() const
+    {
+        return m_key;
+    }
+
+    // Sets the URL and the socket to the handle.
+    void apply(CURL* curl) const;
+
+private:
+    std::string m_url;
+    std::string m_unixSocket;
+    bool m_abstractSocket = false;
+    std::string m_key;
+};
+
+/*
+ * Easy handles of finished requests together with their open connections.
+ * A request to an endpoint takes a handle that was last used for the same endpoint,
+ * so its connection, TLS session and DNS cache are reused.
+ * Handles are reset before they are returned, no options of a request are kept.
+ * A handle may have a multi handle, connections of transfers run in it are kept there.
+ */
+class CurlHandlePool final
+{
+public:
+    static CurlHandlePool& instance();
+
+    // A size of 0 disables the pool.
+    void configure(size_t maxIdleHandles, std::chrono::seconds idleTimeout);
+
+    // Returns nullptr if a handle can not be created. The multi handle kept with the handle is returned in multi.
+    CURL* acquire(const std::string& key, CURLM*& multi);
+    // The handle must not be in the multi handle.
+    void release(const std::string& key, CURL* curl, CURLM* multi);
+
+    // number of handles created and taken from the pool
+    uint64_t getCreateCount() const
+    {
+        return m_createCount;
+    }
+
+    uint64_t getReuseCount() const
+    {
+        return m_reuseCount;
+    }
+
+private:
+    struct IdleHandle
+    {
+        std::string key;
+        CURL* curl;
+        CURLM* multi;
+        std::chrono::steady_clock::time_point releaseTime;
+    };
+
+    CurlHandlePool();
+
+    static void cleanup(const IdleHandle& handle);
+
+    // Removes the handles idle for too long, the caller holds the mutex.
+    void removeExpired(std::deque<IdleHandle>& expired);
+
+    std::mutex m_mutex;
+    std::deque<IdleHandle> m_idleHandles;   // the most recently released are at the back
+    size_t m_maxIdleHandles = DEFAULT_CONNECTION_POOL_SIZE;
+    std::chrono::seconds m_idleTimeout = DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT;
+    std::atomic<uint64_t> m_createCount{ 0 };
+    std::atomic<uint64_t> m_reuseCount{ 0 };
+};
+
+// Handle taken from the pool for one request and returned when the request finishes.
+class PooledCurl final
+{
+public:
+    PooledCurl(CurlHandlePool& pool, const std::string& key)
+        : m_pool(pool)
+        , m_key(key)
+        , m_curl(pool.acquire(key, m_multi))
+    {
+    }
+
+    ~PooledCurl()
+    {
+        if (!m_curl)
+            return;
+        if (m_discard) {
+            if (m_multi)
+                curl_multi_cleanup(m_multi);
+            curl_easy_cleanup(m_curl);
+        }
+        else {
+            m_pool.release(m_key, m_curl, m_multi);
+        }
+    }
+
+    PooledCurl(const PooledCurl&) = delete;
+    PooledCurl& operator=(const PooledCurl&) = delete;
+
+    operator CURL*() const
+    {
+        return m_curl;
+    }
+
+    // Multi handle that stays with the handle in the pool, created on first use.
+    // Returns nullptr if it can not be created.
+    CURLM* getMulti()
+    {
+        if (!m_multi)
+            m_multi = Runtime::instance().createMulti();
+        return m_multi;
+    }
+
+    // The handle is not returned to the pool, for example because its DNS cache
+    // holds addresses given by the request.
+    void discard()
+    {
+        m_discard = true;
+    }
+
+private:
+    CurlHandlePool& m_pool;
+    std::string m_key;
+    CURLM* m_multi = nullptr;
+    CURL* m_curl;
+    bool m_discard = false;
+};
+
+#endif // CONNECTION_POOL_H
@@ -0,0 +1,307 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			DnsResolver.cpp
+ *	DESCRIPTION:	Pre-resolution and pinning of host addresses.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "DnsResolver.h"
+#include "StringUtils.h"
+#include "CurlCompat.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#endif
+
+namespace
+{
+    std::vector<std::string> splitEntries(const std::string& entries)
+    {
+        std::vector<std::string> result;
+        size_t offset = 0;
+        while (offset <= entries.size()) {
+            auto pos = entries.find(';', offset);
+            if (pos == std::string::npos)
+                pos = entries.size();
+            std::string entry = entries.substr(offset, pos - offset);
+            trim(entry);
+            if (!entry.empty())
+                result.push_back(entry);
+            offset = pos + 1;
+        }
+        return result;
+    }
+
+    // Resolves the host with the system resolver. Returns the addresses separated by commas
+    // in the form accepted by CURLOPT_RESOLVE, or an empty string if the host is not resolved.
+    std::string resolveHost(const std::string& host, const std::string& port, long ipResolve)
+    {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_socktype = SOCK_STREAM;
+        switch (ipResolve) {
+        case CURL_IPRESOLVE_V4:
+            hints.ai_family = AF_INET;
+            break;
+        case CURL_IPRESOLVE_V6:
+            hints.ai_family = AF_INET6;
+            break;
+        default:
+            hints.ai_family = AF_UNSPEC;
+        }
+
+        struct addrinfo* info = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &info) != 0)
+            return std::string();
+
+        std::vector<std::string> addresses;
+        for (auto ai = info; ai; ai = ai->ai_next) {
+            char address[NI_MAXHOST];
+            if (getnameinfo(ai->ai_addr, static_cast<socklen_t>(ai->ai_addrlen), address, sizeof(address),
+                nullptr, 0, NI_NUMERICHOST) != 0)
+            {
+                continue;
+            }
+            std::string value = (ai->ai_family == AF_INET6) ? "[" + std::string(address) + "]" : std::string(address);
+            if (std::find(addresses.begin(), addresses.end(), value) == addresses.end())
+                addresses.push_back(value);
+        }
+        freeaddrinfo(info);
+
+        // the order of the system resolver is kept, libcurl uses it for Happy Eyeballs
+        std::string result;
+        for (const auto& address : addresses) {
+            if (!result.empty())
+                result.push_back(',');
+            result += address;
+        }
+        return result;
+    }
+
+    curl_slist* makeSlist(const std::vector<std::string>& entries)
+    {
+        curl_slist* list = nullptr;
+        for (const auto& entry : entries) {
+            curl_slist* newList = curl_slist_append(list, entry.c_str());
+            if (!newList) {
+                curl_slist_free_all(list);
+                throw std::runtime_error("Can't allocate the list of DNS entries.");
+            }
+            list = newList;
+        }
+        return list;
+    }
+}
+
+long getIpResolve(const std::string& value)
+{
+    std::string sValue(value);
+    trim(sValue);
+    toUpper(sValue);
+    if (sValue == "WHATEVER" || sValue == "ANY" || sValue == "0")
+        return CURL_IPRESOLVE_WHATEVER;
+    if (sValue == "V4" || sValue == "IPV4" || sValue == "1")
+        return CURL_IPRESOLVE_V4;
+    if (sValue == "V6" || sValue == "IPV6" || sValue == "2")
+        return CURL_IPRESOLVE_V6;
+    throw std::invalid_argument("Invalid IP resolve mode " + value + ". Expected WHATEVER, V4 or V6.");
+}
+
+
+DnsLists::~DnsLists()
+{
+    curl_slist_free_all(m_resolve);
+    curl_slist_free_all(m_connectTo);
+}
+
+void DnsLists::apply(CURL* curl) const
+{
+    if (m_resolve)
+        curl_easy_setopt(curl, CURLOPT_RESOLVE, m_resolve);
+#if CURL_AT_LEAST_VERSION(7,49,0)
+    if (m_connectTo)
+        curl_easy_setopt(curl, CURLOPT_CONNECT_TO, m_connectTo);
+#endif
+    if (m_ipResolve >= 0)
+        curl_easy_setopt(curl, CURLOPT_IPRESOLVE, m_ipResolve);
+#if CURL_AT_LEAST_VERSION(7,59,0)
+    if (m_happyEyeballsTimeout >= 0)
+        curl_easy_setopt(curl, CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS, m_happyEyeballsTimeout);
+#endif
+}
+
+
+DnsResolver& DnsResolver::instance()
+{
+    static DnsResolver* const resolver = new DnsResolver();
+    return *resolver;
+}
+
+DnsResolver::DnsResolver()
+{
+}
+
+void DnsResolver::requestStop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+}
+
+void DnsResolver::join()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void DnsResolver::start(const UdrConfig& config)
+{
+    m_pins = config.getValues("DnsPin");
+    m_connectTo = config.getValues("DnsConnectTo");
+    if (config.hasValue("IpResolve"))
+        m_ipResolve = getIpResolve(config.getString("IpResolve"));
+    if (config.hasValue("HappyEyeballsTimeout"))
+        m_happyEyeballsTimeout = static_cast<long>(config.getInteger("HappyEyeballsTimeout", 200));
+    m_refreshInterval = std::chrono::seconds(std::max<long long>(config.getInteger("DnsRefreshInterval", 60), 1));
+
+    // host[:port], without a port the host is resolved for HTTP and HTTPS
+    for (const auto& value : config.getValues("DnsPreresolve")) {
+        std::string host(value);
+        trim(host);
+        if (host.empty())
+            continue;
+        const auto colonPos = host.rfind(':');
+        if (colonPos != std::string::npos) {
+            m_hosts.push_back({ host.substr(0, colonPos), host.substr(colonPos + 1), "" });
+        }
+        else {
+            m_hosts.push_back({ host, "80", "" });
+            m_hosts.push_back({ host, "443", "" });
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_resolveEntries = m_pins;
+        m_lists = makeLists(m_resolveEntries, m_connectTo, m_ipResolve, m_happyEyeballsTimeout);
+    }
+
+    if (!m_hosts.empty()) {
+        m_thread = std::thread(&DnsResolver::run, this);
+        Runtime::instance().addService(*this);
+    }
+}
+
+std::shared_ptr<const DnsLists> DnsResolver::getLists(const std::string& resolve, const std::string& connectTo,
+    bool useIpResolve, bool useHappyEyeballsTimeout) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // the usual case, the prepared lists of the library are shared
+    if (resolve.empty() && connectTo.empty() && useIpResolve && useHappyEyeballsTimeout)
+        return m_lists;
+
+    // libcurl replaces an address with the one of a later entry for the same host and port
+    std::vector<std::string> resolveEntries(m_resolveEntries);
+    lock.unlock();
+    for (auto& entry : splitEntries(resolve))
+        resolveEntries.push_back(std::move(entry));
+    std::vector<std::string> connectToEntries = splitEntries(connectTo);
+    connectToEntries.insert(connectToEntries.end(), m_connectTo.cbegin(), m_connectTo.cend());
+
+    return makeLists(resolveEntries, connectToEntries,
+        useIpResolve ? m_ipResolve : -1, useHappyEyeballsTimeout ? m_happyEyeballsTimeout : -1);
+}
+
+std::shared_ptr<const DnsLists> DnsResolver::makeLists(const std::vector<std::string>& resolve,
+    const std::vector<std::string>& connectTo, long ipResolve, long happyEyeballsTimeout) const
+{
+    if (resolve.empty() && connectTo.empty() && ipResolve < 0 && happyEyeballsTimeout < 0)
+        return nullptr;
+
+    std::shared_ptr<DnsLists> lists(new DnsLists());
+    lists->m_resolve = makeSlist(resolve);
+    // for CURLOPT_CONNECT_TO the first matching entry is used
+    lists->m_connectTo = makeSlist(connectTo);
+    lists->m_ipResolve = ipResolve;
+    lists->m_happyEyeballsTimeout = happyEyeballsTimeout;
+    return lists;
+}
+
+void DnsResolver::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        lock.unlock();
+        refresh();
+        lock.lock();
+        m_wakeUp.wait_for(lock, m_refreshInterval, [this]() { return m_stop; });
+    }
+}
+
+void DnsResolver::refresh()
+{
+    // the hosts are changed by this thread only
+    for (auto& host : m_hosts) {
+        ++m_resolveCount;
+        std::string addresses = resolveHost(host.name, host.port, m_ipResolve);
+        if (addresses.empty()) {
+            // the previous addresses remain in use until the resolver answers again
+            ++m_failureCount;
+            continue;
+        }
+        host.addresses = std::move(addresses);
+    }
+
+    std::vector<std::string> entries;
+    for (const auto& host : m_hosts) {
+        if (!host.addresses.empty())
+            entries.push_back(host.name + ":" + host.port + ":" + host.addresses);
+    }
+    // pinned addresses win over the resolved ones
+    entries.insert(entries.end(), m_pins.cbegin(), m_pins.cend());
+
+    std::shared_ptr<const DnsLists> lists;
+    try {
+        lists = makeLists(entries, m_connectTo, m_ipResolve, m_happyEyeballsTimeout);
+    }
+    catch (const std::runtime_error&) {
+        // out of memory, the current lists are kept
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_resolveEntries = std::move(entries);
+    m_lists = std::move(lists);
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Runtime.h"
+#include "UdrConfig.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <curl/curl.h>
+
+// Converts WHATEVER, V4 or V6 to the value of the CURLOPT_IPRESOLVE option.
+long getIpResolve(const std::string& value);
+
+/*
+ * Address lists set to the handles. libcurl reads them when a transfer starts,
+ * so the object must live until then. It is immutable and may be shared
+ * by the handles of several transfers.
+ */
+class DnsLists final
+{
+public:
+    DnsLists() = default;
+    ~DnsLists();
+
+    DnsLists(const DnsLists&) = delete;
+    DnsLists& operator=(const DnsLists&) = delete;
+
+    void apply(CURL* curl) const;
+
+private:
+    friend class DnsResolver;
+
+    curl_slist* m_resolve = nullptr;
+    curl_slist* m_connectTo = nullptr;
+    long m_ipResolve = -1;
+    long m_happyEyeballsTimeout = -1;
+};
+
+/*
+ * DNS layer of the library. The addresses of the hosts listed in the configuration
+ * are resolved in a background thread and refreshed before they become stale,
+ * so requests to these hosts do not wait for the system resolver.
+ * Addresses pinned in the configuration are never resolved.
+ */
+class DnsResolver final : public RuntimeService
+{
+public:
+    static DnsResolver& instance();
+
+    // Reads the settings and starts the pre-resolution of the hosts. Called once.
+    void start(const UdrConfig& config);
+
+    void requestStop() override;
+    void join() override;
+
+    // Lists of the library supplemented with the entries of a request separated by ';'.
+    // The request entries take precedence. Returns nullptr if there is nothing to set.
+    std::shared_ptr<const DnsLists> getLists(const std::string& resolve, const std::string& connectTo,
+        bool useIpResolve, bool useHappyEyeballsTimeout) const;
+
+    // number of resolutions performed in the background and of the failed ones
+    uint64_t getResolveCount() const
+    {
+        return m_resolveCount;
+    }
+
+    uint64_t getFailureCount() const
+    {
+        return m_failureCount;
+    }
+
+private:
+    struct Host
+    {
+        std::string name;
+        std::string port;
+        std::string addresses;   // the last resolved addresses separated by commas
+    };
+
+    DnsResolver();
+
+    void run();
+    void refresh();
+    std::shared_ptr<const DnsLists> makeLists(const std::vector<std::string>& resolve,
+        const std::vector<std::string>& connectTo, long ipResolve, long happyEyeballsTimeout) const;
+
+    std::vector<std::string> m_pins;
+    std::vector<std::string> m_connectTo;
+    std::vector<Host> m_hosts;
+    long m_ipResolve = -1;
+    long m_happyEyeballsTimeout = -1;
+    std::chrono::seconds m_refreshInterval{ 60 };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stop = false;
+    std::thread m_thread;
+    // entries of CURLOPT_RESOLVE known to the library, pinned and resolved
+    std::vector<std::string> m_resolveEntries;
+    std::shared_ptr<const DnsLists> m_lists;
+
+    std::atomic<uint64_t> m_resolveCount{ 0 };
+    std::atomic<uint64_t> m_failureCount{ 0 };
+};
+
+#endif // DNS_RESOLVER_H
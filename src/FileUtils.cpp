@@ -0,0 +1,820 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			FileUtils.cpp
+ *	DESCRIPTION:	Access to server-side files.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "FileUtils.h"
+#include "StringUtils.h"
+#include "UdrConfig.h"
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    std::string systemErrorMessage(const std::string& message, const std::string& fileName)
+    {
+#ifdef _WIN32
+        const DWORD errorCode = GetLastError();
+        return message + " \"" + fileName + "\". System error " + std::to_string(errorCode) + ".";
+#else
+        const int errorCode = errno;
+        return message + " \"" + fileName + "\". " + strerror(errorCode) + ".";
+#endif
+    }
+
+    size_t findLastSeparator(const std::string& fileName)
+    {
+#ifdef _WIN32
+        return fileName.find_last_of("\\/");
+#else
+        return fileName.rfind('/');
+#endif
+    }
+
+    bool isSameOrSubdirectory(const std::string& fileName, const std::string& directory)
+    {
+        if (fileName.size() <= directory.size())
+            return false;
+#ifdef _WIN32
+        // file names are case insensitive on Windows
+        if (_strnicmp(fileName.c_str(), directory.c_str(), directory.size()) != 0)
+            return false;
+#else
+        if (fileName.compare(0, directory.size(), directory) != 0)
+            return false;
+#endif
+        return directory.back() == PATH_SEPARATOR || fileName[directory.size()] == PATH_SEPARATOR;
+    }
+
+    std::string getCanonicalDirectory(const std::string& directory)
+    {
+#ifdef _WIN32
+        char buffer[MAX_PATH];
+        if (!_fullpath(buffer, directory.c_str(), MAX_PATH))
+            throw std::runtime_error(systemErrorMessage("Invalid directory", directory));
+        if (GetFileAttributesA(buffer) == INVALID_FILE_ATTRIBUTES)
+            throw std::runtime_error(systemErrorMessage("Cannot access directory", directory));
+        return std::string(buffer);
+#else
+        char buffer[PATH_MAX];
+        if (!realpath(directory.c_str(), buffer))
+            throw std::runtime_error(systemErrorMessage("Cannot access directory", directory));
+        return std::string(buffer);
+#endif
+    }
+
+    void syncDirectory(const std::string& fileName)
+    {
+#ifndef _WIN32
+        // make the new directory entry durable
+        const size_t sepPos = findLastSeparator(fileName);
+        const std::string directory = (sepPos == std::string::npos) ? "." : fileName.substr(0, sepPos + 1);
+        int dirFd = open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            ::close(dirFd);
+        }
+#endif
+    }
+
+    // Renames the temporary file to the target name. The temporary file is removed on failure.
+    void replaceFile(const std::string& tempFileName, const std::string& fileName, bool overwrite, bool sync)
+    {
+#ifdef _WIN32
+        DWORD flags = MOVEFILE_WRITE_THROUGH;
+        if (overwrite)
+            flags |= MOVEFILE_REPLACE_EXISTING;
+        if (!MoveFileExA(tempFileName.c_str(), fileName.c_str(), flags)) {
+            const std::string message = systemErrorMessage("Cannot rename file", tempFileName);
+            removeFile(tempFileName);
+            throw std::runtime_error(message);
+        }
+#else
+        int rc;
+        if (overwrite) {
+            rc = rename(tempFileName.c_str(), fileName.c_str());
+        }
+        else {
+            // link() fails if the target exists, so an existing file is never replaced
+            rc = link(tempFileName.c_str(), fileName.c_str());
+            if (rc != 0 && errno != EEXIST) {
+                // the file system does not support hard links
+                rc = fileExists(fileName) ? -1 : rename(tempFileName.c_str(), fileName.c_str());
+            }
+        }
+        if (rc != 0) {
+            std::string message = systemErrorMessage("Cannot rename file", tempFileName);
+            if (!overwrite && fileExists(fileName))
+                message = "File \"" + fileName + "\" already exists.";
+            removeFile(tempFileName);
+            throw std::runtime_error(message);
+        }
+        removeFile(tempFileName);
+
+        if (sync) {
+            syncDirectory(fileName);
+        }
+#endif
+    }
+
+    std::string makeTempFileName(const std::string& fileName)
+    {
+        static std::atomic<unsigned int> counter{ 0 };
+#ifdef _WIN32
+        const auto pid = _getpid();
+#else
+        const auto pid = getpid();
+#endif
+        const auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+        return fileName + "." + std::to_string(pid) + "_" + std::to_string(++counter) +
+            "_" + std::to_string(ticks % 1000000) + ".part";
+    }
+}
+
+void FileAccessPolicy::parse(const std::string& value)
+{
+    m_directories.clear();
+
+    std::string sValue(value);
+    trim(sValue);
+    std::string mode = sValue.substr(0, sValue.find_first_of(" \t"));
+    toUpper(mode);
+
+    if (mode.empty() || mode == "NONE") {
+        m_mode = Mode::None;
+        return;
+    }
+    if (mode == "FULL") {
+        m_mode = Mode::Full;
+        return;
+    }
+    if (mode != "RESTRICT") {
+        throw std::runtime_error("Invalid value of the FileAccess parameter: " + value);
+    }
+    m_mode = Mode::Restrict;
+
+    std::string directories = sValue.substr(mode.size());
+    size_t offset = 0;
+    while (offset <= directories.size()) {
+        size_t pos = directories.find(';', offset);
+        if (pos == std::string::npos)
+            pos = directories.size();
+        std::string directory = directories.substr(offset, pos - offset);
+        trim(directory);
+        if (!directory.empty()) {
+            // Directories that do not exist yet are kept as is,
+            // they will simply never match a canonical file name.
+            try {
+                directory = getCanonicalDirectory(directory);
+            }
+            catch (const std::runtime_error&) {
+            }
+            m_directories.push_back(directory);
+        }
+        offset = pos + 1;
+    }
+}
+
+std::string FileAccessPolicy::checkAccess(const std::string& fileName) const
+{
+    if (m_mode == Mode::None) {
+        throw std::runtime_error("Access to server files is disabled. Set the FileAccess parameter in " +
+            std::string(UDR_CONFIG_FILE_NAME) + ".");
+    }
+    const std::string canonicalName = getCanonicalFileName(fileName);
+    if (m_mode == Mode::Full)
+        return canonicalName;
+
+    for (const auto& directory : m_directories) {
+        if (isSameOrSubdirectory(canonicalName, directory))
+            return canonicalName;
+    }
+    throw std::runtime_error("Access to the file \"" + fileName + "\" is not allowed by the FileAccess parameter.");
+}
+
+std::string getCanonicalFileName(const std::string& fileName)
+{
+    const size_t sepPos = findLastSeparator(fileName);
+    const std::string directory = (sepPos == std::string::npos) ? "." : fileName.substr(0, sepPos + 1);
+    const std::string name = (sepPos == std::string::npos) ? fileName : fileName.substr(sepPos + 1);
+
+    if (name.empty() || name == "." || name == "..")
+        throw std::runtime_error("Invalid file name \"" + fileName + "\".");
+
+    std::string canonicalName = getCanonicalDirectory(directory);
+    if (canonicalName.back() != PATH_SEPARATOR)
+        canonicalName += PATH_SEPARATOR;
+    canonicalName += name;
+    return canonicalName;
+}
+
+bool fileExists(const std::string& fileName)
+{
+#ifdef _WIN32
+    return GetFileAttributesA(fileName.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+    struct stat st;
+    return stat(fileName.c_str(), &st) == 0;
+#endif
+}
+
+bool getFileStamp(const std::string& fileName, FileStamp& stamp)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(fileName.c_str(), GetFileExInfoStandard, &data))
+        return false;
+    stamp.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    stamp.modified = static_cast<int64_t>((static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+        data.ftLastWriteTime.dwLowDateTime);
+#else
+    struct stat st;
+    if (stat(fileName.c_str(), &st) != 0)
+        return false;
+    stamp.size = static_cast<uint64_t>(st.st_size);
+#ifdef __linux__
+    stamp.modified = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    stamp.modified = static_cast<int64_t>(st.st_mtime);
+#endif
+#endif
+    return true;
+}
+
+void removeFile(const std::string& fileName)
+{
+#ifdef _WIN32
+    DeleteFileA(fileName.c_str());
+#else
+    unlink(fileName.c_str());
+#endif
+}
+
+FileSyncMode getFileSyncMode(const std::string& value)
+{
+    std::string sValue(value);
+    trim(sValue);
+    toUpper(sValue);
+    if (sValue == "NONE")
+        return FileSyncMode::None;
+    if (sValue == "CLOSE")
+        return FileSyncMode::Close;
+    if (sValue == "INTERVAL")
+        return FileSyncMode::Interval;
+    throw std::runtime_error("Invalid sync mode " + value + ". Possible values are NONE, CLOSE, INTERVAL.");
+}
+
+
+AtomicFileWriter::AtomicFileWriter(const std::string& fileName, FileSyncMode syncMode, bool overwrite)
+    : m_fileName(fileName)
+    , m_tempFileName(makeTempFileName(fileName))
+    , m_syncMode(syncMode)
+    , m_overwrite(overwrite)
+{
+    if (!m_overwrite && fileExists(m_fileName))
+        throw std::runtime_error("File \"" + m_fileName + "\" already exists.");
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(m_tempFileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(systemErrorMessage("Cannot create file", m_tempFileName));
+    m_handle = handle;
+#else
+    m_fd = open(m_tempFileName.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+    if (m_fd < 0)
+        throw std::runtime_error(systemErrorMessage("Cannot create file", m_tempFileName));
+#endif
+}
+
+AtomicFileWriter::~AtomicFileWriter()
+{
+#ifdef _WIN32
+    const bool opened = m_handle != nullptr;
+#else
+    const bool opened = m_fd >= 0;
+#endif
+    if (opened) {
+        close();
+        removeFile(m_tempFileName);
+    }
+}
+
+void AtomicFileWriter::write(const void* data, size_t length)
+{
+    auto p = static_cast<const char*>(data);
+    while (length > 0) {
+#ifdef _WIN32
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 0x40000000));
+        DWORD written = 0;
+        if (!WriteFile(static_cast<HANDLE>(m_handle), p, chunk, &written, nullptr))
+            throw std::runtime_error(systemErrorMessage("Cannot write file", m_tempFileName));
+#else
+        const ssize_t written = ::write(m_fd, p, length);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(systemErrorMessage("Cannot write file", m_tempFileName));
+        }
+#endif
+        p += written;
+        length -= static_cast<size_t>(written);
+        m_size += static_cast<uint64_t>(written);
+    }
+
+    if (m_syncMode == FileSyncMode::Interval && m_size - m_syncedSize >= FILE_SYNC_INTERVAL) {
+        sync();
+    }
+}
+
+void AtomicFileWriter::sync()
+{
+#ifdef _WIN32
+    if (!FlushFileBuffers(static_cast<HANDLE>(m_handle)))
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_tempFileName));
+#elif defined(__linux__)
+    if (fdatasync(m_fd) != 0)
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_tempFileName));
+#else
+    if (fsync(m_fd) != 0)
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_tempFileName));
+#endif
+    m_syncedSize = m_size;
+}
+
+void AtomicFileWriter::close()
+{
+#ifdef _WIN32
+    if (m_handle) {
+        CloseHandle(static_cast<HANDLE>(m_handle));
+        m_handle = nullptr;
+    }
+#else
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+void AtomicFileWriter::commit()
+{
+    if (m_syncMode != FileSyncMode::None) {
+        sync();
+    }
+    close();
+
+    replaceFile(m_tempFileName, m_fileName, m_overwrite, m_syncMode != FileSyncMode::None);
+}
+
+FileReader::FileReader(const std::string& fileName)
+    : m_fileName(fileName)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(m_fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+    m_handle = handle;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        const std::string message = systemErrorMessage("Cannot get size of file", m_fileName);
+        CloseHandle(handle);
+        m_handle = nullptr;
+        throw std::runtime_error(message);
+    }
+    m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+    // The directory of the file is checked by FileAccessPolicy,
+    // so the file itself must not be a symlink leading elsewhere.
+    m_fd = open(m_fileName.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (m_fd < 0)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        const std::string message = systemErrorMessage("Cannot read file", m_fileName);
+        ::close(m_fd);
+        m_fd = -1;
+        throw std::runtime_error(message);
+    }
+    m_size = static_cast<uint64_t>(st.st_size);
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+}
+
+FileReader::~FileReader()
+{
+#ifdef _WIN32
+    if (m_handle)
+        CloseHandle(static_cast<HANDLE>(m_handle));
+#else
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+}
+
+size_t FileReader::read(void* buffer, size_t length)
+{
+    if (m_position >= m_size)
+        return 0;
+    length = static_cast<size_t>(std::min<uint64_t>(length, m_size - m_position));
+#ifdef _WIN32
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(m_position);
+    overlapped.OffsetHigh = static_cast<DWORD>(m_position >> 32);
+    DWORD bytesRead = 0;
+    if (!ReadFile(static_cast<HANDLE>(m_handle), buffer, static_cast<DWORD>(length), &bytesRead, &overlapped))
+        throw std::runtime_error(systemErrorMessage("Cannot read file", m_fileName));
+#else
+    ssize_t bytesRead;
+    do {
+        bytesRead = pread(m_fd, buffer, length, static_cast<off_t>(m_position));
+    } while (bytesRead < 0 && errno == EINTR);
+    if (bytesRead < 0)
+        throw std::runtime_error(systemErrorMessage("Cannot read file", m_fileName));
+#endif
+    if (bytesRead == 0) {
+        // the file was truncated while it was being sent
+        throw std::runtime_error("Unexpected end of file \"" + m_fileName + "\".");
+    }
+    m_position += static_cast<uint64_t>(bytesRead);
+    return static_cast<size_t>(bytesRead);
+}
+
+void FileReader::seek(uint64_t offset)
+{
+    if (offset > m_size)
+        throw std::runtime_error("Invalid position in file \"" + m_fileName + "\".");
+    m_position = offset;
+}
+
+
+FileAppender::FileAppender(const std::string& fileName)
+    : m_fileName(fileName)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(m_fileName.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+    m_handle = handle;
+#else
+    m_fd = open(m_fileName.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC | O_NOFOLLOW);
+    if (m_fd < 0)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+#endif
+}
+
+FileAppender::~FileAppender()
+{
+#ifdef _WIN32
+    if (m_handle)
+        CloseHandle(static_cast<HANDLE>(m_handle));
+#else
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+}
+
+void FileAppender::append(const std::string& data)
+{
+    const char* p = data.data();
+    size_t length = data.size();
+    while (length > 0) {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(static_cast<HANDLE>(m_handle), p, static_cast<DWORD>(length), &written, nullptr))
+            throw std::runtime_error(systemErrorMessage("Cannot write file", m_fileName));
+#else
+        const ssize_t written = ::write(m_fd, p, length);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(systemErrorMessage("Cannot write file", m_fileName));
+        }
+#endif
+        p += written;
+        length -= static_cast<size_t>(written);
+    }
+}
+
+PartialFile::PartialFile(const std::string& fileName, bool overwrite)
+    : m_fileName(fileName)
+    , m_partFileName(fileName + ".part")
+    , m_overwrite(overwrite)
+{
+    if (!m_overwrite && fileExists(m_fileName))
+        throw std::runtime_error("File \"" + m_fileName + "\" already exists.");
+#ifdef _WIN32
+    // the file is not shared, so a concurrent download of the same file fails here
+    HANDLE handle = CreateFileA(m_partFileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_partFileName));
+    m_handle = handle;
+#else
+    m_fd = open(m_partFileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0640);
+    if (m_fd < 0)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_partFileName));
+    if (flock(m_fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(m_fd);
+        m_fd = -1;
+        throw std::runtime_error("File \"" + m_partFileName + "\" is being written by another process.");
+    }
+#endif
+}
+
+PartialFile::~PartialFile()
+{
+    close();
+}
+
+void PartialFile::write(uint64_t offset, const void* data, size_t length)
+{
+    auto p = static_cast<const char*>(data);
+    while (length > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 0x40000000));
+        DWORD written = 0;
+        if (!WriteFile(static_cast<HANDLE>(m_handle), p, chunk, &written, &overlapped))
+            throw std::runtime_error(systemErrorMessage("Cannot write file", m_partFileName));
+#else
+        const ssize_t written = pwrite(m_fd, p, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(systemErrorMessage("Cannot write file", m_partFileName));
+        }
+#endif
+        p += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+void PartialFile::truncate()
+{
+#ifdef _WIN32
+    LARGE_INTEGER zero = {};
+    if (!SetFilePointerEx(static_cast<HANDLE>(m_handle), zero, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(static_cast<HANDLE>(m_handle)))
+    {
+        throw std::runtime_error(systemErrorMessage("Cannot truncate file", m_partFileName));
+    }
+#else
+    if (ftruncate(m_fd, 0) != 0)
+        throw std::runtime_error(systemErrorMessage("Cannot truncate file", m_partFileName));
+#endif
+}
+
+void PartialFile::sync()
+{
+#ifdef _WIN32
+    if (!FlushFileBuffers(static_cast<HANDLE>(m_handle)))
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_partFileName));
+#elif defined(__linux__)
+    if (fdatasync(m_fd) != 0)
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_partFileName));
+#else
+    if (fsync(m_fd) != 0)
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_partFileName));
+#endif
+}
+
+void PartialFile::close()
+{
+#ifdef _WIN32
+    if (m_handle) {
+        CloseHandle(static_cast<HANDLE>(m_handle));
+        m_handle = nullptr;
+    }
+#else
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+void PartialFile::commit()
+{
+    sync();
+#ifdef _WIN32
+    // the file cannot be renamed while it is open
+    close();
+    replaceFile(m_partFileName, m_fileName, m_overwrite, true);
+#else
+    // the file is renamed while it is still locked
+    replaceFile(m_partFileName, m_fileName, m_overwrite, true);
+    close();
+#endif
+}
+
+void PartialFile::discard()
+{
+    close();
+    removeFile(m_partFileName);
+}
+
+
+FileLock::FileLock(const std::string& fileName)
+    : m_fileName(fileName)
+{
+#ifdef _WIN32
+    // the file is not shared, so the lock is held until the handle is closed
+    HANDLE handle = CreateFileA(m_fileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        if (GetLastError() == ERROR_SHARING_VIOLATION)
+            throw std::runtime_error("File \"" + m_fileName + "\" is locked by another process.");
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+    }
+    m_handle = handle;
+#else
+    m_fd = open(m_fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0640);
+    if (m_fd < 0)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+    if (flock(m_fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(m_fd);
+        m_fd = -1;
+        throw std::runtime_error("File \"" + m_fileName + "\" is locked by another process.");
+    }
+#endif
+}
+
+FileLock::~FileLock()
+{
+#ifdef _WIN32
+    if (m_handle)
+        CloseHandle(static_cast<HANDLE>(m_handle));
+#else
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+}
+
+MappedFile::MappedFile(const std::string& fileName, uint64_t size)
+    : m_fileName(fileName)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(m_fileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+    m_handle = handle;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize)) {
+        const std::string message = systemErrorMessage("Cannot get size of file", m_fileName);
+        close();
+        throw std::runtime_error(message);
+    }
+    // the mapping extends the file, the new part is zeroed and allocated
+    m_size = std::max<uint64_t>(size, static_cast<uint64_t>(fileSize.QuadPart));
+    m_mapping = CreateFileMappingA(handle, nullptr, PAGE_READWRITE, static_cast<DWORD>(m_size >> 32),
+        static_cast<DWORD>(m_size), nullptr);
+    if (!m_mapping) {
+        const std::string message = systemErrorMessage("Cannot map file", m_fileName);
+        close();
+        throw std::runtime_error(message);
+    }
+    m_data = static_cast<char*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(m_size)));
+    if (!m_data) {
+        const std::string message = systemErrorMessage("Cannot map file", m_fileName);
+        close();
+        throw std::runtime_error(message);
+    }
+#else
+    m_fd = open(m_fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0640);
+    if (m_fd < 0)
+        throw std::runtime_error(systemErrorMessage("Cannot open file", m_fileName));
+    struct stat st;
+    if (fstat(m_fd, &st) != 0) {
+        const std::string message = systemErrorMessage("Cannot get size of file", m_fileName);
+        close();
+        throw std::runtime_error(message);
+    }
+    m_size = std::max<uint64_t>(size, static_cast<uint64_t>(st.st_size));
+    if (static_cast<uint64_t>(st.st_size) < m_size) {
+#ifdef __linux__
+        // a write to a hole of a full disk would kill the process with SIGBUS
+        const int result = posix_fallocate(m_fd, 0, static_cast<off_t>(m_size));
+        if (result != 0) {
+            errno = result;
+            const std::string message = systemErrorMessage("Cannot allocate file", m_fileName);
+            close();
+            throw std::runtime_error(message);
+        }
+#else
+        if (ftruncate(m_fd, static_cast<off_t>(m_size)) != 0) {
+            const std::string message = systemErrorMessage("Cannot extend file", m_fileName);
+            close();
+            throw std::runtime_error(message);
+        }
+#endif
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) {
+        const std::string message = systemErrorMessage("Cannot map file", m_fileName);
+        close();
+        throw std::runtime_error(message);
+    }
+    m_data = static_cast<char*>(data);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+void MappedFile::sync(uint64_t offset, uint64_t length)
+{
+    if (length == 0)
+        return;
+#ifdef _WIN32
+    if (!FlushViewOfFile(m_data + offset, static_cast<SIZE_T>(length)) ||
+        !FlushFileBuffers(static_cast<HANDLE>(m_handle)))
+    {
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_fileName));
+    }
+#else
+    // msync takes whole pages
+    const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t start = offset / pageSize * pageSize;
+    if (msync(m_data + start, static_cast<size_t>(offset + length - start), MS_SYNC) != 0)
+        throw std::runtime_error(systemErrorMessage("Cannot flush file", m_fileName));
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping) {
+        CloseHandle(static_cast<HANDLE>(m_mapping));
+        m_mapping = nullptr;
+    }
+    if (m_handle) {
+        CloseHandle(static_cast<HANDLE>(m_handle));
+        m_handle = nullptr;
+    }
+#else
+    if (m_data) {
+        munmap(m_data, static_cast<size_t>(m_size));
+        m_data = nullptr;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
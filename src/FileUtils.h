@@ -0,0 +1,315 @@
+#pragma once
+
+#ifndef FILE_UTILS_H
+#define FILE_UTILS_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+constexpr char PATH_SEPARATOR = '\\';
+#else
+constexpr char PATH_SEPARATOR = '/';
+#endif
+
+/*
+ * Restricts the server-side files the library may read or write.
+ *
+ * The policy is set by the FileAccess parameter of http_client_udr.conf
+ * and has the same syntax as ExternalFileAccess in firebird.conf:
+ *
+ *   None
+ *   Full
+ *   Restrict <dir>[;<dir>...]
+ */
+class FileAccessPolicy final
+{
+public:
+    enum class Mode {
+        None,
+        Full,
+        Restrict
+    };
+
+    FileAccessPolicy() = default;
+
+    void parse(const std::string& value);
+
+    // Returns the absolute, symlink free name of the file
+    // or throws an exception if the file is outside of the allowed directories.
+    std::string checkAccess(const std::string& fileName) const;
+
+private:
+    Mode m_mode = Mode::None;
+    std::vector<std::string> m_directories;
+};
+
+// Returns the absolute name of the file with all symlinks of its directory resolved.
+// The file itself does not have to exist, but its directory must.
+std::string getCanonicalFileName(const std::string& fileName);
+
+bool fileExists(const std::string& fileName);
+
+// Size and modification time of a file, used to detect that the file has changed.
+struct FileStamp
+{
+    uint64_t size = 0;
+    int64_t modified = 0;
+
+    bool operator==(const FileStamp& other) const
+    {
+        return size == other.size && modified == other.modified;
+    }
+
+    bool operator!=(const FileStamp& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Returns false if the file does not exist or is not accessible.
+bool getFileStamp(const std::string& fileName, FileStamp& stamp);
+
+void removeFile(const std::string& fileName);
+
+enum class FileSyncMode {
+    None,       // leave flushing to the OS
+    Close,      // flush the data to disk before the file is renamed
+    Interval    // additionally flush every FILE_SYNC_INTERVAL bytes
+};
+
+constexpr uint64_t FILE_SYNC_INTERVAL = 16 * 1024 * 1024;
+
+FileSyncMode getFileSyncMode(const std::string& value);
+
+/*
+ * Writes a file under a temporary name in the target directory
+ * and atomically renames it to the target name on commit().
+ * If the writer is destroyed without commit() the temporary file is removed.
+ */
+class AtomicFileWriter final
+{
+public:
+    AtomicFileWriter(const std::string& fileName, FileSyncMode syncMode, bool overwrite);
+    ~AtomicFileWriter();
+
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    void write(const void* data, size_t length);
+    // Flushes the data written so far to disk, commit() then flushes only the rest.
+    void sync();
+    void commit();
+
+    uint64_t getSize() const
+    {
+        return m_size;
+    }
+
+private:
+    void close();
+
+    std::string m_fileName;
+    std::string m_tempFileName;
+    FileSyncMode m_syncMode;
+    bool m_overwrite;
+    uint64_t m_size = 0;
+    uint64_t m_syncedSize = 0;
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+/*
+ * Sequential reader of a file used as a request body.
+ * The data is read directly into the caller's buffer, so the file content
+ * is copied only once, from the OS cache into the transfer buffer.
+ */
+class FileReader final
+{
+public:
+    explicit FileReader(const std::string& fileName);
+    ~FileReader();
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    uint64_t getSize() const
+    {
+        return m_size;
+    }
+
+    // Reads up to length bytes from the current position, returns 0 at the end of the file.
+    size_t read(void* buffer, size_t length);
+
+    // Sets the current position, for example when a request is resent after a redirect.
+    void seek(uint64_t offset);
+
+private:
+    std::string m_fileName;
+    uint64_t m_size = 0;
+    uint64_t m_position = 0;
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+/*
+ * Existing file opened for appending, such as the progress file of a download.
+ * The file is created by AtomicFileWriter, so it is never opened through a symlink.
+ */
+class FileAppender final
+{
+public:
+    explicit FileAppender(const std::string& fileName);
+    ~FileAppender();
+
+    FileAppender(const FileAppender&) = delete;
+    FileAppender& operator=(const FileAppender&) = delete;
+
+    void append(const std::string& data);
+
+private:
+    std::string m_fileName;
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+/*
+ * File written in pieces at arbitrary offsets under the name <fileName>.part.
+ * Unlike AtomicFileWriter the partial file is kept when the object is destroyed,
+ * so an interrupted download can be continued later.
+ * The partial file is locked while it is open.
+ */
+class PartialFile final
+{
+public:
+    PartialFile(const std::string& fileName, bool overwrite);
+    ~PartialFile();
+
+    PartialFile(const PartialFile&) = delete;
+    PartialFile& operator=(const PartialFile&) = delete;
+
+    const std::string& getPartFileName() const
+    {
+        return m_partFileName;
+    }
+
+    void write(uint64_t offset, const void* data, size_t length);
+    void truncate();
+    void sync();
+
+    // Flushes the data and renames the partial file to the target name.
+    void commit();
+    // Removes the partial file.
+    void discard();
+
+private:
+    void close();
+
+    std::string m_fileName;
+    std::string m_partFileName;
+    bool m_overwrite;
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+/*
+ * Exclusive lock of a file held while the object lives, for example to keep
+ * other server processes from using the same data file. The file is created if needed.
+ */
+class FileLock final
+{
+public:
+    explicit FileLock(const std::string& fileName);
+    ~FileLock();
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    std::string m_fileName;
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+/*
+ * File mapped into memory for reading and writing. The file is created or extended
+ * with zeros to the given size, a larger file is mapped whole.
+ * Space is reserved on disk where possible, so writes to the mapping do not fail
+ * for lack of it.
+ */
+class MappedFile final
+{
+public:
+    MappedFile(const std::string& fileName, uint64_t size);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    char* getData() const
+    {
+        return m_data;
+    }
+
+    uint64_t getSize() const
+    {
+        return m_size;
+    }
+
+    // Writes the modified pages of the range to disk and waits for them.
+    void sync(uint64_t offset, uint64_t length);
+
+private:
+    void close();
+
+    std::string m_fileName;
+    char* m_data = nullptr;
+    uint64_t m_size = 0;
+#ifdef _WIN32
+    void* m_handle = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+#endif // FILE_UTILS_H
@@ -0,0 +1,248 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			HedgedRequest.cpp
+ *	DESCRIPTION:	Hedged requests.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "HedgedRequest.h"
+#include "StringUtils.h"
+#include "CurlCompat.h"
+#include <algorithm>
+#include <stdexcept>
+
+HedgePolicy getHedgePolicy(const std::string& value)
+{
+    HedgePolicy policy;
+    std::string s(value);
+    toUpper(s);
+    if (s == "AUTO") {
+        policy.adaptive = true;
+        return policy;
+    }
+    if (s.empty() || s.size() > 9 || !std::all_of(s.begin(), s.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        throw std::runtime_error("Invalid value of UDR_HEDGE \"" + value + "\", expected AUTO or a delay in milliseconds.");
+    // 0 turns hedging off
+    policy.delay = std::chrono::milliseconds(std::stoul(s));
+    return policy;
+}
+
+
+LatencyTracker& LatencyTracker::instance()
+{
+    static LatencyTracker tracker;
+    return tracker;
+}
+
+void LatencyTracker::add(const std::string& key, std::chrono::milliseconds latency)
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_hosts.find(key);
+    if (it == m_hosts.end()) {
+        // the host that was not used for the longest time gives way
+        if (m_hosts.size() >= HEDGE_MAX_TRACKED_HOSTS) {
+            auto oldest = std::min_element(m_hosts.begin(), m_hosts.end(), [](const auto& a, const auto& b) {
+                return a.second.updateTime < b.second.updateTime;
+            });
+            m_hosts.erase(oldest);
+        }
+        it = m_hosts.emplace(key, Samples()).first;
+        it->second.values.reserve(HEDGE_LATENCY_SAMPLES);
+    }
+    Samples& samples = it->second;
+    if (samples.values.size() < HEDGE_LATENCY_SAMPLES)
+        samples.values.push_back(latency);
+    else
+        samples.values[samples.next] = latency;
+    samples.next = (samples.next + 1) % HEDGE_LATENCY_SAMPLES;
+    samples.updateTime = now;
+}
+
+bool LatencyTracker::getPercentile(const std::string& key, double percentile, std::chrono::milliseconds& latency) const
+{
+    std::vector<std::chrono::milliseconds> values;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_hosts.find(key);
+        if (it == m_hosts.cend() || it->second.values.size() < HEDGE_MIN_LATENCY_SAMPLES)
+            return false;
+        values = it->second.values;
+    }
+    const auto n = static_cast<size_t>(percentile * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    latency = values[n];
+    return true;
+}
+
+
+HedgeBudget& HedgeBudget::instance()
+{
+    static HedgeBudget budget;
+    return budget;
+}
+
+void HedgeBudget::configure(unsigned int percent)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ratio = std::min(percent, 100u) / 100.0;
+}
+
+void HedgeBudget::deposit()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tokens = std::min(m_tokens + m_ratio, HEDGE_BUDGET_BURST);
+}
+
+bool HedgeBudget::withdraw()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tokens >= 1.0) {
+            m_tokens -= 1.0;
+            ++m_copyCount;
+            return true;
+        }
+    }
+    ++m_deniedCount;
+    return false;
+}
+
+
+HedgedTransfer::HedgedTransfer(CURL* curl, CURLM* multi, const std::string& key, const HedgePolicy& policy)
+    : m_curl(curl)
+    , m_multi(multi)
+    , m_key(key)
+    , m_policy(policy)
+    , m_winner(curl)
+{
+}
+
+HedgedTransfer::~HedgedTransfer()
+{
+    // the transfer that is still running is stopped, its connection is closed
+    if (m_copyAdded)
+        curl_multi_remove_handle(m_multi, m_copy);
+    if (m_copy)
+        curl_easy_cleanup(m_copy);
+    if (m_curlAdded)
+        curl_multi_remove_handle(m_multi, m_curl);
+}
+
+CURLcode HedgedTransfer::perform(const PrepareCopy& prepareCopy)
+{
+    auto& budget = HedgeBudget::instance();
+    budget.deposit();
+
+    auto delay = m_policy.delay;
+    bool canHedge = true;
+    if (m_policy.adaptive)
+        canHedge = LatencyTracker::instance().getPercentile(m_key, HEDGE_DELAY_PERCENTILE, delay);
+
+    if (curl_multi_add_handle(m_multi, m_curl) != CURLM_OK)
+        throw std::runtime_error("Can't add the request to the CURL multi handle.");
+    m_curlAdded = true;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto hedgeTime = startTime + delay;
+    bool curlDone = false;
+    bool copyDone = false;
+    CURLcode curlResult = CURLE_OK;
+    CURLcode copyResult = CURLE_OK;
+    while (true) {
+        int running = 0;
+        const CURLMcode mrc = curl_multi_perform(m_multi, &running);
+        if (mrc != CURLM_OK)
+            throw std::runtime_error(curl_multi_strerror(mrc));
+
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &queued)) {
+            if (message->msg != CURLMSG_DONE)
+                continue;
+            if (message->easy_handle == m_curl) {
+                curlDone = true;
+                curlResult = message->data.result;
+            }
+            else {
+                copyDone = true;
+                copyResult = message->data.result;
+            }
+        }
+        // the first response is taken, a failed transfer waits for the other one
+        if (curlDone && (curlResult == CURLE_OK || !m_copy || copyDone)) {
+            m_winner = m_curl;
+            break;
+        }
+        if (copyDone && (copyResult == CURLE_OK || curlDone)) {
+            m_winner = m_copy;
+            break;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (!m_copy && canHedge && now >= hedgeTime) {
+            long responseCode = 0;
+            curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &responseCode);
+            // a response that has started to arrive is awaited
+            canHedge = (responseCode == 0) && budget.withdraw();
+            if (canHedge)
+                m_copy = curl_easy_duphandle(m_curl);
+            if (m_copy) {
+                prepareCopy(m_copy);
+                // the copy must not wait on the connection of the slow request
+                curl_easy_setopt(m_copy, CURLOPT_FRESH_CONNECT, 1L);
+                if (curl_multi_add_handle(m_multi, m_copy) != CURLM_OK)
+                    throw std::runtime_error("Can't add the request to the CURL multi handle.");
+                m_copyAdded = true;
+                continue;
+            }
+            canHedge = false;
+        }
+
+        long timeout = 1000;
+        if (!m_copy && canHedge) {
+            const auto untilHedge = std::chrono::duration_cast<std::chrono::milliseconds>(hedgeTime - now).count() + 1;
+            timeout = std::max(std::min<long>(timeout, static_cast<long>(untilHedge)), 0L);
+        }
+#if CURL_AT_LEAST_VERSION(7,66,0)
+        curl_multi_poll(m_multi, nullptr, 0, static_cast<int>(timeout), nullptr);
+#else
+        curl_multi_wait(m_multi, nullptr, 0, static_cast<int>(timeout), nullptr);
+#endif
+    }
+
+    const CURLcode result = (m_winner == m_curl) ? curlResult : copyResult;
+    if (result == CURLE_OK) {
+        std::chrono::milliseconds latency;
+        if (m_winner == m_curl) {
+            double startTransferTime = 0;
+            curl_easy_getinfo(m_curl, CURLINFO_STARTTRANSFER_TIME, &startTransferTime);
+            latency = std::chrono::milliseconds(static_cast<long long>(startTransferTime * 1000));
+        }
+        else {
+            // the request itself was slower than this
+            latency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+            budget.addCopyWin();
+        }
+        LatencyTracker::instance().add(m_key, latency);
+    }
+    return result;
+}
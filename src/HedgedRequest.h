@@ -0,0 +1,171 @@
+#pragma once
+
+#ifndef HEDGED_REQUEST_H
+#define HEDGED_REQUEST_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <curl/curl.h>
+
+constexpr unsigned int DEFAULT_HEDGE_BUDGET_PERCENT = 10;
+// number of copies that may be sent at once when the budget is full
+constexpr double HEDGE_BUDGET_BURST = 10.0;
+// the adaptive delay is the given percentile of the last samples of the host
+constexpr double HEDGE_DELAY_PERCENTILE = 0.95;
+constexpr size_t HEDGE_LATENCY_SAMPLES = 100;
+constexpr size_t HEDGE_MIN_LATENCY_SAMPLES = 20;
+constexpr size_t HEDGE_MAX_TRACKED_HOSTS = 1024;
+
+struct HedgePolicy
+{
+    // the delay is derived from the tracked latency of the host
+    bool adaptive = false;
+    std::chrono::milliseconds delay{ 0 };
+};
+
+// Parses AUTO or the delay in milliseconds.
+HedgePolicy getHedgePolicy(const std::string& value);
+
+// Times to the first byte of the responses of each host, the last HEDGE_LATENCY_SAMPLES are kept.
+class LatencyTracker final
+{
+public:
+    static LatencyTracker& instance();
+
+    void add(const std::string& key, std::chrono::milliseconds latency);
+
+    // Returns false while the host has too few samples.
+    bool getPercentile(const std::string& key, double percentile, std::chrono::milliseconds& latency) const;
+
+private:
+    struct Samples
+    {
+        std::vector<std::chrono::milliseconds> values;
+        size_t next = 0;
+        std::chrono::steady_clock::time_point updateTime;
+    };
+
+    LatencyTracker() = default;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Samples> m_hosts;
+};
+
+/*
+ * Limits the copies to a percentage of the hedged requests. Every request adds
+ * percent / 100 of a token, a copy takes a whole token, at most HEDGE_BUDGET_BURST
+ * tokens are accumulated.
+ */
+class HedgeBudget final
+{
+public:
+    static HedgeBudget& instance();
+
+    void configure(unsigned int percent);
+
+    void deposit();
+    bool withdraw();
+
+    uint64_t getCopyCount() const
+    {
+        return m_copyCount;
+    }
+
+    uint64_t getDeniedCount() const
+    {
+        return m_deniedCount;
+    }
+
+    uint64_t getCopyWinCount() const
+    {
+        return m_copyWinCount;
+    }
+
+    void addCopyWin()
+    {
+        ++m_copyWinCount;
+    }
+
+private:
+    HedgeBudget() = default;
+
+    std::mutex m_mutex;
+    double m_ratio = DEFAULT_HEDGE_BUDGET_PERCENT / 100.0;
+    double m_tokens = HEDGE_BUDGET_BURST;
+    std::atomic<uint64_t> m_copyCount{ 0 };
+    std::atomic<uint64_t> m_deniedCount{ 0 };
+    std::atomic<uint64_t> m_copyWinCount{ 0 };
+};
+
+/*
+ * Transfer of a request that sends a copy of it if no response arrives within the delay.
+ * The copy is made with curl_easy_duphandle and uses a new connection. The response that comes
+ * first is taken, the other transfer is stopped. Both transfers run in the multi handle
+ * given by the caller, in the caller's thread, so the callbacks of the request are called
+ * from it too. The multi handle keeps the connections for the next hedged requests.
+ */
+class HedgedTransfer final
+{
+public:
+    // Sets the write targets of the copy, they must differ from those of the request.
+    using PrepareCopy = std::function<void(CURL*)>;
+
+    HedgedTransfer(CURL* curl, CURLM* multi, const std::string& key, const HedgePolicy& policy);
+    ~HedgedTransfer();
+
+    HedgedTransfer(const HedgedTransfer&) = delete;
+    HedgedTransfer& operator=(const HedgedTransfer&) = delete;
+
+    CURLcode perform(const PrepareCopy& prepareCopy);
+
+    // handle whose response was taken
+    CURL* getHandle() const
+    {
+        return m_winner;
+    }
+
+    bool isCopyTaken() const
+    {
+        return m_copy && m_winner == m_copy;
+    }
+
+private:
+    CURL* m_curl;
+    CURLM* m_multi;
+    std::string m_key;
+    HedgePolicy m_policy;
+    CURL* m_copy = nullptr;
+    CURL* m_winner;
+    bool m_curlAdded = false;
+    bool m_copyAdded = false;
+};
+
+#endif // HEDGED_REQUEST_H
@@ -0,0 +1,712 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			JsonStream.cpp
+ *	DESCRIPTION:	Streaming extraction of JSON path values.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "JsonStream.h"
+#include "StringUtils.h"
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+
+namespace
+{
+    constexpr size_t MAX_LITERAL_LENGTH = 1024;
+
+    // Returns the first quote or backslash, or end.
+    // memchr is vectorized by the C runtime, so string content is scanned many bytes at a time.
+    inline const char* findStringStop(const char* p, const char* end)
+    {
+        auto quote = static_cast<const char*>(memchr(p, '"', static_cast<size_t>(end - p)));
+        const char* limit = quote ? quote : end;
+        auto backslash = static_cast<const char*>(memchr(p, '\\', static_cast<size_t>(limit - p)));
+        return backslash ? backslash : limit;
+    }
+
+    inline bool isLiteralChar(char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            c == '-' || c == '+' || c == '.';
+    }
+
+    bool isJsonNumber(const std::string& s)
+    {
+        size_t i = 0;
+        const size_t n = s.size();
+        auto digits = [&]() {
+            const size_t start = i;
+            while (i < n && s[i] >= '0' && s[i] <= '9')
+                ++i;
+            return i > start;
+        };
+        if (i < n && s[i] == '-')
+            ++i;
+        if (i < n && s[i] == '0')
+            ++i;
+        else if (!digits())
+            return false;
+        if (i < n && s[i] == '.') {
+            ++i;
+            if (!digits())
+                return false;
+        }
+        if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+            ++i;
+            if (i < n && (s[i] == '+' || s[i] == '-'))
+                ++i;
+            if (!digits())
+                return false;
+        }
+        return i == n;
+    }
+
+    bool isIdentifier(const std::string& s)
+    {
+        if (s.empty())
+            return false;
+        for (const char c : s) {
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'))
+                return false;
+        }
+        return !(s[0] >= '0' && s[0] <= '9');
+    }
+
+    void appendUtf8(std::string& s, uint32_t cp)
+    {
+        if (cp < 0x80) {
+            s.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800) {
+            s.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000) {
+            s.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else {
+            s.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    uint32_t parseHex4(const char* p, const char* end)
+    {
+        if (end - p < 4)
+            throw std::runtime_error("Invalid \\u escape sequence in JSON string.");
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            const char c = p[i];
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+                value |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                value |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                value |= static_cast<uint32_t>(c - 'A' + 10);
+            else
+                throw std::runtime_error("Invalid \\u escape sequence in JSON string.");
+        }
+        return value;
+    }
+}
+
+const char* getJsonTypeName(JsonType type)
+{
+    switch (type) {
+    case JsonType::String:
+        return "STRING";
+    case JsonType::Number:
+        return "NUMBER";
+    case JsonType::Boolean:
+        return "BOOLEAN";
+    case JsonType::Null:
+        return "NULL";
+    case JsonType::Object:
+        return "OBJECT";
+    case JsonType::Array:
+        return "ARRAY";
+    }
+    return "";
+}
+
+std::string unescapeJsonString(const char* data, size_t length)
+{
+    std::string result;
+    result.reserve(length);
+    const char* p = data;
+    const char* const end = data + length;
+    while (p < end) {
+        auto backslash = static_cast<const char*>(memchr(p, '\\', static_cast<size_t>(end - p)));
+        if (!backslash) {
+            result.append(p, end);
+            break;
+        }
+        result.append(p, backslash);
+        p = backslash + 1;
+        if (p == end)
+            throw std::runtime_error("Invalid escape sequence in JSON string.");
+        const char c = *p++;
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            result.push_back(c);
+            break;
+        case 'b':
+            result.push_back('\b');
+            break;
+        case 'f':
+            result.push_back('\f');
+            break;
+        case 'n':
+            result.push_back('\n');
+            break;
+        case 'r':
+            result.push_back('\r');
+            break;
+        case 't':
+            result.push_back('\t');
+            break;
+        case 'u': {
+            uint32_t cp = parseHex4(p, end);
+            p += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                // surrogate pair
+                const uint32_t low = parseHex4(p + 2, end);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            appendUtf8(result, cp);
+            break;
+        }
+        default:
+            throw std::runtime_error("Invalid escape sequence in JSON string.");
+        }
+    }
+    return result;
+}
+
+void appendJsonEscaped(std::string& result, const char* data, size_t length)
+{
+    for (const char* p = data; p < data + length; ++p) {
+        const char c = *p;
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\b':
+            result += "\\b";
+            break;
+        case '\f':
+            result += "\\f";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\r':
+            result += "\\r";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned int>(c));
+                result += buffer;
+            }
+            else {
+                result.push_back(c);
+            }
+        }
+    }
+}
+
+std::string escapeJsonString(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size() + 2);
+    result.push_back('"');
+    appendJsonEscaped(result, value.data(), value.size());
+    result.push_back('"');
+    return result;
+}
+
+
+JsonPath::JsonPath(const std::string& path)
+    : m_text(path)
+{
+    trim(m_text);
+    const std::string& s = m_text;
+    const size_t n = s.size();
+    auto invalid = [&s](const char* reason) {
+        return std::runtime_error("Invalid JSON path \"" + s + "\": " + reason);
+    };
+
+    if (n == 0 || s[0] != '$')
+        throw invalid("it must start with $.");
+
+    size_t i = 1;
+    while (i < n) {
+        if (s[i] == '.') {
+            ++i;
+            if (i < n && s[i] == '*') {
+                m_steps.push_back({ Step::Kind::Any, "", 0 });
+                ++i;
+                continue;
+            }
+            const size_t start = i;
+            while (i < n && s[i] != '.' && s[i] != '[')
+                ++i;
+            if (i == start)
+                throw invalid("member name expected.");
+            m_steps.push_back({ Step::Kind::Member, s.substr(start, i - start), 0 });
+        }
+        else if (s[i] == '[') {
+            ++i;
+            if (i < n && s[i] == '*') {
+                m_steps.push_back({ Step::Kind::Any, "", 0 });
+                ++i;
+            }
+            else if (i < n && (s[i] == '\'' || s[i] == '"')) {
+                const char quote = s[i++];
+                std::string name;
+                while (i < n && s[i] != quote) {
+                    if (s[i] == '\\' && i + 1 < n)
+                        ++i;
+                    name.push_back(s[i++]);
+                }
+                if (i == n)
+                    throw invalid("unterminated member name.");
+                ++i;
+                m_steps.push_back({ Step::Kind::Member, name, 0 });
+            }
+            else {
+                const size_t start = i;
+                while (i < n && s[i] >= '0' && s[i] <= '9')
+                    ++i;
+                if (i == start)
+                    throw invalid("array index expected.");
+                m_steps.push_back({ Step::Kind::Element, "", std::stoul(s.substr(start, i - start)) });
+            }
+            if (i == n || s[i] != ']')
+                throw invalid("] expected.");
+            ++i;
+        }
+        else {
+            throw invalid(". or [ expected.");
+        }
+    }
+}
+
+
+JsonStreamParser::JsonStreamParser(const std::vector<JsonPath>& paths, const Handler& handler)
+    : m_paths(paths)
+    , m_handler(handler)
+{
+}
+
+void JsonStreamParser::parse(const char* data, size_t length)
+{
+    const char* p = data;
+    const char* const end = data + length;
+    m_chunk = data;
+    for (auto& capture : m_captures) {
+        capture.from = data;
+    }
+
+    while (p < end) {
+        if (!m_skipClosers.empty()) {
+            p = skipContainer(p, end);
+            continue;
+        }
+        if (m_state == State::String) {
+            p = parseString(p, end);
+            continue;
+        }
+        if (m_state == State::Literal) {
+            p = parseLiteral(p, end);
+            continue;
+        }
+
+        const char c = *p;
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            ++p;
+            continue;
+        }
+        switch (m_state) {
+        case State::Value:
+            p = beginValue(p);
+            break;
+
+        case State::ArrayFirst:
+            if (c == ']') {
+                closeContainer(c, p);
+                ++p;
+            }
+            else {
+                p = beginValue(p);
+            }
+            break;
+
+        case State::ObjectFirst:
+        case State::ObjectKey:
+            if (c == '"') {
+                m_state = State::String;
+                m_stringIsKey = true;
+                m_escape = false;
+                m_key.clear();
+                ++p;
+            }
+            else if (c == '}' && m_state == State::ObjectFirst) {
+                closeContainer(c, p);
+                ++p;
+            }
+            else {
+                raiseError(p, "member name expected");
+            }
+            break;
+
+        case State::Colon:
+            if (c != ':')
+                raiseError(p, "':' expected");
+            m_state = State::Value;
+            ++p;
+            break;
+
+        case State::AfterValue:
+            if (m_stack.empty()) {
+                // the next document of the stream
+                p = beginValue(p);
+            }
+            else if (c == ',') {
+                Frame& frame = m_stack.back();
+                if (frame.isObject) {
+                    m_state = State::ObjectKey;
+                }
+                else {
+                    ++frame.index;
+                    m_state = State::Value;
+                }
+                ++p;
+            }
+            else if (c == '}' || c == ']') {
+                closeContainer(c, p);
+                ++p;
+            }
+            else {
+                raiseError(p, "',' or end of container expected");
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    for (auto& capture : m_captures) {
+        capture.text.append(capture.from, end);
+    }
+    m_offset += length;
+    m_chunk = nullptr;
+}
+
+void JsonStreamParser::finish()
+{
+    if (m_state == State::Literal && m_stack.empty()) {
+        finishLiteral(nullptr);
+    }
+    if (!m_skipClosers.empty() || !m_stack.empty() || m_state == State::String || m_state == State::Literal) {
+        throw std::runtime_error("Unexpected end of JSON document.");
+    }
+}
+
+const char* JsonStreamParser::beginValue(const char* p)
+{
+    // Which paths match the value and whether any of them can match something inside it.
+    std::vector<size_t> matches;
+    bool descend = false;
+    const size_t depth = m_stack.size();
+    for (size_t i = 0; i < m_paths.size(); i++) {
+        const auto& steps = m_paths[i].getSteps();
+        if (steps.size() < depth)
+            continue;
+        bool prefix = true;
+        for (size_t k = 0; k < depth && prefix; k++) {
+            prefix = matchStep(steps[k], m_stack[k]);
+        }
+        if (!prefix)
+            continue;
+        if (steps.size() == depth)
+            matches.push_back(i);
+        else
+            descend = true;
+    }
+
+    const char c = *p;
+    JsonType type;
+    switch (c) {
+    case '{':
+        type = JsonType::Object;
+        break;
+    case '[':
+        type = JsonType::Array;
+        break;
+    case '"':
+        type = JsonType::String;
+        break;
+    case 't':
+    case 'f':
+        type = JsonType::Boolean;
+        break;
+    case 'n':
+        type = JsonType::Null;
+        break;
+    default:
+        if (c != '-' && !(c >= '0' && c <= '9'))
+            raiseError(p, "value expected");
+        type = JsonType::Number;
+    }
+
+    if (!matches.empty()) {
+        m_captures.push_back({ depth, type, std::move(matches), getLocation(), std::string(), p });
+    }
+
+    switch (type) {
+    case JsonType::Object:
+    case JsonType::Array:
+        m_stack.push_back({ type == JsonType::Object, 0, std::string() });
+        m_state = (type == JsonType::Object) ? State::ObjectFirst : State::ArrayFirst;
+        if (!descend) {
+            m_skipClosers.assign(1, type == JsonType::Object ? '}' : ']');
+            m_skipInString = false;
+            m_escape = false;
+        }
+        return p + 1;
+
+    case JsonType::String:
+        m_state = State::String;
+        m_stringIsKey = false;
+        m_escape = false;
+        return p + 1;
+
+    default:
+        m_state = State::Literal;
+        m_literal.clear();
+        return p;
+    }
+}
+
+void JsonStreamParser::finishValue(const char* p)
+{
+    m_state = State::AfterValue;
+    // captures are nested, so the capture of this value, if any, is the innermost one
+    while (!m_captures.empty() && m_captures.back().depth == m_stack.size()) {
+        Capture capture(std::move(m_captures.back()));
+        m_captures.pop_back();
+        if (p) {
+            capture.text.append(capture.from, p);
+        }
+        for (size_t i = 0; i < capture.pathIndexes.size(); i++) {
+            std::string value = (capture.type == JsonType::String) ?
+                unescapeJsonString(capture.text.data() + 1, capture.text.size() - 2) :
+                capture.text;
+            m_handler(capture.pathIndexes[i], capture.location, capture.type, value);
+        }
+    }
+    if (m_stack.empty()) {
+        ++m_documentCount;
+    }
+}
+
+const char* JsonStreamParser::parseString(const char* p, const char* end)
+{
+    while (p < end) {
+        if (m_escape) {
+            if (m_stringIsKey)
+                m_key.push_back(*p);
+            m_escape = false;
+            ++p;
+            continue;
+        }
+        const char* stop = findStringStop(p, end);
+        if (m_stringIsKey)
+            m_key.append(p, stop);
+        if (stop == end)
+            return end;
+        if (*stop == '\\') {
+            if (m_stringIsKey)
+                m_key.push_back('\\');
+            m_escape = true;
+            p = stop + 1;
+            continue;
+        }
+        // closing quote
+        p = stop + 1;
+        if (m_stringIsKey) {
+            try {
+                m_stack.back().key = unescapeJsonString(m_key.data(), m_key.size());
+            }
+            catch (const std::runtime_error& e) {
+                raiseError(p, e.what());
+            }
+            m_state = State::Colon;
+        }
+        else {
+            finishValue(p);
+        }
+        return p;
+    }
+    return p;
+}
+
+const char* JsonStreamParser::parseLiteral(const char* p, const char* end)
+{
+    const char* start = p;
+    while (p < end && isLiteralChar(*p))
+        ++p;
+    m_literal.append(start, p);
+    if (m_literal.size() > MAX_LITERAL_LENGTH)
+        raiseError(p, "literal is too long");
+    if (p < end)
+        finishLiteral(p);
+    return p;
+}
+
+void JsonStreamParser::finishLiteral(const char* p)
+{
+    const bool valid = m_literal == "true" || m_literal == "false" || m_literal == "null" || isJsonNumber(m_literal);
+    if (!valid) {
+        throw std::runtime_error("Invalid JSON literal " + m_literal + " at offset " +
+            std::to_string(m_offset + (p && m_chunk ? static_cast<uint64_t>(p - m_chunk) : 0)) + ".");
+    }
+    finishValue(p);
+}
+
+const char* JsonStreamParser::skipContainer(const char* p, const char* end)
+{
+    while (p < end) {
+        if (m_skipInString) {
+            if (m_escape) {
+                m_escape = false;
+                ++p;
+                continue;
+            }
+            const char* stop = findStringStop(p, end);
+            if (stop == end)
+                return end;
+            if (*stop == '\\')
+                m_escape = true;
+            else
+                m_skipInString = false;
+            p = stop + 1;
+            continue;
+        }
+        const char c = *p++;
+        switch (c) {
+        case '"':
+            m_skipInString = true;
+            break;
+        case '{':
+            m_skipClosers.push_back('}');
+            break;
+        case '[':
+            m_skipClosers.push_back(']');
+            break;
+        case '}':
+        case ']':
+            if (c != m_skipClosers.back())
+                raiseError(p - 1, "mismatched bracket");
+            m_skipClosers.pop_back();
+            if (m_skipClosers.empty()) {
+                m_stack.pop_back();
+                finishValue(p);
+                return p;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return p;
+}
+
+void JsonStreamParser::closeContainer(char c, const char* p)
+{
+    if (m_stack.empty() || m_stack.back().isObject != (c == '}'))
+        raiseError(p, "mismatched bracket");
+    m_stack.pop_back();
+    finishValue(p + 1);
+}
+
+bool JsonStreamParser::matchStep(const JsonPath::Step& step, const Frame& frame) const
+{
+    switch (step.kind) {
+    case JsonPath::Step::Kind::Any:
+        return true;
+    case JsonPath::Step::Kind::Member:
+        return frame.isObject && frame.key == step.name;
+    case JsonPath::Step::Kind::Element:
+        return !frame.isObject && frame.index == step.index;
+    }
+    return false;
+}
+
+std::string JsonStreamParser::getLocation() const
+{
+    std::string location("$");
+    for (const auto& frame : m_stack) {
+        if (!frame.isObject) {
+            location += "[" + std::to_string(frame.index) + "]";
+        }
+        else if (isIdentifier(frame.key)) {
+            location += "." + frame.key;
+        }
+        else {
+            location += "['";
+            for (const char c : frame.key) {
+                if (c == '\'' || c == '\\')
+                    location.push_back('\\');
+                location.push_back(c);
+            }
+            location += "']";
+        }
+    }
+    return location;
+}
+
+void JsonStreamParser::raiseError(const char* p, const char* message) const
+{
+    const uint64_t offset = m_offset + (m_chunk ? static_cast<uint64_t>(p - m_chunk) : 0);
+    throw std::runtime_error(std::string("Invalid JSON at offset ") + std::to_string(offset) + ": " + message + ".");
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+enum class JsonType {
+    String,
+    Number,
+    Boolean,
+    Null,
+    Object,
+    Array
+};
+
+const char* getJsonTypeName(JsonType type);
+
+// Decodes the content of a JSON string (without quotes) to UTF-8.
+std::string unescapeJsonString(const char* data, size_t length);
+
+// Appends the content of a JSON string literal (without quotes) encoding the given text.
+void appendJsonEscaped(std::string& result, const char* data, size_t length);
+
+// Encodes a string as a JSON string literal, including the quotes.
+std::string escapeJsonString(const std::string& value);
+
+/*
+ * Compiled JSONPath expression.
+ *
+ * Supported subset:
+ *   $                 root
+ *   .name  ['name']   object member
+ *   [n]               array element
+ *   .*  [*]           any member or element
+ */
+class JsonPath final
+{
+public:
+    explicit JsonPath(const std::string& path);
+
+    const std::string& getText() const
+    {
+        return m_text;
+    }
+
+    struct Step
+    {
+        enum class Kind {
+            Member,
+            Element,
+            Any
+        };
+
+        Kind kind;
+        std::string name;
+        size_t index;
+    };
+
+    const std::vector<Step>& getSteps() const
+    {
+        return m_steps;
+    }
+
+private:
+    std::string m_text;
+    std::vector<Step> m_steps;
+};
+
+/*
+ * Push parser that extracts the values of JSON paths from a document
+ * received in arbitrary pieces. Only the matched values are kept in memory;
+ * subtrees that cannot contain a match are skipped without decoding
+ * (and without validation beyond the balance of brackets).
+ * Several documents following each other (for example NDJSON) are parsed one by one.
+ */
+class JsonStreamParser final
+{
+public:
+    // pathIndex - index of the matched path, location - the concrete path of the value,
+    // value - decoded content for strings, JSON text for other types.
+    using Handler = std::function<void(size_t pathIndex, const std::string& location, JsonType type, std::string& value)>;
+
+    JsonStreamParser(const std::vector<JsonPath>& paths, const Handler& handler);
+
+    void parse(const char* data, size_t length);
+    // Checks that the last document is complete.
+    void finish();
+
+    // Number of the completely parsed documents.
+    uint64_t getDocumentCount() const
+    {
+        return m_documentCount;
+    }
+
+private:
+    enum class State {
+        Value,
+        ArrayFirst,
+        ObjectFirst,
+        ObjectKey,
+        Colon,
+        AfterValue,
+        String,
+        Literal
+    };
+
+    struct Frame
+    {
+        bool isObject;
+        size_t index;
+        std::string key;
+    };
+
+    struct Capture
+    {
+        size_t depth;
+        JsonType type;
+        std::vector<size_t> pathIndexes;
+        std::string location;
+        std::string text;
+        const char* from;
+    };
+
+    const char* beginValue(const char* p);
+    void finishValue(const char* p);
+    const char* parseString(const char* p, const char* end);
+    const char* parseLiteral(const char* p, const char* end);
+    void finishLiteral(const char* p);
+    const char* skipContainer(const char* p, const char* end);
+    void closeContainer(char c, const char* p);
+    bool matchStep(const JsonPath::Step& step, const Frame& frame) const;
+    std::string getLocation() const;
+    [[noreturn]] void raiseError(const char* p, const char* message) const;
+
+    std::vector<JsonPath> m_paths;
+    Handler m_handler;
+    std::vector<Frame> m_stack;
+    std::vector<Capture> m_captures;
+    State m_state = State::Value;
+    bool m_stringIsKey = false;
+    bool m_escape = false;
+    std::string m_key;
+    std::string m_literal;
+    // skipping of a container that cannot contain a match, the closing brackets expected
+    std::string m_skipClosers;
+    bool m_skipInString = false;
+    uint64_t m_offset = 0;
+    const char* m_chunk = nullptr;
+    uint64_t m_documentCount = 0;
+};
+
+#endif // JSON_STREAM_H
@@ -0,0 +1,307 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			MemoryBudget.cpp
+ *	DESCRIPTION:	Memory limits of the responses collected in memory.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "MemoryBudget.h"
+#include "StringUtils.h"
+#include "MemoryPool.h"
+#include "CurlCompat.h"
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t SPILL_READ_SIZE = 64 * 1024;
+}
+
+MemoryPolicy getMemoryPolicy(const std::string& value)
+{
+    std::string sValue(value);
+    trim(sValue);
+    toUpper(sValue);
+    if (sValue == "PAUSE")
+        return MemoryPolicy::Pause;
+    if (sValue == "SPILL")
+        return MemoryPolicy::Spill;
+    if (sValue == "REJECT")
+        return MemoryPolicy::Reject;
+    throw std::runtime_error("Invalid memory limit policy " + value + ". Possible values are PAUSE, SPILL, REJECT.");
+}
+
+
+MemoryBudget& MemoryBudget::instance()
+{
+    static MemoryBudget budget;
+    return budget;
+}
+
+void MemoryBudget::configure(uint64_t limit, uint64_t attachmentLimit, MemoryPolicy policy, std::chrono::seconds waitTimeout)
+{
+    m_limit = limit;
+    m_attachmentLimit = attachmentLimit;
+    m_policy = policy;
+#if !CURL_AT_LEAST_VERSION(7,32,0)
+    // a paused transfer is continued by the progress callback
+    if (m_policy == MemoryPolicy::Pause)
+        m_policy = MemoryPolicy::Reject;
+#endif
+    m_waitTimeout = waitTimeout;
+}
+
+bool MemoryBudget::fits(int64_t attachmentId, size_t size) const
+{
+    if (m_limit > 0 && m_usage + size > m_limit)
+        return false;
+    if (m_attachmentLimit > 0) {
+        const auto it = m_attachmentUsage.find(attachmentId);
+        const uint64_t usage = (it != m_attachmentUsage.cend()) ? it->second : 0;
+        if (usage + size > m_attachmentLimit)
+            return false;
+    }
+    return true;
+}
+
+bool MemoryBudget::tryReserve(int64_t attachmentId, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!fits(attachmentId, size))
+        return false;
+    m_attachmentUsage[attachmentId] += size;
+    const uint64_t usage = m_usage += size;
+    if (usage > m_peakUsage)
+        m_peakUsage = usage;
+    return true;
+}
+
+void MemoryBudget::reserve(int64_t attachmentId, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_attachmentUsage[attachmentId] += size;
+    const uint64_t usage = m_usage += size;
+    if (usage > m_peakUsage)
+        m_peakUsage = usage;
+}
+
+void MemoryBudget::release(int64_t attachmentId, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_usage -= size;
+    const auto it = m_attachmentUsage.find(attachmentId);
+    if (it != m_attachmentUsage.end()) {
+        it->second -= std::min<uint64_t>(it->second, size);
+        if (it->second == 0)
+            m_attachmentUsage.erase(it);
+    }
+}
+
+bool MemoryBudget::hasRoom(int64_t attachmentId, size_t size) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return fits(attachmentId, size);
+}
+
+uint64_t MemoryBudget::getAttachmentUsage(int64_t attachmentId) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_attachmentUsage.find(attachmentId);
+    return (it != m_attachmentUsage.cend()) ? it->second : 0;
+}
+
+bool MemoryBudget::exceedsLimits(size_t size) const
+{
+    return (m_limit > 0 && size > m_limit) || (m_attachmentLimit > 0 && size > m_attachmentLimit);
+}
+
+
+MemoryReservation::~MemoryReservation()
+{
+    resize(0);
+}
+
+MemoryReservation::MemoryReservation(MemoryReservation&& other) noexcept
+    : m_budget(other.m_budget)
+    , m_attachmentId(other.m_attachmentId)
+    , m_size(other.m_size)
+{
+    other.m_size = 0;
+}
+
+MemoryReservation& MemoryReservation::operator=(MemoryReservation&& other) noexcept
+{
+    if (this != &other) {
+        resize(0);
+        m_budget = other.m_budget;
+        m_attachmentId = other.m_attachmentId;
+        m_size = other.m_size;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+void MemoryReservation::resize(size_t size)
+{
+    if (!m_budget)
+        return;
+    if (size > m_size)
+        m_budget->reserve(m_attachmentId, size - m_size);
+    else if (size < m_size)
+        m_budget->release(m_attachmentId, m_size - size);
+    m_size = size;
+}
+
+
+ResponseBuffer::~ResponseBuffer()
+{
+    if (m_budget && m_reserved > 0)
+        m_budget->release(m_attachmentId, static_cast<size_t>(m_reserved));
+    if (m_spillFile)
+        std::fclose(m_spillFile);
+}
+
+void ResponseBuffer::setBudget(MemoryBudget& budget, int64_t attachmentId, CURL* curl)
+{
+    m_budget = &budget;
+    m_attachmentId = attachmentId;
+    m_curl = curl;
+}
+
+size_t ResponseBuffer::write_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    return static_cast<ResponseBuffer*>(userdata)->write(ptr, size * nmemb);
+}
+
+size_t ResponseBuffer::append_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    static_cast<ResponseBuffer*>(userdata)->append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+size_t ResponseBuffer::write(const char* data, size_t length)
+{
+    if (!m_budget || length == 0) {
+        m_data.append(data, length);
+        return length;
+    }
+    if (!m_spillFile) {
+        if (m_budget->tryReserve(m_attachmentId, length)) {
+            m_reserved += length;
+            m_data.append(data, length);
+            m_pausedLength = 0;
+            return length;
+        }
+        switch (m_budget->getPolicy()) {
+        case MemoryPolicy::Spill:
+            m_spillFile = std::tmpfile();
+            if (!m_spillFile) {
+                m_error = "Can't create a temporary file for the response.";
+                return 0;
+            }
+            m_budget->addSpill();
+            break;
+
+        case MemoryPolicy::Pause:
+            // waiting is useless if the response alone does not fit
+            if (m_curl && !m_budget->exceedsLimits(static_cast<size_t>(m_reserved) + length)) {
+                if (m_pausedLength == 0) {
+                    m_budget->addPause();
+                    m_pauseTime = std::chrono::steady_clock::now();
+                }
+                // libcurl passes the same data again when the transfer continues
+                m_pausedLength = length;
+                return CURL_WRITEFUNC_PAUSE;
+            }
+            m_budget->addReject();
+            m_error = "The response does not fit the memory limit of the UDR.";
+            return 0;
+
+        case MemoryPolicy::Reject:
+            m_budget->addReject();
+            m_error = "Memory limit of the UDR is reached.";
+            return 0;
+        }
+    }
+    // the rest of a spilled response goes to the file
+    if (std::fwrite(data, 1, length, m_spillFile) != length) {
+        m_error = "Can't write the response to a temporary file.";
+        return 0;
+    }
+    m_spillSize += length;
+    return length;
+}
+
+void ResponseBuffer::append(const char* data, size_t length)
+{
+    if (m_budget) {
+        m_budget->reserve(m_attachmentId, length);
+        m_reserved += length;
+    }
+    m_data.append(data, length);
+}
+
+bool ResponseBuffer::resume()
+{
+    if (m_pausedLength == 0)
+        return true;
+    if (m_budget->hasRoom(m_attachmentId, m_pausedLength)) {
+        // the held data is passed to write() before curl_easy_pause returns
+        curl_easy_pause(m_curl, CURLPAUSE_CONT);
+        return true;
+    }
+    if (std::chrono::steady_clock::now() - m_pauseTime < m_budget->getWaitTimeout())
+        return true;
+    m_error = "Memory limit of the UDR is reached, no memory was released in " +
+        std::to_string(m_budget->getWaitTimeout().count()) + " s.";
+    return false;
+}
+
+void ResponseBuffer::read(const std::function<void(const char*, size_t)>& consumer) const
+{
+    if (!m_data.empty())
+        consumer(m_data.data(), m_data.size());
+    if (!m_spillFile)
+        return;
+    std::lock_guard<std::mutex> lock(m_readMutex);
+    std::rewind(m_spillFile);
+    PooledBuffer buffer(SPILL_READ_SIZE);
+    size_t length;
+    while ((length = std::fread(buffer.data(), 1, buffer.size(), m_spillFile)) > 0)
+        consumer(buffer.data(), length);
+    if (std::ferror(m_spillFile))
+        throw std::runtime_error("Can't read the response from a temporary file.");
+}
+
+void ResponseBuffer::swap(ResponseBuffer& other)
+{
+    std::swap(m_budget, other.m_budget);
+    std::swap(m_attachmentId, other.m_attachmentId);
+    std::swap(m_curl, other.m_curl);
+    m_data.swap(other.m_data);
+    std::swap(m_reserved, other.m_reserved);
+    std::swap(m_spillFile, other.m_spillFile);
+    std::swap(m_spillSize, other.m_spillSize);
+    std::swap(m_pausedLength, other.m_pausedLength);
+    std::swap(m_pauseTime, other.m_pauseTime);
+    m_error.swap(other.m_error);
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <curl/curl.h>
+
+constexpr std::chrono::seconds DEFAULT_MEMORY_WAIT_TIMEOUT{ 30 };
+
+// What happens to a response that does not fit the memory limits.
+enum class MemoryPolicy
+{
+    Pause,       // receiving is paused until memory is released
+    Spill,       // the rest of the response is written to a temporary file
+    Reject       // the request fails, new requests fail until memory is released
+};
+
+MemoryPolicy getMemoryPolicy(const std::string& value);
+
+/*
+ * Memory held by the responses collected in memory, in the whole process and
+ * in each attachment. A limit of 0 means no limit, the memory is still counted.
+ */
+class MemoryBudget final
+{
+public:
+    static MemoryBudget& instance();
+
+    // Called once, before the first reservation.
+    void configure(uint64_t limit, uint64_t attachmentLimit, MemoryPolicy policy, std::chrono::seconds waitTimeout);
+
+    MemoryPolicy getPolicy() const
+    {
+        return m_policy;
+    }
+
+    std::chrono::seconds getWaitTimeout() const
+    {
+        return m_waitTimeout;
+    }
+
+    // Returns false if the size does not fit the limits.
+    bool tryReserve(int64_t attachmentId, size_t size);
+    // Memory that has to be counted even if it exceeds the limits.
+    void reserve(int64_t attachmentId, size_t size);
+    void release(int64_t attachmentId, size_t size);
+
+    // Returns true if the size fits the limits now, nothing is reserved.
+    bool hasRoom(int64_t attachmentId, size_t size) const;
+    // Returns true if the size alone exceeds one of the limits, waiting for memory is useless then.
+    bool exceedsLimits(size_t size) const;
+
+    uint64_t getUsage() const
+    {
+        return m_usage;
+    }
+
+    uint64_t getAttachmentUsage(int64_t attachmentId) const;
+
+    uint64_t getPeakUsage() const
+    {
+        return m_peakUsage;
+    }
+
+    uint64_t getPauseCount() const
+    {
+        return m_pauseCount;
+    }
+
+    uint64_t getSpillCount() const
+    {
+        return m_spillCount;
+    }
+
+    uint64_t getRejectCount() const
+    {
+        return m_rejectCount;
+    }
+
+    void addPause()
+    {
+        ++m_pauseCount;
+    }
+
+    void addSpill()
+    {
+        ++m_spillCount;
+    }
+
+    void addReject()
+    {
+        ++m_rejectCount;
+    }
+
+private:
+    MemoryBudget() = default;
+
+    // The caller holds the mutex.
+    bool fits(int64_t attachmentId, size_t size) const;
+
+    uint64_t m_limit = 0;
+    uint64_t m_attachmentLimit = 0;
+    MemoryPolicy m_policy = MemoryPolicy::Pause;
+    std::chrono::seconds m_waitTimeout = DEFAULT_MEMORY_WAIT_TIMEOUT;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<int64_t, uint64_t> m_attachmentUsage;
+    std::atomic<uint64_t> m_usage{ 0 };
+    std::atomic<uint64_t> m_peakUsage{ 0 };
+    std::atomic<uint64_t> m_pauseCount{ 0 };
+    std::atomic<uint64_t> m_spillCount{ 0 };
+    std::atomic<uint64_t> m_rejectCount{ 0 };
+};
+
+/*
+ * Memory of a buffer that is not a ResponseBuffer, such as a page received ahead
+ * or the ranges of a download waiting for their turn. It is counted even if it
+ * exceeds the limits and released with the object.
+ */
+class MemoryReservation final
+{
+public:
+    MemoryReservation() = default;
+
+    MemoryReservation(MemoryBudget& budget, int64_t attachmentId)
+        : m_budget(&budget)
+        , m_attachmentId(attachmentId)
+    {
+    }
+
+    ~MemoryReservation();
+
+    MemoryReservation(MemoryReservation&& other) noexcept;
+    MemoryReservation& operator=(MemoryReservation&& other) noexcept;
+
+    // Counts the new size of the buffer, does nothing without a budget.
+    void resize(size_t size);
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    MemoryBudget* m_budget = nullptr;
+    int64_t m_attachmentId = 0;
+    size_t m_size = 0;
+};
+
+/*
+ * Response body or headers collected in memory and counted in the memory budget.
+ * Data that does not fit the limits is handled by the policy of the budget: the write
+ * callback pauses the transfer and resume() continues it when memory is released,
+ * the data is written to a temporary file, or the transfer fails.
+ * The content is read with read(), also from several threads.
+ */
+class ResponseBuffer final
+{
+public:
+    ResponseBuffer() = default;
+    ~ResponseBuffer();
+
+    ResponseBuffer(const ResponseBuffer&) = delete;
+    ResponseBuffer& operator=(const ResponseBuffer&) = delete;
+
+    // Data written before the buffer has a budget is not counted.
+    void setBudget(MemoryBudget& budget, int64_t attachmentId, CURL* curl);
+
+    // Callback for CURLOPT_WRITEFUNCTION and CURLOPT_HEADERFUNCTION, the buffer is the user data.
+    static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
+
+    // Callback for data that is always kept in memory, such as the headers.
+    static size_t append_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
+
+    // Returns CURL_WRITEFUNC_PAUSE or 0, which fails the transfer, if the data does not fit.
+    size_t write(const char* data, size_t length);
+    // Appends data that is counted even if it exceeds the limits.
+    void append(const char* data, size_t length);
+
+    // Continues the paused transfer if there is memory for the held data. Returns false
+    // if the transfer has been paused longer than the wait timeout, it has to be stopped.
+    bool resume();
+
+    // Error that has stopped the transfer.
+    const std::string& getError() const
+    {
+        return m_error;
+    }
+
+    uint64_t size() const
+    {
+        return m_data.size() + m_spillSize;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    bool isSpilled() const
+    {
+        return m_spillFile != nullptr;
+    }
+
+    // The whole content if the buffer is not spilled.
+    const std::string& getData() const
+    {
+        return m_data;
+    }
+
+    // Passes the content to the consumer in pieces.
+    void read(const std::function<void(const char*, size_t)>& consumer) const;
+
+    void swap(ResponseBuffer& other);
+
+private:
+    MemoryBudget* m_budget = nullptr;
+    int64_t m_attachmentId = 0;
+    CURL* m_curl = nullptr;
+    std::string m_data;
+    uint64_t m_reserved = 0;
+    std::FILE* m_spillFile = nullptr;
+    uint64_t m_spillSize = 0;
+    // length of the data held by libcurl while the transfer is paused
+    size_t m_pausedLength = 0;
+    std::chrono::steady_clock::time_point m_pauseTime;
+    std::string m_error;
+    // the spill file is read by all requests that share the response
+    mutable std::mutex m_readMutex;
+};
+
+#endif // MEMORY_BUDGET_H
@@ -0,0 +1,304 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			MemoryPool.cpp
+ *	DESCRIPTION:	Thread-caching pools of memory blocks.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Runtime.h"
+#include "MemoryPool.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    // The header keeps the blocks aligned as malloc does.
+    struct alignas(16) BlockHeader
+    {
+        uint32_t sizeClass;
+        uint32_t owner;
+    };
+
+    constexpr size_t HEADER_SIZE = sizeof(BlockHeader);
+    constexpr size_t MIN_CLASS_SIZE = 64;
+    constexpr unsigned int MIN_CLASS_BIT = 6;
+    // 64, then four classes for each power of two up to MAX_POOLED_BLOCK_SIZE
+    constexpr unsigned int CLASS_COUNT = 45;
+    constexpr uint32_t LARGE_CLASS = 0xFFFFFFFF;
+    // the counters of a thread are added to the global ones after this number of allocations
+    constexpr unsigned int COUNTER_FLUSH_INTERVAL = 64;
+
+    static_assert(HEADER_SIZE == 16, "unexpected size of the block header");
+    static_assert((size_t(8) << (MIN_CLASS_BIT + (CLASS_COUNT - 2) / 4 - 2)) == MAX_POOLED_BLOCK_SIZE,
+        "the last size class does not match MAX_POOLED_BLOCK_SIZE");
+
+    std::atomic<uint64_t> g_allocations[2];
+    std::atomic<uint64_t> g_reused[2];
+
+    // Sizes include the header.
+    unsigned int getSizeClass(size_t size)
+    {
+        if (size <= MIN_CLASS_SIZE)
+            return 0;
+        const size_t value = size - 1;
+        unsigned int bit = MIN_CLASS_BIT;
+        while ((value >> (bit + 1)) != 0)
+            ++bit;
+        const unsigned int quarter = static_cast<unsigned int>(value >> (bit - 2)) - 4;
+        return 1 + (bit - MIN_CLASS_BIT) * 4 + quarter;
+    }
+
+    size_t getClassSize(unsigned int sizeClass)
+    {
+        if (sizeClass == 0)
+            return MIN_CLASS_SIZE;
+        const unsigned int bit = MIN_CLASS_BIT + (sizeClass - 1) / 4;
+        const unsigned int quarter = (sizeClass - 1) % 4;
+        return static_cast<size_t>(5 + quarter) << (bit - 2);
+    }
+
+    size_t getClassCapacity(unsigned int sizeClass)
+    {
+        const size_t capacity = THREAD_CACHE_CLASS_SIZE / getClassSize(sizeClass);
+        return capacity < 2 ? 2 : capacity;
+    }
+
+    void* toUser(BlockHeader* header)
+    {
+        return header + 1;
+    }
+
+    BlockHeader* toHeader(void* ptr)
+    {
+        return static_cast<BlockHeader*>(ptr) - 1;
+    }
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct ThreadCache;
+
+    // Set when the cache of the thread is destroyed, blocks freed after that go to the system.
+    // A plain flag has no destructor, so it is valid until the very end of the thread.
+    thread_local bool t_cacheDestroyed = false;
+
+    struct ThreadCache
+    {
+        FreeBlock* lists[CLASS_COUNT] = {};
+        size_t counts[CLASS_COUNT] = {};
+        uint64_t allocations[2] = {};
+        uint64_t reused[2] = {};
+        unsigned int pending = 0;
+
+        ~ThreadCache()
+        {
+            t_cacheDestroyed = true;
+            flushCounters();
+            for (unsigned int i = 0; i < CLASS_COUNT; ++i) {
+                while (lists[i]) {
+                    FreeBlock* block = lists[i];
+                    lists[i] = block->next;
+                    std::free(toHeader(block));
+                }
+            }
+        }
+
+        void count(PoolOwner owner, bool fromCache)
+        {
+            const auto index = static_cast<size_t>(owner);
+            ++allocations[index];
+            if (fromCache)
+                ++reused[index];
+            if (++pending >= COUNTER_FLUSH_INTERVAL)
+                flushCounters();
+        }
+
+        void flushCounters()
+        {
+            for (size_t i = 0; i < 2; ++i) {
+                g_allocations[i].fetch_add(allocations[i], std::memory_order_relaxed);
+                g_reused[i].fetch_add(reused[i], std::memory_order_relaxed);
+                allocations[i] = 0;
+                reused[i] = 0;
+            }
+            pending = 0;
+        }
+    };
+
+    ThreadCache* getThreadCache()
+    {
+        if (t_cacheDestroyed)
+            return nullptr;
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    void* allocateBlock(size_t size, PoolOwner owner)
+    {
+        if (size == 0)
+            size = 1;
+        if (size > MAX_POOLED_BLOCK_SIZE - HEADER_SIZE) {
+            if (size > SIZE_MAX - HEADER_SIZE)
+                return nullptr;
+            auto header = static_cast<BlockHeader*>(std::malloc(size + HEADER_SIZE));
+            if (!header)
+                return nullptr;
+            header->sizeClass = LARGE_CLASS;
+            header->owner = static_cast<uint32_t>(owner);
+            if (ThreadCache* cache = getThreadCache())
+                cache->count(owner, false);
+            else
+                g_allocations[static_cast<size_t>(owner)].fetch_add(1, std::memory_order_relaxed);
+            return toUser(header);
+        }
+
+        const unsigned int sizeClass = getSizeClass(size + HEADER_SIZE);
+        BlockHeader* header = nullptr;
+        ThreadCache* cache = getThreadCache();
+        if (cache && cache->lists[sizeClass]) {
+            FreeBlock* block = cache->lists[sizeClass];
+            cache->lists[sizeClass] = block->next;
+            --cache->counts[sizeClass];
+            header = toHeader(block);
+        }
+        const bool fromCache = header != nullptr;
+        if (!header) {
+            header = static_cast<BlockHeader*>(std::malloc(getClassSize(sizeClass)));
+            if (!header)
+                return nullptr;
+        }
+        header->sizeClass = sizeClass;
+        header->owner = static_cast<uint32_t>(owner);
+        if (cache)
+            cache->count(owner, fromCache);
+        else
+            g_allocations[static_cast<size_t>(owner)].fetch_add(1, std::memory_order_relaxed);
+        return toUser(header);
+    }
+
+    // Bytes the caller may use in the block.
+    size_t getUsableSize(const BlockHeader* header)
+    {
+        return getClassSize(header->sizeClass) - HEADER_SIZE;
+    }
+}
+
+void* poolAllocate(size_t size, PoolOwner owner)
+{
+    void* ptr = allocateBlock(size, owner);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void poolFree(void* ptr)
+{
+    if (!ptr)
+        return;
+    BlockHeader* header = toHeader(ptr);
+    const uint32_t sizeClass = header->sizeClass;
+    if (sizeClass != LARGE_CLASS) {
+        // blocks freed by another thread go to the cache of that thread
+        ThreadCache* cache = getThreadCache();
+        if (cache && cache->counts[sizeClass] < getClassCapacity(sizeClass)) {
+            auto block = static_cast<FreeBlock*>(ptr);
+            block->next = cache->lists[sizeClass];
+            cache->lists[sizeClass] = block;
+            ++cache->counts[sizeClass];
+            return;
+        }
+    }
+    std::free(header);
+}
+
+void* curlPoolMalloc(size_t size)
+{
+    return allocateBlock(size, PoolOwner::Curl);
+}
+
+void curlPoolFree(void* ptr)
+{
+    poolFree(ptr);
+}
+
+void* curlPoolRealloc(void* ptr, size_t size)
+{
+    if (!ptr)
+        return allocateBlock(size, PoolOwner::Curl);
+    if (size == 0)
+        size = 1;
+    BlockHeader* header = toHeader(ptr);
+    if (header->sizeClass == LARGE_CLASS) {
+        if (size > MAX_POOLED_BLOCK_SIZE - HEADER_SIZE) {
+            if (size > SIZE_MAX - HEADER_SIZE)
+                return nullptr;
+            // the header stays at the start of the block moved by realloc
+            auto moved = static_cast<BlockHeader*>(std::realloc(header, size + HEADER_SIZE));
+            return moved ? toUser(moved) : nullptr;
+        }
+    }
+    else if (size <= getUsableSize(header)) {
+        // shrinking keeps the block, it returns to its own class when freed
+        return ptr;
+    }
+    const size_t oldSize = header->sizeClass == LARGE_CLASS ? size : getUsableSize(header);
+    void* result = allocateBlock(size, PoolOwner::Curl);
+    if (!result)
+        return nullptr;
+    // a large block shrinks here, so the new size is the smaller one
+    std::memcpy(result, ptr, oldSize < size ? oldSize : size);
+    poolFree(ptr);
+    return result;
+}
+
+char* curlPoolStrdup(const char* str)
+{
+    const size_t size = std::strlen(str) + 1;
+    auto result = static_cast<char*>(allocateBlock(size, PoolOwner::Curl));
+    if (result)
+        std::memcpy(result, str, size);
+    return result;
+}
+
+void* curlPoolCalloc(size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+        return nullptr;
+    void* result = allocateBlock(count * size, PoolOwner::Curl);
+    if (result)
+        std::memset(result, 0, count * size);
+    return result;
+}
+
+MemoryPoolStats getMemoryPoolStats()
+{
+    MemoryPoolStats stats;
+    stats.curlAllocations = g_allocations[static_cast<size_t>(PoolOwner::Curl)].load(std::memory_order_relaxed);
+    stats.curlReused = g_reused[static_cast<size_t>(PoolOwner::Curl)].load(std::memory_order_relaxed);
+    stats.bufferAllocations = g_allocations[static_cast<size_t>(PoolOwner::Buffer)].load(std::memory_order_relaxed);
+    stats.bufferReused = g_reused[static_cast<size_t>(PoolOwner::Buffer)].load(std::memory_order_relaxed);
+    return stats;
+}
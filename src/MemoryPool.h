@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef MEMORY_POOL_H
+#define MEMORY_POOL_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+// Blocks up to this size are kept in the caches of the threads, larger ones come from the system.
+constexpr size_t MAX_POOLED_BLOCK_SIZE = 128 * 1024;
+// Memory of one size class a thread may keep.
+constexpr size_t THREAD_CACHE_CLASS_SIZE = 128 * 1024;
+
+/*
+ * Allocator of libcurl and of the buffers of the library. Blocks are rounded up to
+ * size classes of a quarter of a power of two. Freed blocks are kept in a cache of
+ * the thread, without a lock, and given to the next allocation of the same class
+ * in that thread. So the handles, lists and buffers of a request reuse the blocks
+ * of the previous request instead of going to the global heap each time.
+ */
+enum class PoolOwner
+{
+    Curl,
+    Buffer
+};
+
+void* poolAllocate(size_t size, PoolOwner owner);
+void poolFree(void* ptr);
+
+// Functions passed to curl_global_init_mem.
+void* curlPoolMalloc(size_t size);
+void curlPoolFree(void* ptr);
+void* curlPoolRealloc(void* ptr, size_t size);
+char* curlPoolStrdup(const char* str);
+void* curlPoolCalloc(size_t count, size_t size);
+
+// Allocations of the owner and those served from the caches of the threads. The counters
+// of a thread are published every few allocations, so they may lag a little behind.
+struct MemoryPoolStats
+{
+    uint64_t curlAllocations;
+    uint64_t curlReused;
+    uint64_t bufferAllocations;
+    uint64_t bufferReused;
+};
+
+MemoryPoolStats getMemoryPoolStats();
+
+// Buffer taken from the pool for the lifetime of the object.
+class PooledBuffer final
+{
+public:
+    explicit PooledBuffer(size_t size)
+        : m_data(static_cast<char*>(poolAllocate(size, PoolOwner::Buffer)))
+        , m_size(size)
+    {
+    }
+
+    ~PooledBuffer()
+    {
+        poolFree(m_data);
+    }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    char* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    char* m_data;
+    size_t m_size;
+};
+
+#endif // MEMORY_POOL_H
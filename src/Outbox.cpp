@@ -0,0 +1,555 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			Outbox.cpp
+ *	DESCRIPTION:	Durable outbox of requests delivered in the background.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Outbox.h"
+#include "ConnectionPool.h"
+#include "RequestTrace.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+namespace
+{
+    size_t discardResponse(void*, size_t size, size_t nmemb, void*)
+    {
+        return size * nmemb;
+    }
+
+    int abortOnStop(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+    {
+        return static_cast<const std::atomic<bool>*>(clientp)->load() ? 1 : 0;
+    }
+
+    bool isRetryable(long statusCode)
+    {
+        return statusCode == 0 || statusCode == 408 || statusCode == 429 || statusCode >= 500;
+    }
+}
+
+Outbox& Outbox::instance()
+{
+    static Outbox* const outbox = new Outbox();
+    return *outbox;
+}
+
+Outbox::Outbox()
+{
+}
+
+void Outbox::requestStop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_stopping = true;
+    m_syncWakeUp.notify_all();
+    m_syncDone.notify_all();
+    m_workWakeUp.notify_all();
+}
+
+void Outbox::join()
+{
+    for (auto& worker : m_workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+    if (m_syncThread.joinable())
+        m_syncThread.join();
+}
+
+void Outbox::open(const UdrConfig& config, Configure configure)
+{
+    m_fileName = config.getString("OutboxFile");
+    if (m_fileName.empty()) {
+        m_error = "The outbox is not configured, set the parameter OutboxFile in the configuration file " +
+            config.getFileName() + ".";
+        return;
+    }
+    const auto fileSize = config.getInteger("OutboxFileSize", DEFAULT_OUTBOX_FILE_SIZE_MB);
+    m_capacity = static_cast<uint64_t>(std::max<long long>(fileSize, 1)) * 1024 * 1024;
+    const auto syncDelay = config.getInteger("OutboxSyncDelay", DEFAULT_OUTBOX_SYNC_DELAY.count());
+    m_syncDelay = std::chrono::milliseconds(std::max<long long>(syncDelay, 0));
+    const auto maxAttempts = config.getInteger("OutboxMaxAttempts", DEFAULT_OUTBOX_MAX_ATTEMPTS);
+    m_maxAttempts = static_cast<unsigned int>(std::max<long long>(maxAttempts, 1));
+    const auto retryDelay = config.getInteger("OutboxRetryDelay", DEFAULT_OUTBOX_RETRY_DELAY.count());
+    m_retryDelay = std::chrono::seconds(std::max<long long>(retryDelay, 1));
+    const auto workers = config.getInteger("OutboxWorkers", DEFAULT_OUTBOX_WORKERS);
+    m_configure = std::move(configure);
+
+    try {
+        // a second process would overwrite the records of the first one
+        m_lock.reset(new FileLock(m_fileName + ".lock"));
+        m_file.reset(new MappedFile(m_fileName, m_capacity));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        replay();
+    }
+    catch (const std::runtime_error& e) {
+        m_file.reset();
+        m_lock.reset();
+        m_error = e.what();
+        return;
+    }
+
+    m_open = true;
+    m_syncThread = std::thread(&Outbox::runSync, this);
+    const auto workerCount = std::min<long long>(std::max<long long>(workers, 1), MAX_OUTBOX_WORKERS);
+    for (long long i = 0; i < workerCount; ++i)
+        m_workers.emplace_back(&Outbox::runWorker, this);
+    Runtime::instance().addService(*this);
+}
+
+void Outbox::replay()
+{
+    char* data = m_file->getData();
+    const uint64_t size = m_file->getSize();
+    if (std::all_of(data, data + sizeof(OUTBOX_FILE_MAGIC), [](char c) { return c == 0; })) {
+        // a new file
+        memcpy(data, OUTBOX_FILE_MAGIC, sizeof(OUTBOX_FILE_MAGIC));
+        m_file->sync(0, OUTBOX_HEADER_SIZE);
+    }
+    else if (memcmp(data, OUTBOX_FILE_MAGIC, sizeof(OUTBOX_FILE_MAGIC)) != 0) {
+        throw std::runtime_error("File \"" + m_fileName + "\" is not an outbox file.");
+    }
+
+    uint64_t offset = OUTBOX_HEADER_SIZE;
+    OutboxRecord record;
+    while (readOutboxRecord(data, size, offset, record)) {
+        if (record.type == OUTBOX_RECORD_REQUEST) {
+            Entry entry;
+            entry.request = decodeOutboxRequest(record.payload, record.length, entry.enqueueTime);
+            entry.recordSize = record.size;
+            m_liveSize += record.size;
+            m_entries[record.id] = std::move(entry);
+        }
+        else if (record.type == OUTBOX_RECORD_DONE) {
+            const auto it = m_entries.find(record.id);
+            if (it != m_entries.end()) {
+                m_liveSize -= it->second.recordSize;
+                m_entries.erase(it);
+            }
+        }
+        m_nextId = std::max(m_nextId, record.id + 1);
+        offset += std::min(record.size, size - offset);
+    }
+    m_written = offset;
+    m_synced = offset;
+
+    // requests without an outcome are sent again, oldest first
+    for (const auto& entry : m_entries)
+        m_ready.push_back(entry.first);
+    m_replayCount = m_entries.size();
+}
+
+bool Outbox::appendRecord(uint8_t type, uint64_t id, const std::string& payload)
+{
+    const uint64_t recordSize = alignOutboxRecord(OUTBOX_RECORD_HEADER_SIZE + payload.size());
+    if (m_written + recordSize > m_file->getSize())
+        return false;
+    char* record = m_file->getData() + m_written;
+    char header[OUTBOX_RECORD_HEADER_SIZE];
+    encodeOutboxRecordHeader(header, type, id, payload.data(), payload.size());
+    memcpy(record + OUTBOX_RECORD_HEADER_SIZE, payload.data(), payload.size());
+    // the magic is written last, so the record is complete once it is there
+    memcpy(record + 4, header + 4, OUTBOX_RECORD_HEADER_SIZE - 4);
+    memcpy(record, header, 4);
+    m_written += recordSize;
+    ++m_appendSequence;
+    return true;
+}
+
+void Outbox::compact(std::unique_lock<std::mutex>& lock)
+{
+    std::vector<std::pair<uint64_t, std::string>> snapshot;
+    snapshot.reserve(m_entries.size());
+    for (const auto& entry : m_entries)
+        snapshot.emplace_back(entry.first, encodeOutboxRequest(entry.second.request, entry.second.enqueueTime));
+    const uint64_t snapshotEnd = m_written;
+
+    // the requests are written without the lock, so enqueue() and the workers go on meanwhile
+    std::unique_ptr<AtomicFileWriter> writer;
+    lock.unlock();
+    try {
+        // the new log is complete on disk before it replaces the old one
+        writer.reset(new AtomicFileWriter(m_fileName, FileSyncMode::Close, true));
+        char header[OUTBOX_HEADER_SIZE] = {};
+        memcpy(header, OUTBOX_FILE_MAGIC, sizeof(OUTBOX_FILE_MAGIC));
+        writer->write(header, sizeof(header));
+        std::string record;
+        for (const auto& entry : snapshot) {
+            const std::string& payload = entry.second;
+            record.assign(OUTBOX_RECORD_HEADER_SIZE, '\0');
+            encodeOutboxRecordHeader(&record[0], OUTBOX_RECORD_REQUEST, entry.first, payload.data(), payload.size());
+            record += payload;
+            record.resize(static_cast<size_t>(alignOutboxRecord(record.size())), '\0');
+            writer->write(record.data(), record.size());
+        }
+        writer->sync();
+    }
+    catch (...) {
+        lock.lock();
+        throw;
+    }
+    lock.lock();
+
+    // the records appended since the snapshot, new requests and outcomes, follow as they are
+    writer->write(m_file->getData() + snapshotEnd, static_cast<size_t>(m_written - snapshotEnd));
+    const uint64_t written = writer->getSize();
+    // the mapping is closed first, a mapped file can not be replaced on Windows
+    m_file.reset();
+    try {
+        writer->commit();
+    }
+    catch (const std::runtime_error&) {
+        m_file.reset(new MappedFile(m_fileName, m_capacity));
+        throw;
+    }
+    m_file.reset(new MappedFile(m_fileName, m_capacity));
+    m_written = written;
+    m_synced = m_written;
+    // everything appended so far is on disk now
+    m_syncSequence = m_appendSequence;
+    ++m_compactGeneration;
+    ++m_compactCount;
+}
+
+uint64_t Outbox::enqueue(OutboxRequest request)
+{
+    if (!isOpen())
+        throw std::runtime_error(m_error);
+    const auto enqueueTime = std::chrono::system_clock::now();
+    const std::string payload = encodeOutboxRequest(request, enqueueTime);
+    const uint64_t recordSize = alignOutboxRecord(OUTBOX_RECORD_HEADER_SIZE + payload.size());
+    if (recordSize > m_capacity / 2)
+        throw std::runtime_error("The request is too large for the outbox file, increase the parameter OutboxFileSize.");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stop)
+        throw std::runtime_error("The outbox is closed.");
+    const uint64_t id = m_nextId++;
+    if (!appendRecord(OUTBOX_RECORD_REQUEST, id, payload)) {
+        // the flushing thread compacts the log
+        const uint64_t generation = m_compactGeneration;
+        m_compactRequested = true;
+        m_syncWakeUp.notify_all();
+        m_syncDone.wait(lock, [this, generation]() { return m_stop || m_compactGeneration != generation || !m_compactRequested; });
+        if (m_stop || !m_file || !appendRecord(OUTBOX_RECORD_REQUEST, id, payload))
+            throw std::runtime_error("The outbox file is full, the requests are not delivered fast enough.");
+    }
+    const uint64_t sequence = m_appendSequence;
+    Entry entry;
+    entry.request = std::move(request);
+    entry.enqueueTime = enqueueTime;
+    entry.recordSize = recordSize;
+    m_entries[id] = std::move(entry);
+    m_liveSize += recordSize;
+    m_unsynced.emplace_back(sequence, id);
+    m_syncWakeUp.notify_all();
+
+    // the call returns when the record is on disk
+    m_syncDone.wait(lock, [this, sequence]() {
+        return m_syncSequence >= sequence || m_failedSequence >= sequence || m_stop;
+    });
+    if (m_syncSequence < sequence) {
+        throw std::runtime_error(m_stop ? std::string("The outbox is closed.") : m_syncError);
+    }
+    ++m_enqueueCount;
+    return id;
+}
+
+void Outbox::runSync()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto lastCompact = std::chrono::steady_clock::now();
+    while (true) {
+        if (m_stop && m_written == m_synced)
+            break;
+        const auto now = std::chrono::steady_clock::now();
+        if (!m_stop && (m_compactRequested || now - lastCompact >= OUTBOX_COMPACT_INTERVAL)) {
+            const uint64_t deadSize = m_written - OUTBOX_HEADER_SIZE - m_liveSize;
+            // records appended since the last flush are flushed by the rewrite
+            if (m_compactRequested || deadSize >= m_capacity / 4) {
+                try {
+                    compact(lock);
+                }
+                catch (const std::runtime_error& e) {
+                    m_syncError = e.what();
+                }
+                if (!m_file) {
+                    // the log can not be used any more
+                    m_stop = true;
+                    m_syncDone.notify_all();
+                    m_workWakeUp.notify_all();
+                    break;
+                }
+                if (m_syncSequence == m_appendSequence) {
+                    for (const auto& unsynced : m_unsynced)
+                        m_ready.push_back(unsynced.second);
+                    m_unsynced.clear();
+                    m_workWakeUp.notify_all();
+                }
+            }
+            m_compactRequested = false;
+            lastCompact = now;
+            m_syncDone.notify_all();
+            continue;
+        }
+        if (m_written == m_synced) {
+            m_syncWakeUp.wait_until(lock, lastCompact + OUTBOX_COMPACT_INTERVAL, [this]() {
+                return m_stop || m_compactRequested || m_written != m_synced;
+            });
+            continue;
+        }
+        if (m_syncDelay.count() > 0 && !m_stop) {
+            // more requests join the flush
+            m_syncWakeUp.wait_for(lock, m_syncDelay, [this]() { return m_stop || m_compactRequested; });
+        }
+        const uint64_t from = m_synced;
+        const uint64_t to = m_written;
+        const uint64_t sequence = m_appendSequence;
+        MappedFile* file = m_file.get();
+        // requests are appended meanwhile, the file is replaced only by this thread
+        lock.unlock();
+        std::string error;
+        try {
+            file->sync(from, to - from);
+        }
+        catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        lock.lock();
+        if (!error.empty()) {
+            m_syncError = error;
+            m_failedSequence = sequence;
+            // the callers get the error, the requests are sent only if the log is replayed
+            while (!m_unsynced.empty() && m_unsynced.front().first <= sequence) {
+                const auto it = m_entries.find(m_unsynced.front().second);
+                if (it != m_entries.end()) {
+                    m_liveSize -= it->second.recordSize;
+                    m_entries.erase(it);
+                }
+                m_unsynced.pop_front();
+            }
+            m_syncDone.notify_all();
+            if (m_stop)
+                break;
+            m_syncWakeUp.wait_for(lock, std::chrono::seconds(1), [this]() { return m_stop; });
+            continue;
+        }
+        m_synced = to;
+        m_syncSequence = sequence;
+        ++m_syncCount;
+        while (!m_unsynced.empty() && m_unsynced.front().first <= sequence) {
+            m_ready.push_back(m_unsynced.front().second);
+            m_unsynced.pop_front();
+        }
+        m_syncDone.notify_all();
+        m_workWakeUp.notify_all();
+    }
+}
+
+void Outbox::runWorker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        const auto now = std::chrono::steady_clock::now();
+        while (!m_delayed.empty() && m_delayed.begin()->first <= now) {
+            m_ready.push_back(m_delayed.begin()->second);
+            m_delayed.erase(m_delayed.begin());
+        }
+        if (m_ready.empty()) {
+            if (m_delayed.empty())
+                m_workWakeUp.wait(lock);
+            else
+                m_workWakeUp.wait_until(lock, m_delayed.begin()->first);
+            continue;
+        }
+        const uint64_t id = m_ready.front();
+        m_ready.pop_front();
+        const auto it = m_entries.find(id);
+        if (it == m_entries.end())
+            continue;
+        it->second.inFlight = true;
+        const OutboxRequest request = it->second.request;
+        lock.unlock();
+
+        std::string error;
+        const long statusCode = send(request, error);
+
+        lock.lock();
+        auto& entry = m_entries[id];
+        entry.inFlight = false;
+        if (m_stopping && statusCode == 0) {
+            // the request is sent again when the log is opened next time
+            break;
+        }
+        ++entry.attempts;
+        if (error.empty()) {
+            finish(id, true, statusCode);
+            ++m_deliverCount;
+        }
+        else if (isRetryable(statusCode) && entry.attempts < m_maxAttempts) {
+            entry.lastError = error;
+            const auto factor = 1LL << std::min(entry.attempts - 1, 20u);
+            const auto delay = std::min<std::chrono::seconds>(m_retryDelay * factor, MAX_OUTBOX_RETRY_DELAY);
+            entry.nextAttempt = std::chrono::steady_clock::now() + delay;
+            m_delayed.emplace(entry.nextAttempt, id);
+            ++m_retryCount;
+        }
+        else {
+            finish(id, false, statusCode);
+            ++m_failCount;
+        }
+    }
+}
+
+long Outbox::send(const OutboxRequest& request, std::string& error) const
+{
+    std::unique_ptr<Endpoint> endpoint;
+    try {
+        endpoint.reset(new Endpoint(request.url));
+    }
+    catch (const std::runtime_error& e) {
+        // the request can not be sent at all
+        error = e.what();
+        return -1;
+    }
+    PooledCurl curl(CurlHandlePool::instance(), endpoint->getKey());
+    if (!curl) {
+        error = "Can't initialize CURL.";
+        return 0;
+    }
+
+    char curlErrorBuffer[CURL_ERROR_SIZE];
+    memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+    endpoint->apply(curl);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, OUTBOX_DEFAULT_TIMEOUT_MS);
+
+    std::shared_ptr<const DnsLists> dnsLists;
+    try {
+        if (m_configure)
+            dnsLists = m_configure(curl, request.options);
+    }
+    catch (const std::exception& e) {
+        error = e.what();
+        return -1;
+    }
+    // addresses given by the request stay in the DNS cache of the handle
+    if (request.options.find("CURLOPT_RESOLVE") != std::string::npos)
+        curl.discard();
+
+    if (request.method == "HEAD") {
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    }
+    else if (request.method == "POST") {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    }
+    else if (request.method != "GET") {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+    }
+    if (request.hasBody) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request.body.size()));
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.data());
+    }
+    else if (request.method == "POST") {
+        // an empty body, otherwise libcurl reads it from the default read callback
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(0));
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "");
+    }
+
+    // headers are stored one per line
+    curl_slist* headers = nullptr;
+    size_t start = 0;
+    while (start < request.headers.size()) {
+        size_t end = request.headers.find('\n', start);
+        if (end == std::string::npos)
+            end = request.headers.size();
+        if (end > start)
+            headers = curl_slist_append(headers, request.headers.substr(start, end - start).c_str());
+        start = end + 1;
+    }
+    std::unique_ptr<curl_slist, void(*)(curl_slist*)> autoHeaders(headers, curl_slist_free_all);
+    if (headers)
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discardResponse);
+    // the workers stop their transfers when the library is unloaded
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, abortOnStop);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &m_stopping);
+    TransferTrace trace(RequestTrace::instance(), curl);
+
+    const CURLcode curlResult = curl_easy_perform(curl);
+    // requests of the workers belong to no attachment
+    trace.record(0, request.method, curl, curlResult, curlErrorBuffer);
+    if (curlResult != CURLE_OK) {
+        error.assign(curlErrorBuffer);
+        if (error.empty())
+            error.assign(curl_easy_strerror(curlResult));
+        return 0;
+    }
+    long statusCode = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
+    if (statusCode >= 400)
+        error = "HTTP status " + std::to_string(statusCode);
+    return statusCode;
+}
+
+void Outbox::finish(uint64_t id, bool delivered, long statusCode)
+{
+    const std::string payload = encodeOutboxDone(statusCode, delivered);
+    // a lost outcome only means the request is sent again, the flush is not waited for
+    if (!m_file || !appendRecord(OUTBOX_RECORD_DONE, id, payload)) {
+        m_compactRequested = true;
+    }
+    const auto it = m_entries.find(id);
+    if (it != m_entries.end()) {
+        m_liveSize -= it->second.recordSize;
+        m_entries.erase(it);
+    }
+    m_syncWakeUp.notify_all();
+}
+
+std::vector<OutboxEntryStatus> Outbox::getPending(const std::string& database) const
+{
+    std::vector<OutboxEntryStatus> pending;
+    const auto steadyNow = std::chrono::steady_clock::now();
+    const auto systemNow = std::chrono::system_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_entries) {
+        if (entry.second.request.database != database)
+            continue;
+        const auto& state = entry.second;
+        auto nextAttemptTime = systemNow;
+        if (!state.inFlight && state.nextAttempt > steadyNow) {
+            nextAttemptTime += std::chrono::duration_cast<std::chrono::system_clock::duration>(state.nextAttempt - steadyNow);
+        }
+        pending.push_back({ entry.first, state.request.method, state.request.url, state.attempts, state.enqueueTime,
+            nextAttemptTime, state.lastError });
+    }
+    return pending;
+}
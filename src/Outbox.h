@@ -0,0 +1,220 @@
+#pragma once
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Runtime.h"
+#include "UdrConfig.h"
+#include "FileUtils.h"
+#include "DnsResolver.h"
+#include "OutboxLog.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <curl/curl.h>
+
+constexpr uint64_t DEFAULT_OUTBOX_FILE_SIZE_MB = 64;
+// extra time given to concurrent requests to join a flush
+constexpr std::chrono::milliseconds DEFAULT_OUTBOX_SYNC_DELAY{ 0 };
+constexpr unsigned int DEFAULT_OUTBOX_WORKERS = 2;
+constexpr unsigned int MAX_OUTBOX_WORKERS = 64;
+constexpr unsigned int DEFAULT_OUTBOX_MAX_ATTEMPTS = 10;
+constexpr std::chrono::seconds DEFAULT_OUTBOX_RETRY_DELAY{ 1 };
+// the retry delay doubles with each attempt up to this
+constexpr std::chrono::seconds MAX_OUTBOX_RETRY_DELAY{ 3600 };
+constexpr std::chrono::seconds OUTBOX_COMPACT_INTERVAL{ 60 };
+// requests of the workers have no statement timeout
+constexpr long OUTBOX_DEFAULT_TIMEOUT_MS = 60000;
+
+struct OutboxEntryStatus
+{
+    uint64_t id;
+    std::string method;
+    std::string url;
+    unsigned int attempts;
+    std::chrono::system_clock::time_point enqueueTime;
+    std::chrono::system_clock::time_point nextAttemptTime;
+    std::string lastError;
+};
+
+/*
+ * Requests delivered in the background with at least once semantics. An enqueued request
+ * is appended to a memory-mapped log file and the call returns when the file is flushed
+ * to disk. One flush covers all requests appended since the previous one (group commit).
+ * Workers send the flushed requests, retry the failed ones and append the outcome to the log.
+ * When the log is opened, the requests without an outcome are sent again. The log is
+ * compacted by the flushing thread when a quarter of it holds finished requests or it is full.
+ */
+class Outbox final : public RuntimeService
+{
+public:
+    // Sets the CURL options of a request, the DNS lists returned live until it is sent.
+    using Configure = std::function<std::shared_ptr<const DnsLists>(CURL* curl, const std::string& options)>;
+
+    static Outbox& instance();
+
+    // Called once. Errors are kept and returned by getError(), the outbox is not open then.
+    void open(const UdrConfig& config, Configure configure);
+
+    // Aborts the transfers of the workers, the requests are sent again when the outbox is opened next time.
+    void requestStop() override;
+    void join() override;
+
+    bool isOpen() const
+    {
+        return m_open;
+    }
+
+    const std::string& getError() const
+    {
+        return m_error;
+    }
+
+    // Returns the ID of the request after it is written to disk.
+    uint64_t enqueue(OutboxRequest request);
+
+    // Requests of the database not delivered yet.
+    std::vector<OutboxEntryStatus> getPending(const std::string& database) const;
+
+    uint64_t getEnqueueCount() const
+    {
+        return m_enqueueCount;
+    }
+
+    uint64_t getDeliverCount() const
+    {
+        return m_deliverCount;
+    }
+
+    uint64_t getFailCount() const
+    {
+        return m_failCount;
+    }
+
+    uint64_t getRetryCount() const
+    {
+        return m_retryCount;
+    }
+
+    uint64_t getReplayCount() const
+    {
+        return m_replayCount;
+    }
+
+    uint64_t getSyncCount() const
+    {
+        return m_syncCount;
+    }
+
+    uint64_t getCompactCount() const
+    {
+        return m_compactCount;
+    }
+
+private:
+    struct Entry
+    {
+        OutboxRequest request;
+        std::chrono::system_clock::time_point enqueueTime;
+        uint64_t recordSize;
+        unsigned int attempts = 0;
+        std::chrono::steady_clock::time_point nextAttempt;
+        std::string lastError;
+        bool inFlight = false;
+    };
+
+    Outbox();
+
+    // The caller holds the mutex.
+    void replay();
+    // Returns false if the record does not fit, the caller holds the mutex.
+    bool appendRecord(uint8_t type, uint64_t id, const std::string& payload);
+    // Rewrites the log with the pending requests only. The caller holds the lock,
+    // it is released while the requests are written and flushed to the new file.
+    void compact(std::unique_lock<std::mutex>& lock);
+
+    void runSync();
+    void runWorker();
+    // Returns the HTTP status, 0 for transport errors.
+    long send(const OutboxRequest& request, std::string& error) const;
+    // Removes a request that got its outcome, the caller holds the mutex.
+    void finish(uint64_t id, bool delivered, long statusCode);
+
+    std::string m_fileName;
+    std::unique_ptr<FileLock> m_lock;
+    std::unique_ptr<MappedFile> m_file;
+    uint64_t m_capacity = 0;
+    std::chrono::milliseconds m_syncDelay = DEFAULT_OUTBOX_SYNC_DELAY;
+    unsigned int m_maxAttempts = DEFAULT_OUTBOX_MAX_ATTEMPTS;
+    std::chrono::seconds m_retryDelay = DEFAULT_OUTBOX_RETRY_DELAY;
+    Configure m_configure;
+    bool m_open = false;
+    std::string m_error;
+
+    mutable std::mutex m_mutex;
+    uint64_t m_written = 0;      // end of the records in the file
+    uint64_t m_synced = 0;       // end of the records flushed to disk
+    uint64_t m_liveSize = 0;     // size of the records of pending requests
+    uint64_t m_nextId = 1;
+    // appended records are numbered, the numbers do not change when the log is compacted
+    uint64_t m_appendSequence = 0;
+    uint64_t m_syncSequence = 0;
+    uint64_t m_failedSequence = 0;
+    std::string m_syncError;
+    bool m_compactRequested = false;
+    uint64_t m_compactGeneration = 0;
+    std::map<uint64_t, Entry> m_entries;
+    // requests waiting for the flush with the sequence of their record
+    std::deque<std::pair<uint64_t, uint64_t>> m_unsynced;
+    std::deque<uint64_t> m_ready;
+    std::multimap<std::chrono::steady_clock::time_point, uint64_t> m_delayed;
+    bool m_stop = false;
+    // aborts the transfers of the workers
+    std::atomic<bool> m_stopping{ false };
+    std::condition_variable m_syncWakeUp;
+    std::condition_variable m_syncDone;
+    std::condition_variable m_workWakeUp;
+    std::thread m_syncThread;
+    std::vector<std::thread> m_workers;
+
+    std::atomic<uint64_t> m_enqueueCount{ 0 };
+    std::atomic<uint64_t> m_deliverCount{ 0 };
+    std::atomic<uint64_t> m_failCount{ 0 };
+    std::atomic<uint64_t> m_retryCount{ 0 };
+    std::atomic<uint64_t> m_replayCount{ 0 };
+    std::atomic<uint64_t> m_syncCount{ 0 };
+    std::atomic<uint64_t> m_compactCount{ 0 };
+};
+
+#endif // OUTBOX_H
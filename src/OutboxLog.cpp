@@ -0,0 +1,185 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			OutboxLog.cpp
+ *	DESCRIPTION:	Records of the outbox log file.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "OutboxLog.h"
+#include <stdexcept>
+#include <cstring>
+
+namespace
+{
+    constexpr uint8_t REQUEST_HAS_BODY = 1;
+
+    uint32_t crc32(uint32_t crc, const void* data, size_t length)
+    {
+        static const struct Table
+        {
+            uint32_t values[256];
+
+            Table()
+            {
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k)
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    values[i] = c;
+                }
+            }
+        } table;
+        auto p = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+        for (size_t i = 0; i < length; ++i)
+            crc = table.values[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    uint32_t recordCrc(uint8_t type, uint64_t id, const char* payload, size_t length)
+    {
+        uint32_t crc = crc32(0, &type, sizeof(type));
+        crc = crc32(crc, &id, sizeof(id));
+        return crc32(crc, payload, length);
+    }
+
+    void putInteger(std::string& data, uint64_t value, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            data.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+
+    void putString(std::string& data, const std::string& value)
+    {
+        putInteger(data, value.size(), 4);
+        data += value;
+    }
+
+    class PayloadReader final
+    {
+    public:
+        PayloadReader(const char* data, size_t length)
+            : m_data(data)
+            , m_end(data + length)
+        {
+        }
+
+        uint64_t getInteger(size_t size)
+        {
+            if (static_cast<size_t>(m_end - m_data) < size)
+                throw std::runtime_error("Invalid record in the outbox file.");
+            uint64_t value = 0;
+            for (size_t i = 0; i < size; ++i)
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(m_data[i])) << (8 * i);
+            m_data += size;
+            return value;
+        }
+
+        std::string getString()
+        {
+            const auto length = static_cast<size_t>(getInteger(4));
+            if (static_cast<size_t>(m_end - m_data) < length)
+                throw std::runtime_error("Invalid record in the outbox file.");
+            std::string value(m_data, length);
+            m_data += length;
+            return value;
+        }
+
+    private:
+        const char* m_data;
+        const char* m_end;
+    };
+}
+
+void encodeOutboxRecordHeader(char* header, uint8_t type, uint64_t id, const char* payload, size_t length)
+{
+    const uint32_t magic = OUTBOX_RECORD_MAGIC;
+    const uint32_t payloadLength = static_cast<uint32_t>(length);
+    const uint32_t crc = recordCrc(type, id, payload, length);
+    memcpy(header, &magic, 4);
+    memcpy(header + 4, &payloadLength, 4);
+    memcpy(header + 8, &crc, 4);
+    memset(header + 12, 0, 4);
+    memcpy(header + 12, &type, 1);
+    memcpy(header + 16, &id, 8);
+}
+
+bool readOutboxRecord(const char* log, uint64_t logSize, uint64_t offset, OutboxRecord& record)
+{
+    if (offset > logSize || logSize - offset < OUTBOX_RECORD_HEADER_SIZE)
+        return false;
+    const char* header = log + offset;
+    uint32_t magic, crc;
+    memcpy(&magic, header, 4);
+    memcpy(&record.length, header + 4, 4);
+    memcpy(&crc, header + 8, 4);
+    memcpy(&record.type, header + 12, 1);
+    memcpy(&record.id, header + 16, 8);
+    if (magic != OUTBOX_RECORD_MAGIC || record.length > logSize - offset - OUTBOX_RECORD_HEADER_SIZE)
+        return false;
+    record.payload = header + OUTBOX_RECORD_HEADER_SIZE;
+    if (recordCrc(record.type, record.id, record.payload, record.length) != crc)
+        return false;
+    record.size = alignOutboxRecord(OUTBOX_RECORD_HEADER_SIZE + record.length);
+    return true;
+}
+
+std::string encodeOutboxRequest(const OutboxRequest& request, std::chrono::system_clock::time_point enqueueTime)
+{
+    std::string payload;
+    payload.reserve(request.database.size() + request.method.size() + request.url.size() +
+        request.headers.size() + request.options.size() + request.body.size() + 32);
+    putInteger(payload, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        enqueueTime.time_since_epoch()).count()), 8);
+    putInteger(payload, request.hasBody ? REQUEST_HAS_BODY : 0, 1);
+    putString(payload, request.database);
+    putString(payload, request.method);
+    putString(payload, request.url);
+    putString(payload, request.headers);
+    putString(payload, request.options);
+    putString(payload, request.body);
+    return payload;
+}
+
+OutboxRequest decodeOutboxRequest(const char* payload, size_t length, std::chrono::system_clock::time_point& enqueueTime)
+{
+    PayloadReader reader(payload, length);
+    enqueueTime = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::microseconds(static_cast<int64_t>(reader.getInteger(8)))));
+    OutboxRequest request;
+    request.hasBody = (reader.getInteger(1) & REQUEST_HAS_BODY) != 0;
+    request.database = reader.getString();
+    request.method = reader.getString();
+    request.url = reader.getString();
+    request.headers = reader.getString();
+    request.options = reader.getString();
+    request.body = reader.getString();
+    return request;
+}
+
+std::string encodeOutboxDone(long statusCode, bool delivered)
+{
+    std::string payload;
+    putInteger(payload, static_cast<uint64_t>(static_cast<uint32_t>(statusCode)), 4);
+    payload.push_back(delivered ? 1 : 0);
+    return payload;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef OUTBOX_LOG_H
+#define OUTBOX_LOG_H
+
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			OutboxLog.h
+ *	DESCRIPTION:	Records of the outbox log file.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+struct OutboxRequest
+{
+    std::string database;        // the database that enqueued the request
+    std::string method;
+    std::string url;
+    std::string headers;         // one per line
+    std::string options;         // as in the OPTIONS parameter
+    bool hasBody = false;        // without a body no POSTFIELDS are set, as for HTTP_REQUEST
+    std::string body;
+};
+
+/*
+ * The log starts with a header followed by records aligned to 8 bytes:
+ *
+ *   magic, payload length, CRC-32 of the type, ID and payload (4 bytes each),
+ *   type (1 byte), 3 reserved bytes, ID (8 bytes), payload.
+ *
+ * The records end where the magic or the CRC does not match, which is also
+ * where a record torn by a crash ends.
+ */
+constexpr char OUTBOX_FILE_MAGIC[8] = { 'H', 'T', 'T', 'P', 'O', 'B', 'X', '1' };
+constexpr uint64_t OUTBOX_HEADER_SIZE = 16;
+constexpr uint32_t OUTBOX_RECORD_MAGIC = 0x5242584F;
+constexpr uint64_t OUTBOX_RECORD_HEADER_SIZE = 24;
+
+constexpr uint8_t OUTBOX_RECORD_REQUEST = 1;    // payload: enqueue time, flags and the fields of the request
+constexpr uint8_t OUTBOX_RECORD_DONE = 2;       // payload: HTTP status and whether it was delivered
+
+inline uint64_t alignOutboxRecord(uint64_t size)
+{
+    return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+// Fills the OUTBOX_RECORD_HEADER_SIZE bytes of the header of a record.
+void encodeOutboxRecordHeader(char* header, uint8_t type, uint64_t id, const char* payload, size_t length);
+
+struct OutboxRecord
+{
+    uint8_t type = 0;
+    uint64_t id = 0;
+    const char* payload = nullptr;
+    uint32_t length = 0;
+    uint64_t size = 0;    // with the header and the alignment, the last record may end past the log
+};
+
+// Reads the record at the offset of the log. Returns false where the records end:
+// at the end of the log, at a torn record or at data that is not a record.
+bool readOutboxRecord(const char* log, uint64_t logSize, uint64_t offset, OutboxRecord& record);
+
+std::string encodeOutboxRequest(const OutboxRequest& request, std::chrono::system_clock::time_point enqueueTime);
+// Throws if the payload is not a request.
+OutboxRequest decodeOutboxRequest(const char* payload, size_t length, std::chrono::system_clock::time_point& enqueueTime);
+
+std::string encodeOutboxDone(long statusCode, bool delivered);
+
+#endif // OUTBOX_LOG_H
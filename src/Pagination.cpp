@@ -0,0 +1,457 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			Pagination.cpp
+ *	DESCRIPTION:	Following the pages of a paginated collection.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Pagination.h"
+#include "StringUtils.h"
+#include "Runtime.h"
+#include "CurlCompat.h"
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+    // Headers of the response. The Link values belong to the last response, so redirects are skipped.
+    struct PageHeaders
+    {
+        std::string text;
+        std::vector<std::string> links;
+    };
+
+    size_t collect_page_header(char* ptr, size_t size, size_t nmemb, void* userdata)
+    {
+        auto headers = static_cast<PageHeaders*>(userdata);
+        const size_t length = size * nmemb;
+        headers->text.append(ptr, length);
+
+        std::string line(ptr, length);
+        if (line.compare(0, 5, "HTTP/") == 0) {
+            // status line of the next response
+            headers->links.clear();
+            return length;
+        }
+        const auto colonPos = line.find(':');
+        if (colonPos == std::string::npos)
+            return length;
+
+        std::string name = line.substr(0, colonPos);
+        trim(name);
+        toLower(name);
+        if (name == "link") {
+            std::string value = line.substr(colonPos + 1);
+            trim(value);
+            headers->links.push_back(value);
+        }
+        return length;
+    }
+
+    size_t collect_page_body(char* ptr, size_t size, size_t nmemb, void* userdata)
+    {
+        auto page = static_cast<PageInfo*>(userdata);
+        const size_t length = size * nmemb;
+        page->body.append(ptr, length);
+        page->memory.resize(page->body.size());
+        return length;
+    }
+
+    std::string getCurlError(CURLcode code, const char* errorBuffer)
+    {
+        std::string message(errorBuffer);
+        if (message.empty())
+            message.assign(curl_easy_strerror(code));
+        return message;
+    }
+
+    bool isAbsoluteUrl(const std::string& url)
+    {
+        const auto colonPos = url.find("://");
+        return colonPos != std::string::npos && colonPos > 0 &&
+            std::all_of(url.begin(), url.begin() + colonPos, [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '-' || c == '.'; });
+    }
+
+#if CURL_AT_LEAST_VERSION(7,62,0)
+    using CurlUrl = std::unique_ptr<CURLU, decltype(&curl_url_cleanup)>;
+
+    CurlUrl parseUrl(const std::string& url)
+    {
+        CurlUrl hUrl(curl_url(), &curl_url_cleanup);
+        if (!hUrl)
+            throw std::runtime_error("Can't initialize CURL.");
+        const CURLUcode rc = curl_url_set(hUrl.get(), CURLUPART_URL, url.c_str(), 0);
+        if (rc != CURLUE_OK)
+            throw std::runtime_error("Invalid URL \"" + url + "\": " + curl_url_strerror(rc));
+        return hUrl;
+    }
+
+    std::string getUrl(CURLU* hUrl)
+    {
+        char* url = nullptr;
+        const CURLUcode rc = curl_url_get(hUrl, CURLUPART_URL, &url, 0);
+        if (rc != CURLUE_OK)
+            throw std::runtime_error(curl_url_strerror(rc));
+        std::string result(url);
+        curl_free(url);
+        return result;
+    }
+#endif
+}
+
+PaginationMode getPaginationMode(const std::string& name)
+{
+    std::string mode(name);
+    trim(mode);
+    toUpper(mode);
+    if (mode == "LINK")
+        return PaginationMode::Link;
+    if (mode == "CURSOR")
+        return PaginationMode::Cursor;
+    if (mode == "OFFSET")
+        return PaginationMode::Offset;
+    if (mode == "PAGE")
+        return PaginationMode::Page;
+    throw std::runtime_error("Unsupported pagination " + name + ".");
+}
+
+std::string findNextLink(const std::vector<std::string>& links)
+{
+    // link-value = "<" URI-Reference ">" *( OWS ";" OWS link-param ), separated by commas
+    for (const auto& value : links) {
+        size_t pos = 0;
+        while (pos < value.size()) {
+            const auto start = value.find('<', pos);
+            if (start == std::string::npos)
+                break;
+            const auto end = value.find('>', start);
+            if (end == std::string::npos)
+                break;
+            const std::string target = value.substr(start + 1, end - start - 1);
+            bool isNext = false;
+            pos = end + 1;
+            while (pos < value.size() && value[pos] != ',') {
+                if (value[pos] != ';') {
+                    ++pos;
+                    continue;
+                }
+                ++pos;
+                const auto nameEnd = value.find_first_of("=;,", pos);
+                std::string name = value.substr(pos, nameEnd == std::string::npos ? std::string::npos : nameEnd - pos);
+                trim(name);
+                toLower(name);
+                pos = (nameEnd == std::string::npos) ? value.size() : nameEnd;
+                if (pos >= value.size() || value[pos] != '=')
+                    continue;
+                ++pos;
+                while (pos < value.size() && (value[pos] == ' ' || value[pos] == '\t'))
+                    ++pos;
+                std::string paramValue;
+                if (pos < value.size() && value[pos] == '"') {
+                    // quoted-string, may contain separators
+                    for (++pos; pos < value.size() && value[pos] != '"'; ++pos) {
+                        if (value[pos] == '\\' && pos + 1 < value.size())
+                            ++pos;
+                        paramValue.push_back(value[pos]);
+                    }
+                    if (pos < value.size())
+                        ++pos;
+                }
+                else {
+                    const auto valueEnd = value.find_first_of(";,", pos);
+                    paramValue = value.substr(pos, valueEnd == std::string::npos ? std::string::npos : valueEnd - pos);
+                    trim(paramValue);
+                    pos = (valueEnd == std::string::npos) ? value.size() : valueEnd;
+                }
+                if (name == "rel") {
+                    // several relation types are separated by spaces
+                    toLower(paramValue);
+                    std::istringstream relations(paramValue);
+                    std::string relation;
+                    while (relations >> relation) {
+                        if (relation == "next")
+                            isNext = true;
+                    }
+                }
+            }
+            if (isNext)
+                return target;
+            ++pos;
+        }
+    }
+    return std::string();
+}
+
+std::string resolveUrl(const std::string& baseUrl, const std::string& reference)
+{
+    if (isAbsoluteUrl(reference))
+        return reference;
+#if CURL_AT_LEAST_VERSION(7,62,0)
+    auto hUrl = parseUrl(baseUrl);
+    // a relative reference is resolved against the URL already set
+    const CURLUcode rc = curl_url_set(hUrl.get(), CURLUPART_URL, reference.c_str(), 0);
+    if (rc != CURLUE_OK)
+        throw std::runtime_error("Invalid URL \"" + reference + "\": " + curl_url_strerror(rc));
+    return getUrl(hUrl.get());
+#else
+    throw std::runtime_error("Relative page URLs are not supported with the current version of libcurl (minimum version 7.62.0).");
+#endif
+}
+
+std::string setQueryParameter(const std::string& url, const std::string& name, const std::string& value)
+{
+#if CURL_AT_LEAST_VERSION(7,62,0)
+    auto hUrl = parseUrl(url);
+    char* query = nullptr;
+    std::string newQuery;
+    if (curl_url_get(hUrl.get(), CURLUPART_QUERY, &query, 0) == CURLUE_OK && query) {
+        // other parameters are kept as they are
+        std::istringstream parameters(query);
+        curl_free(query);
+        std::string parameter;
+        while (std::getline(parameters, parameter, '&')) {
+            if (parameter.empty() || parameter.substr(0, parameter.find('=')) == name)
+                continue;
+            if (!newQuery.empty())
+                newQuery.push_back('&');
+            newQuery += parameter;
+        }
+    }
+    CURLUcode rc = curl_url_set(hUrl.get(), CURLUPART_QUERY, newQuery.empty() ? nullptr : newQuery.c_str(), 0);
+    if (rc == CURLUE_OK) {
+        const std::string parameter = name + "=" + value;
+        rc = curl_url_set(hUrl.get(), CURLUPART_QUERY, parameter.c_str(), CURLU_APPENDQUERY | CURLU_URLENCODE);
+    }
+    if (rc != CURLUE_OK)
+        throw std::runtime_error(curl_url_strerror(rc));
+    return getUrl(hUrl.get());
+#else
+    throw std::runtime_error("Query parameters are not supported with the current version of libcurl (minimum version 7.62.0).");
+#endif
+}
+
+
+Paginator::Paginator(const std::string& url, const Configure& configure, const PaginationSettings& settings,
+    MemoryBudget& budget, int64_t attachmentId)
+    : m_configure(configure)
+    , m_settings(settings)
+    , m_url(url)
+    , m_budget(budget)
+    , m_attachmentId(attachmentId)
+    , m_curl(Runtime::instance().createHandle(), &curl_easy_cleanup)
+{
+    if (!m_curl)
+        throw std::runtime_error("Can't initialize CURL.");
+
+    switch (m_settings.mode) {
+    case PaginationMode::Link:
+        break;
+    case PaginationMode::Cursor:
+        if (m_settings.cursorPath.empty())
+            throw std::runtime_error("The cursor path is required for CURSOR pagination.");
+        break;
+    case PaginationMode::Offset:
+        if (m_settings.pageSize == 0)
+            throw std::runtime_error("The page size is required for OFFSET pagination.");
+        // fall through
+    case PaginationMode::Page:
+        if (m_settings.parameter.empty())
+            throw std::runtime_error("The page parameter is required for OFFSET and PAGE pagination.");
+        if (m_settings.itemsPath.empty())
+            throw std::runtime_error("The items path is required for OFFSET and PAGE pagination.");
+        break;
+    }
+
+    if (!m_settings.itemsPath.empty()) {
+        m_itemsPathIndex = m_paths.size();
+        m_paths.emplace_back(m_settings.itemsPath);
+    }
+    if (m_settings.mode == PaginationMode::Cursor) {
+        m_cursorPathIndex = m_paths.size();
+        m_paths.emplace_back(m_settings.cursorPath);
+    }
+
+    std::string firstUrl = m_url;
+    if (m_settings.mode == PaginationMode::Offset)
+        firstUrl = setQueryParameter(m_url, m_settings.parameter, "0");
+    else if (m_settings.mode == PaginationMode::Page)
+        firstUrl = setQueryParameter(m_url, m_settings.parameter, "1");
+    start(firstUrl, 1);
+}
+
+Paginator::~Paginator()
+{
+    if (m_pending.valid()) {
+        m_cancelled = true;
+        m_pending.wait();
+    }
+}
+
+int Paginator::progress_callback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    auto paginator = static_cast<Paginator*>(clientp);
+    // a non-zero value aborts the transfer
+    return paginator->m_cancelled ? 1 : 0;
+}
+
+void Paginator::start(const std::string& url, uint64_t number)
+{
+    m_pending = std::async(std::launch::async, &Paginator::fetch, this, url, number);
+}
+
+bool Paginator::next(PageInfo& page)
+{
+    if (!m_pending.valid())
+        return false;
+    // rethrows the error of the request
+    page = m_pending.get();
+
+    if (!page.isSuccess() || page.nextUrl.empty())
+        return true;
+    if (m_settings.maxPages > 0 && page.number >= m_settings.maxPages)
+        return true;
+    start(page.nextUrl, page.number + 1);
+    return true;
+}
+
+PageInfo Paginator::fetch(const std::string& url, uint64_t number)
+{
+    CURL* curl = m_curl.get();
+    // the connection of the previous page stays in the handle
+    curl_easy_reset(curl);
+    Runtime::setDefaults(curl);
+
+    char errorBuffer[CURL_ERROR_SIZE];
+    memset(errorBuffer, 0, CURL_ERROR_SIZE);
+
+    PageInfo page;
+    page.number = number;
+    page.url = url;
+    page.memory = MemoryReservation(m_budget, m_attachmentId);
+    PageHeaders headers;
+
+    m_configure(curl);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errorBuffer);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, collect_page_header);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &page);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect_page_body);
+#if CURL_AT_LEAST_VERSION(7,32,0)
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
+#endif
+
+    const CURLcode rc = curl_easy_perform(curl);
+    if (rc != CURLE_OK)
+        throw std::runtime_error("Request for page " + std::to_string(number) + " failed: " + getCurlError(rc, errorBuffer));
+
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &page.statusCode);
+#if CURL_AT_LEAST_VERSION(7,50,0)
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &page.httpVersion);
+#else
+    page.httpVersion = CURL_HTTP_VERSION_1_1;
+#endif
+    char* contentType = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &contentType);
+    if (contentType)
+        page.contentType.assign(contentType);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &page.totalTime);
+    std::string effectiveUrl = url;
+    char* sEffectiveUrl = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &sEffectiveUrl);
+    if (sEffectiveUrl)
+        effectiveUrl.assign(sEffectiveUrl);
+    page.headers = std::move(headers.text);
+
+    // an error response is returned as it is and ends the pagination
+    if (!page.isSuccess())
+        return page;
+
+    std::string cursor;
+    bool cursorFound = false;
+    if (!m_paths.empty()) {
+        if (m_settings.itemsPath.size() > 0)
+            page.itemCount = 0;
+        JsonStreamParser parser(m_paths, [this, &page, &cursor, &cursorFound](size_t pathIndex, const std::string&, JsonType type, std::string& value) {
+            if (!m_settings.itemsPath.empty() && pathIndex == m_itemsPathIndex) {
+                ++page.itemCount;
+            }
+            if (m_settings.mode == PaginationMode::Cursor && pathIndex == m_cursorPathIndex && !cursorFound) {
+                cursorFound = (type != JsonType::Null);
+                if (cursorFound)
+                    cursor = std::move(value);
+            }
+        });
+        try {
+            parser.parse(page.body.data(), page.body.size());
+            parser.finish();
+        }
+        catch (const std::runtime_error& e) {
+            throw std::runtime_error("Page " + std::to_string(number) + ": " + e.what());
+        }
+    }
+
+    if (m_settings.mode == PaginationMode::Link) {
+        const std::string link = findNextLink(headers.links);
+        if (!link.empty())
+            page.nextUrl = resolveUrl(effectiveUrl, link);
+    }
+    else {
+        page.nextUrl = getNextUrl(page, cursor, cursorFound);
+    }
+    return page;
+}
+
+std::string Paginator::getNextUrl(const PageInfo& page, const std::string& cursor, bool cursorFound) const
+{
+    switch (m_settings.mode) {
+    case PaginationMode::Cursor:
+        if (!cursorFound || cursor.empty())
+            return std::string();
+        // the cursor can be the URL of the next page itself
+        if (isAbsoluteUrl(cursor) || cursor[0] == '/' || cursor[0] == '?')
+            return resolveUrl(page.url, cursor);
+        if (m_settings.parameter.empty())
+            throw std::runtime_error("The cursor \"" + cursor + "\" is not a URL, the page parameter is required to pass it.");
+        return setQueryParameter(m_url, m_settings.parameter, cursor);
+
+    case PaginationMode::Offset:
+        // a short page is the last one
+        if (static_cast<uint64_t>(page.itemCount) < m_settings.pageSize)
+            return std::string();
+        return setQueryParameter(m_url, m_settings.parameter, std::to_string(page.number * m_settings.pageSize));
+
+    case PaginationMode::Page:
+        if (page.itemCount == 0 || static_cast<uint64_t>(page.itemCount) < m_settings.pageSize)
+            return std::string();
+        return setQueryParameter(m_url, m_settings.parameter, std::to_string(page.number + 1));
+
+    default:
+        return std::string();
+    }
+}
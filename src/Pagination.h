@@ -0,0 +1,133 @@
+#pragma once
+
+#ifndef PAGINATION_H
+#define PAGINATION_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "JsonStream.h"
+#include "MemoryBudget.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <cstdint>
+#include <curl/curl.h>
+
+enum class PaginationMode {
+    Link,    // RFC 8288 Link header with rel="next"
+    Cursor,  // next cursor or URL in the JSON body
+    Offset,  // offset query parameter increased by the page size
+    Page     // page number query parameter
+};
+
+// Throws an exception for an unknown name.
+PaginationMode getPaginationMode(const std::string& name);
+
+struct PaginationSettings
+{
+    PaginationMode mode = PaginationMode::Link;
+    std::string parameter;    // query parameter of the cursor, offset or page number
+    std::string cursorPath;   // JSON path of the next cursor
+    std::string itemsPath;    // JSON path of the items of a page
+    uint64_t pageSize = 0;
+    uint64_t maxPages = 0;    // 0 - unlimited
+};
+
+struct PageInfo
+{
+    uint64_t number = 0;      // starting from 1
+    std::string url;
+    long statusCode = 0;
+    long httpVersion = 0;
+    std::string contentType;
+    std::string headers;
+    std::string body;
+    int64_t itemCount = -1;   // -1 if the items are not counted
+    double totalTime = 0;
+    std::string nextUrl;      // empty for the last page
+    MemoryReservation memory; // the body counted in the memory budget until the page is released
+
+    bool isSuccess() const
+    {
+        return statusCode >= 200 && statusCode < 300;
+    }
+};
+
+// Returns the target of the link with rel="next" from the values of Link headers, or an empty string.
+std::string findNextLink(const std::vector<std::string>& links);
+
+// Resolves a relative reference against the base URL.
+std::string resolveUrl(const std::string& baseUrl, const std::string& reference);
+
+// Sets the value of a query parameter, replacing the existing one.
+std::string setQueryParameter(const std::string& url, const std::string& name, const std::string& value);
+
+/*
+ * Follows the pages of a collection. The request for the next page is sent
+ * in a background thread as soon as the current page is received, so it runs
+ * while the caller processes the current page. One connection is reused for all pages.
+ */
+class Paginator final
+{
+public:
+    // Sets the options and headers of the request, except the URL.
+    using Configure = std::function<void(CURL*)>;
+
+    // The request for the first page is started immediately. The bodies of the pages
+    // are counted in the memory budget of the attachment.
+    Paginator(const std::string& url, const Configure& configure, const PaginationSettings& settings,
+        MemoryBudget& budget, int64_t attachmentId);
+    // Aborts the request in progress.
+    ~Paginator();
+
+    Paginator(const Paginator&) = delete;
+    Paginator& operator=(const Paginator&) = delete;
+
+    // Waits for the next page and starts the request for the page after it.
+    // Returns false after the last page. A page with an error status is the last one.
+    bool next(PageInfo& page);
+
+private:
+    static int progress_callback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+    void start(const std::string& url, uint64_t number);
+    PageInfo fetch(const std::string& url, uint64_t number);
+    std::string getNextUrl(const PageInfo& page, const std::string& cursor, bool cursorFound) const;
+
+    Configure m_configure;
+    PaginationSettings m_settings;
+    std::string m_url;
+    std::vector<JsonPath> m_paths;
+    size_t m_itemsPathIndex = 0;
+    size_t m_cursorPathIndex = 0;
+    MemoryBudget& m_budget;
+    int64_t m_attachmentId;
+    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> m_curl;
+    std::future<PageInfo> m_pending;
+    std::atomic<bool> m_cancelled{ false };
+};
+
+#endif // PAGINATION_H
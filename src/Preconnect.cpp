@@ -0,0 +1,200 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			Preconnect.cpp
+ *	DESCRIPTION:	Warm-up of the connection pool.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Preconnect.h"
+#include "StringUtils.h"
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    size_t discardData(void*, size_t size, size_t nmemb, void*)
+    {
+        return size * nmemb;
+    }
+
+    struct ConnectionResult
+    {
+        bool ready = false;
+        bool opened = false;
+        std::string error;
+    };
+
+    ConnectionResult openConnection(PooledCurl& curl, const Endpoint& endpoint,
+        const std::function<void(CURL*)>& configure, const std::shared_ptr<const DnsLists>& dnsLists)
+    {
+        ConnectionResult result;
+        if (!curl) {
+            result.error = "Can't initialize CURL.";
+            return result;
+        }
+        char curlErrorBuffer[CURL_ERROR_SIZE];
+        memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+
+        try {
+            if (configure)
+                configure(curl);
+        }
+        catch (const std::exception& e) {
+            // the options are set in a worker thread, errors are returned with the result
+            result.error = e.what();
+            curl.discard();
+            return result;
+        }
+        if (dnsLists)
+            dnsLists->apply(curl);
+        endpoint.apply(curl);
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discardData);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, discardData);
+
+        const CURLcode curlResult = curl_easy_perform(curl);
+        if (curlResult != CURLE_OK) {
+            result.error.assign(curlErrorBuffer);
+            if (result.error.empty())
+                result.error.assign(curl_easy_strerror(curlResult));
+            // the handle has no connection worth keeping
+            curl.discard();
+            return result;
+        }
+        long connects = 0;
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+        result.ready = true;
+        result.opened = (connects > 0);
+        return result;
+    }
+}
+
+PreconnectResult preconnect(CurlHandlePool& pool, const Endpoint& endpoint, unsigned int connections,
+    const std::function<void(CURL*)>& configure, const std::shared_ptr<const DnsLists>& dnsLists)
+{
+    connections = std::min(std::max(connections, 1u), MAX_PRECONNECT_CONNECTIONS);
+
+    // all handles are taken from the pool before any of them is returned,
+    // otherwise the same handle would be warmed up several times
+    std::vector<std::unique_ptr<PooledCurl>> handles;
+    for (unsigned int i = 0; i < connections; ++i)
+        handles.emplace_back(new PooledCurl(pool, endpoint.getKey()));
+
+    // each handle keeps the connection of its own transfer, so they are not run in one multi handle;
+    // the handles are returned after all transfers finish, the futures are destroyed first
+    std::vector<std::future<ConnectionResult>> pending;
+    for (unsigned int i = 1; i < connections; ++i) {
+        pending.push_back(std::async(std::launch::async, openConnection,
+            std::ref(*handles[i]), std::cref(endpoint), std::cref(configure), std::cref(dnsLists)));
+    }
+
+    PreconnectResult result;
+    auto addResult = [&result](const ConnectionResult& connection) {
+        if (connection.ready) {
+            ++result.ready;
+            if (connection.opened)
+                ++result.opened;
+        }
+        else if (result.error.empty()) {
+            result.error = connection.error;
+        }
+    };
+    addResult(openConnection(*handles[0], endpoint, configure, dnsLists));
+    for (auto& connection : pending)
+        addResult(connection.get());
+    return result;
+}
+
+
+Preconnector& Preconnector::instance()
+{
+    static Preconnector* const preconnector = new Preconnector();
+    return *preconnector;
+}
+
+Preconnector::Preconnector()
+{
+}
+
+void Preconnector::requestStop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+}
+
+void Preconnector::join()
+{
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void Preconnector::start(const UdrConfig& config, CurlHandlePool& pool)
+{
+    std::vector<Origin> origins;
+    for (const auto& value : config.getValues("Preconnect")) {
+        std::istringstream stream(value);
+        Origin origin{ "", 1 };
+        stream >> origin.url;
+        if (origin.url.empty())
+            continue;
+        long long connections = 1;
+        if (stream >> connections) {
+            if (connections < 1)
+                throw std::runtime_error("Invalid number of connections of the parameter Preconnect in the configuration file " +
+                    config.getFileName());
+        }
+        origin.connections = static_cast<unsigned int>(std::min<long long>(connections, MAX_PRECONNECT_CONNECTIONS));
+        // the URL is checked now rather than in the background
+        Endpoint endpoint(origin.url);
+        origins.push_back(origin);
+    }
+    const auto interval = config.getInteger("PreconnectInterval", DEFAULT_PRECONNECT_INTERVAL.count());
+    m_interval = std::chrono::seconds(std::max<long long>(interval, 1));
+    m_origins = std::move(origins);
+
+    if (!m_origins.empty()) {
+        m_thread = std::thread(&Preconnector::run, this, std::ref(pool));
+        Runtime::instance().addService(*this);
+    }
+}
+
+void Preconnector::run(CurlHandlePool& pool)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        lock.unlock();
+        // the same handles are used again, which also keeps their connections from idling out
+        for (const auto& origin : m_origins) {
+            preconnect(pool, Endpoint(origin.url), origin.connections, nullptr,
+                DnsResolver::instance().getLists("", "", true, true));
+        }
+        lock.lock();
+        m_wakeUp.wait_for(lock, m_interval, [this]() { return m_stop; });
+    }
+}
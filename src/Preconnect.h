@@ -0,0 +1,98 @@
+#pragma once
+
+#ifndef PRECONNECT_H
+#define PRECONNECT_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Runtime.h"
+#include "ConnectionPool.h"
+#include "DnsResolver.h"
+#include "UdrConfig.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+constexpr unsigned int MAX_PRECONNECT_CONNECTIONS = 64;
+constexpr std::chrono::seconds DEFAULT_PRECONNECT_INTERVAL{ 30 };
+
+struct PreconnectResult
+{
+    unsigned int ready = 0;      // handles with a live connection returned to the pool
+    unsigned int opened = 0;     // connections opened, the others were already open
+    std::string error;           // error of the first failed connection
+};
+
+/*
+ * Opens connections to an endpoint and leaves them in the pool. Each of the handles
+ * sends a HEAD request of the URL at the same time, so every handle gets its own
+ * connection with DNS, TCP and TLS done. Connections opened with CURLOPT_CONNECT_ONLY
+ * are never reused by libcurl for other transfers, so a request is needed.
+ * The options set by configure must match those of the later requests,
+ * otherwise libcurl does not reuse the connections.
+ */
+PreconnectResult preconnect(CurlHandlePool& pool, const Endpoint& endpoint, unsigned int connections,
+    const std::function<void(CURL*)>& configure, const std::shared_ptr<const DnsLists>& dnsLists);
+
+/*
+ * Keeps the connections to the endpoints listed in the configuration warm:
+ * they are opened in the background when the library starts and refreshed
+ * every interval, so the pool holds live connections before the first request.
+ */
+class Preconnector final : public RuntimeService
+{
+public:
+    static Preconnector& instance();
+
+    // Reads the Preconnect parameters, "Preconnect = <url> [<connections>]". Called once.
+    void start(const UdrConfig& config, CurlHandlePool& pool);
+
+    void requestStop() override;
+    void join() override;
+
+private:
+    struct Origin
+    {
+        std::string url;
+        unsigned int connections;
+    };
+
+    Preconnector();
+
+    void run(CurlHandlePool& pool);
+
+    std::vector<Origin> m_origins;
+    std::chrono::seconds m_interval = DEFAULT_PRECONNECT_INTERVAL;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+#endif // PRECONNECT_H
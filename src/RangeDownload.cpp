@@ -0,0 +1,605 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			RangeDownload.cpp
+ *	DESCRIPTION:	Parallel download of a resource by byte ranges.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "RangeDownload.h"
+#include "StringUtils.h"
+#include "Runtime.h"
+#include "CurlCompat.h"
+#include <memory>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+    // Headers of the response. The fields describe the last response, so redirects are skipped.
+    struct ResponseHeaders
+    {
+        std::string text;
+        std::string entityTag;
+        std::string lastModified;
+        int64_t contentLength = -1;
+        int64_t rangeStart = -1;
+        bool acceptRanges = false;
+    };
+
+    size_t collect_header(char* ptr, size_t size, size_t nmemb, void* userdata)
+    {
+        auto headers = static_cast<ResponseHeaders*>(userdata);
+        const size_t length = size * nmemb;
+        headers->text.append(ptr, length);
+
+        std::string line(ptr, length);
+        if (line.compare(0, 5, "HTTP/") == 0) {
+            // status line of the next response
+            headers->entityTag.clear();
+            headers->lastModified.clear();
+            headers->contentLength = -1;
+            headers->rangeStart = -1;
+            headers->acceptRanges = false;
+            return length;
+        }
+        const auto colonPos = line.find(':');
+        if (colonPos == std::string::npos)
+            return length;
+
+        std::string name = line.substr(0, colonPos);
+        trim(name);
+        toLower(name);
+        std::string value = line.substr(colonPos + 1);
+        trim(value);
+
+        try {
+            if (name == "etag") {
+                headers->entityTag = value;
+            }
+            else if (name == "last-modified") {
+                headers->lastModified = value;
+            }
+            else if (name == "content-length") {
+                headers->contentLength = std::stoll(value);
+            }
+            else if (name == "accept-ranges") {
+                toLower(value);
+                headers->acceptRanges = (value == "bytes");
+            }
+            else if (name == "content-range") {
+                // bytes <start>-<end>/<size>
+                const auto startPos = value.find_first_of("0123456789");
+                if (value.compare(0, 5, "bytes") == 0 && startPos != std::string::npos)
+                    headers->rangeStart = std::stoll(value.substr(startPos));
+            }
+        }
+        catch (const std::logic_error&) {
+            // a malformed value is treated as a missing one
+        }
+        return length;
+    }
+
+    struct RangeTransfer
+    {
+        CURL* curl = nullptr;
+        size_t range = 0;
+        uint64_t offset = 0;    // next byte to receive
+        uint64_t end = 0;       // end of the range, exclusive
+        const ResourceInfo* resource = nullptr;
+        RangeTarget* target = nullptr;
+        ResponseHeaders headers;
+        bool checked = false;
+        bool fatal = false;
+        std::string error;
+        std::exception_ptr exception;
+        char errorBuffer[CURL_ERROR_SIZE];
+    };
+
+    size_t write_range(char* ptr, size_t size, size_t nmemb, void* userdata)
+    {
+        auto transfer = static_cast<RangeTransfer*>(userdata);
+        const size_t length = size * nmemb;
+        try {
+            if (!transfer->checked) {
+                long statusCode = 0;
+                curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &statusCode);
+                if (statusCode != 206) {
+                    // an error page is not written to the target
+                    transfer->error = "HTTP status " + std::to_string(statusCode) + " in response to a range request.";
+                    transfer->fatal = (statusCode != 408 && statusCode != 429 && statusCode < 500);
+                    return 0;
+                }
+                if (transfer->headers.rangeStart != static_cast<int64_t>(transfer->offset)) {
+                    transfer->error = "The server returned a different range than requested.";
+                    transfer->fatal = true;
+                    return 0;
+                }
+                if (!transfer->resource->entityTag.empty() && transfer->headers.entityTag != transfer->resource->entityTag) {
+                    transfer->error = "The resource was changed during the download.";
+                    transfer->fatal = true;
+                    return 0;
+                }
+                transfer->checked = true;
+            }
+            if (length > transfer->end - transfer->offset) {
+                transfer->error = "The server returned more data than requested.";
+                transfer->fatal = true;
+                return 0;
+            }
+            transfer->target->write(transfer->range, transfer->offset, ptr, length);
+            transfer->offset += length;
+        }
+        catch (...) {
+            transfer->exception = std::current_exception();
+            return 0;
+        }
+        return length;
+    }
+
+    struct WholeTransfer
+    {
+        RangeTarget* target = nullptr;
+        uint64_t offset = 0;
+        std::exception_ptr exception;
+    };
+
+    size_t write_whole(char* ptr, size_t size, size_t nmemb, void* userdata)
+    {
+        auto transfer = static_cast<WholeTransfer*>(userdata);
+        const size_t length = size * nmemb;
+        try {
+            transfer->target->write(0, transfer->offset, ptr, length);
+            transfer->offset += length;
+        }
+        catch (...) {
+            transfer->exception = std::current_exception();
+            return 0;
+        }
+        return length;
+    }
+
+    // Owns the multi handle and the active transfers.
+    class MultiTransfers final
+    {
+    public:
+        MultiTransfers()
+            : m_multi(Runtime::instance().createMulti())
+        {
+            if (!m_multi)
+                throw std::runtime_error("Can't initialize CURL.");
+        }
+
+        ~MultiTransfers()
+        {
+            for (auto& transfer : m_transfers) {
+                curl_multi_remove_handle(m_multi, transfer->curl);
+                curl_easy_cleanup(transfer->curl);
+            }
+            curl_multi_cleanup(m_multi);
+        }
+
+        MultiTransfers(const MultiTransfers&) = delete;
+        MultiTransfers& operator=(const MultiTransfers&) = delete;
+
+        CURLM* get() const
+        {
+            return m_multi;
+        }
+
+        size_t size() const
+        {
+            return m_transfers.size();
+        }
+
+        void add(std::unique_ptr<RangeTransfer> transfer)
+        {
+            m_transfers.push_back(std::move(transfer));
+            const CURLMcode rc = curl_multi_add_handle(m_multi, m_transfers.back()->curl);
+            if (rc != CURLM_OK)
+                throw std::runtime_error(curl_multi_strerror(rc));
+        }
+
+        std::unique_ptr<RangeTransfer> remove(CURL* curl)
+        {
+            auto it = std::find_if(m_transfers.begin(), m_transfers.end(),
+                [curl](const std::unique_ptr<RangeTransfer>& transfer) { return transfer->curl == curl; });
+            std::unique_ptr<RangeTransfer> transfer(std::move(*it));
+            m_transfers.erase(it);
+            curl_multi_remove_handle(m_multi, transfer->curl);
+            curl_easy_cleanup(transfer->curl);
+            transfer->curl = nullptr;
+            return transfer;
+        }
+
+    private:
+        CURLM* m_multi;
+        std::vector<std::unique_ptr<RangeTransfer>> m_transfers;
+    };
+
+    std::string getCurlError(CURLcode code, const char* errorBuffer)
+    {
+        std::string message(errorBuffer);
+        if (message.empty())
+            message.assign(curl_easy_strerror(code));
+        return message;
+    }
+}
+
+
+RangeDownloader::RangeDownloader(const Configure& configure, const RangeDownloadSettings& settings)
+    : m_configure(configure)
+    , m_settings(settings)
+{
+    if (m_settings.connections == 0)
+        m_settings.connections = 1;
+}
+
+ResourceInfo RangeDownloader::probe(const std::string& url)
+{
+    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> curl(Runtime::instance().createHandle(), &curl_easy_cleanup);
+    if (!curl)
+        throw std::runtime_error("Can't initialize CURL.");
+
+    char errorBuffer[CURL_ERROR_SIZE];
+    memset(errorBuffer, 0, CURL_ERROR_SIZE);
+
+    m_configure(curl.get());
+    ResponseHeaders headers;
+    curl_easy_setopt(curl.get(), CURLOPT_ERRORBUFFER, errorBuffer);
+    curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, &headers);
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, collect_header);
+
+    const CURLcode rc = curl_easy_perform(curl.get());
+    if (rc != CURLE_OK)
+        throw std::runtime_error(getCurlError(rc, errorBuffer));
+
+    ResourceInfo resource;
+    curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &resource.statusCode);
+#if CURL_AT_LEAST_VERSION(7,50,0)
+    curl_easy_getinfo(curl.get(), CURLINFO_HTTP_VERSION, &resource.httpVersion);
+#else
+    resource.httpVersion = CURL_HTTP_VERSION_1_1;
+#endif
+    char* effectiveUrl = nullptr;
+    curl_easy_getinfo(curl.get(), CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+    resource.url = effectiveUrl ? effectiveUrl : url;
+    char* contentType = nullptr;
+    curl_easy_getinfo(curl.get(), CURLINFO_CONTENT_TYPE, &contentType);
+    if (contentType)
+        resource.contentType.assign(contentType);
+
+    resource.headers = std::move(headers.text);
+    resource.entityTag = headers.entityTag;
+    resource.lastModified = headers.lastModified;
+    resource.size = headers.contentLength;
+    resource.acceptRanges = headers.acceptRanges;
+    return resource;
+}
+
+uint64_t RangeDownloader::getRangeSize(uint64_t size) const
+{
+    if (m_settings.rangeSize > 0)
+        return m_settings.rangeSize;
+    // several ranges per connection, so that a slow connection does not delay the end of the download
+    const uint64_t rangeSize = size / (static_cast<uint64_t>(m_settings.connections) * 4);
+    return std::min(std::max(rangeSize, MIN_RANGE_SIZE), MAX_RANGE_SIZE);
+}
+
+void RangeDownloader::download(const ResourceInfo& resource, uint64_t rangeSize, const std::vector<bool>& completed,
+    RangeTarget& target)
+{
+    const uint64_t size = static_cast<uint64_t>(resource.size);
+    const size_t rangeCount = completed.size();
+
+    std::vector<uint64_t> positions(rangeCount);
+    std::vector<unsigned int> retries(rangeCount, 0);
+    std::vector<bool> done(completed);
+    std::deque<size_t> pending;
+    for (size_t i = 0; i < rangeCount; i++) {
+        positions[i] = i * rangeSize;
+        if (!done[i])
+            pending.push_back(i);
+    }
+    size_t firstIncomplete = 0;
+    while (firstIncomplete < rangeCount && done[firstIncomplete])
+        ++firstIncomplete;
+
+    MultiTransfers transfers;
+#if CURL_AT_LEAST_VERSION(7,43,0)
+    // every range needs its own connection, multiplexing them over one HTTP/2 connection gives nothing
+    curl_multi_setopt(transfers.get(), CURLMOPT_PIPELINING, CURLPIPE_NOTHING);
+#endif
+#if CURL_AT_LEAST_VERSION(7,30,0)
+    curl_multi_setopt(transfers.get(), CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(m_settings.connections));
+#endif
+
+    while (true) {
+        while (transfers.size() < m_settings.connections && !pending.empty()) {
+            const size_t range = pending.front();
+            if (m_settings.window > 0 && range >= firstIncomplete + m_settings.window)
+                break;
+            pending.pop_front();
+
+            std::unique_ptr<RangeTransfer> transfer(new RangeTransfer);
+            transfer->curl = Runtime::instance().createHandle();
+            if (!transfer->curl)
+                throw std::runtime_error("Can't initialize CURL.");
+            transfer->range = range;
+            transfer->offset = positions[range];
+            transfer->end = std::min<uint64_t>((range + 1) * rangeSize, size);
+            transfer->resource = &resource;
+            transfer->target = &target;
+            memset(transfer->errorBuffer, 0, CURL_ERROR_SIZE);
+
+            const std::string byteRange = std::to_string(transfer->offset) + "-" + std::to_string(transfer->end - 1);
+            CURL* curl = transfer->curl;
+            m_configure(curl);
+            curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->errorBuffer);
+            curl_easy_setopt(curl, CURLOPT_URL, resource.url.c_str());
+            curl_easy_setopt(curl, CURLOPT_RANGE, byteRange.c_str());
+            curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer->headers);
+            curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, collect_header);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.get());
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_range);
+            transfers.add(std::move(transfer));
+        }
+        if (transfers.size() == 0)
+            break;
+
+        int running = 0;
+        const CURLMcode mrc = curl_multi_perform(transfers.get(), &running);
+        if (mrc != CURLM_OK)
+            throw std::runtime_error(curl_multi_strerror(mrc));
+
+        int finished = 0;
+        int messagesLeft = 0;
+        while (CURLMsg* message = curl_multi_info_read(transfers.get(), &messagesLeft)) {
+            if (message->msg != CURLMSG_DONE)
+                continue;
+            ++finished;
+            const CURLcode result = message->data.result;
+            long statusCode = 0;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_RESPONSE_CODE, &statusCode);
+            auto transfer = transfers.remove(message->easy_handle);
+
+            if (transfer->exception)
+                std::rethrow_exception(transfer->exception);
+
+            const size_t range = transfer->range;
+            positions[range] = transfer->offset;
+            if (result == CURLE_OK && statusCode == 206 && transfer->offset == transfer->end) {
+                target.rangeCompleted(range);
+                done[range] = true;
+                while (firstIncomplete < rangeCount && done[firstIncomplete])
+                    ++firstIncomplete;
+                continue;
+            }
+
+            std::string error = transfer->error;
+            if (error.empty()) {
+                if (result != CURLE_OK)
+                    error = getCurlError(result, transfer->errorBuffer);
+                else if (statusCode != 206)
+                    error = "HTTP status " + std::to_string(statusCode) + " in response to a range request.";
+                else
+                    error = "The connection was closed before the whole range was received.";
+            }
+            // a transfer stopped by the caller is not repeated
+            const bool retryable = !transfer->fatal && result != CURLE_ABORTED_BY_CALLBACK &&
+                (statusCode == 206 || statusCode == 0 || statusCode == 408 || statusCode == 429 || statusCode >= 500);
+            if (!retryable || retries[range] >= m_settings.maxRetries) {
+                throw std::runtime_error("Download of bytes " + std::to_string(range * rangeSize) + "-" +
+                    std::to_string(transfer->end - 1) + " failed: " + error);
+            }
+            // the range is continued from the last received byte
+            ++retries[range];
+            ++m_retryCount;
+            pending.push_front(range);
+        }
+
+        if (finished == 0 && running > 0) {
+#if CURL_AT_LEAST_VERSION(7,66,0)
+            curl_multi_poll(transfers.get(), nullptr, 0, 1000, nullptr);
+#else
+            curl_multi_wait(transfers.get(), nullptr, 0, 1000, nullptr);
+#endif
+        }
+    }
+}
+
+ResourceInfo RangeDownloader::downloadWhole(const std::string& url, RangeTarget& target)
+{
+    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> curl(Runtime::instance().createHandle(), &curl_easy_cleanup);
+    if (!curl)
+        throw std::runtime_error("Can't initialize CURL.");
+
+    char errorBuffer[CURL_ERROR_SIZE];
+    memset(errorBuffer, 0, CURL_ERROR_SIZE);
+
+    m_configure(curl.get());
+    ResponseHeaders headers;
+    WholeTransfer transfer;
+    transfer.target = &target;
+    curl_easy_setopt(curl.get(), CURLOPT_ERRORBUFFER, errorBuffer);
+    curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, &headers);
+    curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, collect_header);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &transfer);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, write_whole);
+
+    const CURLcode rc = curl_easy_perform(curl.get());
+    if (transfer.exception)
+        std::rethrow_exception(transfer.exception);
+    if (rc != CURLE_OK)
+        throw std::runtime_error(getCurlError(rc, errorBuffer));
+
+    ResourceInfo resource;
+    curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &resource.statusCode);
+#if CURL_AT_LEAST_VERSION(7,50,0)
+    curl_easy_getinfo(curl.get(), CURLINFO_HTTP_VERSION, &resource.httpVersion);
+#else
+    resource.httpVersion = CURL_HTTP_VERSION_1_1;
+#endif
+    char* effectiveUrl = nullptr;
+    curl_easy_getinfo(curl.get(), CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+    resource.url = effectiveUrl ? effectiveUrl : url;
+    char* contentType = nullptr;
+    curl_easy_getinfo(curl.get(), CURLINFO_CONTENT_TYPE, &contentType);
+    if (contentType)
+        resource.contentType.assign(contentType);
+
+    resource.headers = std::move(headers.text);
+    resource.entityTag = headers.entityTag;
+    resource.lastModified = headers.lastModified;
+    resource.size = static_cast<int64_t>(transfer.offset);
+    return resource;
+}
+
+
+FileRangeTarget::FileRangeTarget(const std::string& fileName, bool overwrite)
+    : m_file(fileName, overwrite)
+    , m_progressFileName(m_file.getPartFileName() + ".progress")
+{
+}
+
+std::vector<bool> FileRangeTarget::start(const ResourceInfo& resource, uint64_t& rangeSize)
+{
+    const uint64_t size = static_cast<uint64_t>(resource.size);
+    std::vector<bool> completed;
+    m_resumedSize = 0;
+
+    // Without a validator there is no way to know that the partial file
+    // belongs to the same version of the resource.
+    std::string progressText;
+    if ((!resource.entityTag.empty() || !resource.lastModified.empty()) && fileExists(m_progressFileName)) {
+        // the progress file is read without following a symlink, as the partial file is opened
+        FileReader reader(m_progressFileName);
+        progressText.resize(static_cast<size_t>(reader.getSize()));
+        size_t length = 0;
+        while (length < progressText.size()) {
+            length += reader.read(&progressText[length], progressText.size() - length);
+        }
+    }
+    if (!progressText.empty()) {
+        std::istringstream progress(progressText);
+        std::string savedSize, savedRangeSize, savedEntityTag, savedLastModified;
+        std::vector<size_t> doneRanges;
+        std::string line;
+        while (std::getline(progress, line)) {
+            const auto eqPos = line.find('=');
+            if (eqPos == std::string::npos)
+                continue;
+            const std::string key = line.substr(0, eqPos);
+            const std::string value = line.substr(eqPos + 1);
+            if (key == "size")
+                savedSize = value;
+            else if (key == "range_size")
+                savedRangeSize = value;
+            else if (key == "etag")
+                savedEntityTag = value;
+            else if (key == "last_modified")
+                savedLastModified = value;
+            else if (key == "done")
+                doneRanges.push_back(static_cast<size_t>(std::strtoull(value.c_str(), nullptr, 10)));
+        }
+        const uint64_t previousRangeSize = std::strtoull(savedRangeSize.c_str(), nullptr, 10);
+        if (savedSize == std::to_string(size) && previousRangeSize > 0 &&
+            savedEntityTag == resource.entityTag && savedLastModified == resource.lastModified)
+        {
+            rangeSize = previousRangeSize;
+            completed.assign(static_cast<size_t>((size + rangeSize - 1) / rangeSize), false);
+            for (const auto range : doneRanges) {
+                if (range < completed.size() && !completed[range]) {
+                    completed[range] = true;
+                    m_resumedSize += std::min<uint64_t>(rangeSize, size - range * rangeSize);
+                }
+            }
+        }
+    }
+
+    if (m_resumedSize > 0) {
+        m_progress.reset(new FileAppender(m_progressFileName));
+    }
+    else {
+        completed.assign(static_cast<size_t>((size + rangeSize - 1) / rangeSize), false);
+        m_file.truncate();
+        openProgress(resource, rangeSize);
+    }
+    return completed;
+}
+
+void FileRangeTarget::openProgress(const ResourceInfo& resource, uint64_t rangeSize)
+{
+    m_progress.reset();
+    // the file is replaced under a new name, so an existing symlink is never followed
+    std::ostringstream header;
+    header << "size=" << resource.size << "\n"
+        << "range_size=" << rangeSize << "\n"
+        << "etag=" << resource.entityTag << "\n"
+        << "last_modified=" << resource.lastModified << "\n";
+    AtomicFileWriter writer(m_progressFileName, FileSyncMode::None, true);
+    const std::string text = header.str();
+    writer.write(text.data(), text.size());
+    writer.commit();
+    m_progress.reset(new FileAppender(m_progressFileName));
+}
+
+void FileRangeTarget::restart()
+{
+    m_resumedSize = 0;
+    m_file.truncate();
+    removeFile(m_progressFileName);
+}
+
+void FileRangeTarget::write(size_t, uint64_t offset, const void* data, size_t length)
+{
+    m_file.write(offset, data, length);
+}
+
+void FileRangeTarget::rangeCompleted(size_t range)
+{
+    // The range is recorded only after its data is on disk,
+    // so the progress file never refers to data that may be lost.
+    m_file.sync();
+    m_progress->append("done=" + std::to_string(range) + "\n");
+}
+
+void FileRangeTarget::commit()
+{
+    m_progress.reset();
+    m_file.commit();
+    removeFile(m_progressFileName);
+}
+
+void FileRangeTarget::discard()
+{
+    m_progress.reset();
+    m_file.discard();
+    removeFile(m_progressFileName);
+}
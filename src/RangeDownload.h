@@ -0,0 +1,151 @@
+#pragma once
+
+#ifndef RANGE_DOWNLOAD_H
+#define RANGE_DOWNLOAD_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "FileUtils.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <curl/curl.h>
+
+constexpr uint64_t MIN_RANGE_SIZE = 1024 * 1024;
+constexpr uint64_t MAX_RANGE_SIZE = 64 * 1024 * 1024;
+
+struct RangeDownloadSettings
+{
+    unsigned int connections = 4;
+    uint64_t rangeSize = 0;       // 0 - chosen by the size of the resource
+    unsigned int maxRetries = 3;  // per range
+    size_t window = 0;            // how far ahead of the first incomplete range transfers may run, 0 - unlimited
+};
+
+// Response of the server to the probe (HEAD) or the whole (GET) request.
+struct ResourceInfo
+{
+    long statusCode = 0;
+    long httpVersion = 0;
+    std::string url;          // effective URL after redirects
+    std::string headers;
+    std::string contentType;
+    std::string entityTag;
+    std::string lastModified;
+    int64_t size = -1;        // -1 if unknown
+    bool acceptRanges = false;
+
+    bool isSuccess() const
+    {
+        return statusCode >= 200 && statusCode < 300;
+    }
+};
+
+/*
+ * Receiver of the downloaded ranges.
+ * Data of different ranges arrives interleaved, data of one range arrives in order.
+ */
+class RangeTarget
+{
+public:
+    virtual ~RangeTarget() = default;
+
+    virtual void write(size_t range, uint64_t offset, const void* data, size_t length) = 0;
+    virtual void rangeCompleted(size_t range) = 0;
+};
+
+/*
+ * Downloads a resource by byte ranges over several connections at once.
+ * All transfers are driven by one curl multi handle in the calling thread.
+ */
+class RangeDownloader final
+{
+public:
+    // Sets the options and headers of the request, except the URL and the range.
+    using Configure = std::function<void(CURL*)>;
+
+    RangeDownloader(const Configure& configure, const RangeDownloadSettings& settings);
+
+    // Sends a HEAD request to find out the size of the resource and whether it supports ranges.
+    ResourceInfo probe(const std::string& url);
+
+    uint64_t getRangeSize(uint64_t size) const;
+
+    // Downloads the ranges not marked as completed. Failed ranges are retried from the last received byte.
+    void download(const ResourceInfo& resource, uint64_t rangeSize, const std::vector<bool>& completed,
+        RangeTarget& target);
+
+    // Downloads the resource with a single GET request, when ranges are not supported.
+    ResourceInfo downloadWhole(const std::string& url, RangeTarget& target);
+
+    unsigned int getRetryCount() const
+    {
+        return m_retryCount;
+    }
+
+private:
+    Configure m_configure;
+    RangeDownloadSettings m_settings;
+    unsigned int m_retryCount = 0;
+};
+
+/*
+ * Writes the ranges to <fileName>.part and records the completed ones
+ * in <fileName>.part.progress, so that an interrupted download is resumed
+ * from the ranges already received.
+ */
+class FileRangeTarget final : public RangeTarget
+{
+public:
+    FileRangeTarget(const std::string& fileName, bool overwrite);
+
+    // Returns the completed ranges of a previous attempt if it downloaded the same version of the resource,
+    // otherwise starts from scratch. The range size of the previous attempt is kept.
+    std::vector<bool> start(const ResourceInfo& resource, uint64_t& rangeSize);
+    // Starts a download that cannot be resumed.
+    void restart();
+
+    void write(size_t range, uint64_t offset, const void* data, size_t length) override;
+    void rangeCompleted(size_t range) override;
+
+    void commit();
+    void discard();
+
+    uint64_t getResumedSize() const
+    {
+        return m_resumedSize;
+    }
+
+private:
+    void openProgress(const ResourceInfo& resource, uint64_t rangeSize);
+
+    PartialFile m_file;
+    std::string m_progressFileName;
+    std::unique_ptr<FileAppender> m_progress;
+    uint64_t m_resumedSize = 0;
+};
+
+#endif // RANGE_DOWNLOAD_H
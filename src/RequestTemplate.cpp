@@ -0,0 +1,226 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			RequestTemplate.cpp
+ *	DESCRIPTION:	Request templates with parameter substitution.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "RequestTemplate.h"
+#include "StringUtils.h"
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+    // Takes the member name from the location of a value of the root object: $.name or $['name'].
+    std::string getMemberName(const std::string& location)
+    {
+        if (location.compare(0, 2, "$.") == 0)
+            return location.substr(2);
+        if (location.compare(0, 3, "$['") != 0)
+            throw std::runtime_error("Template parameters must be a JSON object.");
+        std::string name;
+        for (size_t i = 3; i + 2 < location.size(); ++i) {
+            if (location[i] == '\\')
+                ++i;
+            name.push_back(location[i]);
+        }
+        return name;
+    }
+
+    void appendUrlEncoded(std::string& result, const std::string& value)
+    {
+        static const char hexDigits[] = "0123456789ABCDEF";
+        for (const char c : value) {
+            const auto u = static_cast<unsigned char>(c);
+            // unreserved characters of RFC 3986
+            if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') ||
+                u == '-' || u == '.' || u == '_' || u == '~')
+            {
+                result.push_back(c);
+            }
+            else {
+                result.push_back('%');
+                result.push_back(hexDigits[u >> 4]);
+                result.push_back(hexDigits[u & 0x0F]);
+            }
+        }
+    }
+
+    const std::vector<JsonPath>& getParameterPaths()
+    {
+        static const std::vector<JsonPath> paths{ JsonPath("$.*") };
+        return paths;
+    }
+}
+
+TemplateParameters::TemplateParameters(const std::string& json)
+{
+    JsonStreamParser parser(getParameterPaths(), [this](size_t, const std::string& location, JsonType type, std::string& value) {
+        m_parameters.push_back({ getMemberName(location), type, std::move(value) });
+    });
+    parser.parse(json.data(), json.size());
+    parser.finish();
+    if (parser.getDocumentCount() > 1)
+        throw std::runtime_error("Template parameters must be a single JSON object.");
+}
+
+const TemplateParameter* TemplateParameters::find(const std::string& name) const
+{
+    // there are few parameters, a linear search is the fastest
+    for (const auto& parameter : m_parameters) {
+        if (parameter.name == name)
+            return &parameter;
+    }
+    return nullptr;
+}
+
+
+TemplateText::TemplateText(const std::string& text, TemplateEscaping escaping)
+{
+    size_t pos = 0;
+    // for JSON the position inside or outside string literals is tracked
+    bool inString = false;
+    auto addLiteral = [this, escaping, &inString](const std::string& literal) {
+        if (literal.empty())
+            return;
+        if (escaping == TemplateEscaping::Json) {
+            for (size_t i = 0; i < literal.size(); ++i) {
+                if (literal[i] == '\\' && inString)
+                    ++i;
+                else if (literal[i] == '"')
+                    inString = !inString;
+            }
+        }
+        m_literalSize += literal.size();
+        if (!m_parts.empty() && !m_parts.back().isParameter)
+            m_parts.back().text += literal;
+        else
+            m_parts.push_back({ literal, false, TemplateEscaping::None });
+    };
+
+    while (pos < text.size()) {
+        const auto start = text.find("{{", pos);
+        if (start == std::string::npos)
+            break;
+        const auto end = text.find("}}", start + 2);
+        if (end == std::string::npos)
+            break;
+        std::string name = text.substr(start + 2, end - start - 2);
+        trim(name);
+        if (name.empty())
+            throw std::runtime_error("Empty parameter name in template at position " + std::to_string(start + 1) + ".");
+
+        addLiteral(text.substr(pos, start - pos));
+        TemplateEscaping partEscaping = escaping;
+        if (escaping == TemplateEscaping::Json)
+            partEscaping = inString ? TemplateEscaping::JsonString : TemplateEscaping::JsonValue;
+        m_parts.push_back({ name, true, partEscaping });
+        if (std::find(m_parameterNames.begin(), m_parameterNames.end(), name) == m_parameterNames.end())
+            m_parameterNames.push_back(name);
+        pos = end + 2;
+    }
+    addLiteral(text.substr(pos));
+}
+
+void TemplateText::render(const TemplateParameters& parameters, std::string& result) const
+{
+    for (const auto& part : m_parts) {
+        if (!part.isParameter) {
+            result += part.text;
+            continue;
+        }
+        const TemplateParameter* parameter = parameters.find(part.text);
+        if (!parameter)
+            throw std::runtime_error("Template parameter \"" + part.text + "\" is not specified.");
+
+        // JSON null is substituted as an empty string everywhere except JSON values
+        const bool isNull = (parameter->type == JsonType::Null);
+        switch (part.escaping) {
+        case TemplateEscaping::Url:
+            if (!isNull)
+                appendUrlEncoded(result, parameter->value);
+            break;
+        case TemplateEscaping::JsonValue:
+            if (parameter->type == JsonType::String) {
+                result.push_back('"');
+                appendJsonEscaped(result, parameter->value.data(), parameter->value.size());
+                result.push_back('"');
+            }
+            else {
+                result += parameter->value;
+            }
+            break;
+        case TemplateEscaping::JsonString:
+            if (!isNull)
+                appendJsonEscaped(result, parameter->value.data(), parameter->value.size());
+            break;
+        default:
+            if (!isNull)
+                result += parameter->value;
+        }
+    }
+}
+
+TemplateEscaping getBodyEscaping(const std::string& contentType)
+{
+    std::string type(contentType);
+    toLower(type);
+    const std::string mediaType = type.substr(0, type.find(';'));
+    if (mediaType.find("json") != std::string::npos)
+        return TemplateEscaping::Json;
+    if (mediaType.find("x-www-form-urlencoded") != std::string::npos)
+        return TemplateEscaping::Url;
+    return TemplateEscaping::None;
+}
+
+
+TemplateRegistry& TemplateRegistry::instance()
+{
+    static TemplateRegistry registry;
+    return registry;
+}
+
+void TemplateRegistry::put(const std::string& key, std::shared_ptr<const RequestTemplate> requestTemplate)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_templates.size() >= MAX_REGISTERED_TEMPLATES && m_templates.find(key) == m_templates.end())
+        throw std::runtime_error("Too many templates are registered, unregister unused ones with HTTP_TEMPLATE_UNREGISTER.");
+    // calls that already use the previous version keep it until they finish
+    m_templates[key] = std::move(requestTemplate);
+}
+
+std::shared_ptr<const RequestTemplate> TemplateRegistry::get(const std::string& key) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_templates.find(key);
+    if (it == m_templates.end())
+        return nullptr;
+    return it->second;
+}
+
+bool TemplateRegistry::remove(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // running calls keep the removed template until they finish
+    return m_templates.erase(key) != 0;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#ifndef REQUEST_TEMPLATE_H
+#define REQUEST_TEMPLATE_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "JsonStream.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <curl/curl.h>
+
+// How the values of parameters are escaped.
+enum class TemplateEscaping {
+    None,
+    Url,         // percent-encoding
+    Json,        // JSON value, or the content of a string if the placeholder is inside a string literal
+    JsonValue,
+    JsonString
+};
+
+struct TemplateParameter
+{
+    std::string name;
+    JsonType type;
+    std::string value;   // decoded content for strings, JSON text for other types
+};
+
+// Values of the parameters of one call, passed as a flat JSON object.
+class TemplateParameters final
+{
+public:
+    TemplateParameters() = default;
+    explicit TemplateParameters(const std::string& json);
+
+    const TemplateParameter* find(const std::string& name) const;
+
+private:
+    std::vector<TemplateParameter> m_parameters;
+};
+
+/*
+ * Text with {{name}} placeholders. The text is split into literal parts
+ * and parameters once, when the template is registered.
+ */
+class TemplateText final
+{
+public:
+    TemplateText() = default;
+    TemplateText(const std::string& text, TemplateEscaping escaping);
+
+    // Appends the text with the values of the parameters substituted.
+    void render(const TemplateParameters& parameters, std::string& result) const;
+
+    // Size of the text without parameters, the minimum size of the result.
+    size_t getLiteralSize() const
+    {
+        return m_literalSize;
+    }
+
+    const std::vector<std::string>& getParameterNames() const
+    {
+        return m_parameterNames;
+    }
+
+private:
+    struct Part
+    {
+        std::string text;           // literal text or parameter name
+        bool isParameter;
+        TemplateEscaping escaping;
+    };
+
+    std::vector<Part> m_parts;
+    std::vector<std::string> m_parameterNames;
+    size_t m_literalSize = 0;
+};
+
+// Escaping of the request body by its content type.
+TemplateEscaping getBodyEscaping(const std::string& contentType);
+
+struct CurlSlistDeleter
+{
+    void operator()(curl_slist* list) const
+    {
+        curl_slist_free_all(list);
+    }
+};
+
+// Request compiled by HTTP_TEMPLATE_REGISTER. It is immutable once registered.
+struct RequestTemplate
+{
+    std::string method;
+    TemplateText url;
+    TemplateText body;
+    bool hasBody = false;
+    std::unique_ptr<curl_slist, CurlSlistDeleter> headers;
+    std::map<long, std::string> curlOptions;
+};
+
+// Templates kept by the process for all databases.
+constexpr size_t MAX_REGISTERED_TEMPLATES = 10000;
+
+/*
+ * Templates of all attachments of the process. The key includes the database,
+ * so templates of different databases do not conflict.
+ */
+class TemplateRegistry final
+{
+public:
+    static TemplateRegistry& instance();
+
+    // Throws if a new template would exceed MAX_REGISTERED_TEMPLATES.
+    void put(const std::string& key, std::shared_ptr<const RequestTemplate> requestTemplate);
+    std::shared_ptr<const RequestTemplate> get(const std::string& key) const;
+    // Returns false if there is no such template.
+    bool remove(const std::string& key);
+
+private:
+    TemplateRegistry() = default;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<const RequestTemplate>> m_templates;
+};
+
+#endif // REQUEST_TEMPLATE_H
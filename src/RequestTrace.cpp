@@ -0,0 +1,330 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			RequestTrace.cpp
+ *	DESCRIPTION:	Trace of the recent requests.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "RequestTrace.h"
+#include "StringUtils.h"
+#include "Runtime.h"
+#include "CurlCompat.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+
+namespace
+{
+    // Copies at most size - 1 bytes without cutting a UTF-8 sequence.
+    size_t copyField(char* dest, size_t size, const char* value, size_t length)
+    {
+        if (length >= size) {
+            length = size - 1;
+            while (length > 0 && (static_cast<unsigned char>(value[length]) & 0xC0) == 0x80)
+                --length;
+        }
+        memcpy(dest, value, length);
+        dest[length] = '\0';
+        return length;
+    }
+
+    size_t copyField(char* dest, size_t size, const std::string& value)
+    {
+        return copyField(dest, size, value.data(), value.size());
+    }
+
+    int64_t getTime(CURL* curl, CURLINFO info)
+    {
+#if CURL_AT_LEAST_VERSION(7,61,0)
+        curl_off_t value = 0;
+        curl_easy_getinfo(curl, info, &value);
+        return static_cast<int64_t>(value);
+#else
+        double value = 0;
+        curl_easy_getinfo(curl, info, &value);
+        return static_cast<int64_t>(value * 1000000);
+#endif
+    }
+
+    int64_t getSize(CURL* curl, CURLINFO info)
+    {
+#if CURL_AT_LEAST_VERSION(7,55,0)
+        curl_off_t value = 0;
+        curl_easy_getinfo(curl, info, &value);
+        return static_cast<int64_t>(value);
+#else
+        double value = 0;
+        curl_easy_getinfo(curl, info, &value);
+        return static_cast<int64_t>(value);
+#endif
+    }
+
+    bool isSecretHeader(const std::string& line)
+    {
+        std::string name = line.substr(0, line.find(':'));
+        toLower(name);
+        return name == "authorization" || name == "proxy-authorization" || name == "cookie" || name == "set-cookie";
+    }
+}
+
+std::string redactUrl(const std::string& url)
+{
+    std::string result(url, 0, url.find('#'));
+    const auto schemeEnd = result.find("://");
+    if (schemeEnd != std::string::npos) {
+        const auto authorityStart = schemeEnd + 3;
+        const auto authorityEnd = std::min(result.find_first_of("/?", authorityStart), result.size());
+        const auto atPos = result.rfind('@', authorityEnd);
+        if (atPos != std::string::npos && atPos >= authorityStart)
+            result.erase(authorityStart, atPos + 1 - authorityStart);
+    }
+    const auto queryStart = result.find('?');
+    if (queryStart == std::string::npos)
+        return result;
+    std::string query;
+    size_t pos = queryStart + 1;
+    while (pos <= result.size()) {
+        auto end = result.find('&', pos);
+        if (end == std::string::npos)
+            end = result.size();
+        const auto eqPos = result.find('=', pos);
+        query.push_back(query.empty() ? '?' : '&');
+        if (eqPos != std::string::npos && eqPos < end)
+            query.append(result, pos, eqPos + 1 - pos).append("***");
+        else
+            query.append(result, pos, end - pos);
+        pos = end + 1;
+    }
+    result.erase(queryStart);
+    return result + query;
+}
+
+std::tm toLocalTime(int64_t time)
+{
+    const std::time_t seconds = static_cast<std::time_t>(time / 1000000);
+    std::tm result{};
+#ifdef _WIN32
+    localtime_s(&result, &seconds);
+#else
+    localtime_r(&seconds, &result);
+#endif
+    return result;
+}
+
+
+RequestTrace& RequestTrace::instance()
+{
+    static RequestTrace* const trace = new RequestTrace();
+    return *trace;
+}
+
+RequestTrace::RequestTrace()
+{
+}
+
+void RequestTrace::configure(size_t size, unsigned int wireSampleRate)
+{
+    m_size = std::min(size, MAX_TRACE_BUFFER_SIZE);
+    m_wireSampleRate = wireSampleRate;
+    if (m_size > 0)
+        m_slots.reset(new Slot[m_size]);
+}
+
+bool RequestTrace::sampleWire()
+{
+    if (m_wireSampleRate == 0)
+        return false;
+    return m_wireCounter.fetch_add(1, std::memory_order_relaxed) % m_wireSampleRate == 0;
+}
+
+void RequestTrace::record(const TraceEntry& entry)
+{
+    if (m_size == 0)
+        return;
+    const uint64_t id = m_next.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[id % m_size];
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    // a writer that has lapped the buffer is still writing the slot
+    if ((sequence & 1) != 0 ||
+        !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed))
+    {
+        m_dropCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // the unused part of the wire trace is not copied
+    memcpy(&slot.entry, &entry, offsetof(TraceEntry, wire));
+    memcpy(slot.entry.wire, entry.wire, entry.wireLength + 1);
+    slot.entry.id = id;
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+std::vector<TraceEntry> RequestTrace::dump() const
+{
+    std::vector<TraceEntry> entries;
+    if (m_size == 0)
+        return entries;
+    entries.reserve(m_size);
+    std::unique_ptr<TraceEntry> entry(new TraceEntry);
+    for (size_t i = 0; i < m_size; ++i) {
+        const Slot& slot = m_slots[i];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == 0 || (sequence & 1) != 0)
+            continue;
+        memcpy(entry.get(), &slot.entry, offsetof(TraceEntry, wire));
+        memcpy(entry->wire, slot.entry.wire, std::min(entry->wireLength, TRACE_WIRE_SIZE - 1) + 1);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // the slot was overwritten while it was copied
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+        entries.push_back(*entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const TraceEntry& a, const TraceEntry& b) {
+        return a.id < b.id;
+    });
+    return entries;
+}
+
+
+TransferTrace::TransferTrace(RequestTrace& trace, CURL* curl)
+    : m_trace(trace)
+{
+    if (!m_trace.isEnabled() || !m_trace.sampleWire())
+        return;
+    m_wireData.reserve(TRACE_WIRE_SIZE);
+    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, debugCallback);
+    curl_easy_setopt(curl, CURLOPT_DEBUGDATA, this);
+    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+}
+
+int TransferTrace::debugCallback(CURL*, curl_infotype type, char* data, size_t size, void* userptr)
+{
+    auto trace = static_cast<TransferTrace*>(userptr);
+    switch (type) {
+    case CURLINFO_TEXT:
+        trace->append('*', data, size);
+        break;
+    case CURLINFO_HEADER_OUT:
+        trace->append('>', data, size);
+        break;
+    case CURLINFO_HEADER_IN:
+        trace->append('<', data, size);
+        break;
+    default:
+        // bodies and TLS data are not recorded
+        break;
+    }
+    return 0;
+}
+
+void TransferTrace::append(char prefix, const char* data, size_t size)
+{
+    const char* end = data + size;
+    // libcurl passes the headers of a request at once, starting with the request line
+    bool requestLine = (prefix == '>');
+    while (data < end && m_wireData.size() < TRACE_WIRE_SIZE) {
+        const char* lineEnd = std::find(data, end, '\n');
+        std::string line(data, lineEnd);
+        data = (lineEnd == end) ? end : lineEnd + 1;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+        if (requestLine) {
+            const auto targetStart = line.find(' ');
+            const auto targetEnd = line.rfind(' ');
+            if (targetStart != std::string::npos && targetEnd > targetStart) {
+                line = line.substr(0, targetStart + 1) +
+                    redactUrl(line.substr(targetStart + 1, targetEnd - targetStart - 1)) + line.substr(targetEnd);
+            }
+            requestLine = false;
+        }
+        else if (prefix != '*' && isSecretHeader(line)) {
+            line = line.substr(0, line.find(':') + 1) + " ***";
+        }
+        else if (prefix == '*') {
+            // HTTP/2 shows the pseudo-headers of the request as text
+            const auto pathPos = line.find("[:path: ");
+            if (pathPos != std::string::npos) {
+                const auto pathStart = pathPos + 8;
+                const auto pathEnd = std::min(line.find(']', pathStart), line.size());
+                line = line.substr(0, pathStart) + redactUrl(line.substr(pathStart, pathEnd - pathStart)) + line.substr(pathEnd);
+            }
+        }
+        m_wireData.push_back(prefix);
+        m_wireData.push_back(' ');
+        m_wireData.append(line);
+        m_wireData.push_back('\n');
+    }
+}
+
+void TransferTrace::record(int64_t attachmentId, const std::string& method, CURL* curl, CURLcode curlResult, const char* error)
+{
+    if (!m_trace.isEnabled())
+        return;
+    // the entry is too large for the stack of the server threads
+    thread_local TraceEntry threadEntry;
+    TraceEntry* entry = &threadEntry;
+    entry->id = 0;
+    entry->time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    entry->attachmentId = attachmentId;
+    copyField(entry->method, TRACE_METHOD_SIZE, method);
+    char* url = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    copyField(entry->url, TRACE_URL_SIZE, redactUrl(url ? url : ""));
+    entry->statusCode = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &entry->statusCode);
+    entry->curlCode = static_cast<int>(curlResult);
+#if CURL_AT_LEAST_VERSION(7,61,0)
+    entry->nameLookupTime = getTime(curl, CURLINFO_NAMELOOKUP_TIME_T);
+    entry->connectTime = getTime(curl, CURLINFO_CONNECT_TIME_T);
+    entry->appConnectTime = getTime(curl, CURLINFO_APPCONNECT_TIME_T);
+    entry->startTransferTime = getTime(curl, CURLINFO_STARTTRANSFER_TIME_T);
+    entry->totalTime = getTime(curl, CURLINFO_TOTAL_TIME_T);
+#else
+    entry->nameLookupTime = getTime(curl, CURLINFO_NAMELOOKUP_TIME);
+    entry->connectTime = getTime(curl, CURLINFO_CONNECT_TIME);
+    entry->appConnectTime = getTime(curl, CURLINFO_APPCONNECT_TIME);
+    entry->startTransferTime = getTime(curl, CURLINFO_STARTTRANSFER_TIME);
+    entry->totalTime = getTime(curl, CURLINFO_TOTAL_TIME);
+#endif
+#if CURL_AT_LEAST_VERSION(7,55,0)
+    entry->requestSize = getSize(curl, CURLINFO_SIZE_UPLOAD_T);
+    entry->responseSize = getSize(curl, CURLINFO_SIZE_DOWNLOAD_T);
+#else
+    entry->requestSize = getSize(curl, CURLINFO_SIZE_UPLOAD);
+    entry->responseSize = getSize(curl, CURLINFO_SIZE_DOWNLOAD);
+#endif
+    std::string errorText;
+    if (curlResult != CURLE_OK) {
+        errorText.assign(error ? error : "");
+        if (errorText.empty())
+            errorText.assign(curl_easy_strerror(curlResult));
+    }
+    copyField(entry->error, TRACE_ERROR_SIZE, errorText);
+    entry->wireLength = copyField(entry->wire, TRACE_WIRE_SIZE, m_wireData);
+    m_trace.record(*entry);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#ifndef REQUEST_TRACE_H
+#define REQUEST_TRACE_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <curl/curl.h>
+
+constexpr size_t DEFAULT_TRACE_BUFFER_SIZE = 256;
+constexpr size_t MAX_TRACE_BUFFER_SIZE = 8192;
+
+constexpr size_t TRACE_METHOD_SIZE = 16;
+constexpr size_t TRACE_URL_SIZE = 1024;
+constexpr size_t TRACE_ERROR_SIZE = 256;
+constexpr size_t TRACE_WIRE_SIZE = 2048;
+
+// Strings are truncated to the size of their fields, the times are in microseconds.
+struct TraceEntry
+{
+    uint64_t id;
+    int64_t time;                // since the epoch
+    int64_t attachmentId;
+    char method[TRACE_METHOD_SIZE];
+    char url[TRACE_URL_SIZE];    // without user info and the values of query parameters
+    long statusCode;
+    int curlCode;
+    int64_t nameLookupTime;
+    int64_t connectTime;
+    int64_t appConnectTime;
+    int64_t startTransferTime;
+    int64_t totalTime;
+    int64_t requestSize;
+    int64_t responseSize;
+    char error[TRACE_ERROR_SIZE];
+    size_t wireLength;
+    char wire[TRACE_WIRE_SIZE];  // headers and informational text of libcurl
+};
+
+// Removes the user info and replaces the values of the query parameters with ***.
+std::string redactUrl(const std::string& url);
+
+// Converts the time of an entry to the local time of the server.
+std::tm toLocalTime(int64_t time);
+
+/*
+ * Ring buffer of the last requests of the process. Recording takes no lock:
+ * a writer claims the next slot with a compare-and-swap of its sequence number
+ * (odd while it is written) and drops the entry if another writer still holds it.
+ * Readers copy the slots and keep only those whose sequence did not change meanwhile.
+ */
+class RequestTrace final
+{
+public:
+    static RequestTrace& instance();
+
+    // Called once, before the first entry is recorded. Size 0 disables the trace.
+    void configure(size_t size, unsigned int wireSampleRate);
+
+    bool isEnabled() const
+    {
+        return m_size > 0;
+    }
+
+    // Returns true for every wireSampleRate-th request.
+    bool sampleWire();
+
+    void record(const TraceEntry& entry);
+
+    // Entries in the order they were recorded.
+    std::vector<TraceEntry> dump() const;
+
+    uint64_t getRecordCount() const
+    {
+        return m_next.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getDropCount() const
+    {
+        return m_dropCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{ 0 };
+        TraceEntry entry;
+    };
+
+    RequestTrace();
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_size = 0;
+    unsigned int m_wireSampleRate = 0;
+    std::atomic<uint64_t> m_next{ 0 };
+    std::atomic<uint64_t> m_wireCounter{ 0 };
+    std::atomic<uint64_t> m_dropCount{ 0 };
+};
+
+/*
+ * Trace of one transfer. The wire trace of sampled requests is collected with CURLOPT_DEBUGFUNCTION,
+ * values of the Authorization and Cookie headers are hidden, bodies are not recorded.
+ */
+class TransferTrace final
+{
+public:
+    TransferTrace(RequestTrace& trace, CURL* curl);
+
+    TransferTrace(const TransferTrace&) = delete;
+    TransferTrace& operator=(const TransferTrace&) = delete;
+
+    // The URL is the effective one, after redirects.
+    void record(int64_t attachmentId, const std::string& method, CURL* curl, CURLcode curlResult, const char* error);
+
+private:
+    static int debugCallback(CURL* curl, curl_infotype type, char* data, size_t size, void* userptr);
+
+    void append(char prefix, const char* data, size_t size);
+
+    RequestTrace& m_trace;
+    std::string m_wireData;
+};
+
+#endif // REQUEST_TRACE_H
@@ -0,0 +1,175 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			Runtime.cpp
+ *	DESCRIPTION:	Process-wide state of the library.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Runtime.h"
+#include "MemoryPool.h"
+#include "StringUtils.h"
+#include "CurlCompat.h"
+#include <stdexcept>
+
+namespace
+{
+    // How long a handle keeps the trust store parsed from CURLOPT_CAINFO,
+    // a changed CA bundle is used by new connections after this time.
+    constexpr long CA_CACHE_TIMEOUT = 3600;
+}
+
+CurlAllocator getCurlAllocator(const std::string& value)
+{
+    std::string sValue(value);
+    trim(sValue);
+    toUpper(sValue);
+    if (sValue == "SYSTEM")
+        return CurlAllocator::System;
+    if (sValue == "POOLED")
+        return CurlAllocator::Pooled;
+    throw std::runtime_error("Invalid CURL allocator " + value + ". Possible values are SYSTEM, POOLED.");
+}
+
+Runtime& Runtime::instance()
+{
+    static Runtime* const runtime = new Runtime();
+    return *runtime;
+}
+
+Runtime::Runtime()
+{
+}
+
+void Runtime::start(const UdrConfig& config)
+{
+    try {
+        initialize(getCurlAllocator(config.getString("CurlAllocator", "SYSTEM")));
+    }
+    catch (const std::runtime_error& e) {
+        initialize(CurlAllocator::System, e.what());
+    }
+}
+
+void Runtime::initialize(CurlAllocator allocator, const std::string& error)
+{
+    // curl_global_init is called once even if the first requests
+    // of several attachments arrive together
+    std::call_once(m_initialized, [this, allocator, &error]() {
+        m_allocator = allocator;
+        if (!error.empty()) {
+            // libcurl stays uninitialized, so no handles are created with the wrong allocator
+            m_initError = error;
+        }
+        else if (allocator == CurlAllocator::Pooled) {
+            m_initResult = curl_global_init_mem(CURL_GLOBAL_DEFAULT, curlPoolMalloc, curlPoolFree,
+                curlPoolRealloc, curlPoolStrdup, curlPoolCalloc);
+        }
+        else {
+            m_initResult = curl_global_init(CURL_GLOBAL_DEFAULT);
+        }
+        if (m_initError.empty() && m_initResult != CURLE_OK)
+            m_initError = curl_easy_strerror(m_initResult);
+    });
+}
+
+CURLcode Runtime::getInitResult()
+{
+    initialize(CurlAllocator::System);
+    return m_initResult;
+}
+
+CURL* Runtime::createHandle()
+{
+    if (getInitResult() != CURLE_OK)
+        return nullptr;
+    CURL* curl = curl_easy_init();
+    if (curl)
+        setDefaults(curl);
+    return curl;
+}
+
+CURLM* Runtime::createMulti()
+{
+    if (getInitResult() != CURLE_OK)
+        return nullptr;
+    return curl_multi_init();
+}
+
+void Runtime::setDefaults(CURL* curl)
+{
+    // timeouts of the resolver must not raise SIGALRM in the threads of the server
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+#if CURL_AT_LEAST_VERSION(7,87,0)
+    // handles of the pool parse the CA bundle once for all their connections
+    curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, CA_CACHE_TIMEOUT);
+#endif
+}
+
+void Runtime::addService(RuntimeService& service)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_shutdown) {
+            m_services.push_back(&service);
+            return;
+        }
+    }
+    service.requestStop();
+    service.join();
+}
+
+void Runtime::shutdown()
+{
+    std::vector<RuntimeService*> services;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_shutdown)
+            return;
+        m_shutdown = true;
+        services.swap(m_services);
+    }
+    // the services started last may use the ones started before them
+    for (auto it = services.rbegin(); it != services.rend(); ++it)
+        (*it)->requestStop();
+    for (auto it = services.rbegin(); it != services.rend(); ++it)
+        (*it)->join();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_joined = true;
+}
+
+void Runtime::unload()
+{
+    std::vector<RuntimeService*> services;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_joined) {
+            // no thread uses libcurl any more
+            if (m_initResult == CURLE_OK)
+                curl_global_cleanup();
+            return;
+        }
+        m_shutdown = true;
+        services.swap(m_services);
+    }
+    for (auto it = services.rbegin(); it != services.rend(); ++it)
+        (*it)->requestStop();
+}
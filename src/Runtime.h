@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "UdrConfig.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <curl/curl.h>
+
+// Object with background threads, stopped by the unload hook of the library.
+// The services and the objects used by their threads are never destroyed, so a thread
+// that is still running when the library is unloaded without the hook finds them intact.
+class RuntimeService
+{
+public:
+    virtual ~RuntimeService() = default;
+
+    // Asks the threads to finish without waiting for them.
+    virtual void requestStop() = 0;
+    // Waits for the threads to finish.
+    virtual void join() = 0;
+};
+
+// Allocator given to libcurl when it is initialized.
+enum class CurlAllocator
+{
+    System,      // malloc and free of the C runtime
+    Pooled       // thread-caching pools of MemoryPool.h
+};
+
+// Throws std::runtime_error for an unknown allocator.
+CurlAllocator getCurlAllocator(const std::string& value);
+
+/*
+ * State of the library shared by all attachments of the process. libcurl is initialized
+ * once by start(), which is called when the settings are read and at the latest before
+ * the first handle is created, and cleaned up when the runtime is destroyed. Objects that use libcurl create the runtime in their
+ * constructors, so it outlives them. Services register when their threads start. The first
+ * service destroyed stops all of them: every service is asked to stop before any of them
+ * is waited for, so the threads finish together and none of them uses a destroyed object.
+ */
+class Runtime final
+{
+public:
+    static Runtime& instance();
+
+    // Initializes libcurl with the allocator of the settings, the next calls do nothing.
+    // An invalid setting fails the initialization, getInitError() describes it then.
+    void start(const UdrConfig& config);
+
+    // Returns nullptr if libcurl is not initialized or the handle can not be created.
+    CURL* createHandle();
+    CURLM* createMulti();
+
+    // Options set on every handle, also after curl_easy_reset.
+    static void setDefaults(CURL* curl);
+
+    // Errors of the initialization of libcurl, CURLE_OK if it is initialized.
+    CURLcode getInitResult();
+
+    const std::string& getInitError()
+    {
+        getInitResult();
+        return m_initError;
+    }
+
+    CurlAllocator getAllocator() const
+    {
+        return m_allocator;
+    }
+
+    // A service registered after the shutdown is stopped at once.
+    void addService(RuntimeService& service);
+    // Stops the services and waits for their threads, the next calls do nothing.
+    // Called by the unload hook, while the library is loaded and the threads can be joined.
+    void shutdown();
+    // Called when the library is unloaded. Without the shutdown before it the services are only
+    // asked to stop: joining a thread under the loader lock of Windows deadlocks.
+    void unload();
+
+private:
+    Runtime();
+
+    void initialize(CurlAllocator allocator, const std::string& error = std::string());
+
+    std::once_flag m_initialized;
+    CURLcode m_initResult = CURLE_FAILED_INIT;
+    std::string m_initError;
+    CurlAllocator m_allocator = CurlAllocator::System;
+
+    std::mutex m_mutex;
+    std::vector<RuntimeService*> m_services;
+    bool m_shutdown = false;
+    bool m_joined = false;
+};
+
+#endif // RUNTIME_H
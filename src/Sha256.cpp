@@ -0,0 +1,149 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			Sha256.cpp
+ *	DESCRIPTION:	SHA-256 checksum.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Sha256.h"
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+    const uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    inline uint32_t rotr(uint32_t x, unsigned n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+}
+
+Sha256::Sha256()
+    : m_state{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+{
+}
+
+void Sha256::transform(const uint8_t* block)
+{
+    uint32_t w[64];
+    for (unsigned i = 0; i < 16; i++) {
+        w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+               (uint32_t(block[i * 4 + 2]) << 8) | uint32_t(block[i * 4 + 3]);
+    }
+    for (unsigned i = 16; i < 64; i++) {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+
+    for (unsigned i = 0; i < 64; i++) {
+        const uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        const uint32_t ch = (e & f) ^ (~e & g);
+        const uint32_t t1 = h + s1 + ch + K[i] + w[i];
+        const uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+void Sha256::update(const void* data, size_t length)
+{
+    auto p = static_cast<const uint8_t*>(data);
+    m_length += length;
+
+    if (m_bufferSize > 0) {
+        const size_t n = std::min<size_t>(64 - m_bufferSize, length);
+        memcpy(m_buffer + m_bufferSize, p, n);
+        m_bufferSize += n;
+        p += n;
+        length -= n;
+        if (m_bufferSize < 64)
+            return;
+        transform(m_buffer);
+        m_bufferSize = 0;
+    }
+    // full blocks are processed directly from the input
+    while (length >= 64) {
+        transform(p);
+        p += 64;
+        length -= 64;
+    }
+    if (length > 0) {
+        memcpy(m_buffer, p, length);
+        m_bufferSize = length;
+    }
+}
+
+std::string Sha256::hexDigest()
+{
+    const uint64_t bitLength = m_length * 8;
+
+    uint8_t padding[72] = { 0x80 };
+    const size_t padLength = (m_bufferSize < 56) ? (56 - m_bufferSize) : (120 - m_bufferSize);
+    uint8_t lengthBytes[8];
+    for (unsigned i = 0; i < 8; i++) {
+        lengthBytes[i] = static_cast<uint8_t>(bitLength >> (56 - i * 8));
+    }
+    update(padding, padLength);
+    update(lengthBytes, 8);
+
+    static const char digits[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(64);
+    for (unsigned i = 0; i < 8; i++) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            result.push_back(digits[(m_state[i] >> shift) & 0x0F]);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef SHA256_H
+#define SHA256_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/*
+ * Incremental SHA-256 (FIPS 180-4) used to checksum transferred files.
+ */
+class Sha256 final
+{
+public:
+    Sha256();
+
+    void update(const void* data, size_t length);
+
+    // Finishes the calculation and returns the digest as a lowercase hex string.
+    std::string hexDigest();
+
+private:
+    void transform(const uint8_t* block);
+
+    uint32_t m_state[8];
+    uint64_t m_length = 0;
+    uint8_t m_buffer[64];
+    size_t m_bufferSize = 0;
+};
+
+#endif // SHA256_H
@@ -0,0 +1,86 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			SingleFlight.cpp
+ *	DESCRIPTION:	Coalescing of identical concurrent requests.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "SingleFlight.h"
+#include <exception>
+
+SingleFlight& SingleFlight::instance()
+{
+    static SingleFlight singleFlight;
+    return singleFlight;
+}
+
+std::shared_ptr<const SharedResponse> SingleFlight::run(const std::string& key, const Perform& perform,
+    const IsCancelled& isCancelled, bool& shared)
+{
+    std::promise<std::shared_ptr<const SharedResponse>> promise;
+    while (true) {
+        std::shared_future<std::shared_ptr<const SharedResponse>> inFlight;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto it = m_calls.find(key);
+            if (it != m_calls.end())
+                inFlight = it->second;
+            else
+                m_calls.emplace(key, promise.get_future().share());
+        }
+        shared = inFlight.valid();
+        if (!shared)
+            break;
+        // the transfer is already in flight, its result or error is received
+        while (inFlight.wait_for(SINGLE_FLIGHT_WAIT_INTERVAL) != std::future_status::ready) {
+            if (isCancelled())
+                return nullptr;
+        }
+        auto response = inFlight.get();
+        if (!response->local) {
+            ++m_sharedCount;
+            return response;
+        }
+        // the request that performed the transfer was stopped, this one takes over
+    }
+    ++m_leaderCount;
+
+    std::shared_ptr<const SharedResponse> response;
+    try {
+        response = perform();
+    }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_calls.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    {
+        // requests that arrive from now on start a new transfer
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_calls.erase(key);
+    }
+    promise.set_value(response);
+    return response;
+}
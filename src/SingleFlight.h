@@ -0,0 +1,102 @@
+#pragma once
+
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "MemoryBudget.h"
+#include <string>
+#include <memory>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+#include <curl/curl.h>
+
+// How often a request waiting for a shared transfer checks its own cancellation.
+constexpr std::chrono::milliseconds SINGLE_FLIGHT_WAIT_INTERVAL{ 100 };
+
+// Complete response of a transfer, shared by all requests that waited for it.
+struct SharedResponse
+{
+    CURLcode result = CURLE_OK;
+    std::string error;
+    // the transfer was stopped for a reason of the request that performed it (its cancellation,
+    // statement timeout or memory limit), the waiting requests send the request again
+    bool local = false;
+    long statusCode = 0;
+    long httpVersion = 0;
+    bool hasContentType = false;
+    std::string contentType;
+    ResponseBuffer headers;
+    // false if only the status lines were kept, see UDR_RESPONSE_HEADERS
+    bool hasHeaders = true;
+    // counted in the memory budget until the last request releases the response
+    ResponseBuffer body;
+};
+
+/*
+ * Coalesces identical concurrent requests of all attachments of the process.
+ * The first request with a key performs the transfer, the requests that arrive
+ * while it is in flight wait for it and receive the same response. If the transfer
+ * fails for a reason of its own request, one of the waiting requests performs it again.
+ * Nothing is kept after the transfer finishes, so this is not a cache.
+ */
+class SingleFlight final
+{
+public:
+    using Perform = std::function<std::shared_ptr<const SharedResponse>()>;
+    using IsCancelled = std::function<bool()>;
+
+    static SingleFlight& instance();
+
+    // shared is set to true if the response of another request was received.
+    // Returns nullptr if the request is cancelled while it waits for another one.
+    std::shared_ptr<const SharedResponse> run(const std::string& key, const Perform& perform,
+        const IsCancelled& isCancelled, bool& shared);
+
+    // number of transfers performed and of requests that joined them
+    uint64_t getLeaderCount() const
+    {
+        return m_leaderCount;
+    }
+
+    uint64_t getSharedCount() const
+    {
+        return m_sharedCount;
+    }
+
+private:
+    SingleFlight() = default;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const SharedResponse>>> m_calls;
+    std::atomic<uint64_t> m_leaderCount{ 0 };
+    std::atomic<uint64_t> m_sharedCount{ 0 };
+};
+
+#endif // SINGLE_FLIGHT_H
@@ -0,0 +1,165 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			StreamingTransfer.cpp
+ *	DESCRIPTION:	Transfer driven by the consumer of the received data.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "StreamingTransfer.h"
+#include "Runtime.h"
+#include "CurlCompat.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // The buffer is compacted once this much of it has been read.
+    constexpr size_t COMPACT_THRESHOLD = 64 * 1024;
+
+    // Longest wait in one call of poll.
+    constexpr long POLL_INTERVAL_MS = 1000;
+}
+
+StreamingTransfer::StreamingTransfer(CURL* curl, size_t bufferLimit)
+    : m_curl(curl)
+    , m_bufferLimit(bufferLimit)
+{
+    m_multi = Runtime::instance().createMulti();
+    if (!m_multi) {
+        curl_easy_cleanup(m_curl);
+        throw std::runtime_error("Can't initialize CURL.");
+    }
+    memset(m_errorBuffer, 0, CURL_ERROR_SIZE);
+    curl_easy_setopt(m_curl, CURLOPT_ERRORBUFFER, m_errorBuffer);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_multi_add_handle(m_multi, m_curl);
+}
+
+StreamingTransfer::~StreamingTransfer()
+{
+    curl_multi_remove_handle(m_multi, m_curl);
+    curl_easy_cleanup(m_curl);
+    curl_multi_cleanup(m_multi);
+}
+
+size_t StreamingTransfer::write_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    auto transfer = static_cast<StreamingTransfer*>(userdata);
+    const size_t length = size * nmemb;
+    if (transfer->m_buffer.size() - transfer->m_readPos >= transfer->m_bufferLimit) {
+        // curl keeps the data and passes it again after the transfer is resumed
+        transfer->m_paused = true;
+        return CURL_WRITEFUNC_PAUSE;
+    }
+    transfer->m_buffer.append(ptr, length);
+    transfer->m_reservation.resize(transfer->m_buffer.size());
+    transfer->m_receivedSize += length;
+    return length;
+}
+
+StreamingTransfer::ReadResult StreamingTransfer::readRecord(const std::string& delimiter, std::string& record,
+    std::chrono::steady_clock::time_point deadline)
+{
+    while (true) {
+        // the part of the buffer already searched is not searched again
+        const size_t pos = m_buffer.find(delimiter, std::max(m_searchPos, m_readPos));
+        if (pos != std::string::npos) {
+            record.assign(m_buffer, m_readPos, pos - m_readPos);
+            m_readPos = pos + delimiter.size();
+            m_searchPos = m_readPos;
+            break;
+        }
+        if (m_buffer.size() >= delimiter.size())
+            m_searchPos = m_buffer.size() - delimiter.size() + 1;
+
+        if (m_finished) {
+            if (m_readPos == m_buffer.size())
+                return ReadResult::End;
+            record.assign(m_buffer, m_readPos, std::string::npos);
+            m_readPos = m_buffer.size();
+            break;
+        }
+        // the transfer stays paused until the buffer is read, which never happens
+        // if the buffer holds no complete record
+        if (m_buffer.size() - m_readPos >= m_bufferLimit)
+            return ReadResult::TooLong;
+        if (!receive(deadline))
+            return ReadResult::Timeout;
+    }
+
+    if (m_readPos >= COMPACT_THRESHOLD || m_readPos == m_buffer.size()) {
+        m_buffer.erase(0, m_readPos);
+        m_reservation.resize(m_buffer.size());
+        m_searchPos -= std::min(m_searchPos, m_readPos);
+        m_readPos = 0;
+    }
+    return ReadResult::Record;
+}
+
+bool StreamingTransfer::receive(std::chrono::steady_clock::time_point deadline)
+{
+    if (m_paused) {
+        m_paused = false;
+        curl_easy_pause(m_curl, CURLPAUSE_CONT);
+    }
+    const uint64_t receivedSize = m_receivedSize;
+    while (true) {
+        int running = 0;
+        const CURLMcode rc = curl_multi_perform(m_multi, &running);
+        if (rc != CURLM_OK)
+            throw std::runtime_error(curl_multi_strerror(rc));
+
+        int messagesLeft = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &messagesLeft)) {
+            if (message->msg != CURLMSG_DONE)
+                continue;
+            m_finished = true;
+            const CURLcode result = message->data.result;
+            if (result != CURLE_OK) {
+                std::string error(m_errorBuffer);
+                if (error.empty())
+                    error.assign(curl_easy_strerror(result));
+                throw std::runtime_error(error);
+            }
+        }
+        if (m_finished || m_receivedSize != receivedSize)
+            return true;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return false;
+        if (m_paused)
+            return true;
+        long timeout = POLL_INTERVAL_MS;
+        if (deadline != std::chrono::steady_clock::time_point::max()) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            timeout = static_cast<long>(std::min<long long>(left + 1, POLL_INTERVAL_MS));
+        }
+#if CURL_AT_LEAST_VERSION(7,66,0)
+        curl_multi_poll(m_multi, nullptr, 0, static_cast<int>(timeout), nullptr);
+#else
+        curl_multi_wait(m_multi, nullptr, 0, static_cast<int>(timeout), nullptr);
+#endif
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef STREAMING_TRANSFER_H
+#define STREAMING_TRANSFER_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "MemoryBudget.h"
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <curl/curl.h>
+
+// How much received data may wait for the consumer before the transfer is paused,
+// also the longest record.
+constexpr size_t STREAM_BUFFER_LIMIT = 1024 * 1024;
+
+/*
+ * Transfer that is advanced only when the consumer needs more data.
+ *
+ * The request runs in a curl multi handle which is driven from the caller
+ * (for example from the fetch of a selectable procedure), so nothing is received
+ * while the consumer is busy. If more than the buffer limit is received at once,
+ * the transfer is paused until the consumer reads the complete records. A record
+ * that does not end within the buffer limit is not waited for.
+ */
+class StreamingTransfer final
+{
+public:
+    enum class ReadResult {
+        Record,
+        End,
+        Timeout,
+        TooLong      // no delimiter within the buffer limit, the transfer can not continue
+    };
+
+    // Takes ownership of the configured easy handle. The write callback is set here.
+    explicit StreamingTransfer(CURL* curl, size_t bufferLimit = STREAM_BUFFER_LIMIT);
+    ~StreamingTransfer();
+
+    StreamingTransfer(const StreamingTransfer&) = delete;
+    StreamingTransfer& operator=(const StreamingTransfer&) = delete;
+
+    CURL* getHandle() const
+    {
+        return m_curl;
+    }
+
+    // Counts the buffer in the memory budget of the attachment.
+    void setBudget(MemoryBudget& budget, int64_t attachmentId)
+    {
+        m_reservation = MemoryReservation(budget, attachmentId);
+        m_reservation.resize(m_buffer.size());
+    }
+
+    // Returns the next record ending with the delimiter (the delimiter is removed).
+    // The rest of the data after the end of the transfer is returned as the last record.
+    // Throws an exception if the transfer fails.
+    ReadResult readRecord(const std::string& delimiter, std::string& record,
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    size_t getBufferLimit() const
+    {
+        return m_bufferLimit;
+    }
+
+    bool isFinished() const
+    {
+        return m_finished;
+    }
+
+    uint64_t getReceivedSize() const
+    {
+        return m_receivedSize;
+    }
+
+private:
+    static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
+
+    // Waits for more data, returns false if the deadline has passed.
+    bool receive(std::chrono::steady_clock::time_point deadline);
+
+    CURLM* m_multi = nullptr;
+    CURL* m_curl = nullptr;
+    size_t m_bufferLimit;
+    std::string m_buffer;
+    MemoryReservation m_reservation;
+    size_t m_readPos = 0;
+    size_t m_searchPos = 0;
+    bool m_paused = false;
+    bool m_finished = false;
+    uint64_t m_receivedSize = 0;
+    char m_errorBuffer[CURL_ERROR_SIZE];
+};
+
+#endif // STREAMING_TRANSFER_H
@@ -0,0 +1,134 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			UdrConfig.cpp
+ *	DESCRIPTION:	Settings of the Http Client UDR library.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "UdrConfig.h"
+#include "StringUtils.h"
+#include <fstream>
+#include <stdexcept>
+
+void UdrConfig::load(const std::string& fileName)
+{
+    m_fileName = fileName;
+    m_values.clear();
+
+    std::ifstream file(fileName);
+    if (!file.is_open())
+        return;
+
+    std::string line;
+    unsigned int lineNo = 0;
+    while (std::getline(file, line)) {
+        ++lineNo;
+        auto commentPos = line.find('#');
+        if (commentPos != std::string::npos) {
+            line.erase(commentPos);
+        }
+        trim(line);
+        if (line.empty())
+            continue;
+
+        auto eqPos = line.find('=');
+        if (eqPos == std::string::npos) {
+            throw std::runtime_error(
+                "Invalid line " + std::to_string(lineNo) + " in the configuration file " + fileName
+            );
+        }
+        std::string key = line.substr(0, eqPos);
+        trim(key);
+        toUpper(key);
+        std::string value = line.substr(eqPos + 1);
+        trim(value);
+
+        m_values[key].push_back(value);
+    }
+}
+
+bool UdrConfig::hasValue(const std::string& key) const
+{
+    std::string sKey(key);
+    toUpper(sKey);
+    return m_values.find(sKey) != m_values.cend();
+}
+
+std::string UdrConfig::getString(const std::string& key, const std::string& defaultValue) const
+{
+    std::string sKey(key);
+    toUpper(sKey);
+    auto it = m_values.find(sKey);
+    if (it == m_values.cend() || it->second.empty())
+        return defaultValue;
+    return it->second.back();
+}
+
+long long UdrConfig::getInteger(const std::string& key, long long defaultValue) const
+{
+    if (!hasValue(key))
+        return defaultValue;
+    const std::string value = getString(key);
+    try {
+        size_t pos = 0;
+        long long result = std::stoll(value, &pos);
+        std::string suffix = value.substr(pos);
+        trim(suffix);
+        toUpper(suffix);
+        // Sizes may be given with the K, M, G suffixes, as in firebird.conf.
+        if (suffix == "K")
+            result *= 1024;
+        else if (suffix == "M")
+            result *= 1024 * 1024;
+        else if (suffix == "G")
+            result *= 1024 * 1024 * 1024;
+        else if (!suffix.empty())
+            throw std::invalid_argument(value);
+        return result;
+    }
+    catch (const std::logic_error&) {
+        throw std::runtime_error("Invalid integer value of the parameter " + key + " in the configuration file " + m_fileName);
+    }
+}
+
+bool UdrConfig::getBoolean(const std::string& key, bool defaultValue) const
+{
+    if (!hasValue(key))
+        return defaultValue;
+    std::string value = getString(key);
+    toUpper(value);
+    if (value == "1" || value == "TRUE" || value == "YES" || value == "ON")
+        return true;
+    if (value == "0" || value == "FALSE" || value == "NO" || value == "OFF")
+        return false;
+    throw std::runtime_error("Invalid boolean value of the parameter " + key + " in the configuration file " + m_fileName);
+}
+
+std::vector<std::string> UdrConfig::getValues(const std::string& key) const
+{
+    std::string sKey(key);
+    toUpper(sKey);
+    auto it = m_values.find(sKey);
+    if (it == m_values.cend())
+        return {};
+    return it->second;
+}
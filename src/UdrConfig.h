@@ -0,0 +1,75 @@
+#pragma once
+
+#ifndef UDR_CONFIG_H
+#define UDR_CONFIG_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+
+constexpr const char* UDR_CONFIG_FILE_NAME = "http_client_udr.conf";
+
+/*
+ * Settings of the library read from the http_client_udr.conf file
+ * located next to the library (plugins/udr).
+ *
+ * The file has the same format as firebird.conf:
+ *
+ *   # comment
+ *   Key = Value
+ *
+ * Keys are case insensitive. A key may be repeated, in which case
+ * all its values are kept in the order of appearance.
+ */
+class UdrConfig final
+{
+public:
+    UdrConfig() = default;
+
+    // Reads settings from the given file. A missing file is not an error,
+    // in that case the default values of all settings are used.
+    void load(const std::string& fileName);
+
+    const std::string& getFileName() const
+    {
+        return m_fileName;
+    }
+
+    bool hasValue(const std::string& key) const;
+
+    // Returns the last value of the key or defaultValue if the key is not set.
+    std::string getString(const std::string& key, const std::string& defaultValue = "") const;
+    long long getInteger(const std::string& key, long long defaultValue) const;
+    bool getBoolean(const std::string& key, bool defaultValue) const;
+
+    // Returns all values of the key in the order of appearance.
+    std::vector<std::string> getValues(const std::string& key) const;
+
+private:
+    std::string m_fileName;
+    std::map<std::string, std::vector<std::string>> m_values;
+};
+
+#endif // UDR_CONFIG_H
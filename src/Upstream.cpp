@@ -0,0 +1,289 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			Upstream.cpp
+ *	DESCRIPTION:	Client-side load balancing across upstream groups.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Upstream.h"
+#include "StringUtils.h"
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+UpstreamLease::UpstreamLease(const std::shared_ptr<UpstreamGroup>& group, size_t member, const std::string& url)
+    : m_group(group)
+    , m_member(member)
+    , m_url(url)
+{
+}
+
+UpstreamLease::~UpstreamLease()
+{
+    release();
+}
+
+UpstreamLease::UpstreamLease(UpstreamLease&& other) noexcept
+    : m_group(std::move(other.m_group))
+    , m_member(other.m_member)
+    , m_url(std::move(other.m_url))
+{
+    other.m_group.reset();
+}
+
+UpstreamLease& UpstreamLease::operator=(UpstreamLease&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_group = std::move(other.m_group);
+        m_member = other.m_member;
+        m_url = std::move(other.m_url);
+        other.m_group.reset();
+    }
+    return *this;
+}
+
+void UpstreamLease::complete(bool success, std::chrono::milliseconds latency)
+{
+    if (!m_group)
+        return;
+    m_group->complete(m_member, success, latency);
+    m_group.reset();
+}
+
+void UpstreamLease::release()
+{
+    if (!m_group)
+        return;
+    m_group->release(m_member);
+    m_group.reset();
+}
+
+
+UpstreamGroup::UpstreamGroup(const std::string& name, std::vector<Member> members, UpstreamBalance balance,
+    unsigned int maxFails, std::chrono::seconds ejectTime)
+    : m_name(name)
+    , m_balance(balance)
+    , m_maxFails(maxFails)
+    , m_ejectTime(ejectTime)
+{
+    for (auto& member : members) {
+        MemberState state;
+        state.member = std::move(member);
+        m_members.push_back(std::move(state));
+    }
+}
+
+double UpstreamGroup::getCost(const MemberState& state, std::chrono::steady_clock::time_point now) const
+{
+    if (m_balance == UpstreamBalance::LeastOutstanding) {
+        // idle members have equal cost, so the weights spread the requests
+        return static_cast<double>(state.outstanding) / state.member.weight;
+    }
+    // the latency of a member that gets no requests decays, so it is tried again
+    const std::chrono::duration<double> idle = now - state.latencyTime;
+    const double latency = state.latency * std::exp(-idle.count() / UPSTREAM_EWMA_DECAY.count());
+    return (latency + 1.0) * (state.outstanding + 1.0) / state.member.weight;
+}
+
+UpstreamLease UpstreamGroup::acquire(const std::string& path)
+{
+    const auto now = std::chrono::steady_clock::now();
+    size_t chosen = 0;
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<size_t> candidates;
+        double bestCost = 0;
+        for (size_t i = 0; i < m_members.size(); ++i) {
+            const auto& state = m_members[i];
+            if (state.failures >= m_maxFails) {
+                // an ejected member is readmitted with one request at a time until it succeeds
+                if (now < state.ejectedUntil || state.outstanding > 0)
+                    continue;
+            }
+            const double cost = getCost(state, now);
+            if (candidates.empty() || cost < bestCost) {
+                candidates.assign(1, i);
+                bestCost = cost;
+            }
+            else if (cost == bestCost) {
+                candidates.push_back(i);
+            }
+        }
+        if (candidates.empty()) {
+            // all members are ejected, the one readmitted first is used rather than failing the request
+            size_t first = 0;
+            for (size_t i = 1; i < m_members.size(); ++i) {
+                if (m_members[i].ejectedUntil < m_members[first].ejectedUntil)
+                    first = i;
+            }
+            candidates.assign(1, first);
+        }
+        // smooth weighted round robin spreads the requests among the members of equal cost
+        long long totalWeight = 0;
+        chosen = candidates.front();
+        for (const auto i : candidates) {
+            m_members[i].currentWeight += m_members[i].member.weight;
+            totalWeight += m_members[i].member.weight;
+            if (m_members[i].currentWeight > m_members[chosen].currentWeight)
+                chosen = i;
+        }
+        m_members[chosen].currentWeight -= totalWeight;
+        ++m_members[chosen].outstanding;
+        ++m_members[chosen].requests;
+        url = m_members[chosen].member.url + path;
+    }
+    return UpstreamLease(shared_from_this(), chosen, url);
+}
+
+void UpstreamGroup::release(size_t member)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    --m_members[member].outstanding;
+}
+
+void UpstreamGroup::complete(size_t member, bool success, std::chrono::milliseconds latency)
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& state = m_members[member];
+    --state.outstanding;
+    if (!success) {
+        if (++state.failures >= m_maxFails) {
+            const unsigned int factor = std::min(1u << std::min(state.ejections, 31u), UPSTREAM_MAX_EJECT_FACTOR);
+            state.ejectedUntil = now + m_ejectTime * factor;
+            ++state.ejections;
+            UpstreamGroups::instance().addEjection();
+        }
+        // failures are often fast, they do not make the member look faster
+        return;
+    }
+    state.failures = 0;
+    state.ejections = 0;
+    // the weight of a sample grows with the time since the previous one
+    if (state.latencyTime == std::chrono::steady_clock::time_point()) {
+        state.latency = static_cast<double>(latency.count());
+    }
+    else {
+        const std::chrono::duration<double> elapsed = now - state.latencyTime;
+        const double decay = std::exp(-elapsed.count() / UPSTREAM_EWMA_DECAY.count());
+        state.latency = state.latency * decay + latency.count() * (1.0 - decay);
+    }
+    state.latencyTime = now;
+}
+
+void UpstreamGroup::getStatus(std::vector<UpstreamMemberStatus>& status) const
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& state : m_members) {
+        status.push_back({ m_name, state.member.url, state.member.weight, state.outstanding, state.latency,
+            state.failures, state.failures >= m_maxFails && now < state.ejectedUntil, state.requests });
+    }
+}
+
+
+UpstreamGroups& UpstreamGroups::instance()
+{
+    static UpstreamGroups groups;
+    return groups;
+}
+
+void UpstreamGroups::configure(const UdrConfig& config)
+{
+    std::string balanceName = config.getString("UpstreamBalance", "LEAST_OUTSTANDING");
+    toUpper(balanceName);
+    UpstreamBalance balance;
+    if (balanceName == "LEAST_OUTSTANDING")
+        balance = UpstreamBalance::LeastOutstanding;
+    else if (balanceName == "EWMA")
+        balance = UpstreamBalance::Ewma;
+    else
+        throw std::runtime_error("Invalid value of the parameter UpstreamBalance in the configuration file " +
+            config.getFileName() + ", expected LEAST_OUTSTANDING or EWMA.");
+    const auto maxFails = config.getInteger("UpstreamMaxFails", DEFAULT_UPSTREAM_MAX_FAILS);
+    const auto ejectTime = config.getInteger("UpstreamEjectTime", DEFAULT_UPSTREAM_EJECT_TIME.count());
+
+    std::map<std::string, std::vector<UpstreamGroup::Member>> members;
+    for (const auto& value : config.getValues("Upstream")) {
+        std::istringstream stream(value);
+        std::string name;
+        UpstreamGroup::Member member{ "", 1 };
+        stream >> name >> member.url;
+        if (member.url.empty())
+            throw std::runtime_error("The parameter Upstream in the configuration file " + config.getFileName() +
+                " must be in the form <group> <url> [<weight>].");
+        long long weight = 1;
+        if (stream >> weight) {
+            if (weight < 1)
+                throw std::runtime_error("Invalid weight of the parameter Upstream in the configuration file " +
+                    config.getFileName());
+        }
+        member.weight = static_cast<unsigned int>(std::min<long long>(weight, MAX_UPSTREAM_WEIGHT));
+        // the path of the request is appended to the base URL
+        while (!member.url.empty() && member.url.back() == '/')
+            member.url.pop_back();
+        toLower(name);
+        members[name].push_back(std::move(member));
+    }
+
+    std::map<std::string, std::shared_ptr<UpstreamGroup>> groups;
+    for (auto& group : members) {
+        groups[group.first] = std::make_shared<UpstreamGroup>(group.first, std::move(group.second), balance,
+            static_cast<unsigned int>(std::max<long long>(maxFails, 1)), std::chrono::seconds(std::max<long long>(ejectTime, 1)));
+    }
+    m_groups = std::move(groups);
+}
+
+bool UpstreamGroups::isUpstreamUrl(const std::string& url)
+{
+    const std::string scheme(UPSTREAM_SCHEME);
+    if (url.size() < scheme.size())
+        return false;
+    std::string prefix = url.substr(0, scheme.size());
+    toLower(prefix);
+    return prefix == scheme;
+}
+
+UpstreamLease UpstreamGroups::acquire(const std::string& url)
+{
+    const auto nameStart = std::string(UPSTREAM_SCHEME).size();
+    auto nameEnd = url.find_first_of("/?#", nameStart);
+    if (nameEnd == std::string::npos)
+        nameEnd = url.size();
+    std::string name = url.substr(nameStart, nameEnd - nameStart);
+    toLower(name);
+    const auto it = m_groups.find(name);
+    if (it == m_groups.cend())
+        throw std::runtime_error("Upstream group \"" + name + "\" is not defined in the configuration.");
+    return it->second->acquire(url.substr(nameEnd));
+}
+
+std::vector<UpstreamMemberStatus> UpstreamGroups::getStatus() const
+{
+    std::vector<UpstreamMemberStatus> status;
+    for (const auto& group : m_groups)
+        group.second->getStatus(status);
+    return status;
+}
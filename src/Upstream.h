@@ -0,0 +1,202 @@
+#pragma once
+
+#ifndef UPSTREAM_H
+#define UPSTREAM_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "UdrConfig.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// URLs of the form upstream://<group>/<path> address a group of the configuration
+constexpr const char* UPSTREAM_SCHEME = "upstream://";
+
+constexpr unsigned int MAX_UPSTREAM_WEIGHT = 1000;
+constexpr long long DEFAULT_UPSTREAM_MAX_FAILS = 5;
+constexpr std::chrono::seconds DEFAULT_UPSTREAM_EJECT_TIME{ 30 };
+// repeated ejections double the time up to this factor
+constexpr unsigned int UPSTREAM_MAX_EJECT_FACTOR = 10;
+// time in which the latency of an idle member decays by e
+constexpr std::chrono::seconds UPSTREAM_EWMA_DECAY{ 10 };
+
+enum class UpstreamBalance
+{
+    LeastOutstanding,
+    Ewma
+};
+
+struct UpstreamMemberStatus
+{
+    std::string group;
+    std::string url;
+    unsigned int weight;
+    unsigned int outstanding;
+    double latency;              // EWMA of the time to the first byte, ms
+    unsigned int failures;       // consecutive failures
+    bool ejected;
+    uint64_t requests;
+};
+
+class UpstreamGroup;
+
+/*
+ * Member of a group chosen for one request. The request reports its outcome with complete(),
+ * a lease released without it only stops counting as an outstanding request.
+ */
+class UpstreamLease final
+{
+public:
+    UpstreamLease() = default;
+    UpstreamLease(const std::shared_ptr<UpstreamGroup>& group, size_t member, const std::string& url);
+    ~UpstreamLease();
+
+    UpstreamLease(UpstreamLease&& other) noexcept;
+    UpstreamLease& operator=(UpstreamLease&& other) noexcept;
+
+    UpstreamLease(const UpstreamLease&) = delete;
+    UpstreamLease& operator=(const UpstreamLease&) = delete;
+
+    explicit operator bool() const
+    {
+        return static_cast<bool>(m_group);
+    }
+
+    // URL of the request with the base URL of the member
+    const std::string& getUrl() const
+    {
+        return m_url;
+    }
+
+    // success is false for transport errors and 5xx responses
+    void complete(bool success, std::chrono::milliseconds latency);
+
+private:
+    void release();
+
+    std::shared_ptr<UpstreamGroup> m_group;
+    size_t m_member = 0;
+    std::string m_url;
+};
+
+/*
+ * Base URLs with weights among which the requests to the group are spread.
+ * The member with the least outstanding requests per unit of weight is chosen,
+ * with EWMA balancing this is also multiplied by the latency of the member.
+ * Members are ejected after MaxFails consecutive failures and readmitted after
+ * the eject time with a single probe request.
+ */
+class UpstreamGroup final : public std::enable_shared_from_this<UpstreamGroup>
+{
+public:
+    struct Member
+    {
+        std::string url;
+        unsigned int weight;
+    };
+
+    UpstreamGroup(const std::string& name, std::vector<Member> members, UpstreamBalance balance,
+        unsigned int maxFails, std::chrono::seconds ejectTime);
+
+    const std::string& getName() const
+    {
+        return m_name;
+    }
+
+    // path is the part of the URL after the group name
+    UpstreamLease acquire(const std::string& path);
+
+    void getStatus(std::vector<UpstreamMemberStatus>& status) const;
+
+private:
+    friend class UpstreamLease;
+
+    struct MemberState
+    {
+        Member member;
+        unsigned int outstanding = 0;
+        double latency = 0;
+        std::chrono::steady_clock::time_point latencyTime;
+        unsigned int failures = 0;
+        unsigned int ejections = 0;
+        std::chrono::steady_clock::time_point ejectedUntil;
+        // smooth weighted round robin among the members of equal cost
+        long long currentWeight = 0;
+        uint64_t requests = 0;
+    };
+
+    double getCost(const MemberState& state, std::chrono::steady_clock::time_point now) const;
+    void release(size_t member);
+    void complete(size_t member, bool success, std::chrono::milliseconds latency);
+
+    const std::string m_name;
+    const UpstreamBalance m_balance;
+    const unsigned int m_maxFails;
+    const std::chrono::seconds m_ejectTime;
+
+    mutable std::mutex m_mutex;
+    std::vector<MemberState> m_members;
+};
+
+/*
+ * Groups read from the configuration, "Upstream = <group> <url> [<weight>]".
+ */
+class UpstreamGroups final
+{
+public:
+    static UpstreamGroups& instance();
+
+    // Called once.
+    void configure(const UdrConfig& config);
+
+    static bool isUpstreamUrl(const std::string& url);
+
+    // Chooses a member for the upstream:// URL.
+    UpstreamLease acquire(const std::string& url);
+
+    std::vector<UpstreamMemberStatus> getStatus() const;
+
+    uint64_t getEjectionCount() const
+    {
+        return m_ejectionCount;
+    }
+
+    void addEjection()
+    {
+        ++m_ejectionCount;
+    }
+
+private:
+    UpstreamGroups() = default;
+
+    std::map<std::string, std::shared_ptr<UpstreamGroup>> m_groups;
+    std::atomic<uint64_t> m_ejectionCount{ 0 };
+};
+
+#endif // UPSTREAM_H
@@ -25,47 +25,55 @@
  */
 
 #include "UDR.h"
+#include "StringUtils.h"
+#include "UdrConfig.h"
+#include "FileUtils.h"
+#include "Sha256.h"
+#include "RangeDownload.h"
+#include "JsonStream.h"
+#include "StreamingTransfer.h"
+#include "Pagination.h"
+#include "RequestTemplate.h"
+#include "SingleFlight.h"
+#include "DnsResolver.h"
+#include "CertificateCache.h"
+#include "ConnectionPool.h"
+#include "Preconnect.h"
+#include "HedgedRequest.h"
+#include "Upstream.h"
+#include "RequestTrace.h"
+#include "BulkSink.h"
+#include "Outbox.h"
+#include "Runtime.h"
+#include "MemoryBudget.h"
+#include "MemoryPool.h"
+#include "CurlCompat.h"
 #include <string>
 #include <memory>
 #include <vector>
 #include <map>
+#include <set>
 #include <algorithm>
 #include <sstream>
 #include <cstdarg>
+#include <mutex>
+#include <chrono>
+#include <thread>
 #include <curl/curl.h>
-
-// for old curl versions
-#ifndef CURL_VERSION_BITS
-#define CURL_VERSION_BITS(x,y,z) ((x)<<16|(y)<<8|(z))
-#endif
-
-#ifndef CURL_AT_LEAST_VERSION
-#define CURL_AT_LEAST_VERSION(x,y,z) \
-  (LIBCURL_VERSION_NUM >= CURL_VERSION_BITS(x, y, z))
+#ifdef _MSC_VER
+// fb_shutdown_callback of the unload hook
+#pragma comment(lib, "fbclient_ms.lib")
 #endif
 
 constexpr unsigned int BUFFER_LARGE = 16384;
 constexpr unsigned int MAX_SEGMENT_SIZE = 65535;
 
-// trim from start (in place)
-static inline void ltrim(std::string& s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }));
-}
-
-// trim from end (in place)
-static inline void rtrim(std::string& s) {
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }).base(), s.end());
-}
-
-// trim from both ends (in place)
-static inline void trim(std::string& s) {
-    rtrim(s);
-    ltrim(s);
-}
+// Options of the UDR itself. They are passed in the OPTIONS string together with the CURL options
+// and have negative keys so that they do not overlap with CURLoption values.
+constexpr long UDR_SINGLE_FLIGHT = -1;
+constexpr long UDR_HEDGE = -2;
+constexpr long UDR_IDEMPOTENT = -3;
+constexpr long UDR_RESPONSE_HEADERS = -4;
 
 template <typename T>
 class AutoCurlCleanupClear
@@ -172,7 +180,7 @@ HttpMethod getHttpMethod(const std::string& httpMethod)
 [[noreturn]]
 void throwException(Firebird::ThrowStatusWrapper* const status, const char* message, ...)
 {
-    std::vector<char> buffer(BUFFER_LARGE);
+    PooledBuffer buffer(BUFFER_LARGE);
 
     va_list ptr;
     va_start(ptr, message);
@@ -241,11 +249,68 @@ size_t read_callback(char* ptr, size_t size, size_t nmemb, void* userdata)
 
 size_t write_data(void* ptr, size_t size, size_t nmemb, void* stream) 
 {
-    std::string data((const char*)ptr, (size_t)size * nmemb);
-    *((std::ostringstream*)stream) << data;
+    static_cast<std::ostringstream*>(stream)->write(static_cast<const char*>(ptr), size * nmemb);
     return size * nmemb;
 }
 
+// Response headers kept by the UDR_RESPONSE_HEADERS option.
+struct HeaderCapture
+{
+    bool all = true;
+    // upper case names of the kept headers, the status lines are always kept for STATUS_TEXT
+    std::vector<std::string> names;
+    ResponseBuffer* headers = nullptr;
+};
+
+// Parses the value of UDR_RESPONSE_HEADERS: ALL, NONE or a comma-separated list of header names.
+HeaderCapture getHeaderCapture(const std::string& value)
+{
+    HeaderCapture capture;
+    std::string names(value);
+    trim(names);
+    toUpper(names);
+    if (names == "ALL")
+        return capture;
+    capture.all = false;
+    if (names == "NONE")
+        return capture;
+    size_t start = 0;
+    while (start <= names.size()) {
+        size_t end = names.find(',', start);
+        if (end == std::string::npos)
+            end = names.size();
+        std::string name = names.substr(start, end - start);
+        trim(name);
+        if (name.empty() || name.find_first_of(" \t:") != std::string::npos)
+            throw std::runtime_error("Invalid value of UDR_RESPONSE_HEADERS: " + value);
+        capture.names.push_back(name);
+        start = end + 1;
+    }
+    return capture;
+}
+
+size_t write_header(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    const auto capture = static_cast<const HeaderCapture*>(userdata);
+    const size_t length = size * nmemb;
+    bool keep = (length >= 5 && memcmp(ptr, "HTTP/", 5) == 0);
+    if (!keep) {
+        const auto colon = static_cast<const char*>(memchr(ptr, ':', length));
+        const size_t nameLength = colon ? static_cast<size_t>(colon - ptr) : 0;
+        for (const auto& name : capture->names) {
+            if (name.size() == nameLength && std::equal(name.cbegin(), name.cend(), ptr, [](char a, char b) {
+                return a == static_cast<char>(toupper(static_cast<unsigned char>(b)));
+            })) {
+                keep = true;
+                break;
+            }
+        }
+    }
+    if (keep)
+        capture->headers->append(ptr, length);
+    return length;
+}
+
 std::map<long, std::string> parseCurlOptions(const std::string& options)
 {
     std::map<long, std::string> optionValues;
@@ -270,9 +335,35 @@ std::map<long, std::string> parseCurlOptions(const std::string& options)
             if (key == "CURLOPT_DNS_SERVERS") {
                 optionValues[CURLOPT_DNS_SERVERS] = value;
             }
+            else if (key == "CURLOPT_RESOLVE") {
+                optionValues[CURLOPT_RESOLVE] = value;
+            }
+#if CURL_AT_LEAST_VERSION(7,49,0)
+            else if (key == "CURLOPT_CONNECT_TO") {
+                optionValues[CURLOPT_CONNECT_TO] = value;
+            }
+#endif
+            else if (key == "CURLOPT_IPRESOLVE") {
+                optionValues[CURLOPT_IPRESOLVE] = value;
+            }
+#if CURL_AT_LEAST_VERSION(7,59,0)
+            else if (key == "CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS") {
+                optionValues[CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS] = value;
+            }
+#endif
             else if (key == "CURLOPT_PORT") {
                 optionValues[CURLOPT_PORT] = value;
             }
+#if CURL_AT_LEAST_VERSION(7,40,0)
+            else if (key == "CURLOPT_UNIX_SOCKET_PATH") {
+                optionValues[CURLOPT_UNIX_SOCKET_PATH] = value;
+            }
+#endif
+#if CURL_AT_LEAST_VERSION(7,53,0)
+            else if (key == "CURLOPT_ABSTRACT_UNIX_SOCKET") {
+                optionValues[CURLOPT_ABSTRACT_UNIX_SOCKET] = value;
+            }
+#endif
             else if (key == "CURLOPT_PROXY") {
                 optionValues[CURLOPT_PROXY] = value;
             }
@@ -362,6 +453,21 @@ std::map<long, std::string> parseCurlOptions(const std::string& options)
             else if (key == "CURLOPT_MAXREDIRS") {
                 optionValues[CURLOPT_MAXREDIRS] = value;
             }
+            else if (key == "UDR_SINGLE_FLIGHT") {
+                optionValues[UDR_SINGLE_FLIGHT] = value;
+            }
+            else if (key == "UDR_HEDGE") {
+                // checked now, so an invalid value is reported even for requests that are not hedged
+                getHedgePolicy(value);
+                optionValues[UDR_HEDGE] = value;
+            }
+            else if (key == "UDR_IDEMPOTENT") {
+                optionValues[UDR_IDEMPOTENT] = value;
+            }
+            else if (key == "UDR_RESPONSE_HEADERS") {
+                getHeaderCapture(value);
+                optionValues[UDR_RESPONSE_HEADERS] = value;
+            }
             else {
                 throw std::runtime_error(std::string("Unsupported CURL option ") + key);
             }
@@ -375,6 +481,24 @@ std::map<long, std::string> parseCurlOptions(const std::string& options)
     return std::move(optionValues);
 }
 
+#if CURL_AT_LEAST_VERSION(7,77,0)
+// Passes the cached contents of a certificate or key file instead of its name, so the file
+// is not read for every request. Returns false if the file can not be read or the TLS backend
+// does not accept blobs, then the file name is passed and libcurl reports the error.
+bool setCertificateBlob(CURL* curl, CURLoption option, const std::string& fileName)
+{
+    const auto content = CertificateCache::instance().get(fileName);
+    if (!content) {
+        return false;
+    }
+    struct curl_blob blob;
+    blob.data = const_cast<char*>(content->data());
+    blob.len = content->size();
+    blob.flags = CURL_BLOB_COPY;
+    return curl_easy_setopt(curl, option, &blob) == CURLE_OK;
+}
+#endif
+
 void setCurlOptions(CURL* curl, const std::map<long, std::string>& options) 
 {
     for (const auto& kv : options) {
@@ -385,10 +509,39 @@ void setCurlOptions(CURL* curl, const std::map<long, std::string>& options)
             curl_easy_setopt(curl, CURLOPT_PORT, std::stol(value));
             break;
 
+#if CURL_AT_LEAST_VERSION(7,40,0)
+        case CURLOPT_UNIX_SOCKET_PATH:
+            curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, value.c_str());
+            break;
+#endif
+
+#if CURL_AT_LEAST_VERSION(7,53,0)
+        case CURLOPT_ABSTRACT_UNIX_SOCKET:
+            curl_easy_setopt(curl, CURLOPT_ABSTRACT_UNIX_SOCKET, value.c_str());
+            break;
+#endif
+
         case CURLOPT_DNS_SERVERS:
             curl_easy_setopt(curl, CURLOPT_DNS_SERVERS, value.c_str());
             break;
 
+        case CURLOPT_RESOLVE:
+#if CURL_AT_LEAST_VERSION(7,49,0)
+        case CURLOPT_CONNECT_TO:
+#endif
+            // lists are set together with the DNS settings of the library, see getDnsLists
+            break;
+
+        case CURLOPT_IPRESOLVE:
+            curl_easy_setopt(curl, CURLOPT_IPRESOLVE, getIpResolve(value));
+            break;
+
+#if CURL_AT_LEAST_VERSION(7,59,0)
+        case CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS:
+            curl_easy_setopt(curl, CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS, std::stol(value));
+            break;
+#endif
+
         case CURLOPT_PROXY:
             curl_easy_setopt(curl, CURLOPT_PROXY, value.c_str());
             break;
@@ -452,10 +605,18 @@ void setCurlOptions(CURL* curl, const std::map<long, std::string>& options)
             break;
 
         case CURLOPT_SSLCERT:
+#if CURL_AT_LEAST_VERSION(7,77,0)
+            if (setCertificateBlob(curl, CURLOPT_SSLCERT_BLOB, value))
+                break;
+#endif
             curl_easy_setopt(curl, CURLOPT_SSLCERT, value.c_str());
             break;
 
         case CURLOPT_SSLKEY:
+#if CURL_AT_LEAST_VERSION(7,77,0)
+            if (setCertificateBlob(curl, CURLOPT_SSLKEY_BLOB, value))
+                break;
+#endif
             curl_easy_setopt(curl, CURLOPT_SSLKEY, value.c_str());
             break;
 
@@ -464,6 +625,15 @@ void setCurlOptions(CURL* curl, const std::map<long, std::string>& options)
             break;
 
         case CURLOPT_CAINFO:
+            // since 7.87.0 the handle keeps the trust store parsed from the file, see Runtime::setDefaults,
+            // a blob would disable that cache
+#if CURL_AT_LEAST_VERSION(7,77,0) && !CURL_AT_LEAST_VERSION(7,87,0)
+            if (setCertificateBlob(curl, CURLOPT_CAINFO_BLOB, value)) {
+                // the bundle given replaces the default one, as with CURLOPT_CAINFO
+                curl_easy_setopt(curl, CURLOPT_CAINFO, nullptr);
+                break;
+            }
+#endif
             curl_easy_setopt(curl, CURLOPT_CAINFO, value.c_str());
             break;
 
@@ -504,6 +674,13 @@ void setCurlOptions(CURL* curl, const std::map<long, std::string>& options)
         case CURLOPT_MAXREDIRS:
             curl_easy_setopt(curl, CURLOPT_MAXREDIRS, std::stol(value));
             break;
+
+        case UDR_SINGLE_FLIGHT:
+        case UDR_HEDGE:
+        case UDR_IDEMPOTENT:
+        case UDR_RESPONSE_HEADERS:
+            // not a CURL option
+            break;
         }
     }
     // Some default values differ from those accepted in libCurl.
@@ -516,324 +693,4626 @@ void setCurlOptions(CURL* curl, const std::map<long, std::string>& options)
     }
 }
 
+// Returns the parsed options, so that the options of the UDR can be checked.
+std::map<long, std::string> applyCurlOptions(Firebird::ThrowStatusWrapper* const status, CURL* curl, const std::string& curlOptions)
+{
+    std::map<long, std::string> options;
+    try {
+        options = parseCurlOptions(curlOptions);
+        setCurlOptions(curl, options);
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    catch (const std::invalid_argument& e) {
+        throwException(status, "%s", e.what());
+    }
+    catch (const std::out_of_range& e) {
+        throwException(status, "%s", e.what());
+    }
+    return options;
+}
 
+bool isUdrOptionEnabled(const std::map<long, std::string>& options, long option)
+{
+    const auto it = options.find(option);
+    if (it == options.cend())
+        return false;
+    std::string value = it->second;
+    toUpper(value);
+    return value == "1" || value == "TRUE" || value == "ON" || value == "YES";
+}
 
-/*
-  PROCEDURE HTTP_REQUEST (
-    METHOD               VARCHAR(7) NOT NULL,
-    URL                  VARCHAR(8191) NOT NULL,
-    REQUEST_BODY         BLOB SUB_TYPE BINARY,
-    REQUEST_TYPE         VARCHAR(256),
-    HEADERS              VARCHAR(8191),
-    OPTIONS              VARCHAR(8191)
-  )
-  RETURNS (
-    STATUS_CODE          SMALLINT,
-    STATUS_TEXT          VARCHAR(256),
-    RESPONSE_TYPE        VARCHAR(256),
-    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
-    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
-  )
-  EXTERNAL NAME 'http_client_udr!sendHttpRequest'
-  ENGINE UDR;
-*/
-
-FB_UDR_BEGIN_PROCEDURE(sendHttpRequest)
-
-    FB_UDR_MESSAGE(InMessage,
-        (FB_INTL_VARCHAR(28, 0), method)
-        (FB_INTL_VARCHAR(32765, 0), url)
-        (FB_BLOB, body)
-        (FB_INTL_VARCHAR(1024, 0), contentType)
-        (FB_INTL_VARCHAR(32765, 0), headers)
-        (FB_INTL_VARCHAR(32765, 0), options)
-    );
-
-    FB_UDR_MESSAGE(OutMessage,
-        (FB_SMALLINT, statusCode)
-        (FB_INTL_VARCHAR(1024, 0), statusText)
-        (FB_INTL_VARCHAR(1024, 0), contentType)
-        (FB_BLOB, body)
-        (FB_BLOB, headers)
-    );
-
-    FB_UDR_EXECUTE_PROCEDURE
+// Appends headers separated by line breaks to the list.
+curl_slist* appendHeaders(curl_slist* headers, const std::string& sHeaders)
+{
+    std::size_t prev = 0, pos;
+    while (prev < sHeaders.size())
     {
-        m_att.reset(context->getAttachment(status));
-        m_tra.reset(context->getTransaction(status));
-
-        if (in->methodNull) {
-            throwException(status, "HTTP_METHOD can not be NULL.");
+        pos = sHeaders.find_first_of("\r\n", prev);
+        if (pos == std::string::npos)
+            pos = sHeaders.size();
+        if (pos > prev) {
+            std::string header = sHeaders.substr(prev, pos - prev);
+            trim(header);
+            if (!header.empty()) {
+                headers = curl_slist_append(headers, header.c_str());
+            }
         }
-        const std::string sHttpMethod(in->method.str, in->method.length);
+        prev = pos + 1;
+    }
+    return headers;
+}
 
-        auto httpMethod = getHttpMethod(sHttpMethod);
-        if (httpMethod == HttpMethod::None) {
-            throwException(status, "Unsupported HTTP method %s.", sHttpMethod.c_str());
-        }
+void setHttpMethod(Firebird::ThrowStatusWrapper* const status, CURL* curl, HttpMethod httpMethod,
+    const std::string& sHttpMethod)
+{
+    switch (httpMethod) {
+    case HttpMethod::Get:
+        break;
+    case HttpMethod::Head:
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L); // HEAD
+        break;
+    case HttpMethod::Post:
+        curl_easy_setopt(curl, CURLOPT_POST, 1L); // POST
+        break;
+    case HttpMethod::Put:
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+        break;
+    case HttpMethod::Patch:
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
+        break;
+    case HttpMethod::Delete:
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+        break;
+    case HttpMethod::Options:
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "OPTIONS");
+        break;
+    case HttpMethod::Trace:
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "TRACE");
+        break;
+    default:
+        throwException(status, "HTTP method %s in not supported.", sHttpMethod.c_str());
+    }
+}
 
-        if (in->urlNull) {
-            throwException(status, "URL can not be NULL.");
+void readBlob(Firebird::ThrowStatusWrapper* const status, Firebird::IAttachment* att, Firebird::ITransaction* tra,
+    ISC_QUAD* blobId, std::ostream& stream)
+{
+    Firebird::AutoRelease<Firebird::IBlob> blob(att->openBlob(status, tra, blobId, 0, nullptr));
+    bool eof = false;
+    PooledBuffer vBuffer(MAX_SEGMENT_SIZE);
+    auto buffer = vBuffer.data();
+    while (!eof) {
+        unsigned int l = 0;
+        switch (blob->getSegment(status, MAX_SEGMENT_SIZE, buffer, &l))
+        {
+        case Firebird::IStatus::RESULT_OK:
+        case Firebird::IStatus::RESULT_SEGMENT:
+            stream.write(buffer, l);
+            break;
+        default:
+            blob->close(status);
+            blob.release();
+            eof = true;
+            break;
         }
-        const std::string url(in->url.str, in->url.length);
+    }
+}
 
-        AutoCurlCleanup<CURL> curl(curl_easy_init());
+void writeBlob(Firebird::ThrowStatusWrapper* const status, Firebird::IAttachment* att, Firebird::ITransaction* tra,
+    ISC_QUAD* blobId, const char* data, size_t length)
+{
+    const unsigned char bpb[] = {
+        isc_bpb_version1,
+        isc_bpb_type, 1, isc_bpb_type_stream,
+        isc_bpb_storage, 1, isc_bpb_storage_temp
+    };
 
-        if (!curl) {
-            throwException(status, "Can't initialize CURL.");
-        }
+    Firebird::AutoRelease<Firebird::IBlob> blob(
+        att->createBlob(status, tra, blobId, sizeof(bpb), bpb)
+    );
 
-        // buffer for storing text errors
-        char curlErrorBuffer[CURL_ERROR_SIZE];
-        memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
-        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+    size_t offset = 0;
+    while (offset < length) {
+        const auto len = std::min<size_t>(length - offset, MAX_SEGMENT_SIZE);
+        blob->putSegment(status, static_cast<unsigned int>(len), data + offset);
+        offset += len;
+    }
+    blob->close(status);
+    blob.release();
+}
 
-        // set url
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+void writeBlob(Firebird::ThrowStatusWrapper* const status, Firebird::IAttachment* att, Firebird::ITransaction* tra,
+    ISC_QUAD* blobId, const ResponseBuffer& buffer)
+{
+    const unsigned char bpb[] = {
+        isc_bpb_version1,
+        isc_bpb_type, 1, isc_bpb_type_stream,
+        isc_bpb_storage, 1, isc_bpb_storage_temp
+    };
 
-        // set Http method
-        switch (httpMethod) {
-        case HttpMethod::Get: 
-            break;
-        case HttpMethod::Head:
-            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L); // HEAD
-            break;
-        case HttpMethod::Post:
-            curl_easy_setopt(curl, CURLOPT_POST, 1L); // POST
-            break;
-        case HttpMethod::Put:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
-            break;
-        case HttpMethod::Patch:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-            break;
-        case HttpMethod::Delete:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
-            break;
-        case HttpMethod::Options:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "OPTIONS");
-            break;
-        case HttpMethod::Trace:
-            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "TRACE");
-            break;
-        default:
-            throwException(status, "HTTP method %s in not supported.", sHttpMethod.c_str());
-        }
-        
-        if (!in->optionsNull) {
-            std::string curlOptions(in->options.str, in->options.length);
-            try {
-                setCurlOptions(curl, parseCurlOptions(curlOptions));
-            }
-            catch (const std::runtime_error &e) {
-                throwException(status, e.what());
-            }
-            catch (const std::invalid_argument& e) {
-                throwException(status, e.what());
-            }
-            catch (const std::out_of_range& e) {
-                throwException(status, e.what());
+    Firebird::AutoRelease<Firebird::IBlob> blob(
+        att->createBlob(status, tra, blobId, sizeof(bpb), bpb)
+    );
+
+    try {
+        // a spilled response is read from its file
+        buffer.read([status, &blob](const char* data, size_t length) {
+            size_t offset = 0;
+            while (offset < length) {
+                const auto len = std::min<size_t>(length - offset, MAX_SEGMENT_SIZE);
+                blob->putSegment(status, static_cast<unsigned int>(len), data + offset);
+                offset += len;
             }
-        }
+        });
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    blob->close(status);
+    blob.release();
+}
 
-        // collecting headers
-        struct curl_slist* headers = nullptr;
-        // content-type
-        if (!in->contentTypeNull) {
-            std::string contentType(in->contentType.str, in->contentType.length);
-            contentType = std::string("Content-Type: ") + contentType;
-            headers = curl_slist_append(headers, contentType.c_str());
-        }
-        // other headers
-        if (!in->headersNull) {
-            std::string sHeaders(in->headers.str, in->headers.length);
-            std::size_t prev = 0, pos;
-            while ((pos = sHeaders.find_first_of("\r\n", prev)) != std::string::npos)
-            {
-                if (pos > prev) {
-                    std::string header = sHeaders.substr(prev, pos - prev);
-                    if (!header.empty()) {
-                        headers = curl_slist_append(headers, header.c_str());
-                    }
-                }
-                prev = pos + 1;
+namespace
+{
+    // The server calls it on its shutdown, before the providers are closed and the library
+    // is unloaded, so the threads of the services are joined outside the loader lock.
+    int shutdownRuntime(const int /*reason*/, const int /*mask*/, void* /*arg*/)
+    {
+        Runtime::instance().shutdown();
+        return FB_SUCCESS;
+    }
+
+    // Unload hook of the library, installed with the first start of the runtime.
+    class UnloadHook final
+    {
+    public:
+        ~UnloadHook()
+        {
+            if (m_installed) {
+                // the library is unloaded before the shutdown of the server, mask 0 disables the callback
+                ISC_STATUS_ARRAY status;
+                fb_shutdown_callback(status, shutdownRuntime, 0, nullptr);
             }
-        }
-        // auto-delete headers
-        AutoCurlHeadersFree<curl_slist> autoHeaders(headers);
-        // set headers
-        if (headers) {
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+            Runtime::instance().unload();
         }
 
-        std::stringstream requestBody{};
-        if (!in->bodyNull) {
-            Firebird::AutoRelease<Firebird::IBlob> bodyBlob(m_att->openBlob(status, m_tra, &in->body, 0, nullptr));
-            bool eof = false;
-            std::vector<char> vBuffer(MAX_SEGMENT_SIZE);
-            auto buffer = vBuffer.data();
-            while (!eof) {
-                unsigned int l = 0;
-                switch (bodyBlob->getSegment(status, MAX_SEGMENT_SIZE, buffer, &l))
-                {
-                case Firebird::IStatus::RESULT_OK:
-                case Firebird::IStatus::RESULT_SEGMENT:
-                    requestBody.write(buffer, l);
-                    break;
-                default:
-                    bodyBlob->close(status);
-                    bodyBlob.release();
-                    eof = true;
-                    break;
-                }
-            }
-            // set beginning of stream
-            requestBody.seekg(0, std::ios::beg);
-            
-            curl_easy_setopt(curl, CURLOPT_READDATA, &requestBody);
-            curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
+        void install()
+        {
+            ISC_STATUS_ARRAY status;
+            m_installed = fb_shutdown_callback(status, shutdownRuntime, fb_shut_preproviders, nullptr) == 0;
         }
 
-        // function called by cURL to record received headers 
-        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &m_responseHeaders);
-        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_data);
-        // function called by cURL to record the received data 
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &m_response);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_data);
+    private:
+        bool m_installed = false;
+    };
 
+    UnloadHook unloadHook;
+}
 
-        // execute a request
-        CURLcode curlResult = curl_easy_perform(curl);
+const UdrConfig& getUdrConfig(Firebird::IExternalContext* context)
+{
+    static UdrConfig config;
+    static std::once_flag configLoaded;
+    std::call_once(configLoaded, [context]() {
+        auto configManager = context->getMaster()->getConfigManager();
+        std::string fileName(configManager->getDirectory(Firebird::IConfigManager::DIRECTORY_PLUGINS));
+        fileName += PATH_SEPARATOR;
+        fileName += "udr";
+        fileName += PATH_SEPARATOR;
+        fileName += UDR_CONFIG_FILE_NAME;
+        config.load(fileName);
+        // libcurl is initialized with the allocator of the settings
+        Runtime::instance().start(config);
+        unloadHook.install();
+    });
+    return config;
+}
 
-        if (curlResult == CURLE_OK) {
-            out->statusCodeNull = FB_FALSE;
-            if (curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &out->statusCode) != CURLE_OK) {
-                throwException(status, curlErrorBuffer);
-            }
+// The settings are read first, so that libcurl is not initialized before the allocator is known.
+CURL* createCurlHandle(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context)
+{
+    getUdrConfig(context);
+    CURL* curl = Runtime::instance().createHandle();
+    if (!curl) {
+        const auto& error = Runtime::instance().getInitError();
+        if (!error.empty()) {
+            throwException(status, "Can't initialize CURL. %s", error.c_str());
+        }
+        throwException(status, "Can't initialize CURL.");
+    }
+    return curl;
+}
 
-            char* contentType = nullptr;
-            if (curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &contentType) == CURLE_OK) {
-                if (contentType) {
-                    out->contentTypeNull = FB_FALSE;
-                    m_resonseContentType.assign(contentType);
-                }
-                else {
-                    out->contentTypeNull = FB_TRUE;
-                }
-            }
-            else {
-                throwException(status, curlErrorBuffer);
-            }
+const FileAccessPolicy& getFileAccessPolicy(Firebird::IExternalContext* context)
+{
+    static FileAccessPolicy policy;
+    static std::once_flag policyLoaded;
+    std::call_once(policyLoaded, [context]() {
+        policy.parse(getUdrConfig(context).getString("FileAccess", "None"));
+    });
+    return policy;
+}
 
-#if CURL_AT_LEAST_VERSION(7,50,0)
-            curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &m_http_version);
+// DNS lists of the library and of the request. They must live until the transfers of the handles start.
+std::shared_ptr<const DnsLists> selectDnsLists(const std::map<long, std::string>& options)
+{
+    auto getOption = [&options](long option) {
+        const auto it = options.find(option);
+        return it != options.cend() ? it->second : std::string();
+    };
+#if CURL_AT_LEAST_VERSION(7,49,0)
+    const std::string connectTo = getOption(CURLOPT_CONNECT_TO);
 #else
-            m_http_version = CURL_HTTP_VERSION_1_1;
+    const std::string connectTo;
 #endif
-            m_needFetch = true;
-        }
+#if CURL_AT_LEAST_VERSION(7,59,0)
+    const bool useHappyEyeballsTimeout = (options.find(CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS) == options.cend());
+#else
+    const bool useHappyEyeballsTimeout = true;
+#endif
+    return DnsResolver::instance().getLists(getOption(CURLOPT_RESOLVE), connectTo,
+        options.find(CURLOPT_IPRESOLVE) == options.cend(), useHappyEyeballsTimeout);
+}
+
+std::shared_ptr<const DnsLists> getDnsLists(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context,
+    const std::map<long, std::string>& options)
+{
+    static std::once_flag resolverStarted;
+    try {
+        // the pre-resolution of the hosts starts in the background with the first request
+        std::call_once(resolverStarted, [context]() {
+            DnsResolver::instance().start(getUdrConfig(context));
+        });
+        return selectDnsLists(options);
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return nullptr;
+}
+
+// The outbox is opened with the first request of the process, so the requests left by
+// the previous run are sent again without waiting for the next HTTP_OUTBOX_ENQUEUE.
+void openOutbox(Firebird::IExternalContext* context)
+{
+    static std::once_flag outboxOpened;
+    std::call_once(outboxOpened, [context]() {
+        Outbox::instance().open(getUdrConfig(context), [](CURL* curl, const std::string& options) {
+            const auto curlOptions = parseCurlOptions(options);
+            setCurlOptions(curl, curlOptions);
+            auto dnsLists = selectDnsLists(curlOptions);
+            if (dnsLists) {
+                dnsLists->apply(curl);
+            }
+            return dnsLists;
+        });
+    });
+}
+
+// Handles of finished requests are kept with their connections for the next requests.
+CurlHandlePool& getCurlHandlePool(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context)
+{
+    static std::once_flag poolConfigured;
+    try {
+        std::call_once(poolConfigured, [status, context]() {
+            // pinned and pre-resolved addresses are used by the warm-up of the pool
+            getDnsLists(status, context, std::map<long, std::string>());
+            const auto& config = getUdrConfig(context);
+            const auto poolSize = config.getInteger("ConnectionPoolSize", DEFAULT_CONNECTION_POOL_SIZE);
+            const auto idleTimeout = config.getInteger("ConnectionPoolIdleTimeout", DEFAULT_CONNECTION_POOL_IDLE_TIMEOUT.count());
+            CurlHandlePool::instance().configure(static_cast<size_t>(std::max<long long>(poolSize, 0)),
+                std::chrono::seconds(std::max<long long>(idleTimeout, 1)));
+            // connections to the endpoints of the configuration are opened in the background
+            Preconnector::instance().start(config, CurlHandlePool::instance());
+            openOutbox(context);
+        });
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return CurlHandlePool::instance();
+}
+
+Endpoint getEndpoint(Firebird::ThrowStatusWrapper* const status, const std::string& url)
+{
+    if (UpstreamGroups::isUpstreamUrl(url)) {
+        throwException(status, "Upstream groups can be used only by HTTP_REQUEST and HTTP_TEMPLATE_EXECUTE.");
+    }
+    try {
+        return Endpoint(url);
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return Endpoint(std::string());
+}
+
+// Upstream groups are read from the configuration once.
+UpstreamGroups& getUpstreamGroups(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context)
+{
+    static std::once_flag groupsConfigured;
+    try {
+        std::call_once(groupsConfigured, [context]() {
+            UpstreamGroups::instance().configure(getUdrConfig(context));
+        });
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return UpstreamGroups::instance();
+}
+
+// Chooses a member of the group addressed by an upstream:// URL, other URLs get an empty lease.
+UpstreamLease acquireUpstream(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context,
+    const std::string& url)
+{
+    if (!UpstreamGroups::isUpstreamUrl(url))
+        return UpstreamLease();
+    auto& groups = getUpstreamGroups(status, context);
+    try {
+        return groups.acquire(url);
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return UpstreamLease();
+}
+
+std::shared_ptr<const DnsLists> applyDnsSettings(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context,
+    CURL* curl, const std::map<long, std::string>& options)
+{
+    auto dnsLists = getDnsLists(status, context, options);
+    if (dnsLists) {
+        dnsLists->apply(curl);
+    }
+    return dnsLists;
+}
+
+// Returns true if a late request is to be hedged. Only idempotent requests are, GET and HEAD
+// or those marked with UDR_IDEMPOTENT.
+bool isHedgingEnabled(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context,
+    const std::map<long, std::string>& options, HttpMethod httpMethod, HedgePolicy& policy)
+{
+    const auto it = options.find(UDR_HEDGE);
+    if (it == options.cend())
+        return false;
+    if (httpMethod != HttpMethod::Get && httpMethod != HttpMethod::Head && !isUdrOptionEnabled(options, UDR_IDEMPOTENT))
+        return false;
+    static std::once_flag budgetConfigured;
+    try {
+        std::call_once(budgetConfigured, [context]() {
+            const auto percent = getUdrConfig(context).getInteger("HedgeBudgetPercent", DEFAULT_HEDGE_BUDGET_PERCENT);
+            HedgeBudget::instance().configure(static_cast<unsigned int>(std::max<long long>(percent, 0)));
+        });
+        policy = getHedgePolicy(it->second);
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return policy.adaptive || policy.delay.count() > 0;
+}
+
+// The trace buffer of the recent requests is allocated once.
+RequestTrace& getRequestTrace(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context)
+{
+    static std::once_flag traceConfigured;
+    try {
+        std::call_once(traceConfigured, [context]() {
+            const auto& config = getUdrConfig(context);
+            const auto size = config.getInteger("TraceBufferSize", DEFAULT_TRACE_BUFFER_SIZE);
+            const auto wireSampleRate = config.getInteger("TraceWireSampleRate", 0);
+            RequestTrace::instance().configure(static_cast<size_t>(std::max<long long>(size, 0)),
+                static_cast<unsigned int>(std::max<long long>(wireSampleRate, 0)));
+        });
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return RequestTrace::instance();
+}
+
+// Limits of the memory held by the responses collected in memory, read once.
+MemoryBudget& getMemoryBudget(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context)
+{
+    static std::once_flag memoryConfigured;
+    try {
+        std::call_once(memoryConfigured, [context]() {
+            const auto& config = getUdrConfig(context);
+            const auto limit = config.getInteger("MemoryLimit", 0);
+            const auto attachmentLimit = config.getInteger("AttachmentMemoryLimit", 0);
+            const auto policy = getMemoryPolicy(config.getString("MemoryLimitPolicy", "PAUSE"));
+            const auto waitTimeout = config.getInteger("MemoryWaitTimeout", DEFAULT_MEMORY_WAIT_TIMEOUT.count());
+            // the limits are given in megabytes
+            MemoryBudget::instance().configure(static_cast<uint64_t>(std::max<long long>(limit, 0)) * 1024 * 1024,
+                static_cast<uint64_t>(std::max<long long>(attachmentLimit, 0)) * 1024 * 1024, policy,
+                std::chrono::seconds(std::max<long long>(waitTimeout, 1)));
+        });
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    return MemoryBudget::instance();
+}
+
+// Interval between the checks of the cancellation of the statement during a transfer
+constexpr std::chrono::milliseconds CANCEL_CHECK_INTERVAL{ 200 };
+
+// Reads the statement timeout in milliseconds of the attachment or the database (0 if there is none)
+// and the attachment ID with one call.
+void getAttachmentInfo(Firebird::IMaster* master, Firebird::IAttachment* att, unsigned int& timeout, int64_t& attachmentId)
+{
+    timeout = 0;
+    attachmentId = 0;
+    const unsigned char items[] = {
+        isc_info_attachment_id,
+#if FB_API_VER >= 40
+        fb_info_statement_timeout_db, fb_info_statement_timeout_att,
+#endif
+        isc_info_end
+    };
+    unsigned char buffer[64];
+    Firebird::AutoDispose<Firebird::IStatus> infoStatus(master->getStatus());
+    Firebird::CheckStatusWrapper statusWrapper(infoStatus);
+    att->getInfo(&statusWrapper, sizeof(items), items, sizeof(buffer), buffer);
+    if (statusWrapper.getState() & Firebird::IStatus::STATE_ERRORS)
+        return;
+    for (const unsigned char* p = buffer; p < buffer + sizeof(buffer) - 3 && *p != isc_info_end;) {
+        const unsigned char item = *p++;
+        if (item == isc_info_truncated || item == isc_info_error)
+            break;
+        const auto length = static_cast<short>(isc_vax_integer(reinterpret_cast<const char*>(p), 2));
+        p += 2;
+        if (p + length > buffer + sizeof(buffer))
+            break;
+        if (item == isc_info_attachment_id) {
+            // the ID is 64-bit since Firebird 4.0
+            attachmentId = isc_portable_integer(p, length);
+            p += length;
+            continue;
+        }
+        const auto value = static_cast<unsigned int>(isc_vax_integer(reinterpret_cast<const char*>(p), length));
+        p += length;
+        // the timeout of the attachment overrides the one of the database only if it is smaller
+        if (value > 0 && (timeout == 0 || value < timeout))
+            timeout = value;
+    }
+}
+
+/*
+ * Stops the transfers of a routine when its statement is cancelled with fb_cancel_operation
+ * or its statement timeout expires. The progress callback pings the attachment, a pending
+ * cancel request is reported by the engine as an error of the ping. The callback must run
+ * in the thread of the routine, the engine does not allow other threads to use the attachment.
+ */
+class TransferGuard final
+{
+public:
+    TransferGuard(Firebird::ThrowStatusWrapper* status, Firebird::IExternalContext* context)
+        : m_att(context->getAttachment(status))
+        , m_pingStatus(context->getMaster()->getStatus())
+        , m_lastCheck(std::chrono::steady_clock::now())
+    {
+        // the statement started earlier, so the real deadline may be a bit closer
+        getAttachmentInfo(context->getMaster(), m_att, m_statementTimeout, m_attachmentId);
+        m_deadline = m_lastCheck + std::chrono::milliseconds(m_statementTimeout);
+    }
+
+    TransferGuard(const TransferGuard&) = delete;
+    TransferGuard& operator=(const TransferGuard&) = delete;
+
+    // Installs the progress callback and limits the transfer timeout.
+    void attach(CURL* curl, const std::map<long, std::string>& options)
+    {
+        attachShared(curl);
+        limitTimeout(curl, options);
+    }
+
+    // Installs the progress callback only. A transfer shared with other statements is not
+    // limited by this statement timeout, so its expiry is told apart from the timeout of the request.
+    void attachShared(CURL* curl)
+    {
+#if CURL_AT_LEAST_VERSION(7,32,0)
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
+#endif
+    }
+
+    // Counts the buffer in the memory budget of the attachment. A paused transfer
+    // is continued by the progress callback, errors of the buffer are raised by check().
+    void watch(MemoryBudget& budget, CURL* curl, ResponseBuffer& buffer)
+    {
+        buffer.setBudget(budget, m_attachmentId, curl);
+        m_buffers.push_back(&buffer);
+    }
+
+    // With the REJECT policy a new request fails while a memory limit is reached.
+    void checkMemory(Firebird::ThrowStatusWrapper* status, MemoryBudget& budget) const
+    {
+        if (budget.getPolicy() == MemoryPolicy::Reject && !budget.hasRoom(m_attachmentId, 1)) {
+            budget.addReject();
+            throwException(status, "Memory limit of the UDR is reached.");
+        }
+    }
+
+    // Limits the transfer timeout by the rest of the statement timeout. Safe for handles used in other threads.
+    void limitTimeout(CURL* curl, const std::map<long, std::string>& options) const
+    {
+        if (m_statementTimeout == 0)
+            return;
+        const auto now = std::chrono::steady_clock::now();
+        long timeout = 1;
+        if (m_deadline > now)
+            timeout = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(m_deadline - now).count()) + 1;
+        // the smaller timeout of the request is kept
+        auto it = options.find(CURLOPT_TIMEOUT_MS);
+        if (it != options.cend() && std::stol(it->second) > 0)
+            timeout = std::min(timeout, std::stol(it->second));
+        it = options.find(CURLOPT_TIMEOUT);
+        if (it != options.cend() && std::stol(it->second) > 0)
+            timeout = std::min(timeout, std::stol(it->second) * 1000);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout);
+    }
+
+    // Pings the attachment at most once per CANCEL_CHECK_INTERVAL.
+    bool isCancelled()
+    {
+        if (m_cancelled || m_timedOut)
+            return true;
+        const auto now = std::chrono::steady_clock::now();
+        if (m_statementTimeout > 0 && now >= m_deadline) {
+            m_timedOut = true;
+            return true;
+        }
+        if (now - m_lastCheck < CANCEL_CHECK_INTERVAL)
+            return false;
+        m_lastCheck = now;
+        Firebird::CheckStatusWrapper statusWrapper(m_pingStatus);
+        m_att->ping(&statusWrapper);
+        m_cancelled = (statusWrapper.getState() & Firebird::IStatus::STATE_ERRORS) != 0;
+        return m_cancelled;
+    }
+
+    int64_t getAttachmentId() const
+    {
+        return m_attachmentId;
+    }
+
+    // Returns true if a transfer failed because of this statement rather than because of the server:
+    // cancellation, the statement timeout passed as CURLOPT_TIMEOUT_MS, a memory limit or an error of a callback.
+    bool isLocalFailure(CURLcode result) const
+    {
+        switch (result) {
+        case CURLE_OK:
+            return false;
+        case CURLE_ABORTED_BY_CALLBACK:
+        case CURLE_WRITE_ERROR:
+        case CURLE_READ_ERROR:
+        case CURLE_OUT_OF_MEMORY:
+            return true;
+        default:
+            break;
+        }
+        if (m_cancelled || m_timedOut)
+            return true;
+        if (result == CURLE_OPERATION_TIMEDOUT && m_statementTimeout > 0 && std::chrono::steady_clock::now() >= m_deadline)
+            return true;
+        for (const auto buffer : m_buffers) {
+            if (!buffer->getError().empty())
+                return true;
+        }
+        return false;
+    }
+
+    // Raises the error of the cancelled or timed out statement, called when a transfer fails.
+    void check(Firebird::ThrowStatusWrapper* status)
+    {
+        if (m_cancelled) {
+            // the ping has taken the cancel request, so the engine gets its error back
+            throw Firebird::FbException(status, m_pingStatus->getErrors());
+        }
+        if (m_timedOut || (m_statementTimeout > 0 && std::chrono::steady_clock::now() >= m_deadline)) {
+            throwException(status, "Statement timeout of %u ms expired during the HTTP transfer.", m_statementTimeout);
+        }
+        for (const auto buffer : m_buffers) {
+            if (!buffer->getError().empty()) {
+                throwException(status, "%s", buffer->getError().c_str());
+            }
+        }
+    }
+
+private:
+    static int progress_callback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+    {
+        auto guard = static_cast<TransferGuard*>(clientp);
+        for (const auto buffer : guard->m_buffers) {
+            if (!buffer->resume())
+                return 1;
+        }
+        // a non-zero value aborts the transfer
+        return guard->isCancelled() ? 1 : 0;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att;
+    Firebird::AutoDispose<Firebird::IStatus> m_pingStatus;
+    unsigned int m_statementTimeout = 0;
+    int64_t m_attachmentId = 0;
+    std::chrono::steady_clock::time_point m_deadline;
+    std::chrono::steady_clock::time_point m_lastCheck;
+    bool m_cancelled = false;
+    bool m_timedOut = false;
+    // buffers of the responses of the transfer
+    std::vector<ResponseBuffer*> m_buffers;
+};
+
+// Passes the outcome of the transfer to the health checks of the upstream group. Only transport
+// errors and 5xx responses of the server count as failures of the member, failures caused by the
+// statement (see TransferGuard::isLocalFailure) say nothing about it.
+void completeUpstream(UpstreamLease& upstream, const TransferGuard& guard, CURLcode curlResult, CURL* curl)
+{
+    if (!upstream || guard.isLocalFailure(curlResult))
+        return;
+    long statusCode = 0;
+    double startTransferTime = 0;
+    if (curlResult == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &startTransferTime);
+    }
+    upstream.complete(curlResult == CURLE_OK && statusCode < 500,
+        std::chrono::milliseconds(static_cast<long long>(startTransferTime * 1000)));
+}
+
+// Arguments of HTTP_REQUEST and its variants.
+struct HttpRequestArgs
+{
+    std::string method;
+    std::string url;
+    bool hasBody = false;
+    ISC_QUAD body;               // BLOB with the request body
+    // body passed as VARCHAR, it is sent from the input message without copies
+    const char* text = nullptr;
+    size_t textLength = 0;
+    bool hasContentType = false;
+    std::string contentType;
+    std::string headers;
+    std::string options;
+};
+
+// Takes the arguments from the input message of HTTP_REQUEST or of one of its variants, except the body.
+template <class InMessage>
+HttpRequestArgs getHttpRequestArgs(Firebird::ThrowStatusWrapper* const status, const InMessage* in)
+{
+    HttpRequestArgs args;
+    if (in->methodNull) {
+        throwException(status, "HTTP_METHOD can not be NULL.");
+    }
+    args.method.assign(in->method.str, in->method.length);
+    if (in->urlNull) {
+        throwException(status, "URL can not be NULL.");
+    }
+    args.url.assign(in->url.str, in->url.length);
+    if (!in->contentTypeNull) {
+        args.hasContentType = true;
+        args.contentType.assign(in->contentType.str, in->contentType.length);
+    }
+    if (!in->headersNull) {
+        args.headers.assign(in->headers.str, in->headers.length);
+    }
+    if (!in->optionsNull) {
+        args.options.assign(in->options.str, in->options.length);
+    }
+    return args;
+}
+
+// Identical requests of idempotent methods without a body in flight at the same time share one transfer.
+bool isSingleFlight(const std::map<long, std::string>& curlOptions, HttpMethod httpMethod, bool hasBody)
+{
+    return !hasBody && (httpMethod == HttpMethod::Get || httpMethod == HttpMethod::Head) &&
+        isUdrOptionEnabled(curlOptions, UDR_SINGLE_FLIGHT);
+}
+
+// Performs the transfer of HTTP_REQUEST, of its variants and of HTTP_TEMPLATE_EXECUTE. The handle has
+// the URL, method, options, headers and body of the request. A request with a single flight key shares
+// its transfer with identical ones, a late idempotent request is hedged, the response headers are kept
+// as UDR_RESPONSE_HEADERS says. The body of a hedged copy is set by prepareCopyBody if it is not in memory.
+// Transfer errors are thrown.
+std::shared_ptr<const SharedResponse> performTransfer(Firebird::ThrowStatusWrapper* const status,
+    Firebird::IExternalContext* context, PooledCurl& curl, const Endpoint& endpoint, UpstreamLease& upstream,
+    HttpMethod httpMethod, const std::string& method, const std::map<long, std::string>& curlOptions,
+    const std::string& singleFlightKey, char* curlErrorBuffer, const HedgedTransfer::PrepareCopy& prepareCopyBody)
+{
+    // the transfer stops when the statement is cancelled or times out
+    TransferGuard guard(status, context);
+    if (!singleFlightKey.empty()) {
+        guard.attachShared(curl);
+    }
+    else {
+        guard.attach(curl, curlOptions);
+    }
+    // the response is counted in the memory limits
+    auto& memoryBudget = getMemoryBudget(status, context);
+    guard.checkMemory(status, memoryBudget);
+    // the transfer is recorded in the trace buffer
+    TransferTrace trace(getRequestTrace(status, context), curl);
+
+    // most callers never read the headers, so they may be skipped
+    HeaderCapture headerCapture;
+    const auto headersOption = curlOptions.find(UDR_RESPONSE_HEADERS);
+    if (headersOption != curlOptions.cend()) {
+        headerCapture = getHeaderCapture(headersOption->second);
+    }
+    const auto setHeaderTarget = [&headerCapture](CURL* handle, HeaderCapture& capture, ResponseBuffer* headers) {
+        capture = headerCapture;
+        capture.headers = headers;
+        if (capture.all) {
+            curl_easy_setopt(handle, CURLOPT_HEADERDATA, headers);
+            curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, ResponseBuffer::append_callback);
+        }
+        else {
+            curl_easy_setopt(handle, CURLOPT_HEADERDATA, &capture);
+            curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, write_header);
+        }
+    };
+
+    if (!singleFlightKey.empty()) {
+        CURL* hCurl = curl;
+        bool shared = false;
+        const auto attachmentId = guard.getAttachmentId();
+        auto sharedResponse = SingleFlight::instance().run(singleFlightKey, [&, hCurl]() {
+            std::shared_ptr<SharedResponse> response(new SharedResponse());
+            HeaderCapture capture;
+            setHeaderTarget(hCurl, capture, &response->headers);
+            response->hasHeaders = capture.all || !capture.names.empty();
+            guard.watch(memoryBudget, hCurl, response->headers);
+            guard.watch(memoryBudget, hCurl, response->body);
+            curl_easy_setopt(hCurl, CURLOPT_WRITEDATA, &response->body);
+            curl_easy_setopt(hCurl, CURLOPT_WRITEFUNCTION, ResponseBuffer::write_callback);
+
+            response->result = curl_easy_perform(hCurl);
+            trace.record(attachmentId, method, hCurl, response->result, curlErrorBuffer);
+            completeUpstream(upstream, guard, response->result, hCurl);
+            if (response->result != CURLE_OK) {
+                // the waiting requests do not fail because this statement was cancelled,
+                // timed out or reached the memory limit of its attachment
+                response->local = response->result == CURLE_ABORTED_BY_CALLBACK ||
+                    !response->body.getError().empty() || !response->headers.getError().empty();
+                // a memory limit stops the transfer with a write error
+                response->error = response->body.getError();
+                if (response->error.empty())
+                    response->error = response->headers.getError();
+                if (response->error.empty())
+                    response->error.assign(curlErrorBuffer);
+                if (response->error.empty())
+                    response->error.assign(curl_easy_strerror(response->result));
+                return std::shared_ptr<const SharedResponse>(response);
+            }
+            curl_easy_getinfo(hCurl, CURLINFO_RESPONSE_CODE, &response->statusCode);
+            char* contentType = nullptr;
+            curl_easy_getinfo(hCurl, CURLINFO_CONTENT_TYPE, &contentType);
+            response->hasContentType = (contentType != nullptr);
+            if (contentType)
+                response->contentType.assign(contentType);
+#if CURL_AT_LEAST_VERSION(7,50,0)
+            curl_easy_getinfo(hCurl, CURLINFO_HTTP_VERSION, &response->httpVersion);
+#else
+            response->httpVersion = CURL_HTTP_VERSION_1_1;
+#endif
+            return std::shared_ptr<const SharedResponse>(response);
+        }, [&guard]() { return guard.isCancelled(); }, shared);
+
+        if (!sharedResponse) {
+            // cancelled while waiting for the transfer of another statement
+            guard.check(status);
+        }
+        if (sharedResponse->result != CURLE_OK) {
+            guard.check(status);
+            throwException(status, "%s", sharedResponse->error.c_str());
+        }
+        return sharedResponse;
+    }
+
+    // the response of the own transfer is collected the same way as a shared one
+    std::shared_ptr<SharedResponse> response(new SharedResponse());
+    // function called by cURL to record received headers 
+    HeaderCapture capture;
+    setHeaderTarget(curl, capture, &response->headers);
+    response->hasHeaders = capture.all || !capture.names.empty();
+    guard.watch(memoryBudget, curl, response->headers);
+    guard.watch(memoryBudget, curl, response->body);
+    // function called by cURL to record the received data 
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response->body);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ResponseBuffer::write_callback);
+
+    // a copy of a late idempotent request is sent on another connection
+    HedgePolicy hedgePolicy;
+    std::unique_ptr<HedgedTransfer> hedgedTransfer;
+    ResponseBuffer copyHeaders;
+    HeaderCapture copyCapture;
+    ResponseBuffer copyResponse;
+    if (isHedgingEnabled(status, context, curlOptions, httpMethod, hedgePolicy)) {
+        CURLM* multi = curl.getMulti();
+        if (!multi) {
+            throwException(status, "Can't initialize CURL.");
+        }
+        hedgedTransfer.reset(new HedgedTransfer(curl, multi, endpoint.getKey(), hedgePolicy));
+    }
+
+    // execute a request
+    CURLcode curlResult = CURLE_OK;
+    CURL* responseCurl = curl;
+    if (hedgedTransfer) {
+        try {
+            curlResult = hedgedTransfer->perform([&](CURL* copy) {
+                setHeaderTarget(copy, copyCapture, &copyHeaders);
+                guard.watch(memoryBudget, copy, copyHeaders);
+                guard.watch(memoryBudget, copy, copyResponse);
+                curl_easy_setopt(copy, CURLOPT_WRITEDATA, &copyResponse);
+                if (prepareCopyBody)
+                    prepareCopyBody(copy);
+            });
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        if (hedgedTransfer->isCopyTaken()) {
+            response->headers.swap(copyHeaders);
+            response->body.swap(copyResponse);
+        }
+        responseCurl = hedgedTransfer->getHandle();
+    }
+    else {
+        curlResult = curl_easy_perform(curl);
+    }
+    completeUpstream(upstream, guard, curlResult, responseCurl);
+    trace.record(guard.getAttachmentId(), method, responseCurl, curlResult, curlErrorBuffer);
+
+    if (curlResult != CURLE_OK) {
+        guard.check(status);
+
+        std::string curlErrorMessage(curlErrorBuffer);
+        if (curlErrorMessage.empty())
+            curlErrorMessage.assign(curl_easy_strerror(curlResult));
+
+        throwException(status, "%s", curlErrorMessage.c_str());
+    }
+
+    if (curl_easy_getinfo(responseCurl, CURLINFO_RESPONSE_CODE, &response->statusCode) != CURLE_OK) {
+        throwException(status, "%s", curlErrorBuffer);
+    }
+
+    char* contentType = nullptr;
+    if (curl_easy_getinfo(responseCurl, CURLINFO_CONTENT_TYPE, &contentType) != CURLE_OK) {
+        throwException(status, "%s", curlErrorBuffer);
+    }
+    response->hasContentType = (contentType != nullptr);
+    if (contentType)
+        response->contentType.assign(contentType);
+
+#if CURL_AT_LEAST_VERSION(7,50,0)
+    curl_easy_getinfo(responseCurl, CURLINFO_HTTP_VERSION, &response->httpVersion);
+#else
+    response->httpVersion = CURL_HTTP_VERSION_1_1;
+#endif
+    return response;
+}
+
+// Sends the request of HTTP_REQUEST or of one of its variants, transfer errors are thrown.
+std::shared_ptr<const SharedResponse> performHttpRequest(Firebird::ThrowStatusWrapper* const status,
+    Firebird::IExternalContext* context, Firebird::IAttachment* att, Firebird::ITransaction* tra, HttpRequestArgs& args)
+{
+    auto httpMethod = getHttpMethod(args.method);
+    if (httpMethod == HttpMethod::None) {
+        throwException(status, "Unsupported HTTP method %s.", args.method.c_str());
+    }
+
+    // a request to an upstream group is sent to one of its members
+    UpstreamLease upstream = acquireUpstream(status, context, args.url);
+    const Endpoint endpoint = getEndpoint(status, upstream ? upstream.getUrl() : args.url);
+
+    // the handle keeps its connection for the next request to the same endpoint
+    PooledCurl curl(getCurlHandlePool(status, context), endpoint.getKey());
+
+    if (!curl) {
+        throwException(status, "Can't initialize CURL.");
+    }
+
+    // buffer for storing text errors
+    char curlErrorBuffer[CURL_ERROR_SIZE];
+    memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+
+    // set url
+    endpoint.apply(curl);
+
+    // set Http method
+    setHttpMethod(status, curl, httpMethod, args.method);
+
+    std::map<long, std::string> curlOptions;
+    if (!args.options.empty()) {
+        curlOptions = applyCurlOptions(status, curl, args.options);
+    }
+    // addresses given by the request stay in the DNS cache of the handle
+    if (curlOptions.find(CURLOPT_RESOLVE) != curlOptions.cend()) {
+        curl.discard();
+    }
+
+    // collecting headers
+    struct curl_slist* headers = nullptr;
+    // content-type
+    if (args.hasContentType) {
+        const std::string contentType = std::string("Content-Type: ") + args.contentType;
+        headers = curl_slist_append(headers, contentType.c_str());
+    }
+    // other headers
+    headers = appendHeaders(headers, args.headers);
+    // auto-delete headers
+    AutoCurlHeadersFree<curl_slist> autoHeaders(headers);
+    // set headers
+    if (headers) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    }
+
+    std::stringstream requestBody{};
+    if (args.hasBody) {
+        readBlob(status, att, tra, &args.body, requestBody);
+        // set beginning of stream
+        requestBody.seekg(0, std::ios::beg);
+
+        curl_easy_setopt(curl, CURLOPT_READDATA, &requestBody);
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
+    }
+    else if (args.text && httpMethod != HttpMethod::Head) {
+        // libcurl reads the body from the input message, which lives until the transfer ends
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(args.textLength));
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, args.text);
+        if (httpMethod == HttpMethod::Get) {
+            // the body would make it a POST
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
+        }
+    }
+
+    std::string singleFlightKey;
+    if (isSingleFlight(curlOptions, httpMethod, args.hasBody || args.text)) {
+        // everything that can change the response is a part of the key
+        singleFlightKey = args.method;
+        singleFlightKey.push_back('\n');
+        singleFlightKey += args.url;
+        singleFlightKey.push_back('\n');
+        singleFlightKey += args.contentType;
+        singleFlightKey.push_back('\n');
+        singleFlightKey += args.headers;
+        singleFlightKey.push_back('\n');
+        singleFlightKey += args.options;
+    }
+
+    std::stringstream copyBody;
+    return performTransfer(status, context, curl, endpoint, upstream, httpMethod, args.method, curlOptions,
+        singleFlightKey, curlErrorBuffer, [&args, &requestBody, &copyBody](CURL* copy) {
+            if (args.hasBody) {
+                copyBody.str(requestBody.str());
+                curl_easy_setopt(copy, CURLOPT_READDATA, &copyBody);
+            }
+        });
+}
+
+// Fills the output message of HTTP_REQUEST, HTTP_REQUEST_TEXT or HTTP_TEMPLATE_EXECUTE, the status code
+// is set by the execution.
+template <class OutMessage>
+void writeHttpResponse(Firebird::ThrowStatusWrapper* const status, Firebird::IAttachment* att, Firebird::ITransaction* tra,
+    const SharedResponse& response, OutMessage* out)
+{
+    // response headers
+    out->statusTextNull = FB_TRUE;
+    const std::string& headers = response.headers.getData();
+    if (!headers.empty()) {
+        auto statusText = extractResponseStatusText(response.httpVersion, out->statusCode, headers);
+        out->statusTextNull = statusText.empty();
+        if (!out->statusTextNull) {
+            out->statusText.length = std::min<short>(statusText.size(), 1024);
+            statusText.copy(out->statusText.str, out->statusText.length);
+        }
+    }
+    // with UDR_RESPONSE_HEADERS=NONE only the status lines are kept
+    out->headersNull = (headers.empty() || !response.hasHeaders) ? FB_TRUE : FB_FALSE;
+    if (!out->headersNull) {
+        writeBlob(status, att, tra, &out->headers, headers.data(), headers.length());
+    }
+
+    // response body
+    out->bodyNull = response.body.empty() ? FB_TRUE : FB_FALSE;
+    if (!out->bodyNull) {
+        writeBlob(status, att, tra, &out->body, response.body);
+    }
+    // contentType
+    if (!out->contentTypeNull) {
+        out->contentType.length = std::min<short>(response.contentType.size(), 1024);
+        response.contentType.copy(out->contentType.str, out->contentType.length);
+    }
+}
+
+/*
+  PROCEDURE HTTP_REQUEST (
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE BINARY,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!sendHttpRequest'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(sendHttpRequest)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_BLOB, body)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_BLOB, body)
+        (FB_BLOB, headers)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        auto args = getHttpRequestArgs(status, in);
+        if (!in->bodyNull) {
+            args.hasBody = true;
+            args.body = in->body;
+        }
+        m_response = performHttpRequest(status, context, m_att, m_tra, args);
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = static_cast<ISC_SHORT>(m_response->statusCode);
+        out->contentTypeNull = m_response->hasContentType ? FB_FALSE : FB_TRUE;
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    bool m_needFetch = false;
+    // the response may be shared with identical requests, it is not copied
+    std::shared_ptr<const SharedResponse> m_response;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = !m_needFetch;
+        writeHttpResponse(status, m_att, m_tra, *m_response, out);
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+// A body of this size fits VARCHAR(8191) in any character set.
+constexpr long long MAX_INLINE_BODY_SIZE = 8191;
+
+// Responses up to this size are returned by HTTP_REQUEST_INLINE without a BLOB.
+size_t getInlineBodySize(Firebird::IExternalContext* context)
+{
+    static size_t inlineBodySize = 0;
+    static std::once_flag inlineBodySizeRead;
+    std::call_once(inlineBodySizeRead, [context]() {
+        const auto size = getUdrConfig(context).getInteger("InlineBodySize", MAX_INLINE_BODY_SIZE);
+        inlineBodySize = static_cast<size_t>(std::min(std::max<long long>(size, 0), MAX_INLINE_BODY_SIZE));
+    });
+    return inlineBodySize;
+}
+
+/*
+  PROCEDURE HTTP_REQUEST_INLINE (
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE BINARY,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_TEXT        VARCHAR(8191) CHARACTER SET OCTETS,
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS_TEXT VARCHAR(8191),
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    BODY_INLINE          BOOLEAN
+  )
+  EXTERNAL NAME 'http_client_udr!sendHttpRequestInline'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(sendHttpRequestInline)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_BLOB, body)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(8191, 1), text)
+        (FB_BLOB, body)
+        (FB_INTL_VARCHAR(32765, 0), headersText)
+        (FB_BLOB, headers)
+        (FB_BOOLEAN, bodyInline)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        auto args = getHttpRequestArgs(status, in);
+        if (!in->bodyNull) {
+            args.hasBody = true;
+            args.body = in->body;
+        }
+        m_inlineBodySize = getInlineBodySize(context);
+        m_response = performHttpRequest(status, context, m_att, m_tra, args);
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = static_cast<ISC_SHORT>(m_response->statusCode);
+        out->contentTypeNull = m_response->hasContentType ? FB_FALSE : FB_TRUE;
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    bool m_needFetch = false;
+    size_t m_inlineBodySize = 0;
+    std::shared_ptr<const SharedResponse> m_response;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        const std::string& headers = m_response->headers.getData();
+        out->statusTextNull = FB_TRUE;
+        if (!headers.empty()) {
+            auto statusText = extractResponseStatusText(m_response->httpVersion, out->statusCode, headers);
+            out->statusTextNull = statusText.empty();
+            if (!out->statusTextNull) {
+                out->statusText.length = std::min<short>(statusText.size(), 1024);
+                statusText.copy(out->statusText.str, out->statusText.length);
+            }
+        }
+
+        // headers are returned like the body, without a BLOB if they fit
+        const bool hasHeaders = !headers.empty() && m_response->hasHeaders;
+        const bool headersInline = headers.size() <= m_inlineBodySize;
+        out->headersTextNull = (hasHeaders && headersInline) ? FB_FALSE : FB_TRUE;
+        out->headersNull = (hasHeaders && !headersInline) ? FB_FALSE : FB_TRUE;
+        if (!out->headersTextNull) {
+            out->headersText.length = static_cast<unsigned short>(headers.size());
+            headers.copy(out->headersText.str, out->headersText.length);
+        }
+        if (!out->headersNull) {
+            writeBlob(status, m_att, m_tra, &out->headers, headers.data(), headers.length());
+        }
+
+        // the BLOB is created only for a body that does not fit into RESPONSE_TEXT
+        const ResponseBuffer& response = m_response->body;
+        out->bodyInlineNull = FB_FALSE;
+        out->bodyInline = (!response.isSpilled() && response.size() <= m_inlineBodySize) ? FB_TRUE : FB_FALSE;
+        out->textNull = (out->bodyInline && !response.empty()) ? FB_FALSE : FB_TRUE;
+        out->bodyNull = (!out->bodyInline && !response.empty()) ? FB_FALSE : FB_TRUE;
+        if (!out->textNull) {
+            out->text.length = static_cast<unsigned short>(response.size());
+            response.getData().copy(out->text.str, out->text.length);
+        }
+        if (!out->bodyNull) {
+            writeBlob(status, m_att, m_tra, &out->body, response);
+        }
+
+        if (!out->contentTypeNull) {
+            out->contentType.length = std::min<short>(m_response->contentType.size(), 1024);
+            m_response->contentType.copy(out->contentType.str, out->contentType.length);
+        }
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+/*
+  PROCEDURE HTTP_REQUEST_TEXT (
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_TEXT         VARCHAR(8191),
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!sendHttpRequestText'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(sendHttpRequestText)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(32765, 0), text)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_BLOB, body)
+        (FB_BLOB, headers)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        auto args = getHttpRequestArgs(status, in);
+        if (!in->textNull) {
+            args.text = in->text.str;
+            args.textLength = in->text.length;
+        }
+        m_response = performHttpRequest(status, context, m_att, m_tra, args);
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = static_cast<ISC_SHORT>(m_response->statusCode);
+        out->contentTypeNull = m_response->hasContentType ? FB_FALSE : FB_TRUE;
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    bool m_needFetch = false;
+    std::shared_ptr<const SharedResponse> m_response;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        writeHttpResponse(status, m_att, m_tra, *m_response, out);
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+struct FileDownload
+{
+    AtomicFileWriter* writer = nullptr;
+    Sha256 checksum;
+    std::string error;
+};
+
+size_t write_file_data(void* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    auto download = static_cast<FileDownload*>(userdata);
+    const size_t length = size * nmemb;
+    try {
+        download->writer->write(ptr, length);
+        download->checksum.update(ptr, length);
+    }
+    catch (const std::exception& e) {
+        download->error = e.what();
+        // abort the transfer
+        return 0;
+    }
+    return length;
+}
+
+/*
+  PROCEDURE HTTP_DOWNLOAD_TO_FILE (
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    SYNC_MODE            VARCHAR(10),
+    OVERWRITE            BOOLEAN
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    FILE_SIZE            BIGINT,
+    CHECKSUM             VARCHAR(64),
+    NAMELOOKUP_TIME      DOUBLE PRECISION,
+    CONNECT_TIME         DOUBLE PRECISION,
+    STARTTRANSFER_TIME   DOUBLE PRECISION,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!downloadToFile'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(downloadToFile)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(32765, 0), fileName)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+        (FB_INTL_VARCHAR(40, 0), syncMode)
+        (FB_BOOLEAN, overwrite)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_BLOB, headers)
+        (FB_BIGINT, fileSize)
+        (FB_INTL_VARCHAR(256, 0), checksum)
+        (FB_DOUBLE, nameLookupTime)
+        (FB_DOUBLE, connectTime)
+        (FB_DOUBLE, startTransferTime)
+        (FB_DOUBLE, totalTime)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        const std::string url(in->url.str, in->url.length);
+
+        if (in->fileNameNull) {
+            throwException(status, "FILE_NAME can not be NULL.");
+        }
+        const std::string fileName(in->fileName.str, in->fileName.length);
+
+        std::unique_ptr<AtomicFileWriter> writer;
+        try {
+            const auto syncMode = in->syncModeNull ? FileSyncMode::Close :
+                getFileSyncMode(std::string(in->syncMode.str, in->syncMode.length));
+            const std::string canonicalName = getFileAccessPolicy(context).checkAccess(fileName);
+            writer.reset(new AtomicFileWriter(canonicalName, syncMode, !in->overwriteNull && in->overwrite));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+
+        AutoCurlCleanup<CURL> curl(createCurlHandle(status, context));
+
+        // buffer for storing text errors
+        char curlErrorBuffer[CURL_ERROR_SIZE];
+        memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+
+        // set url
+        getEndpoint(status, url).apply(curl);
+
+        std::map<long, std::string> curlOptions;
+        if (!in->optionsNull) {
+            curlOptions = applyCurlOptions(status, curl, std::string(in->options.str, in->options.length));
+        }
+        const auto dnsLists = applyDnsSettings(status, context, curl, curlOptions);
+        // the transfer stops when the statement is cancelled or times out
+        TransferGuard guard(status, context);
+        guard.attach(curl, curlOptions);
+        // the response headers are counted in the memory limits
+        auto& memoryBudget = getMemoryBudget(status, context);
+        guard.checkMemory(status, memoryBudget);
+        // the transfer is recorded in the trace buffer
+        TransferTrace trace(getRequestTrace(status, context), curl);
+
+        curl_slist* headers = nullptr;
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        // auto-delete headers
+        AutoCurlHeadersFree<curl_slist> autoHeaders(headers);
+        // set headers
+        if (headers) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        }
+
+        FileDownload download;
+        download.writer = writer.get();
+
+        // function called by cURL to record received headers 
+        guard.watch(memoryBudget, curl, m_responseHeaders);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &m_responseHeaders);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ResponseBuffer::append_callback);
+        // received data is written directly to the file
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &download);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_file_data);
+
+        // execute a request
+        CURLcode curlResult = curl_easy_perform(curl);
+        trace.record(guard.getAttachmentId(), "GET", curl, curlResult, curlErrorBuffer);
+
+        if (curlResult != CURLE_OK) {
+            guard.check(status);
+            if (!download.error.empty()) {
+                throwException(status, "%s", download.error.c_str());
+            }
+            std::string curlErrorMessage(curlErrorBuffer);
+            if (curlErrorMessage.empty())
+                curlErrorMessage.assign(curl_easy_strerror(curlResult));
+
+            throwException(status, "%s", curlErrorMessage.c_str());
+        }
+
+        out->statusCodeNull = FB_FALSE;
+        long statusCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
+        out->statusCode = static_cast<ISC_SHORT>(statusCode);
+
+        char* contentType = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &contentType);
+        out->contentTypeNull = contentType ? FB_FALSE : FB_TRUE;
+        if (contentType) {
+            m_resonseContentType.assign(contentType);
+        }
+
+#if CURL_AT_LEAST_VERSION(7,50,0)
+        curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &m_http_version);
+#else
+        m_http_version = CURL_HTTP_VERSION_1_1;
+#endif
+
+        out->nameLookupTimeNull = FB_FALSE;
+        curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &out->nameLookupTime);
+        out->connectTimeNull = FB_FALSE;
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &out->connectTime);
+        out->startTransferTimeNull = FB_FALSE;
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &out->startTransferTime);
+
+        double totalTime = 0;
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &totalTime);
+        const auto commitStart = std::chrono::steady_clock::now();
+
+        // Only a successful response replaces the target file,
+        // otherwise the received error page is discarded with the temporary file.
+        out->fileSizeNull = FB_TRUE;
+        out->checksumNull = FB_TRUE;
+        if (statusCode >= 200 && statusCode < 300) {
+            try {
+                writer->commit();
+            }
+            catch (const std::runtime_error& e) {
+                throwException(status, "%s", e.what());
+            }
+            out->fileSizeNull = FB_FALSE;
+            out->fileSize = static_cast<ISC_INT64>(writer->getSize());
+
+            const std::string checksum = download.checksum.hexDigest();
+            out->checksumNull = FB_FALSE;
+            out->checksum.length = static_cast<unsigned short>(checksum.size());
+            checksum.copy(out->checksum.str, out->checksum.length);
+        }
+        writer.reset();
+
+        // the total time also includes flushing and renaming the file
+        out->totalTimeNull = FB_FALSE;
+        out->totalTime = totalTime + std::chrono::duration<double>(std::chrono::steady_clock::now() - commitStart).count();
+
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    bool m_needFetch = false;
+    ResponseBuffer m_responseHeaders;
+    std::string m_resonseContentType{ "" };
+    long m_http_version = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        // response headers
+        const std::string& headers = m_responseHeaders.getData();
+        out->headersNull = headers.empty() ? FB_TRUE : FB_FALSE;
+        out->statusTextNull = FB_TRUE;
+        if (!out->headersNull) {
+            auto statusText = extractResponseStatusText(m_http_version, out->statusCode, headers);
+            out->statusTextNull = statusText.empty();
+            if (!out->statusTextNull) {
+                out->statusText.length = std::min<short>(statusText.size(), 1024);
+                statusText.copy(out->statusText.str, out->statusText.length);
+            }
+
+            writeBlob(status, m_att, m_tra, &out->headers, headers.data(), headers.length());
+        }
+        // contentType
+        if (!out->contentTypeNull) {
+            out->contentType.length = std::min<short>(m_resonseContentType.size(), 1024);
+            m_resonseContentType.copy(out->contentType.str, out->contentType.length);
+        }
+
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+// Size of the buffer curl reads the request body into.
+// The default 64K buffer makes too many small reads for large files.
+constexpr long UPLOAD_BUFFER_SIZE = 1024 * 1024;
+
+struct FileUpload
+{
+    FileReader* reader = nullptr;
+    std::string error;
+};
+
+size_t read_file_data(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    auto upload = static_cast<FileUpload*>(userdata);
+    try {
+        // the file is read straight into the curl upload buffer
+        return upload->reader->read(ptr, size * nmemb);
+    }
+    catch (const std::exception& e) {
+        upload->error = e.what();
+        return CURL_READFUNC_ABORT;
+    }
+}
+
+int seek_file_data(void* userdata, curl_off_t offset, int origin)
+{
+    auto upload = static_cast<FileUpload*>(userdata);
+    if (origin != SEEK_SET)
+        return CURL_SEEKFUNC_CANTSEEK;
+    try {
+        upload->reader->seek(static_cast<uint64_t>(offset));
+    }
+    catch (const std::exception& e) {
+        upload->error = e.what();
+        return CURL_SEEKFUNC_FAIL;
+    }
+    return CURL_SEEKFUNC_OK;
+}
+
+/*
+  PROCEDURE HTTP_UPLOAD_FROM_FILE (
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191) NOT NULL,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    FILE_SIZE            BIGINT,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!uploadFromFile'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(uploadFromFile)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(32765, 0), fileName)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_BLOB, body)
+        (FB_BLOB, headers)
+        (FB_BIGINT, fileSize)
+        (FB_DOUBLE, totalTime)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->methodNull) {
+            throwException(status, "HTTP_METHOD can not be NULL.");
+        }
+        const std::string sHttpMethod(in->method.str, in->method.length);
+
+        const auto httpMethod = getHttpMethod(sHttpMethod);
+        if (httpMethod != HttpMethod::Post && httpMethod != HttpMethod::Put && httpMethod != HttpMethod::Patch) {
+            throwException(status, "HTTP method %s in not supported for file upload.", sHttpMethod.c_str());
+        }
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        const std::string url(in->url.str, in->url.length);
+
+        if (in->fileNameNull) {
+            throwException(status, "FILE_NAME can not be NULL.");
+        }
+        const std::string fileName(in->fileName.str, in->fileName.length);
+
+        std::unique_ptr<FileReader> reader;
+        try {
+            const std::string canonicalName = getFileAccessPolicy(context).checkAccess(fileName);
+            reader.reset(new FileReader(canonicalName));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+
+        AutoCurlCleanup<CURL> curl(createCurlHandle(status, context));
+
+        // buffer for storing text errors
+        char curlErrorBuffer[CURL_ERROR_SIZE];
+        memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+
+        // set url
+        getEndpoint(status, url).apply(curl);
+
+        // The size of the file is known in advance, so the request is sent
+        // with an exact Content-Length instead of chunked encoding.
+        const auto fileSize = static_cast<curl_off_t>(reader->getSize());
+        if (httpMethod == HttpMethod::Post) {
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, fileSize);
+        }
+        else {
+            curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+            curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, fileSize);
+            if (httpMethod == HttpMethod::Patch) {
+                curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
+            }
+        }
+
+        std::map<long, std::string> curlOptions;
+        if (!in->optionsNull) {
+            curlOptions = applyCurlOptions(status, curl, std::string(in->options.str, in->options.length));
+        }
+        const auto dnsLists = applyDnsSettings(status, context, curl, curlOptions);
+        // the transfer stops when the statement is cancelled or times out
+        TransferGuard guard(status, context);
+        guard.attach(curl, curlOptions);
+        // the response is counted in the memory limits
+        auto& memoryBudget = getMemoryBudget(status, context);
+        guard.checkMemory(status, memoryBudget);
+        // the transfer is recorded in the trace buffer
+        TransferTrace trace(getRequestTrace(status, context), curl);
+
+        // collecting headers
+        struct curl_slist* headers = nullptr;
+        // content-type
+        if (!in->contentTypeNull) {
+            std::string contentType(in->contentType.str, in->contentType.length);
+            contentType = std::string("Content-Type: ") + contentType;
+            headers = curl_slist_append(headers, contentType.c_str());
+        }
+        // other headers
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        // auto-delete headers
+        AutoCurlHeadersFree<curl_slist> autoHeaders(headers);
+        // set headers
+        if (headers) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        }
+
+        FileUpload upload;
+        upload.reader = reader.get();
+
+        // the request body is read from the file piece by piece
+        curl_easy_setopt(curl, CURLOPT_READDATA, &upload);
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_file_data);
+        curl_easy_setopt(curl, CURLOPT_SEEKDATA, &upload);
+        curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, seek_file_data);
+#if CURL_AT_LEAST_VERSION(7,62,0)
+        curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE, UPLOAD_BUFFER_SIZE);
+#endif
+
+        // function called by cURL to record received headers 
+        guard.watch(memoryBudget, curl, m_responseHeaders);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &m_responseHeaders);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ResponseBuffer::append_callback);
+        // function called by cURL to record the received data 
+        guard.watch(memoryBudget, curl, m_response);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &m_response);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ResponseBuffer::write_callback);
+
+        // execute a request
+        CURLcode curlResult = curl_easy_perform(curl);
+        trace.record(guard.getAttachmentId(), sHttpMethod, curl, curlResult, curlErrorBuffer);
+
+        if (curlResult != CURLE_OK) {
+            guard.check(status);
+            if (!upload.error.empty()) {
+                throwException(status, "%s", upload.error.c_str());
+            }
+            std::string curlErrorMessage(curlErrorBuffer);
+            if (curlErrorMessage.empty())
+                curlErrorMessage.assign(curl_easy_strerror(curlResult));
+
+            throwException(status, "%s", curlErrorMessage.c_str());
+        }
+
+        out->statusCodeNull = FB_FALSE;
+        long statusCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
+        out->statusCode = static_cast<ISC_SHORT>(statusCode);
+
+        char* contentType = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &contentType);
+        out->contentTypeNull = contentType ? FB_FALSE : FB_TRUE;
+        if (contentType) {
+            m_resonseContentType.assign(contentType);
+        }
+
+#if CURL_AT_LEAST_VERSION(7,50,0)
+        curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &m_http_version);
+#else
+        m_http_version = CURL_HTTP_VERSION_1_1;
+#endif
+
+        out->fileSizeNull = FB_FALSE;
+        out->fileSize = static_cast<ISC_INT64>(fileSize);
+        out->totalTimeNull = FB_FALSE;
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &out->totalTime);
+
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    bool m_needFetch = false;
+    ResponseBuffer m_response;
+    ResponseBuffer m_responseHeaders;
+    std::string m_resonseContentType{ "" };
+    long m_http_version = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        // response headers
+        const std::string& headers = m_responseHeaders.getData();
+        out->headersNull = headers.empty() ? FB_TRUE : FB_FALSE;
+        out->statusTextNull = FB_TRUE;
+        if (!out->headersNull) {
+            auto statusText = extractResponseStatusText(m_http_version, out->statusCode, headers);
+            out->statusTextNull = statusText.empty();
+            if (!out->statusTextNull) {
+                out->statusText.length = std::min<short>(statusText.size(), 1024);
+                statusText.copy(out->statusText.str, out->statusText.length);
+            }
+
+            writeBlob(status, m_att, m_tra, &out->headers, headers.data(), headers.length());
+        }
+
+        // response body
+        out->bodyNull = m_response.empty() ? FB_TRUE : FB_FALSE;
+        if (!out->bodyNull) {
+            writeBlob(status, m_att, m_tra, &out->body, m_response);
+        }
+        // contentType
+        if (!out->contentTypeNull) {
+            out->contentType.length = std::min<short>(m_resonseContentType.size(), 1024);
+            m_resonseContentType.copy(out->contentType.str, out->contentType.length);
+        }
+
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+// Default range size for downloads to a BLOB.
+constexpr uint64_t BLOB_RANGE_SIZE = 4 * 1024 * 1024;
+
+/*
+ * Writes the ranges to a BLOB. The BLOB can only be written sequentially,
+ * so the data of ranges received ahead of the current one is kept in memory.
+ * The amount of such data is limited by the download window.
+ */
+class BlobRangeTarget final : public RangeTarget
+{
+public:
+    BlobRangeTarget(Firebird::ThrowStatusWrapper* status, Firebird::IAttachment* att, Firebird::ITransaction* tra,
+        ISC_QUAD* blobId)
+        : m_status(status)
+        , m_att(att)
+        , m_tra(tra)
+        , m_blobId(blobId)
+    {
+    }
+
+    void write(size_t range, uint64_t, const void* data, size_t length) override
+    {
+        if (range == m_nextRange) {
+            putData(static_cast<const char*>(data), length);
+        }
+        else {
+            m_ranges[range].append(static_cast<const char*>(data), length);
+            m_memory.resize(m_memory.size() + length);
+        }
+    }
+
+    void rangeCompleted(size_t range) override
+    {
+        m_completed.insert(range);
+        while (m_completed.erase(m_nextRange) > 0) {
+            ++m_nextRange;
+            auto it = m_ranges.find(m_nextRange);
+            if (it != m_ranges.end()) {
+                putData(it->second.data(), it->second.size());
+                m_memory.resize(m_memory.size() - it->second.size());
+                m_ranges.erase(it);
+            }
+        }
+    }
+
+    // Counts the ranges waiting for their turn in the memory budget of the attachment.
+    void setBudget(MemoryBudget& budget, int64_t attachmentId)
+    {
+        m_memory = MemoryReservation(budget, attachmentId);
+    }
+
+    // Returns false if no data was written.
+    bool close()
+    {
+        if (!m_blob)
+            return false;
+        m_blob->close(m_status);
+        m_blob.release();
+        return true;
+    }
+
+private:
+    void putData(const char* data, size_t length)
+    {
+        if (!m_blob) {
+            const unsigned char bpb[] = {
+                isc_bpb_version1,
+                isc_bpb_type, 1, isc_bpb_type_stream,
+                isc_bpb_storage, 1, isc_bpb_storage_temp
+            };
+            m_blob.reset(m_att->createBlob(m_status, m_tra, m_blobId, sizeof(bpb), bpb));
+        }
+        size_t offset = 0;
+        while (offset < length) {
+            const auto len = std::min<size_t>(length - offset, MAX_SEGMENT_SIZE);
+            m_blob->putSegment(m_status, static_cast<unsigned int>(len), data + offset);
+            offset += len;
+        }
+    }
+
+    Firebird::ThrowStatusWrapper* m_status;
+    Firebird::IAttachment* m_att;
+    Firebird::ITransaction* m_tra;
+    ISC_QUAD* m_blobId;
+    Firebird::AutoRelease<Firebird::IBlob> m_blob{ nullptr };
+    std::map<size_t, std::string> m_ranges;
+    MemoryReservation m_memory;
+    std::set<size_t> m_completed;
+    size_t m_nextRange = 0;
+};
+
+/*
+  PROCEDURE HTTP_PARALLEL_DOWNLOAD (
+    URL                  VARCHAR(8191) NOT NULL,
+    FILE_NAME            VARCHAR(8191),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    CONNECTIONS          SMALLINT,
+    RANGE_SIZE           BIGINT,
+    MAX_RETRIES          SMALLINT,
+    OVERWRITE            BOOLEAN
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    CONTENT_LENGTH       BIGINT,
+    RANGE_COUNT          INTEGER,
+    RESUMED_SIZE         BIGINT,
+    RETRY_COUNT          INTEGER,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!parallelDownload'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(parallelDownload)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(32765, 0), fileName)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+        (FB_SMALLINT, connections)
+        (FB_BIGINT, rangeSize)
+        (FB_SMALLINT, maxRetries)
+        (FB_BOOLEAN, overwrite)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_BLOB, body)
+        (FB_BLOB, headers)
+        (FB_BIGINT, contentLength)
+        (FB_INTEGER, rangeCount)
+        (FB_BIGINT, resumedSize)
+        (FB_INTEGER, retryCount)
+        (FB_DOUBLE, totalTime)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        const auto startTime = std::chrono::steady_clock::now();
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        const std::string url(in->url.str, in->url.length);
+
+        RangeDownloadSettings settings;
+        const auto maxConnections = getUdrConfig(context).getInteger("MaxDownloadConnections", 16);
+        if (!in->connectionsNull) {
+            if (in->connections <= 0) {
+                throwException(status, "CONNECTIONS must be greater than 0.");
+            }
+            settings.connections = static_cast<unsigned int>(in->connections);
+        }
+        settings.connections = static_cast<unsigned int>(std::min<long long>(settings.connections, std::max(maxConnections, 1LL)));
+        if (!in->rangeSizeNull) {
+            if (in->rangeSize < static_cast<ISC_INT64>(MIN_RANGE_SIZE)) {
+                throwException(status, "RANGE_SIZE must be at least %u bytes.", static_cast<unsigned int>(MIN_RANGE_SIZE));
+            }
+            settings.rangeSize = static_cast<uint64_t>(in->rangeSize);
+        }
+        if (!in->maxRetriesNull) {
+            settings.maxRetries = static_cast<unsigned int>(std::max<ISC_SHORT>(in->maxRetries, 0));
+        }
+
+        std::unique_ptr<FileRangeTarget> fileTarget;
+        if (!in->fileNameNull) {
+            try {
+                const std::string fileName(in->fileName.str, in->fileName.length);
+                const std::string canonicalName = getFileAccessPolicy(context).checkAccess(fileName);
+                fileTarget.reset(new FileRangeTarget(canonicalName, !in->overwriteNull && in->overwrite));
+            }
+            catch (const std::runtime_error& e) {
+                throwException(status, "%s", e.what());
+            }
+        }
+        else {
+            // Ranges received out of order wait in memory until the BLOB reaches them,
+            // so both the number of such ranges and their size are limited.
+            settings.window = settings.connections * 2;
+            if (settings.rangeSize == 0)
+                settings.rangeSize = BLOB_RANGE_SIZE;
+        }
+        BlobRangeTarget blobTarget(status, m_att, m_tra, &out->body);
+        RangeTarget& target = fileTarget ? static_cast<RangeTarget&>(*fileTarget) : blobTarget;
+
+        std::map<long, std::string> curlOptions;
+        try {
+            if (!in->optionsNull) {
+                curlOptions = parseCurlOptions(std::string(in->options.str, in->options.length));
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+
+        curl_slist* headers = nullptr;
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        // auto-delete headers
+        AutoCurlHeadersFree<curl_slist> autoHeaders(headers);
+
+        const auto dnsLists = getDnsLists(status, context, curlOptions);
+        // the transfers stop when the statement is cancelled or times out
+        TransferGuard guard(status, context);
+        blobTarget.setBudget(getMemoryBudget(status, context), guard.getAttachmentId());
+
+        RangeDownloader downloader([&curlOptions, &dnsLists, &guard, headers](CURL* curl) {
+            setCurlOptions(curl, curlOptions);
+            if (dnsLists) {
+                dnsLists->apply(curl);
+            }
+            guard.attach(curl, curlOptions);
+            if (headers) {
+                curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+            }
+        }, settings);
+
+        ResourceInfo resource;
+        out->rangeCount = 1;
+        out->resumedSize = 0;
+        try {
+            resource = downloader.probe(url);
+            if (resource.isSuccess() && resource.acceptRanges && resource.size > 0) {
+                uint64_t rangeSize = downloader.getRangeSize(static_cast<uint64_t>(resource.size));
+                std::vector<bool> completed(static_cast<size_t>((resource.size + rangeSize - 1) / rangeSize), false);
+                if (fileTarget) {
+                    completed = fileTarget->start(resource, rangeSize);
+                    out->resumedSize = static_cast<ISC_INT64>(fileTarget->getResumedSize());
+                }
+                out->rangeCount = static_cast<ISC_LONG>(completed.size());
+                downloader.download(resource, rangeSize, completed, target);
+            }
+            else {
+                // the server can't send ranges, the resource is received with a single request
+                if (fileTarget) {
+                    fileTarget->restart();
+                }
+                resource = downloader.downloadWhole(url, target);
+            }
+
+            if (fileTarget) {
+                if (resource.isSuccess())
+                    fileTarget->commit();
+                else
+                    fileTarget->discard();
+            }
+        }
+        catch (const std::runtime_error& e) {
+            guard.check(status);
+            throwException(status, "%s", e.what());
+        }
+        catch (const std::invalid_argument& e) {
+            throwException(status, "%s", e.what());
+        }
+        catch (const std::out_of_range& e) {
+            throwException(status, "%s", e.what());
+        }
+        catch (const std::bad_alloc&) {
+            throwException(status, "Not enough memory to download the resource.");
+        }
+
+        out->bodyNull = blobTarget.close() ? FB_FALSE : FB_TRUE;
+
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = static_cast<ISC_SHORT>(resource.statusCode);
+        m_http_version = resource.httpVersion;
+        m_responseHeaders = resource.headers;
+        out->contentTypeNull = resource.contentType.empty() ? FB_TRUE : FB_FALSE;
+        m_resonseContentType = resource.contentType;
+        out->contentLengthNull = resource.size < 0 ? FB_TRUE : FB_FALSE;
+        out->contentLength = static_cast<ISC_INT64>(resource.size);
+        out->rangeCountNull = FB_FALSE;
+        out->resumedSizeNull = FB_FALSE;
+        out->retryCountNull = FB_FALSE;
+        out->retryCount = static_cast<ISC_LONG>(downloader.getRetryCount());
+        out->totalTimeNull = FB_FALSE;
+        out->totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    bool m_needFetch = false;
+    std::string m_responseHeaders{ "" };
+    std::string m_resonseContentType{ "" };
+    long m_http_version = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        // response headers
+        out->headersNull = m_responseHeaders.empty() ? FB_TRUE : FB_FALSE;
+        out->statusTextNull = FB_TRUE;
+        if (!out->headersNull) {
+            auto statusText = extractResponseStatusText(m_http_version, out->statusCode, m_responseHeaders);
+            out->statusTextNull = statusText.empty();
+            if (!out->statusTextNull) {
+                out->statusText.length = std::min<short>(statusText.size(), 1024);
+                statusText.copy(out->statusText.str, out->statusText.length);
+            }
+
+            writeBlob(status, m_att, m_tra, &out->headers, m_responseHeaders.data(), m_responseHeaders.length());
+        }
+        // contentType
+        if (!out->contentTypeNull) {
+            out->contentType.length = std::min<short>(m_resonseContentType.size(), 1024);
+            m_resonseContentType.copy(out->contentType.str, out->contentType.length);
+        }
+
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+// Maximum length of a value returned in a VARCHAR(8191) column.
+constexpr size_t MAX_VARCHAR_VALUE_LENGTH = 32765;
+
+struct JsonValue
+{
+    size_t pathIndex;
+    std::string location;
+    JsonType type;
+    std::string value;
+};
+
+struct JsonResponse
+{
+    JsonStreamParser* parser = nullptr;
+    std::ostringstream* body = nullptr;
+    std::string error;
+};
+
+size_t write_json_data(void* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    auto response = static_cast<JsonResponse*>(userdata);
+    const size_t length = size * nmemb;
+    if (response->body) {
+        response->body->write(static_cast<const char*>(ptr), length);
+    }
+    // after an error the rest of the response is not parsed, but still received
+    if (response->error.empty()) {
+        try {
+            response->parser->parse(static_cast<const char*>(ptr), length);
+        }
+        catch (const std::runtime_error& e) {
+            response->error = e.what();
+        }
+    }
+    return length;
+}
+
+/*
+  PROCEDURE HTTP_REQUEST_JSON (
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    PATHS                VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE BINARY,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    KEEP_BODY            BOOLEAN
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    JSON_PATH            VARCHAR(1024),
+    VALUE_PATH           VARCHAR(8191),
+    VALUE_TYPE           VARCHAR(10),
+    VALUE_TEXT           VARCHAR(8191),
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!requestJson'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(requestJson)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(32765, 0), paths)
+        (FB_BLOB, body)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+        (FB_BOOLEAN, keepBody)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(4096, 0), jsonPath)
+        (FB_INTL_VARCHAR(32765, 0), valuePath)
+        (FB_INTL_VARCHAR(40, 0), valueType)
+        (FB_INTL_VARCHAR(32765, 0), valueText)
+        (FB_BLOB, body)
+        (FB_BLOB, headers)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->methodNull) {
+            throwException(status, "HTTP_METHOD can not be NULL.");
+        }
+        const std::string sHttpMethod(in->method.str, in->method.length);
+
+        auto httpMethod = getHttpMethod(sHttpMethod);
+        if (httpMethod == HttpMethod::None) {
+            throwException(status, "Unsupported HTTP method %s.", sHttpMethod.c_str());
+        }
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        const std::string url(in->url.str, in->url.length);
+
+        if (in->pathsNull) {
+            throwException(status, "PATHS can not be NULL.");
+        }
+        // one path per line
+        try {
+            const std::string sPaths(in->paths.str, in->paths.length);
+            std::istringstream pathStream(sPaths);
+            std::string path;
+            while (std::getline(pathStream, path)) {
+                trim(path);
+                if (!path.empty()) {
+                    m_paths.emplace_back(path);
+                }
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+
+        AutoCurlCleanup<CURL> curl(createCurlHandle(status, context));
+
+        // buffer for storing text errors
+        char curlErrorBuffer[CURL_ERROR_SIZE];
+        memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+
+        // set url
+        getEndpoint(status, url).apply(curl);
+
+        // set Http method
+        setHttpMethod(status, curl, httpMethod, sHttpMethod);
+
+        std::map<long, std::string> curlOptions;
+        if (!in->optionsNull) {
+            curlOptions = applyCurlOptions(status, curl, std::string(in->options.str, in->options.length));
+        }
+        const auto dnsLists = applyDnsSettings(status, context, curl, curlOptions);
+        // the transfer stops when the statement is cancelled or times out
+        TransferGuard guard(status, context);
+        guard.attach(curl, curlOptions);
+        // the transfer is recorded in the trace buffer
+        TransferTrace trace(getRequestTrace(status, context), curl);
+
+        // collecting headers
+        struct curl_slist* headers = nullptr;
+        // content-type
+        if (!in->contentTypeNull) {
+            std::string contentType(in->contentType.str, in->contentType.length);
+            contentType = std::string("Content-Type: ") + contentType;
+            headers = curl_slist_append(headers, contentType.c_str());
+        }
+        // other headers
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        // auto-delete headers
+        AutoCurlHeadersFree<curl_slist> autoHeaders(headers);
+        // set headers
+        if (headers) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        }
+
+        std::stringstream requestBody{};
+        if (!in->bodyNull) {
+            readBlob(status, m_att, m_tra, &in->body, requestBody);
+            // set beginning of stream
+            requestBody.seekg(0, std::ios::beg);
+
+            curl_easy_setopt(curl, CURLOPT_READDATA, &requestBody);
+            curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
+        }
+
+        // The response is parsed as it arrives, only the values of the paths are kept.
+        JsonStreamParser parser(m_paths, [this](size_t pathIndex, const std::string& location, JsonType type, std::string& value) {
+            if (value.size() > MAX_VARCHAR_VALUE_LENGTH || location.size() > MAX_VARCHAR_VALUE_LENGTH) {
+                throw std::runtime_error("The value of " + location + " is too long.");
+            }
+            m_values.push_back({ pathIndex, location, type, std::move(value) });
+        });
+        JsonResponse response;
+        response.parser = &parser;
+        if (!in->keepBodyNull && in->keepBody) {
+            response.body = &m_response;
+        }
+
+        // function called by cURL to record received headers 
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &m_responseHeaders);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_data);
+        // function called by cURL to parse the received data
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_json_data);
+
+        // execute a request
+        CURLcode curlResult = curl_easy_perform(curl);
+        trace.record(guard.getAttachmentId(), sHttpMethod, curl, curlResult, curlErrorBuffer);
+
+        if (curlResult != CURLE_OK) {
+            guard.check(status);
+            std::string curlErrorMessage(curlErrorBuffer);
+            if (curlErrorMessage.empty())
+                curlErrorMessage.assign(curl_easy_strerror(curlResult));
+
+            throwException(status, "%s", curlErrorMessage.c_str());
+        }
+
+        long statusCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &statusCode);
+        m_statusCode = static_cast<ISC_SHORT>(statusCode);
+
+        if (response.error.empty()) {
+            try {
+                parser.finish();
+            }
+            catch (const std::runtime_error& e) {
+                response.error = e.what();
+            }
+        }
+        // An error response does not have to be JSON, then there is nothing to extract from it.
+        if (!response.error.empty() && statusCode >= 200 && statusCode < 300) {
+            throwException(status, "%s", response.error.c_str());
+        }
+
+        char* contentType = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &contentType);
+        m_contentTypeNull = !contentType;
+        if (contentType) {
+            m_resonseContentType.assign(contentType);
+        }
+
+#if CURL_AT_LEAST_VERSION(7,50,0)
+        curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &m_http_version);
+#else
+        m_http_version = CURL_HTTP_VERSION_1_1;
+#endif
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    std::vector<JsonPath> m_paths;
+    std::vector<JsonValue> m_values;
+    size_t m_valueIndex = 0;
+    bool m_needFetch = false;
+    ISC_SHORT m_statusCode = 0;
+    bool m_contentTypeNull = true;
+    std::ostringstream m_response{};
+    std::ostringstream m_responseHeaders{};
+    std::string m_resonseContentType{ "" };
+    long m_http_version = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        const bool firstRow = (m_valueIndex == 0);
+
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = m_statusCode;
+        // contentType
+        out->contentTypeNull = m_contentTypeNull ? FB_TRUE : FB_FALSE;
+        if (!out->contentTypeNull) {
+            out->contentType.length = std::min<short>(m_resonseContentType.size(), 1024);
+            m_resonseContentType.copy(out->contentType.str, out->contentType.length);
+        }
+
+        // response headers and body are returned only in the first row
+        out->headersNull = FB_TRUE;
+        out->bodyNull = FB_TRUE;
+        out->statusTextNull = FB_TRUE;
+        const std::string headers = m_responseHeaders.str();
+        if (!headers.empty()) {
+            auto statusText = extractResponseStatusText(m_http_version, out->statusCode, headers);
+            out->statusTextNull = statusText.empty();
+            if (!out->statusTextNull) {
+                out->statusText.length = std::min<short>(statusText.size(), 1024);
+                statusText.copy(out->statusText.str, out->statusText.length);
+            }
+            if (firstRow) {
+                out->headersNull = FB_FALSE;
+                writeBlob(status, m_att, m_tra, &out->headers, headers.data(), headers.length());
+            }
+        }
+        if (firstRow) {
+            const std::string response = m_response.str();
+            out->bodyNull = response.empty() ? FB_TRUE : FB_FALSE;
+            if (!out->bodyNull) {
+                writeBlob(status, m_att, m_tra, &out->body, response.data(), response.length());
+            }
+        }
+
+        // If nothing matched, a single row with the response status is returned.
+        out->jsonPathNull = FB_TRUE;
+        out->valuePathNull = FB_TRUE;
+        out->valueTypeNull = FB_TRUE;
+        out->valueTextNull = FB_TRUE;
+        if (m_valueIndex < m_values.size()) {
+            const JsonValue& value = m_values[m_valueIndex];
+            const std::string& jsonPath = m_paths[value.pathIndex].getText();
+            out->jsonPathNull = FB_FALSE;
+            out->jsonPath.length = static_cast<unsigned short>(std::min<size_t>(jsonPath.size(), 4096));
+            jsonPath.copy(out->jsonPath.str, out->jsonPath.length);
+            out->valuePathNull = FB_FALSE;
+            out->valuePath.length = static_cast<unsigned short>(value.location.size());
+            value.location.copy(out->valuePath.str, out->valuePath.length);
+            const std::string valueType(getJsonTypeName(value.type));
+            out->valueTypeNull = FB_FALSE;
+            out->valueType.length = static_cast<unsigned short>(valueType.size());
+            valueType.copy(out->valueType.str, out->valueType.length);
+            // JSON null is returned as SQL NULL
+            if (value.type != JsonType::Null) {
+                out->valueTextNull = FB_FALSE;
+                out->valueText.length = static_cast<unsigned short>(value.value.size());
+                value.value.copy(out->valueText.str, out->valueText.length);
+            }
+        }
+
+        ++m_valueIndex;
+        m_needFetch = m_valueIndex < m_values.size();
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+/*
+  PROCEDURE HTTP_STREAM_LINES (
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE BINARY,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    DELIMITER            VARCHAR(10)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    LINE_NUMBER          BIGINT,
+    LINE                 VARCHAR(8191),
+    LINE_BLOB            BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!streamLines'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(streamLines)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_BLOB, body)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+        (FB_INTL_VARCHAR(40, 0), delimiter)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_BIGINT, lineNumber)
+        (FB_INTL_VARCHAR(32765, 0), line)
+        (FB_BLOB, lineBlob)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->methodNull) {
+            throwException(status, "HTTP_METHOD can not be NULL.");
+        }
+        const std::string sHttpMethod(in->method.str, in->method.length);
+
+        auto httpMethod = getHttpMethod(sHttpMethod);
+        if (httpMethod == HttpMethod::None) {
+            throwException(status, "Unsupported HTTP method %s.", sHttpMethod.c_str());
+        }
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        const std::string url(in->url.str, in->url.length);
+
+        if (!in->delimiterNull) {
+            m_delimiter.assign(in->delimiter.str, in->delimiter.length);
+            if (m_delimiter.empty()) {
+                throwException(status, "DELIMITER can not be empty.");
+            }
+        }
+        // with the default delimiter CRLF line endings are accepted too
+        m_stripCR = (m_delimiter == "\n");
+
+        AutoCurlCleanup<CURL> curl(createCurlHandle(status, context));
+
+        // set url
+        getEndpoint(status, url).apply(curl);
+
+        // set Http method
+        setHttpMethod(status, curl, httpMethod, sHttpMethod);
+
+        std::map<long, std::string> curlOptions;
+        if (!in->optionsNull) {
+            curlOptions = applyCurlOptions(status, curl, std::string(in->options.str, in->options.length));
+        }
+        m_dnsLists = applyDnsSettings(status, context, curl, curlOptions);
+
+        // collecting headers
+        struct curl_slist* headers = nullptr;
+        // content-type
+        if (!in->contentTypeNull) {
+            std::string contentType(in->contentType.str, in->contentType.length);
+            contentType = std::string("Content-Type: ") + contentType;
+            headers = curl_slist_append(headers, contentType.c_str());
+        }
+        // other headers
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        // headers are needed until the end of the transfer
+        m_headers.reset(headers);
+        // set headers
+        if (headers) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        }
+
+        if (!in->bodyNull) {
+            readBlob(status, m_att, m_tra, &in->body, m_requestBody);
+            // set beginning of stream
+            m_requestBody.seekg(0, std::ios::beg);
+
+            curl_easy_setopt(curl, CURLOPT_READDATA, &m_requestBody);
+            curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
+        }
+
+        // the transfer stops when the statement is cancelled or times out
+        m_guard.reset(new TransferGuard(status, context));
+        m_guard->attach(curl, curlOptions);
+
+        // The transfer is advanced only from fetch, so a slow consumer slows down the server.
+        try {
+            m_transfer.reset(new StreamingTransfer(curl.release()));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        m_transfer->setBudget(getMemoryBudget(status, context), m_guard->getAttachmentId());
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    AutoCurlHeadersFree<curl_slist> m_headers{ nullptr };
+    std::shared_ptr<const DnsLists> m_dnsLists;
+    std::stringstream m_requestBody{};
+    std::unique_ptr<TransferGuard> m_guard;
+    std::unique_ptr<StreamingTransfer> m_transfer;
+    std::string m_delimiter{ "\n" };
+    bool m_stripCR = false;
+    std::string m_line;
+    ISC_INT64 m_lineNumber = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        StreamingTransfer::ReadResult result;
+        try {
+            result = m_transfer->readRecord(m_delimiter, m_line);
+        }
+        catch (const std::runtime_error& e) {
+            m_guard->check(status);
+            throwException(status, "%s", e.what());
+        }
+        if (result == StreamingTransfer::ReadResult::TooLong) {
+            throwException(status, "Line %lld is longer than %u bytes.", static_cast<long long>(m_lineNumber + 1),
+                static_cast<unsigned int>(m_transfer->getBufferLimit()));
+        }
+        if (result != StreamingTransfer::ReadResult::Record) {
+            return false;
+        }
+        if (m_stripCR && !m_line.empty() && m_line.back() == '\r') {
+            m_line.pop_back();
+        }
+
+        long statusCode = 0;
+        curl_easy_getinfo(m_transfer->getHandle(), CURLINFO_RESPONSE_CODE, &statusCode);
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = static_cast<ISC_SHORT>(statusCode);
+
+        out->lineNumberNull = FB_FALSE;
+        out->lineNumber = ++m_lineNumber;
+
+        // a line that does not fit into VARCHAR is returned as BLOB
+        out->lineNull = FB_TRUE;
+        out->lineBlobNull = FB_TRUE;
+        if (m_line.size() <= MAX_VARCHAR_VALUE_LENGTH) {
+            out->lineNull = FB_FALSE;
+            out->line.length = static_cast<unsigned short>(m_line.size());
+            m_line.copy(out->line.str, out->line.length);
+        }
+        else {
+            out->lineBlobNull = FB_FALSE;
+            writeBlob(status, m_att, m_tra, &out->lineBlob, m_line.data(), m_line.length());
+        }
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+// Reconnection time of an event stream if the server does not send the retry field.
+constexpr unsigned int SSE_DEFAULT_RETRY_MS = 3000;
+// Longest reconnection time accepted from the retry field.
+constexpr unsigned int SSE_MAX_RETRY_MS = 60000;
+// How many times in a row a lost event stream is reconnected by default.
+constexpr unsigned int SSE_DEFAULT_MAX_RECONNECTS = 3;
+
+struct SseEvent
+{
+    std::string type;
+    std::string data;
+};
+
+/*
+  PROCEDURE HTTP_SSE_SUBSCRIBE (
+    URL                  VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    LAST_EVENT_ID        VARCHAR(1024),
+    MAX_EVENTS           INTEGER,
+    IDLE_TIMEOUT         INTEGER,
+    MAX_DURATION         INTEGER,
+    MAX_RECONNECTS       SMALLINT
+  )
+  RETURNS (
+    EVENT_NUMBER         BIGINT,
+    EVENT_ID             VARCHAR(1024),
+    EVENT_TYPE           VARCHAR(256),
+    EVENT_DATA           VARCHAR(8191),
+    EVENT_DATA_BLOB      BLOB SUB_TYPE TEXT,
+    RECONNECT_COUNT      INTEGER
+  )
+  EXTERNAL NAME 'http_client_udr!sseSubscribe'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(sseSubscribe)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+        (FB_INTL_VARCHAR(4096, 0), lastEventId)
+        (FB_INTEGER, maxEvents)
+        (FB_INTEGER, idleTimeout)
+        (FB_INTEGER, maxDuration)
+        (FB_SMALLINT, maxReconnects)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_BIGINT, eventNumber)
+        (FB_INTL_VARCHAR(4096, 0), eventId)
+        (FB_INTL_VARCHAR(1024, 0), eventType)
+        (FB_INTL_VARCHAR(32765, 0), eventData)
+        (FB_BLOB, eventDataBlob)
+        (FB_INTEGER, reconnectCount)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        m_url.assign(in->url.str, in->url.length);
+
+        if (!in->headersNull) {
+            m_headers.assign(in->headers.str, in->headers.length);
+        }
+        if (!in->optionsNull) {
+            m_options.assign(in->options.str, in->options.length);
+        }
+        if (!in->lastEventIdNull) {
+            m_lastEventId.assign(in->lastEventId.str, in->lastEventId.length);
+        }
+        if (!in->maxEventsNull) {
+            if (in->maxEvents <= 0) {
+                throwException(status, "MAX_EVENTS must be greater than 0.");
+            }
+            m_maxEvents = in->maxEvents;
+        }
+        if (!in->idleTimeoutNull) {
+            if (in->idleTimeout <= 0) {
+                throwException(status, "IDLE_TIMEOUT must be greater than 0.");
+            }
+            m_idleTimeout = std::chrono::seconds(in->idleTimeout);
+        }
+        if (!in->maxDurationNull) {
+            if (in->maxDuration <= 0) {
+                throwException(status, "MAX_DURATION must be greater than 0.");
+            }
+            m_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(in->maxDuration);
+        }
+        if (!in->maxReconnectsNull) {
+            m_maxReconnects = static_cast<unsigned int>(std::max<ISC_SHORT>(in->maxReconnects, 0));
+        }
+
+        // the DNS lists are shared by all connections of the subscription
+        std::map<long, std::string> curlOptions;
+        try {
+            if (!m_options.empty()) {
+                curlOptions = parseCurlOptions(m_options);
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        m_dnsLists = getDnsLists(status, context, curlOptions);
+        // the subscription stops when the statement is cancelled or times out
+        m_guard.reset(new TransferGuard(status, context));
+        m_budget = &getMemoryBudget(status, context);
+
+        connect(status);
+        m_lastEventTime = std::chrono::steady_clock::now();
+    }
+
+    void connect(Firebird::ThrowStatusWrapper* const status)
+    {
+        AutoCurlCleanup<CURL> curl(Runtime::instance().createHandle());
+
+        if (!curl) {
+            throwException(status, "Can't initialize CURL.");
+        }
+
+        // set url
+        getEndpoint(status, m_url).apply(curl);
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+
+        std::map<long, std::string> curlOptions;
+        if (!m_options.empty()) {
+            curlOptions = applyCurlOptions(status, curl, m_options);
+        }
+        if (m_dnsLists) {
+            m_dnsLists->apply(curl);
+        }
+        m_guard->attach(curl, curlOptions);
+
+        // collecting headers
+        struct curl_slist* headers = nullptr;
+        headers = curl_slist_append(headers, "Accept: text/event-stream");
+        headers = curl_slist_append(headers, "Cache-Control: no-cache");
+        // the server resumes the stream after the last received event
+        if (!m_lastEventId.empty()) {
+            const std::string lastEventId = "Last-Event-ID: " + m_lastEventId;
+            headers = curl_slist_append(headers, lastEventId.c_str());
+        }
+        // other headers
+        if (!m_headers.empty()) {
+            headers = appendHeaders(headers, m_headers);
+        }
+        m_transfer.reset();
+        m_requestHeaders.reset(headers);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+        try {
+            m_transfer.reset(new StreamingTransfer(curl.release()));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        m_transfer->setBudget(*m_budget, m_guard->getAttachmentId());
+        m_established = false;
+        m_firstLine = true;
+        m_event = SseEvent();
+    }
+
+    // Returns false if the stream was closed by the server and must not be reconnected.
+    bool checkResponse(Firebird::ThrowStatusWrapper* const status)
+    {
+        long statusCode = 0;
+        curl_easy_getinfo(m_transfer->getHandle(), CURLINFO_RESPONSE_CODE, &statusCode);
+        // 204 No Content means that the client must stop reconnecting
+        if (statusCode == 204) {
+            return false;
+        }
+        if (statusCode != 200) {
+            throwException(status, "Event stream request failed with HTTP status %ld.", statusCode);
+        }
+        m_established = true;
+        return true;
+    }
+
+    // Processes one line of the stream, returns true if an event is complete.
+    bool processLine(std::string& line)
+    {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (m_firstLine) {
+            m_firstLine = false;
+            if (line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+                line.erase(0, 3);
+            }
+        }
+        if (line.empty()) {
+            // an empty line dispatches the event, but an event without data is ignored
+            if (m_event.data.empty()) {
+                m_event.type.clear();
+                return false;
+            }
+            m_event.data.pop_back();
+            return true;
+        }
+        // comment, usually a keep-alive
+        if (line[0] == ':') {
+            return false;
+        }
+        const auto colonPos = line.find(':');
+        const std::string field = line.substr(0, colonPos);
+        size_t valuePos = line.size();
+        if (colonPos != std::string::npos) {
+            valuePos = colonPos + 1;
+            if (valuePos < line.size() && line[valuePos] == ' ') {
+                ++valuePos;
+            }
+        }
+        if (field == "data") {
+            m_event.data.append(line, valuePos, std::string::npos);
+            m_event.data.push_back('\n');
+        }
+        else if (field == "event") {
+            m_event.type.assign(line, valuePos, std::string::npos);
+        }
+        else if (field == "id") {
+            if (line.find('\0', valuePos) == std::string::npos) {
+                m_lastEventId.assign(line, valuePos, std::string::npos);
+            }
+        }
+        else if (field == "retry") {
+            const std::string value = line.substr(valuePos);
+            if (!value.empty() && value.size() < 10 &&
+                std::all_of(value.begin(), value.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            {
+                m_retry = std::chrono::milliseconds(std::min<unsigned long>(std::stoul(value), SSE_MAX_RETRY_MS));
+            }
+        }
+        // other fields are ignored
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point getDeadline() const
+    {
+        if (m_idleTimeout.count() > 0) {
+            return std::min(m_deadline, m_lastEventTime + m_idleTimeout);
+        }
+        return m_deadline;
+    }
+
+    // Waits for the next event, returns false if the subscription is over.
+    bool readEvent(Firebird::ThrowStatusWrapper* const status)
+    {
+        std::string line;
+        while (true) {
+            if (!m_transfer) {
+                if (m_reconnectAttempts >= m_maxReconnects) {
+                    if (!m_transferError.empty()) {
+                        throwException(status, "%s", m_transferError.c_str());
+                    }
+                    return false;
+                }
+                const auto reconnectTime = std::chrono::steady_clock::now() + m_retry;
+                if (reconnectTime >= getDeadline()) {
+                    return false;
+                }
+                // a cancelled statement is not reconnected, also while waiting for the reconnection
+                while (true) {
+                    if (m_guard->isCancelled()) {
+                        m_guard->check(status);
+                    }
+                    const auto now = std::chrono::steady_clock::now();
+                    if (now >= reconnectTime) {
+                        break;
+                    }
+                    std::this_thread::sleep_until(std::min(reconnectTime, now + CANCEL_CHECK_INTERVAL));
+                }
+                ++m_reconnectAttempts;
+                ++m_reconnectCount;
+                connect(status);
+            }
+
+            StreamingTransfer::ReadResult result;
+            try {
+                result = m_transfer->readRecord("\n", line, getDeadline());
+            }
+            catch (const std::runtime_error& e) {
+                m_guard->check(status);
+                // a server that could not be reached at all is not reconnected
+                if (!m_established && m_reconnectCount == 0) {
+                    throwException(status, "%s", e.what());
+                }
+                // the lost connection is reestablished
+                m_transferError = e.what();
+                m_transfer.reset();
+                continue;
+            }
+            if (result == StreamingTransfer::ReadResult::Timeout) {
+                return false;
+            }
+            if (!m_established && !checkResponse(status)) {
+                return false;
+            }
+            if (result == StreamingTransfer::ReadResult::TooLong) {
+                throwException(status, "Event line is longer than %u bytes.",
+                    static_cast<unsigned int>(m_transfer->getBufferLimit()));
+            }
+            if (result == StreamingTransfer::ReadResult::End) {
+                // the server closed the stream, an incomplete event is discarded
+                m_transferError.clear();
+                m_transfer.reset();
+                continue;
+            }
+            if (processLine(line)) {
+                m_reconnectAttempts = 0;
+                m_lastEventTime = std::chrono::steady_clock::now();
+                return true;
+            }
+        }
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    std::string m_url;
+    std::string m_headers;
+    std::string m_options;
+    std::shared_ptr<const DnsLists> m_dnsLists;
+    std::string m_lastEventId;
+    ISC_LONG m_maxEvents = 0;
+    std::chrono::seconds m_idleTimeout{ 0 };
+    std::chrono::steady_clock::time_point m_deadline = std::chrono::steady_clock::time_point::max();
+    unsigned int m_maxReconnects = SSE_DEFAULT_MAX_RECONNECTS;
+    std::chrono::milliseconds m_retry{ SSE_DEFAULT_RETRY_MS };
+
+    std::unique_ptr<TransferGuard> m_guard;
+    MemoryBudget* m_budget = nullptr;
+    AutoCurlHeadersFree<curl_slist> m_requestHeaders{ nullptr };
+    std::unique_ptr<StreamingTransfer> m_transfer;
+    bool m_established = false;
+    bool m_firstLine = true;
+    std::string m_transferError;
+    unsigned int m_reconnectAttempts = 0;
+    ISC_LONG m_reconnectCount = 0;
+    std::chrono::steady_clock::time_point m_lastEventTime;
+    SseEvent m_event;
+    ISC_INT64 m_eventNumber = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (m_maxEvents > 0 && m_eventNumber >= m_maxEvents) {
+            return false;
+        }
+        if (!readEvent(status)) {
+            return false;
+        }
+
+        out->eventNumberNull = FB_FALSE;
+        out->eventNumber = ++m_eventNumber;
+
+        out->eventIdNull = m_lastEventId.empty() ? FB_TRUE : FB_FALSE;
+        if (!out->eventIdNull) {
+            out->eventId.length = static_cast<unsigned short>(std::min<size_t>(m_lastEventId.size(), 4096));
+            m_lastEventId.copy(out->eventId.str, out->eventId.length);
+        }
+
+        // the default event type is message
+        const std::string eventType = m_event.type.empty() ? std::string("message") : m_event.type;
+        out->eventTypeNull = FB_FALSE;
+        out->eventType.length = static_cast<unsigned short>(std::min<size_t>(eventType.size(), 1024));
+        eventType.copy(out->eventType.str, out->eventType.length);
+
+        // data that does not fit into VARCHAR is returned as BLOB
+        out->eventDataNull = FB_TRUE;
+        out->eventDataBlobNull = FB_TRUE;
+        if (m_event.data.size() <= MAX_VARCHAR_VALUE_LENGTH) {
+            out->eventDataNull = FB_FALSE;
+            out->eventData.length = static_cast<unsigned short>(m_event.data.size());
+            m_event.data.copy(out->eventData.str, out->eventData.length);
+        }
+        else {
+            out->eventDataBlobNull = FB_FALSE;
+            writeBlob(status, m_att, m_tra, &out->eventDataBlob, m_event.data.data(), m_event.data.length());
+        }
+
+        out->reconnectCountNull = FB_FALSE;
+        out->reconnectCount = m_reconnectCount;
+
+        m_event = SseEvent();
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+/*
+  PROCEDURE HTTP_PAGINATE (
+    URL                  VARCHAR(8191) NOT NULL,
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    PAGINATION           VARCHAR(10),
+    PAGE_PARAMETER       VARCHAR(256),
+    CURSOR_PATH          VARCHAR(1024),
+    ITEMS_PATH           VARCHAR(1024),
+    PAGE_SIZE            INTEGER,
+    MAX_PAGES            INTEGER
+  )
+  RETURNS (
+    PAGE_NUMBER          INTEGER,
+    PAGE_URL             VARCHAR(8191),
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT,
+    ITEM_COUNT           INTEGER,
+    TOTAL_TIME           DOUBLE PRECISION
+  )
+  EXTERNAL NAME 'http_client_udr!paginate'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(paginate)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+        (FB_INTL_VARCHAR(40, 0), pagination)
+        (FB_INTL_VARCHAR(1024, 0), pageParameter)
+        (FB_INTL_VARCHAR(4096, 0), cursorPath)
+        (FB_INTL_VARCHAR(4096, 0), itemsPath)
+        (FB_INTEGER, pageSize)
+        (FB_INTEGER, maxPages)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_INTEGER, pageNumber)
+        (FB_INTL_VARCHAR(32765, 0), pageUrl)
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_BLOB, body)
+        (FB_BLOB, headers)
+        (FB_INTEGER, itemCount)
+        (FB_DOUBLE, totalTime)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        const std::string url(in->url.str, in->url.length);
+
+        PaginationSettings settings;
+        if (!in->pageSizeNull) {
+            if (in->pageSize <= 0) {
+                throwException(status, "PAGE_SIZE must be greater than 0.");
+            }
+            settings.pageSize = static_cast<uint64_t>(in->pageSize);
+        }
+        if (!in->maxPagesNull) {
+            if (in->maxPages <= 0) {
+                throwException(status, "MAX_PAGES must be greater than 0.");
+            }
+            settings.maxPages = static_cast<uint64_t>(in->maxPages);
+        }
+        if (!in->pageParameterNull) {
+            settings.parameter.assign(in->pageParameter.str, in->pageParameter.length);
+        }
+        if (!in->cursorPathNull) {
+            settings.cursorPath.assign(in->cursorPath.str, in->cursorPath.length);
+        }
+        if (!in->itemsPathNull) {
+            settings.itemsPath.assign(in->itemsPath.str, in->itemsPath.length);
+        }
+
+        try {
+            if (!in->paginationNull) {
+                settings.mode = getPaginationMode(std::string(in->pagination.str, in->pagination.length));
+            }
+            if (!in->optionsNull) {
+                m_curlOptions = parseCurlOptions(std::string(in->options.str, in->options.length));
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+
+        if (!in->headersNull) {
+            m_headers.reset(appendHeaders(nullptr, std::string(in->headers.str, in->headers.length)));
+        }
+
+        m_dnsLists = getDnsLists(status, context, m_curlOptions);
+        // The attachment can't be pinged from the background thread, so the requests get only
+        // the rest of the statement timeout. Cancellation is checked before each page.
+        m_guard.reset(new TransferGuard(status, context));
+
+        // Pages are requested in a background thread, which uses only the options and headers prepared here.
+        curl_slist* headers = m_headers;
+        try {
+            m_paginator.reset(new Paginator(url, [this, headers](CURL* curl) {
+                setCurlOptions(curl, m_curlOptions);
+                if (m_dnsLists) {
+                    m_dnsLists->apply(curl);
+                }
+                if (headers) {
+                    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+                }
+                m_guard->limitTimeout(curl, m_curlOptions);
+            }, settings, getMemoryBudget(status, context), m_guard->getAttachmentId()));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    std::map<long, std::string> m_curlOptions;
+    std::shared_ptr<const DnsLists> m_dnsLists;
+    AutoCurlHeadersFree<curl_slist> m_headers{ nullptr };
+    std::unique_ptr<TransferGuard> m_guard;
+    // declared last, so the background request is finished before the options and headers are freed
+    std::unique_ptr<Paginator> m_paginator;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (m_guard->isCancelled()) {
+            m_guard->check(status);
+        }
+        PageInfo page;
+        try {
+            if (!m_paginator->next(page)) {
+                return false;
+            }
+        }
+        catch (const std::exception& e) {
+            m_guard->check(status);
+            throwException(status, "%s", e.what());
+        }
+
+        out->pageNumberNull = FB_FALSE;
+        out->pageNumber = static_cast<ISC_LONG>(page.number);
+
+        out->pageUrlNull = FB_FALSE;
+        out->pageUrl.length = static_cast<unsigned short>(std::min<size_t>(page.url.size(), 32765));
+        page.url.copy(out->pageUrl.str, out->pageUrl.length);
+
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = static_cast<ISC_SHORT>(page.statusCode);
+
+        out->contentTypeNull = page.contentType.empty() ? FB_TRUE : FB_FALSE;
+        if (!out->contentTypeNull) {
+            out->contentType.length = static_cast<unsigned short>(std::min<size_t>(page.contentType.size(), 1024));
+            page.contentType.copy(out->contentType.str, out->contentType.length);
+        }
+
+        out->statusTextNull = FB_TRUE;
+        out->headersNull = page.headers.empty() ? FB_TRUE : FB_FALSE;
+        if (!out->headersNull) {
+            auto statusText = extractResponseStatusText(page.httpVersion, out->statusCode, page.headers);
+            out->statusTextNull = statusText.empty();
+            if (!out->statusTextNull) {
+                out->statusText.length = std::min<short>(statusText.size(), 1024);
+                statusText.copy(out->statusText.str, out->statusText.length);
+            }
+            writeBlob(status, m_att, m_tra, &out->headers, page.headers.data(), page.headers.length());
+        }
+
+        out->bodyNull = page.body.empty() ? FB_TRUE : FB_FALSE;
+        if (!out->bodyNull) {
+            writeBlob(status, m_att, m_tra, &out->body, page.body.data(), page.body.length());
+        }
+
+        out->itemCountNull = page.itemCount < 0 ? FB_TRUE : FB_FALSE;
+        out->itemCount = static_cast<ISC_LONG>(std::max<int64_t>(page.itemCount, 0));
+
+        out->totalTimeNull = FB_FALSE;
+        out->totalTime = page.totalTime;
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+// Key of a template or a bulk sink in its registry, objects of different databases do not conflict.
+std::string getRegistryKey(Firebird::IExternalContext* context, const std::string& name)
+{
+    std::string key(context->getDatabaseName());
+    key.push_back('\n');
+    key += name;
+    return key;
+}
+
+/*
+  PROCEDURE HTTP_TEMPLATE_REGISTER (
+    NAME                 VARCHAR(63) NOT NULL,
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE TEXT,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    PARAMETER_NAMES      VARCHAR(8191)
+  )
+  EXTERNAL NAME 'http_client_udr!registerTemplate'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(registerTemplate)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(252, 0), name)
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_BLOB, body)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_INTL_VARCHAR(32765, 0), parameterNames)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        if (in->nameNull) {
+            throwException(status, "NAME can not be NULL.");
+        }
+        std::string name(in->name.str, in->name.length);
+        trim(name);
+        if (name.empty()) {
+            throwException(status, "NAME can not be empty.");
+        }
+
+        if (in->methodNull) {
+            throwException(status, "HTTP_METHOD can not be NULL.");
+        }
+        const std::string sHttpMethod(in->method.str, in->method.length);
+        const auto httpMethod = getHttpMethod(sHttpMethod);
+        if (httpMethod == HttpMethod::None) {
+            throwException(status, "Unsupported HTTP method %s.", sHttpMethod.c_str());
+        }
+        // the body is sent as POSTFIELDS, which would turn these methods into POST
+        if (!in->bodyNull && (httpMethod == HttpMethod::Get || httpMethod == HttpMethod::Head)) {
+            throwException(status, "Request body is not supported for HTTP method %s.", sHttpMethod.c_str());
+        }
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+
+        std::shared_ptr<RequestTemplate> requestTemplate(new RequestTemplate());
+        requestTemplate->method = sHttpMethod;
+
+        std::string contentType;
+        if (!in->contentTypeNull) {
+            contentType.assign(in->contentType.str, in->contentType.length);
+        }
+
+        try {
+            requestTemplate->url = TemplateText(std::string(in->url.str, in->url.length), TemplateEscaping::Url);
+            if (!in->bodyNull) {
+                Firebird::AutoRelease<Firebird::IAttachment> att(context->getAttachment(status));
+                Firebird::AutoRelease<Firebird::ITransaction> tra(context->getTransaction(status));
+                std::ostringstream body;
+                readBlob(status, att, tra, &in->body, body);
+                requestTemplate->body = TemplateText(body.str(), getBodyEscaping(contentType));
+                requestTemplate->hasBody = true;
+            }
+            if (!in->optionsNull) {
+                requestTemplate->curlOptions = parseCurlOptions(std::string(in->options.str, in->options.length));
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+
+        // the header list is built once and shared by all calls of the template
+        struct curl_slist* headers = nullptr;
+        if (!contentType.empty()) {
+            headers = curl_slist_append(headers, ("Content-Type: " + contentType).c_str());
+        }
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        requestTemplate->headers.reset(headers);
+
+        // parameter names, one per line
+        std::vector<std::string> parameterNames = requestTemplate->url.getParameterNames();
+        for (const auto& parameterName : requestTemplate->body.getParameterNames()) {
+            if (std::find(parameterNames.begin(), parameterNames.end(), parameterName) == parameterNames.end()) {
+                parameterNames.push_back(parameterName);
+            }
+        }
+        for (const auto& parameterName : parameterNames) {
+            if (!m_parameterNames.empty()) {
+                m_parameterNames.push_back('\n');
+            }
+            m_parameterNames += parameterName;
+        }
+
+        try {
+            TemplateRegistry::instance().put(getRegistryKey(context, name), std::move(requestTemplate));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        m_needFetch = true;
+    }
+
+    bool m_needFetch = false;
+    std::string m_parameterNames;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        out->parameterNamesNull = m_parameterNames.empty() ? FB_TRUE : FB_FALSE;
+        if (!out->parameterNamesNull) {
+            out->parameterNames.length = static_cast<unsigned short>(std::min<size_t>(m_parameterNames.size(), 32765));
+            m_parameterNames.copy(out->parameterNames.str, out->parameterNames.length);
+        }
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+/*
+  PROCEDURE HTTP_TEMPLATE_EXECUTE (
+    NAME                 VARCHAR(63) NOT NULL,
+    PARAMS               VARCHAR(8191)
+  )
+  RETURNS (
+    STATUS_CODE          SMALLINT,
+    STATUS_TEXT          VARCHAR(256),
+    RESPONSE_TYPE        VARCHAR(256),
+    RESPONSE_BODY        BLOB SUB_TYPE BINARY,
+    RESPONSE_HEADERS     BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!executeTemplate'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(executeTemplate)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(252, 0), name)
+        (FB_INTL_VARCHAR(32765, 0), params)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(1024, 0), statusText)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_BLOB, body)
+        (FB_BLOB, headers)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->nameNull) {
+            throwException(status, "NAME can not be NULL.");
+        }
+        std::string name(in->name.str, in->name.length);
+        trim(name);
+
+        // the template stays alive until the end of the call even if it is registered again
+        const auto requestTemplate = TemplateRegistry::instance().get(getRegistryKey(context, name));
+        if (!requestTemplate) {
+            throwException(status, "Template %s is not registered.", name.c_str());
+        }
+
+        // only the variable parts are built for each call
+        std::string url;
+        std::string requestBody;
+        try {
+            TemplateParameters parameters;
+            if (!in->paramsNull) {
+                parameters = TemplateParameters(std::string(in->params.str, in->params.length));
+            }
+            url.reserve(requestTemplate->url.getLiteralSize() + 64);
+            requestTemplate->url.render(parameters, url);
+            if (requestTemplate->hasBody) {
+                requestBody.reserve(requestTemplate->body.getLiteralSize() + 256);
+                requestTemplate->body.render(parameters, requestBody);
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        // a request to an upstream group is sent to one of its members
+        UpstreamLease upstream = acquireUpstream(status, context, url);
+        const Endpoint endpoint = getEndpoint(status, upstream ? upstream.getUrl() : url);
+
+        // the handle keeps its connection for the next request to the same endpoint
+        PooledCurl curl(getCurlHandlePool(status, context), endpoint.getKey());
+
+        if (!curl) {
+            throwException(status, "Can't initialize CURL.");
+        }
+        const auto& templateOptions = requestTemplate->curlOptions;
+        // addresses given by the request stay in the DNS cache of the handle
+        if (templateOptions.find(CURLOPT_RESOLVE) != templateOptions.cend()) {
+            curl.discard();
+        }
+
+        // buffer for storing text errors
+        char curlErrorBuffer[CURL_ERROR_SIZE];
+        memset(curlErrorBuffer, 0, CURL_ERROR_SIZE);
+        curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, curlErrorBuffer);
+
+        // set url
+        endpoint.apply(curl);
+
+        // set Http method
+        const auto httpMethod = getHttpMethod(requestTemplate->method);
+        setHttpMethod(status, curl, httpMethod, requestTemplate->method);
+
+        try {
+            setCurlOptions(curl, templateOptions);
+        }
+        catch (const std::invalid_argument& e) {
+            throwException(status, "%s", e.what());
+        }
+        catch (const std::out_of_range& e) {
+            throwException(status, "%s", e.what());
+        }
+        const auto dnsLists = applyDnsSettings(status, context, curl, templateOptions);
+
+        // headers prepared by the registration
+        if (requestTemplate->headers) {
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, requestTemplate->headers.get());
+        }
+
+        // the body is sent from memory without copying, also by a hedged copy
+        if (requestTemplate->hasBody) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(requestBody.size()));
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, requestBody.data());
+        }
+
+        std::string singleFlightKey;
+        if (isSingleFlight(templateOptions, httpMethod, requestTemplate->hasBody)) {
+            // the template is kept by the call, so its address stands for its headers and options
+            singleFlightKey = requestTemplate->method;
+            singleFlightKey.push_back('\n');
+            singleFlightKey += url;
+            singleFlightKey.push_back('\n');
+            singleFlightKey += std::to_string(reinterpret_cast<uintptr_t>(requestTemplate.get()));
+        }
+
+        m_response = performTransfer(status, context, curl, endpoint, upstream, httpMethod, requestTemplate->method,
+            templateOptions, singleFlightKey, curlErrorBuffer, HedgedTransfer::PrepareCopy());
+        out->statusCodeNull = FB_FALSE;
+        out->statusCode = static_cast<ISC_SHORT>(m_response->statusCode);
+        out->contentTypeNull = m_response->hasContentType ? FB_FALSE : FB_TRUE;
+        m_needFetch = true;
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+
+    bool m_needFetch = false;
+    // the response may be shared with identical requests, it is not copied
+    std::shared_ptr<const SharedResponse> m_response;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        writeHttpResponse(status, m_att, m_tra, *m_response, out);
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+/*
+  PROCEDURE HTTP_TEMPLATE_UNREGISTER (
+    NAME                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    REMOVED              BOOLEAN
+  )
+  EXTERNAL NAME 'http_client_udr!unregisterTemplate'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(unregisterTemplate)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(252, 0), name)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_BOOLEAN, removed)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        if (in->nameNull) {
+            throwException(status, "NAME can not be NULL.");
+        }
+        std::string name(in->name.str, in->name.length);
+        trim(name);
+        m_removed = TemplateRegistry::instance().remove(getRegistryKey(context, name));
+        m_needFetch = true;
+    }
+
+    bool m_needFetch = false;
+    bool m_removed = false;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        out->removedNull = FB_FALSE;
+        out->removed = m_removed ? FB_TRUE : FB_FALSE;
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+/*
+  PROCEDURE HTTP_STATS
+  RETURNS (
+    STAT_NAME            VARCHAR(63),
+    STAT_VALUE           BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!getStatistics'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(getStatistics)
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_INTL_VARCHAR(252, 0), name)
+        (FB_BIGINT, value)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        // the counters are taken at once, so the rows are consistent with each other
+        const auto& singleFlight = SingleFlight::instance();
+        m_statistics.emplace_back("SINGLE_FLIGHT_TRANSFERS", singleFlight.getLeaderCount());
+        m_statistics.emplace_back("SINGLE_FLIGHT_SHARED", singleFlight.getSharedCount());
+
+        const auto& resolver = DnsResolver::instance();
+        m_statistics.emplace_back("DNS_RESOLVES", resolver.getResolveCount());
+        m_statistics.emplace_back("DNS_RESOLVE_FAILURES", resolver.getFailureCount());
+
+        const auto& certificates = CertificateCache::instance();
+        m_statistics.emplace_back("TLS_FILE_LOADS", certificates.getLoadCount());
+        m_statistics.emplace_back("TLS_FILE_CACHE_HITS", certificates.getHitCount());
+
+        const auto& handlePool = CurlHandlePool::instance();
+        m_statistics.emplace_back("POOL_HANDLES_CREATED", handlePool.getCreateCount());
+        m_statistics.emplace_back("POOL_HANDLES_REUSED", handlePool.getReuseCount());
+
+        const auto& hedgeBudget = HedgeBudget::instance();
+        m_statistics.emplace_back("HEDGE_COPIES_SENT", hedgeBudget.getCopyCount());
+        m_statistics.emplace_back("HEDGE_COPIES_TAKEN", hedgeBudget.getCopyWinCount());
+        m_statistics.emplace_back("HEDGE_BUDGET_DENIED", hedgeBudget.getDeniedCount());
+
+        m_statistics.emplace_back("UPSTREAM_EJECTIONS", UpstreamGroups::instance().getEjectionCount());
+
+        const auto& trace = RequestTrace::instance();
+        m_statistics.emplace_back("TRACE_ENTRIES_RECORDED", trace.getRecordCount());
+        m_statistics.emplace_back("TRACE_ENTRIES_DROPPED", trace.getDropCount());
+
+        const auto& bulkSinks = BulkSinkRegistry::instance();
+        m_statistics.emplace_back("BULK_RECORDS_APPENDED", bulkSinks.getAppendCount());
+        m_statistics.emplace_back("BULK_BATCHES_SENT", bulkSinks.getBatchCount());
+        m_statistics.emplace_back("BULK_RECORDS_FAILED", bulkSinks.getFailedCount());
+
+        const auto& outbox = Outbox::instance();
+        m_statistics.emplace_back("OUTBOX_ENQUEUED", outbox.getEnqueueCount());
+        m_statistics.emplace_back("OUTBOX_DELIVERED", outbox.getDeliverCount());
+        m_statistics.emplace_back("OUTBOX_FAILED", outbox.getFailCount());
+        m_statistics.emplace_back("OUTBOX_RETRIES", outbox.getRetryCount());
+        m_statistics.emplace_back("OUTBOX_REPLAYED", outbox.getReplayCount());
+        m_statistics.emplace_back("OUTBOX_SYNCS", outbox.getSyncCount());
+        m_statistics.emplace_back("OUTBOX_COMPACTIONS", outbox.getCompactCount());
+
+        const auto& memoryBudget = MemoryBudget::instance();
+        Firebird::AutoRelease<Firebird::IAttachment> att(context->getAttachment(status));
+        unsigned int statementTimeout = 0;
+        int64_t attachmentId = 0;
+        getAttachmentInfo(context->getMaster(), att, statementTimeout, attachmentId);
+        m_statistics.emplace_back("MEMORY_USAGE", memoryBudget.getUsage());
+        m_statistics.emplace_back("MEMORY_ATTACHMENT_USAGE", memoryBudget.getAttachmentUsage(attachmentId));
+        m_statistics.emplace_back("MEMORY_PEAK_USAGE", memoryBudget.getPeakUsage());
+        m_statistics.emplace_back("MEMORY_PAUSES", memoryBudget.getPauseCount());
+        m_statistics.emplace_back("MEMORY_SPILLS", memoryBudget.getSpillCount());
+        m_statistics.emplace_back("MEMORY_REJECTS", memoryBudget.getRejectCount());
+
+        const auto allocations = getMemoryPoolStats();
+        m_statistics.emplace_back("ALLOC_CURL_TOTAL", allocations.curlAllocations);
+        m_statistics.emplace_back("ALLOC_CURL_REUSED", allocations.curlReused);
+        m_statistics.emplace_back("ALLOC_BUFFER_TOTAL", allocations.bufferAllocations);
+        m_statistics.emplace_back("ALLOC_BUFFER_REUSED", allocations.bufferReused);
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> m_statistics;
+    size_t m_position = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (m_position >= m_statistics.size()) {
+            return false;
+        }
+        const auto& statistic = m_statistics[m_position++];
+        out->nameNull = FB_FALSE;
+        out->name.length = static_cast<unsigned short>(statistic.first.size());
+        statistic.first.copy(out->name.str, out->name.length);
+        out->valueNull = FB_FALSE;
+        out->value = static_cast<ISC_INT64>(statistic.second);
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+/*
+  PROCEDURE HTTP_PRECONNECT (
+    URL                  VARCHAR(8191) NOT NULL,
+    CONNECTIONS          SMALLINT NOT NULL DEFAULT 1,
+    OPTIONS              VARCHAR(8191) DEFAULT NULL
+  )
+  RETURNS (
+    READY_CONNECTIONS    SMALLINT,
+    NEW_CONNECTIONS      SMALLINT
+  )
+  EXTERNAL NAME 'http_client_udr!preconnect'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(preconnect)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_SMALLINT, connections)
+        (FB_INTL_VARCHAR(32765, 0), options)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_SMALLINT, readyConnections)
+        (FB_SMALLINT, newConnections)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        const Endpoint endpoint = getEndpoint(status, std::string(in->url.str, in->url.length));
+
+        unsigned int connections = 1;
+        if (!in->connectionsNull) {
+            if (in->connections < 1 || in->connections > static_cast<int>(MAX_PRECONNECT_CONNECTIONS)) {
+                throwException(status, "CONNECTIONS must be between 1 and %u.", MAX_PRECONNECT_CONNECTIONS);
+            }
+            connections = static_cast<unsigned int>(in->connections);
+        }
+
+        std::map<long, std::string> curlOptions;
+        try {
+            if (!in->optionsNull) {
+                curlOptions = parseCurlOptions(std::string(in->options.str, in->options.length));
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        // handles with addresses of the request are not returned to the pool
+        if (curlOptions.find(CURLOPT_RESOLVE) != curlOptions.cend()) {
+            throwException(status, "CURLOPT_RESOLVE can not be used to warm up the pool, use the DnsPin parameter.");
+        }
+
+        auto& pool = getCurlHandlePool(status, context);
+        const auto dnsLists = getDnsLists(status, context, curlOptions);
+        // the connections are reused only by requests with the same options
+        const auto result = ::preconnect(pool, endpoint, connections, [&curlOptions](CURL* curl) {
+            setCurlOptions(curl, curlOptions);
+        }, dnsLists);
+        if (result.ready == 0) {
+            throwException(status, "%s", result.error.c_str());
+        }
+
+        out->readyConnectionsNull = FB_FALSE;
+        out->readyConnections = static_cast<ISC_SHORT>(result.ready);
+        out->newConnectionsNull = FB_FALSE;
+        out->newConnections = static_cast<ISC_SHORT>(result.opened);
+        m_needFetch = true;
+    }
+
+    bool m_needFetch = false;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+/*
+  PROCEDURE HTTP_UPSTREAMS
+  RETURNS (
+    GROUP_NAME           VARCHAR(63),
+    URL                  VARCHAR(8191),
+    WEIGHT               INTEGER,
+    OUTSTANDING_REQUESTS INTEGER,
+    LATENCY              DOUBLE PRECISION,
+    FAILURES             INTEGER,
+    EJECTED              BOOLEAN,
+    REQUESTS             BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!getUpstreams'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(getUpstreams)
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_INTL_VARCHAR(252, 0), groupName)
+        (FB_INTL_VARCHAR(32764, 0), url)
+        (FB_INTEGER, weight)
+        (FB_INTEGER, outstanding)
+        (FB_DOUBLE, latency)
+        (FB_INTEGER, failures)
+        (FB_BOOLEAN, ejected)
+        (FB_BIGINT, requests)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_members = getUpstreamGroups(status, context).getStatus();
+    }
+
+    std::vector<UpstreamMemberStatus> m_members;
+    size_t m_position = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (m_position >= m_members.size()) {
+            return false;
+        }
+        const auto& member = m_members[m_position++];
+        out->groupNameNull = FB_FALSE;
+        out->groupName.length = static_cast<unsigned short>(std::min<size_t>(member.group.size(), 252));
+        member.group.copy(out->groupName.str, out->groupName.length);
+        out->urlNull = FB_FALSE;
+        out->url.length = static_cast<unsigned short>(std::min<size_t>(member.url.size(), 32764));
+        member.url.copy(out->url.str, out->url.length);
+        out->weightNull = FB_FALSE;
+        out->weight = static_cast<ISC_LONG>(member.weight);
+        out->outstandingNull = FB_FALSE;
+        out->outstanding = static_cast<ISC_LONG>(member.outstanding);
+        out->latencyNull = FB_FALSE;
+        out->latency = member.latency;
+        out->failuresNull = FB_FALSE;
+        out->failures = static_cast<ISC_LONG>(member.failures);
+        out->ejectedNull = FB_FALSE;
+        out->ejected = member.ejected ? FB_TRUE : FB_FALSE;
+        out->requestsNull = FB_FALSE;
+        out->requests = static_cast<ISC_INT64>(member.requests);
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+/*
+  PROCEDURE HTTP_TRACE_DUMP
+  RETURNS (
+    ID                   BIGINT,
+    TRACE_TIME           TIMESTAMP,
+    ATTACHMENT_ID        BIGINT,
+    METHOD               VARCHAR(16),
+    URL                  VARCHAR(1024),
+    STATUS_CODE          SMALLINT,
+    CURL_CODE            INTEGER,
+    ERROR_MESSAGE        VARCHAR(256),
+    NAMELOOKUP_TIME      DOUBLE PRECISION,
+    CONNECT_TIME         DOUBLE PRECISION,
+    APPCONNECT_TIME      DOUBLE PRECISION,
+    STARTTRANSFER_TIME   DOUBLE PRECISION,
+    TOTAL_TIME           DOUBLE PRECISION,
+    REQUEST_SIZE         BIGINT,
+    RESPONSE_SIZE        BIGINT,
+    WIRE_TRACE           BLOB SUB_TYPE TEXT
+  )
+  EXTERNAL NAME 'http_client_udr!dumpTrace'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(dumpTrace)
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_BIGINT, id)
+        (FB_TIMESTAMP, traceTime)
+        (FB_BIGINT, attachmentId)
+        (FB_INTL_VARCHAR(64, 0), method)
+        (FB_INTL_VARCHAR(4096, 0), url)
+        (FB_SMALLINT, statusCode)
+        (FB_INTEGER, curlCode)
+        (FB_INTL_VARCHAR(1024, 0), errorMessage)
+        (FB_DOUBLE, nameLookupTime)
+        (FB_DOUBLE, connectTime)
+        (FB_DOUBLE, appConnectTime)
+        (FB_DOUBLE, startTransferTime)
+        (FB_DOUBLE, totalTime)
+        (FB_BIGINT, requestSize)
+        (FB_BIGINT, responseSize)
+        (FB_BLOB, wireTrace)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+        m_util = context->getMaster()->getUtilInterface();
+        // the slots are copied at once, the requests are not stopped
+        m_entries = getRequestTrace(status, context).dump();
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+    Firebird::IUtil* m_util = nullptr;
+    std::vector<TraceEntry> m_entries;
+    size_t m_position = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (m_position >= m_entries.size()) {
+            return false;
+        }
+        const auto& entry = m_entries[m_position++];
+        out->idNull = FB_FALSE;
+        out->id = static_cast<ISC_INT64>(entry.id);
+
+        const std::tm time = toLocalTime(entry.time);
+        out->traceTimeNull = FB_FALSE;
+        out->traceTime.date.encode(m_util, time.tm_year + 1900, time.tm_mon + 1, time.tm_mday);
+        out->traceTime.time.encode(m_util, time.tm_hour, time.tm_min, time.tm_sec,
+            static_cast<unsigned>(entry.time % 1000000 / 100));
+
+        out->attachmentIdNull = entry.attachmentId ? FB_FALSE : FB_TRUE;
+        out->attachmentId = static_cast<ISC_INT64>(entry.attachmentId);
+
+        out->methodNull = FB_FALSE;
+        out->method.length = static_cast<unsigned short>(strlen(entry.method));
+        memcpy(out->method.str, entry.method, out->method.length);
+
+        out->urlNull = FB_FALSE;
+        out->url.length = static_cast<unsigned short>(strlen(entry.url));
+        memcpy(out->url.str, entry.url, out->url.length);
+
+        out->statusCodeNull = entry.statusCode ? FB_FALSE : FB_TRUE;
+        out->statusCode = static_cast<ISC_SHORT>(entry.statusCode);
+        out->curlCodeNull = FB_FALSE;
+        out->curlCode = entry.curlCode;
+
+        out->errorMessage.length = static_cast<unsigned short>(strlen(entry.error));
+        out->errorMessageNull = out->errorMessage.length ? FB_FALSE : FB_TRUE;
+        memcpy(out->errorMessage.str, entry.error, out->errorMessage.length);
+
+        // seconds, as in HTTP_DOWNLOAD_TO_FILE
+        out->nameLookupTimeNull = FB_FALSE;
+        out->nameLookupTime = entry.nameLookupTime / 1000000.0;
+        out->connectTimeNull = FB_FALSE;
+        out->connectTime = entry.connectTime / 1000000.0;
+        out->appConnectTimeNull = FB_FALSE;
+        out->appConnectTime = entry.appConnectTime / 1000000.0;
+        out->startTransferTimeNull = FB_FALSE;
+        out->startTransferTime = entry.startTransferTime / 1000000.0;
+        out->totalTimeNull = FB_FALSE;
+        out->totalTime = entry.totalTime / 1000000.0;
+
+        out->requestSizeNull = FB_FALSE;
+        out->requestSize = static_cast<ISC_INT64>(entry.requestSize);
+        out->responseSizeNull = FB_FALSE;
+        out->responseSize = static_cast<ISC_INT64>(entry.responseSize);
+
+        out->wireTraceNull = entry.wireLength ? FB_FALSE : FB_TRUE;
+        if (!out->wireTraceNull) {
+            writeBlob(status, m_att, m_tra, &out->wireTrace, entry.wire, entry.wireLength);
+        }
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+// Sends the records of the sink by the flusher thread. The statement waits for the result
+// until it is cancelled or its timeout expires, the records are sent anyway.
+BulkFlushResult flushBulkRecords(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context,
+    const std::shared_ptr<BulkSink>& sink)
+{
+    TransferGuard guard(status, context);
+    std::future<BulkFlushResult> result;
+    try {
+        result = BulkSinkRegistry::instance().requestFlush(sink);
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+    while (result.wait_for(BULK_FLUSH_WAIT_INTERVAL) != std::future_status::ready) {
+        if (guard.isCancelled()) {
+            guard.check(status);
+        }
+    }
+    try {
+        return result.get();
+    }
+    catch (const std::runtime_error& e) {
+        throwException(status, "%s", e.what());
+    }
+}
+
+/*
+  PROCEDURE HTTP_BULK_SINK_REGISTER (
+    NAME                 VARCHAR(63) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    FORMAT               VARCHAR(10) NOT NULL,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191),
+    MAX_RECORDS          INTEGER,
+    MAX_BYTES            INTEGER,
+    MAX_AGE              INTEGER,
+    ENVELOPE             VARCHAR(8191),
+    RESULT_PATH          VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!registerBulkSink'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(registerBulkSink)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(252, 0), name)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTL_VARCHAR(40, 0), format)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+        (FB_INTEGER, maxRecords)
+        (FB_INTEGER, maxBytes)
+        (FB_INTEGER, maxAge)
+        (FB_INTL_VARCHAR(32765, 0), envelope)
+        (FB_INTL_VARCHAR(4096, 0), resultPath)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        if (in->nameNull) {
+            throwException(status, "NAME can not be NULL.");
+        }
+        std::string name(in->name.str, in->name.length);
+        trim(name);
+        if (name.empty()) {
+            throwException(status, "NAME can not be empty.");
+        }
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+
+        BulkSinkSettings settings;
+        settings.url.assign(in->url.str, in->url.length);
+        if (UpstreamGroups::isUpstreamUrl(settings.url)) {
+            throwException(status, "Upstream groups can be used only by HTTP_REQUEST and HTTP_TEMPLATE_EXECUTE.");
+        }
+
+        std::string format("NDJSON");
+        if (!in->formatNull) {
+            format.assign(in->format.str, in->format.length);
+            trim(format);
+            toUpper(format);
+        }
+        if (format == "NDJSON") {
+            settings.format = BulkFormat::Ndjson;
+        }
+        else if (format == "JSON_ARRAY") {
+            settings.format = BulkFormat::JsonArray;
+        }
         else {
-            std::string curlErrorMessage(curlErrorBuffer);
-            if (curlErrorMessage.empty())
-                curlErrorMessage.assign(curl_easy_strerror(curlResult));
+            throwException(status, "Unsupported FORMAT %s, expected NDJSON or JSON_ARRAY.", format.c_str());
+        }
+
+        if (!in->maxRecordsNull) {
+            if (in->maxRecords < 1) {
+                throwException(status, "MAX_RECORDS must be greater than 0.");
+            }
+            settings.maxRecords = static_cast<unsigned int>(in->maxRecords);
+        }
+        if (!in->maxBytesNull) {
+            if (in->maxBytes < 1) {
+                throwException(status, "MAX_BYTES must be greater than 0.");
+            }
+            settings.maxBytes = static_cast<size_t>(in->maxBytes);
+        }
+        if (!in->maxAgeNull) {
+            if (in->maxAge < 1) {
+                throwException(status, "MAX_AGE must be greater than 0.");
+            }
+            settings.maxAge = std::chrono::milliseconds(in->maxAge);
+        }
+        if (!in->envelopeNull) {
+            settings.envelope.assign(in->envelope.str, in->envelope.length);
+        }
+        if (!in->resultPathNull) {
+            settings.resultPath.assign(in->resultPath.str, in->resultPath.length);
+        }
+
+        std::map<long, std::string> curlOptions;
+        try {
+            if (!in->optionsNull) {
+                curlOptions = parseCurlOptions(std::string(in->options.str, in->options.length));
+            }
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        // the flusher thread uses the pool, the resolver and the trace buffer configured by the requests
+        getCurlHandlePool(status, context);
+        getDnsLists(status, context, curlOptions);
+        getRequestTrace(status, context);
+        settings.privateDns = curlOptions.find(CURLOPT_RESOLVE) != curlOptions.cend();
+        settings.configure = [curlOptions](CURL* curl) {
+            setCurlOptions(curl, curlOptions);
+            // the lists are taken for each batch, so they follow the refreshes of the resolver
+            auto dnsLists = selectDnsLists(curlOptions);
+            if (dnsLists) {
+                dnsLists->apply(curl);
+            }
+            return dnsLists;
+        };
+
+        // the header list is built once and shared by all batches of the sink
+        std::string contentType(settings.format == BulkFormat::Ndjson ? "application/x-ndjson" : "application/json");
+        if (!in->contentTypeNull) {
+            contentType.assign(in->contentType.str, in->contentType.length);
+        }
+        struct curl_slist* headers = curl_slist_append(nullptr, ("Content-Type: " + contentType).c_str());
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        settings.headers.reset(headers);
+
+        std::shared_ptr<BulkSink> sink;
+        try {
+            sink = std::make_shared<BulkSink>(std::move(settings));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
 
-            throwException(status, curlErrorMessage.c_str());
+        // records of the previous registration are sent first, the batches to be retried
+        // are sent later by the flusher thread
+        const auto previous = BulkSinkRegistry::instance().put(getRegistryKey(context, name), std::move(sink));
+        if (previous) {
+            flushBulkRecords(status, context, previous);
         }
+    }
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        return false;
+    }
 
+FB_UDR_END_PROCEDURE
 
+// Returns the sink registered with the name in the database of the attachment.
+std::shared_ptr<BulkSink> getBulkSink(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context,
+    const std::string& name)
+{
+    auto sink = BulkSinkRegistry::instance().get(getRegistryKey(context, name));
+    if (!sink) {
+        throwException(status, "Bulk sink %s is not registered.", name.c_str());
     }
+    return sink;
+}
 
-    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
-    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+/*
+  PROCEDURE HTTP_BULK_APPEND (
+    SINK                 VARCHAR(63) NOT NULL,
+    PAYLOAD              VARCHAR(8191) NOT NULL
+  )
+  RETURNS (
+    RECORD_ID            BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!appendBulkRecord'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(appendBulkRecord)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(252, 0), sink)
+        (FB_INTL_VARCHAR(32765, 0), payload)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_BIGINT, recordId)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        if (in->sinkNull) {
+            throwException(status, "SINK can not be NULL.");
+        }
+        if (in->payloadNull) {
+            throwException(status, "PAYLOAD can not be NULL.");
+        }
+        std::string name(in->sink.str, in->sink.length);
+        trim(name);
+        const auto sink = getBulkSink(status, context, name);
+        try {
+            // the record is sent later by the flusher thread, whatever happens to the transaction
+            m_recordId = sink->append(std::string(in->payload.str, in->payload.length));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        m_needFetch = true;
+    }
 
     bool m_needFetch = false;
-    std::ostringstream m_response{};
-    std::ostringstream m_responseHeaders{};
-    std::string m_resonseContentType{ "" };
-    long m_http_version = 0;
+    uint64_t m_recordId = 0;
 
     FB_UDR_FETCH_PROCEDURE
     {
         if (!m_needFetch) {
             return false;
         }
-        m_needFetch = !m_needFetch;
-        // response headers
-        const std::string headers = m_responseHeaders.str();
-        out->headersNull = headers.empty() ? FB_TRUE : FB_FALSE;
-        if (!out->headersNull) {
-            auto statusText = extractResponseStatusText(m_http_version, out->statusCode, headers);
-            out->statusTextNull = statusText.empty();
-            if (!out->statusTextNull) {
-                out->statusText.length = std::min<short>(statusText.size(), 1024);
-                statusText.copy(out->statusText.str, out->statusText.length);
-            }
+        m_needFetch = false;
+        out->recordIdNull = FB_FALSE;
+        out->recordId = static_cast<ISC_INT64>(m_recordId);
+        return true;
+    }
 
-            const unsigned char bpb[] = {
-                isc_bpb_version1,
-                isc_bpb_type, 1, isc_bpb_type_stream,
-                isc_bpb_storage, 1, isc_bpb_storage_temp
-            };
+FB_UDR_END_PROCEDURE
+
+/*
+  PROCEDURE HTTP_BULK_FLUSH (
+    SINK                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    RECORDS              INTEGER,
+    BATCHES              INTEGER,
+    STATUS_CODE          SMALLINT,
+    ERROR_MESSAGE        VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!flushBulkSink'
+  ENGINE UDR;
+*/
 
-            Firebird::AutoRelease<Firebird::IBlob> headersBlob(
-                m_att->createBlob(status, m_tra, &out->headers, sizeof(bpb), bpb)
-            );
+FB_UDR_BEGIN_PROCEDURE(flushBulkSink)
 
-            size_t str_len = headers.length();
-            size_t offset = 0;
-            std::vector<char> vBuffer(MAX_SEGMENT_SIZE + 1);
-            {
-                char* buffer = vBuffer.data();
-                while (str_len > 0) {
-                    const auto len = std::min<unsigned int>(str_len, MAX_SEGMENT_SIZE);
-                    memset(buffer, 0, MAX_SEGMENT_SIZE + 1);
-                    memcpy(buffer, headers.data() + offset, len);
-                    headersBlob->putSegment(status, len, buffer);
-                    offset += len;
-                    str_len -= len;
-                }
-            }
-            headersBlob->close(status);
-            headersBlob.release();
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(252, 0), sink)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_INTEGER, records)
+        (FB_INTEGER, batches)
+        (FB_SMALLINT, statusCode)
+        (FB_INTL_VARCHAR(4096, 0), errorMessage)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        if (in->sinkNull) {
+            throwException(status, "SINK can not be NULL.");
         }
+        std::string name(in->sink.str, in->sink.length);
+        trim(name);
+        const auto sink = getBulkSink(status, context, name);
+        // failed batches do not raise an error, their records get it in HTTP_BULK_RESULTS
+        m_result = flushBulkRecords(status, context, sink);
+        m_needFetch = true;
+    }
 
-        // response body
-        const std::string response = m_response.str();
-        out->bodyNull = response.empty() ? FB_TRUE : FB_FALSE;
-        if (!out->bodyNull) {
-            const unsigned char bpb[] = {
-                isc_bpb_version1,
-                isc_bpb_type, 1, isc_bpb_type_stream,
-                isc_bpb_storage, 1, isc_bpb_storage_temp
-            };
+    bool m_needFetch = false;
+    BulkFlushResult m_result;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        out->recordsNull = FB_FALSE;
+        out->records = static_cast<ISC_LONG>(m_result.records);
+        out->batchesNull = FB_FALSE;
+        out->batches = static_cast<ISC_LONG>(m_result.batches);
+        out->statusCodeNull = m_result.statusCode ? FB_FALSE : FB_TRUE;
+        out->statusCode = static_cast<ISC_SHORT>(m_result.statusCode);
+        out->errorMessageNull = m_result.error.empty() ? FB_TRUE : FB_FALSE;
+        out->errorMessage.length = static_cast<unsigned short>(std::min<size_t>(m_result.error.size(), 4096));
+        m_result.error.copy(out->errorMessage.str, out->errorMessage.length);
+        return true;
+    }
 
-            Firebird::AutoRelease<Firebird::IBlob> responseBodyBlob(
-                m_att->createBlob(status, m_tra, &out->body, sizeof(bpb), bpb)
-            );
+FB_UDR_END_PROCEDURE
 
-            size_t str_len = response.length();
-            size_t offset = 0;
-            std::vector<char> vBuffer(MAX_SEGMENT_SIZE + 1);
-            {
-                char* buffer = vBuffer.data();
-                while (str_len > 0) {
-                    const auto len = std::min<unsigned int>(str_len, MAX_SEGMENT_SIZE);
-                    memset(buffer, 0, MAX_SEGMENT_SIZE + 1);
-                    memcpy(buffer, response.data() + offset, len);
-                    responseBodyBlob->putSegment(status, len, buffer);
-                    offset += len;
-                    str_len -= len;
-                }
+/*
+  PROCEDURE HTTP_BULK_RESULTS (
+    SINK                 VARCHAR(63) NOT NULL
+  )
+  RETURNS (
+    RECORD_ID            BIGINT,
+    STATUS_CODE          SMALLINT,
+    RESULT               BLOB SUB_TYPE TEXT,
+    ERROR_MESSAGE        VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!getBulkResults'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(getBulkResults)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(252, 0), sink)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_BIGINT, recordId)
+        (FB_SMALLINT, statusCode)
+        (FB_BLOB, result)
+        (FB_INTL_VARCHAR(4096, 0), errorMessage)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_att.reset(context->getAttachment(status));
+        m_tra.reset(context->getTransaction(status));
+
+        if (in->sinkNull) {
+            throwException(status, "SINK can not be NULL.");
+        }
+        std::string name(in->sink.str, in->sink.length);
+        trim(name);
+        m_results = getBulkSink(status, context, name)->getResults();
+    }
+
+    Firebird::AutoRelease<Firebird::IAttachment> m_att{ nullptr };
+    Firebird::AutoRelease<Firebird::ITransaction> m_tra{ nullptr };
+    std::vector<BulkResult> m_results;
+    size_t m_position = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (m_position >= m_results.size()) {
+            return false;
+        }
+        const auto& result = m_results[m_position++];
+        out->recordIdNull = FB_FALSE;
+        out->recordId = static_cast<ISC_INT64>(result.recordId);
+        out->statusCodeNull = result.statusCode ? FB_FALSE : FB_TRUE;
+        out->statusCode = static_cast<ISC_SHORT>(result.statusCode);
+        out->resultNull = result.hasItem ? FB_FALSE : FB_TRUE;
+        if (result.hasItem) {
+            writeBlob(status, m_att, m_tra, &out->result, result.item.data(), result.item.size());
+        }
+        out->errorMessageNull = result.error.empty() ? FB_TRUE : FB_FALSE;
+        out->errorMessage.length = static_cast<unsigned short>(std::min<size_t>(result.error.size(), 4096));
+        result.error.copy(out->errorMessage.str, out->errorMessage.length);
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+
+// Returns the outbox opened by the first request of the process.
+Outbox& getOutbox(Firebird::ThrowStatusWrapper* const status, Firebird::IExternalContext* context)
+{
+    // the workers use the pool, the resolver and the trace buffer configured by the requests
+    getCurlHandlePool(status, context);
+    getRequestTrace(status, context);
+    auto& outbox = Outbox::instance();
+    if (!outbox.isOpen()) {
+        throwException(status, "%s", outbox.getError().c_str());
+    }
+    return outbox;
+}
+
+/*
+  PROCEDURE HTTP_OUTBOX_ENQUEUE (
+    METHOD               VARCHAR(7) NOT NULL,
+    URL                  VARCHAR(8191) NOT NULL,
+    REQUEST_BODY         BLOB SUB_TYPE BINARY,
+    REQUEST_TYPE         VARCHAR(256),
+    HEADERS              VARCHAR(8191),
+    OPTIONS              VARCHAR(8191)
+  )
+  RETURNS (
+    REQUEST_ID           BIGINT
+  )
+  EXTERNAL NAME 'http_client_udr!enqueueOutboxRequest'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(enqueueOutboxRequest)
+
+    FB_UDR_MESSAGE(InMessage,
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_BLOB, body)
+        (FB_INTL_VARCHAR(1024, 0), contentType)
+        (FB_INTL_VARCHAR(32765, 0), headers)
+        (FB_INTL_VARCHAR(32765, 0), options)
+    );
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_BIGINT, requestId)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        if (in->methodNull) {
+            throwException(status, "HTTP_METHOD can not be NULL.");
+        }
+        OutboxRequest request;
+        request.method.assign(in->method.str, in->method.length);
+        const HttpMethod httpMethod = getHttpMethod(request.method);
+        if (httpMethod == HttpMethod::None) {
+            throwException(status, "Unsupported HTTP method %s.", request.method.c_str());
+        }
+        // the body is sent as POSTFIELDS, which would turn these methods into POST
+        if (!in->bodyNull && (httpMethod == HttpMethod::Get || httpMethod == HttpMethod::Head)) {
+            throwException(status, "Request body is not supported for HTTP method %s.", request.method.c_str());
+        }
+
+        if (in->urlNull) {
+            throwException(status, "URL can not be NULL.");
+        }
+        request.url.assign(in->url.str, in->url.length);
+        // the URL is checked now, the request is sent later
+        getEndpoint(status, request.url);
+
+        if (!in->optionsNull) {
+            request.options.assign(in->options.str, in->options.length);
+            try {
+                parseCurlOptions(request.options);
+            }
+            catch (const std::runtime_error& e) {
+                throwException(status, "%s", e.what());
             }
-            responseBodyBlob->close(status);
-            responseBodyBlob.release();
         }
-        // contentType
-        if (!out->contentTypeNull) {
-            out->contentType.length = std::min<short>(m_resonseContentType.size(), 1024);
-            m_resonseContentType.copy(out->contentType.str, out->contentType.length);
+
+        // headers are stored one per line
+        struct curl_slist* headers = nullptr;
+        if (!in->contentTypeNull) {
+            headers = curl_slist_append(headers, ("Content-Type: " + std::string(in->contentType.str, in->contentType.length)).c_str());
+        }
+        if (!in->headersNull) {
+            headers = appendHeaders(headers, std::string(in->headers.str, in->headers.length));
+        }
+        AutoCurlHeadersFree<curl_slist> autoHeaders(headers);
+        for (auto header = headers; header; header = header->next) {
+            request.headers += header->data;
+            request.headers += '\n';
+        }
+
+        if (!in->bodyNull) {
+            Firebird::AutoRelease<Firebird::IAttachment> att(context->getAttachment(status));
+            Firebird::AutoRelease<Firebird::ITransaction> tra(context->getTransaction(status));
+            std::stringstream body;
+            readBlob(status, att, tra, &in->body, body);
+            request.body = body.str();
+            request.hasBody = true;
+        }
+        request.database = context->getDatabaseName();
+
+        auto& outbox = getOutbox(status, context);
+        try {
+            // the request is delivered whatever happens to the transaction
+            m_requestId = outbox.enqueue(std::move(request));
+        }
+        catch (const std::runtime_error& e) {
+            throwException(status, "%s", e.what());
+        }
+        m_needFetch = true;
+    }
+
+    bool m_needFetch = false;
+    uint64_t m_requestId = 0;
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (!m_needFetch) {
+            return false;
+        }
+        m_needFetch = false;
+        out->requestIdNull = FB_FALSE;
+        out->requestId = static_cast<ISC_INT64>(m_requestId);
+        return true;
+    }
+
+FB_UDR_END_PROCEDURE
+
+/*
+  PROCEDURE HTTP_OUTBOX_PENDING
+  RETURNS (
+    REQUEST_ID           BIGINT,
+    METHOD               VARCHAR(7),
+    URL                  VARCHAR(8191),
+    ATTEMPTS             INTEGER,
+    ENQUEUE_TIME         TIMESTAMP,
+    NEXT_ATTEMPT_TIME    TIMESTAMP,
+    LAST_ERROR           VARCHAR(1024)
+  )
+  EXTERNAL NAME 'http_client_udr!getOutboxPending'
+  ENGINE UDR;
+*/
+
+FB_UDR_BEGIN_PROCEDURE(getOutboxPending)
+
+    FB_UDR_MESSAGE(OutMessage,
+        (FB_BIGINT, requestId)
+        (FB_INTL_VARCHAR(28, 0), method)
+        (FB_INTL_VARCHAR(32765, 0), url)
+        (FB_INTEGER, attempts)
+        (FB_TIMESTAMP, enqueueTime)
+        (FB_TIMESTAMP, nextAttemptTime)
+        (FB_INTL_VARCHAR(4096, 0), lastError)
+    );
+
+    FB_UDR_EXECUTE_PROCEDURE
+    {
+        m_util = context->getMaster()->getUtilInterface();
+        // requests of other databases served by the process are not shown
+        m_entries = getOutbox(status, context).getPending(context->getDatabaseName());
+    }
+
+    Firebird::IUtil* m_util = nullptr;
+    std::vector<OutboxEntryStatus> m_entries;
+    size_t m_position = 0;
+
+    void setTimestamp(Firebird::FbTimestamp& timestamp, std::chrono::system_clock::time_point timePoint) const
+    {
+        const auto value = std::chrono::duration_cast<std::chrono::microseconds>(timePoint.time_since_epoch()).count();
+        const std::tm time = toLocalTime(value);
+        timestamp.date.encode(m_util, time.tm_year + 1900, time.tm_mon + 1, time.tm_mday);
+        timestamp.time.encode(m_util, time.tm_hour, time.tm_min, time.tm_sec,
+            static_cast<unsigned>(value % 1000000 / 100));
+    }
+
+    FB_UDR_FETCH_PROCEDURE
+    {
+        if (m_position >= m_entries.size()) {
+            return false;
         }
+        const auto& entry = m_entries[m_position++];
+        out->requestIdNull = FB_FALSE;
+        out->requestId = static_cast<ISC_INT64>(entry.id);
+
+        out->methodNull = FB_FALSE;
+        out->method.length = static_cast<unsigned short>(std::min<size_t>(entry.method.size(), sizeof(out->method.str)));
+        entry.method.copy(out->method.str, out->method.length);
+
+        out->urlNull = FB_FALSE;
+        out->url.length = static_cast<unsigned short>(std::min<size_t>(entry.url.size(), sizeof(out->url.str)));
+        entry.url.copy(out->url.str, out->url.length);
+
+        out->attemptsNull = FB_FALSE;
+        out->attempts = static_cast<ISC_LONG>(entry.attempts);
+
+        out->enqueueTimeNull = FB_FALSE;
+        setTimestamp(out->enqueueTime, entry.enqueueTime);
+        out->nextAttemptTimeNull = FB_FALSE;
+        setTimestamp(out->nextAttemptTime, entry.nextAttemptTime);
 
+        out->lastError.length = static_cast<unsigned short>(std::min<size_t>(entry.lastError.size(), sizeof(out->lastError.str)));
+        out->lastErrorNull = out->lastError.length ? FB_FALSE : FB_TRUE;
+        entry.lastError.copy(out->lastError.str, out->lastError.length);
         return true;
     }
 
@@ -868,11 +5347,7 @@ FB_UDR_BEGIN_FUNCTION(urlEncode)
         out->strNull = FB_FALSE;
         
 
-        AutoCurlCleanup<CURL> curl(curl_easy_init());
-
-        if (!curl) {
-            throwException(status, "Can't initialize CURL.");
-        }
+        AutoCurlCleanup<CURL> curl(createCurlHandle(status, context));
 
         char* output = curl_easy_escape(curl, in->str.str, in->str.length);
         if (output) {
@@ -915,11 +5390,7 @@ FB_UDR_BEGIN_FUNCTION(urlDecode)
         out->strNull = FB_FALSE;
 
 
-        AutoCurlCleanup<CURL> curl(curl_easy_init());
-
-        if (!curl) {
-            throwException(status, "Can't initialize CURL.");
-        }
+        AutoCurlCleanup<CURL> curl(createCurlHandle(status, context));
 
         int outLength = 0;
         char* output = curl_easy_unescape(curl, in->str.str, in->str.length, &outLength);
@@ -1542,7 +6013,7 @@ FB_UDR_BEGIN_PROCEDURE(parseHeaders)
         if (!in->headersNull) {
             Firebird::AutoRelease<Firebird::IBlob> headersBlob(att->openBlob(status, tra, &in->headers, 0, nullptr));
             bool eof = false;
-            std::vector<char> vBuffer(MAX_SEGMENT_SIZE);
+            PooledBuffer vBuffer(MAX_SEGMENT_SIZE);
             auto buffer = vBuffer.data();
             while (!eof) {
                 unsigned int l = 0;
@@ -1649,7 +6120,7 @@ FB_UDR_BEGIN_FUNCTION(getHeaderValue)
         std::stringstream headers{};
         Firebird::AutoRelease<Firebird::IBlob> headersBlob(att->openBlob(status, tra, &in->headers, 0, nullptr));
         bool eof = false;
-        std::vector<char> vBuffer(MAX_SEGMENT_SIZE);
+        PooledBuffer vBuffer(MAX_SEGMENT_SIZE);
         auto buffer = vBuffer.data();
         while (!eof) {
             unsigned int l = 0;
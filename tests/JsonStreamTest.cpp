@@ -0,0 +1,222 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			JsonStreamTest.cpp
+ *	DESCRIPTION:	Tests of the streaming extraction of JSON path values.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Test.h"
+#include "JsonStream.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Values matched in a document, each as "<path index> <location> <type> <value>".
+    std::vector<std::string> extract(const std::vector<std::string>& paths, const std::string& document,
+        size_t chunkSize = 0)
+    {
+        std::vector<JsonPath> compiled;
+        for (const auto& path : paths)
+            compiled.emplace_back(path);
+        std::vector<std::string> values;
+        JsonStreamParser parser(compiled, [&values](size_t pathIndex, const std::string& location, JsonType type,
+            std::string& value) {
+            values.push_back(std::to_string(pathIndex) + " " + location + " " + getJsonTypeName(type) + " " + value);
+        });
+        if (chunkSize == 0)
+            chunkSize = std::max<size_t>(document.size(), 1);
+        for (size_t offset = 0; offset < document.size(); offset += chunkSize)
+            parser.parse(document.data() + offset, std::min(chunkSize, document.size() - offset));
+        parser.finish();
+        return values;
+    }
+
+    // The result must not depend on how the document is split into pieces.
+    void checkAllSplits(const std::vector<std::string>& paths, const std::string& document,
+        const std::vector<std::string>& expected)
+    {
+        for (size_t chunkSize = 0; chunkSize <= document.size(); ++chunkSize) {
+            const auto values = extract(paths, document, chunkSize);
+            CHECK_EQUAL(expected.size(), values.size());
+            if (values != expected)
+                test::fail(__FILE__, __LINE__, "different values for pieces of " + std::to_string(chunkSize) + " bytes");
+        }
+    }
+
+    void testPathSyntax()
+    {
+        const JsonPath path("  $.store.book[2]['first name'][*].*  ");
+        CHECK_EQUAL(std::string("$.store.book[2]['first name'][*].*"), path.getText());
+        const auto& steps = path.getSteps();
+        CHECK_EQUAL(6u, steps.size());
+        CHECK(steps[0].kind == JsonPath::Step::Kind::Member && steps[0].name == "store");
+        CHECK(steps[1].kind == JsonPath::Step::Kind::Member && steps[1].name == "book");
+        CHECK(steps[2].kind == JsonPath::Step::Kind::Element && steps[2].index == 2);
+        CHECK(steps[3].kind == JsonPath::Step::Kind::Member && steps[3].name == "first name");
+        CHECK(steps[4].kind == JsonPath::Step::Kind::Any);
+        CHECK(steps[5].kind == JsonPath::Step::Kind::Any);
+
+        CHECK(JsonPath("$").getSteps().empty());
+        const JsonPath quoted("$['it\\'s']");
+        CHECK_EQUAL(std::string("it's"), quoted.getSteps()[0].name);
+
+        CHECK_THROWS(JsonPath(""));
+        CHECK_THROWS(JsonPath("store"));
+        CHECK_THROWS(JsonPath("$."));
+        CHECK_THROWS(JsonPath("$store"));
+        CHECK_THROWS(JsonPath("$["));
+        CHECK_THROWS(JsonPath("$[x]"));
+        CHECK_THROWS(JsonPath("$[1"));
+        CHECK_THROWS(JsonPath("$['name"));
+    }
+
+    void testMembersAndElements()
+    {
+        const std::string document = R"({"a": {"b": [1, 2.5e3, {"c": "x"}]}, "d": true, "e": null})";
+        checkAllSplits({ "$.a.b[2].c" }, document, { "0 $.a.b[2].c STRING x" });
+        checkAllSplits({ "$.a.b[*]" }, document, {
+            "0 $.a.b[0] NUMBER 1",
+            "0 $.a.b[1] NUMBER 2.5e3",
+            R"(0 $.a.b[2] OBJECT {"c": "x"})"
+        });
+        checkAllSplits({ "$.d", "$.e", "$.missing" }, document, {
+            "0 $.d BOOLEAN true",
+            "1 $.e NULL null"
+        });
+        checkAllSplits({ "$" }, "[1, [2]]", { "0 $ ARRAY [1, [2]]" });
+    }
+
+    void testSeveralPathsOfOneValue()
+    {
+        // each matching path gets the value, in the order of the paths
+        checkAllSplits({ "$.a", "$.*", "$['a']" }, R"({"a": 1})", {
+            "0 $.a NUMBER 1",
+            "1 $.a NUMBER 1",
+            "2 $.a NUMBER 1"
+        });
+    }
+
+    void testNestedMatches()
+    {
+        // a value inside a matched container is reported before the container
+        checkAllSplits({ "$.a", "$.a.b" }, R"({"a": {"b": 1}})", {
+            "1 $.a.b NUMBER 1",
+            R"(0 $.a OBJECT {"b": 1})"
+        });
+    }
+
+    void testStrings()
+    {
+        const std::string document = R"({"s": "q\"b\\s\/ é 😀 \n\t", "k\"ey": 1, "it's": 2})";
+        checkAllSplits({ "$.s" }, document, { "0 $.s STRING q\"b\\s/ \xC3\xA9 \xF0\x9F\x98\x80 \n\t" });
+        // keys that are not identifiers are quoted in the location
+        checkAllSplits({ "$['k\"ey']", "$[\"it's\"]" }, document, {
+            "0 $['k\"ey'] NUMBER 1",
+            "1 $['it\\'s'] NUMBER 2"
+        });
+    }
+
+    void testSkippedSubtrees()
+    {
+        // brackets and quotes inside strings of a skipped container do not end it
+        const std::string document = R"({"skip": {"x": "]}\"{[", "y": [[], {}]}, "want": [5]})";
+        checkAllSplits({ "$.want[0]" }, document, { "0 $.want[0] NUMBER 5" });
+    }
+
+    void testDocumentStream()
+    {
+        std::vector<JsonPath> paths{ JsonPath("$.id") };
+        std::vector<std::string> ids;
+        JsonStreamParser parser(paths, [&ids](size_t, const std::string&, JsonType, std::string& value) {
+            ids.push_back(value);
+        });
+        const std::string lines = "{\"id\": 1}\n{\"id\": \"two\"}\r\n{\"other\": 3}\n";
+        parser.parse(lines.data(), lines.size());
+        parser.finish();
+        CHECK_EQUAL(3u, parser.getDocumentCount());
+        CHECK((ids == std::vector<std::string>{ "1", "two" }));
+    }
+
+    void testTopLevelLiteral()
+    {
+        // a number at the end of the input is complete only when the input ends
+        CHECK((extract({ "$" }, "42") == std::vector<std::string>{ "0 $ NUMBER 42" }));
+        CHECK((extract({ "$" }, "-0.5", 1) == std::vector<std::string>{ "0 $ NUMBER -0.5" }));
+    }
+
+    void testErrors()
+    {
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": })"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"a" 1})"));
+        CHECK_THROWS(extract({ "$.a" }, R"({a: 1})"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": tru})"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": 01})"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": [1, 2}})"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"skip": [{"x": 1]}, "a": 1})"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": "\x"})"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": "\u12"})"));
+        // incomplete documents, also when the unfinished part is skipped
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": 1)"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"b": [1, 2)"));
+        CHECK_THROWS(extract({ "$.a" }, R"({"a": "text)"));
+
+        try {
+            extract({ "$.a" }, R"({"a": 1 2})");
+            test::fail(__FILE__, __LINE__, "no error for a missing comma");
+        }
+        catch (const std::runtime_error& e) {
+            CHECK(std::string(e.what()).find("offset 8") != std::string::npos);
+        }
+    }
+
+    void testEscaping()
+    {
+        CHECK_EQUAL(std::string(R"("a\"b\\c\n\t\u0001")"), escapeJsonString("a\"b\\c\n\t\x01"));
+        CHECK_EQUAL(std::string("\"\""), escapeJsonString(""));
+        for (const std::string value : { "", "plain", "quote \" backslash \\ slash /", "\b\f\n\r\t\x1f", "\xC3\xA9\xF0\x9F\x98\x80" }) {
+            const std::string literal = escapeJsonString(value);
+            CHECK_EQUAL(value, unescapeJsonString(literal.data() + 1, literal.size() - 2));
+        }
+        // an unpaired surrogate is encoded as is
+        CHECK_EQUAL(std::string("\xED\xA0\xBD"), unescapeJsonString("\\ud83d", 6));
+        CHECK_THROWS(unescapeJsonString("\\", 1));
+        CHECK_THROWS(unescapeJsonString("\\uZZZZ", 6));
+    }
+}
+
+int main()
+{
+    RUN_TEST(testPathSyntax);
+    RUN_TEST(testMembersAndElements);
+    RUN_TEST(testSeveralPathsOfOneValue);
+    RUN_TEST(testNestedMatches);
+    RUN_TEST(testStrings);
+    RUN_TEST(testSkippedSubtrees);
+    RUN_TEST(testDocumentStream);
+    RUN_TEST(testTopLevelLiteral);
+    RUN_TEST(testErrors);
+    RUN_TEST(testEscaping);
+    return test::failures();
+}
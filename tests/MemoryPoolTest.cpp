@@ -0,0 +1,246 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			MemoryPoolTest.cpp
+ *	DESCRIPTION:	Tests of the pooled allocator.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Test.h"
+#include "MemoryPool.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+    constexpr size_t HEADER_SIZE = 16;
+
+    // Size classes computed independently of the allocator: 64, then four classes
+    // for each power of two, 80 96 112 128 160 ... up to MAX_POOLED_BLOCK_SIZE.
+    std::vector<size_t> getClassSizes()
+    {
+        std::vector<size_t> sizes{ 64 };
+        for (size_t base = 16; sizes.back() < MAX_POOLED_BLOCK_SIZE; base *= 2) {
+            for (size_t quarter = 5; quarter <= 8; ++quarter)
+                sizes.push_back(quarter * base);
+        }
+        return sizes;
+    }
+
+    // Bytes the caller may use in a pooled block of the requested size.
+    size_t getExpectedUsableSize(size_t size)
+    {
+        for (const size_t classSize : getClassSizes()) {
+            if (std::max<size_t>(size, 1) + HEADER_SIZE <= classSize)
+                return classSize - HEADER_SIZE;
+        }
+        return 0;
+    }
+
+    bool hasFill(const void* ptr, size_t length, unsigned char value)
+    {
+        const auto bytes = static_cast<const unsigned char*>(ptr);
+        for (size_t i = 0; i < length; ++i) {
+            if (bytes[i] != value)
+                return false;
+        }
+        return true;
+    }
+
+    // The counters of a thread are published when it ends.
+    MemoryPoolStats runInThread(const std::function<void()>& function)
+    {
+        const MemoryPoolStats before = getMemoryPoolStats();
+        std::thread thread(function);
+        thread.join();
+        const MemoryPoolStats after = getMemoryPoolStats();
+        return {
+            after.curlAllocations - before.curlAllocations,
+            after.curlReused - before.curlReused,
+            after.bufferAllocations - before.bufferAllocations,
+            after.bufferReused - before.bufferReused
+        };
+    }
+
+    void testClassSizes()
+    {
+        const auto sizes = getClassSizes();
+        CHECK_EQUAL(45u, sizes.size());
+        CHECK_EQUAL(MAX_POOLED_BLOCK_SIZE, sizes.back());
+    }
+
+    void testUsableSize()
+    {
+        // a block is grown in place while the new size fits its class, so realloc tells the usable size
+        std::vector<size_t> sizes;
+        for (size_t size = 0; size <= 2048; ++size)
+            sizes.push_back(size);
+        for (const size_t classSize : getClassSizes()) {
+            sizes.push_back(classSize - HEADER_SIZE - 1);
+            sizes.push_back(classSize - HEADER_SIZE);
+            sizes.push_back(classSize - HEADER_SIZE + 1);
+        }
+        for (const size_t size : sizes) {
+            const size_t usable = getExpectedUsableSize(size);
+            if (usable == 0)
+                continue;
+            void* ptr = curlPoolMalloc(size);
+            CHECK(ptr != nullptr);
+            CHECK(reinterpret_cast<uintptr_t>(ptr) % 16 == 0);
+            std::memset(ptr, 0xA5, size);
+            void* same = curlPoolRealloc(ptr, usable);
+            if (same != ptr)
+                test::fail(__FILE__, __LINE__, "block of " + std::to_string(size) + " bytes is not grown in place");
+            void* moved = curlPoolRealloc(same, usable + 1);
+            if (moved == same)
+                test::fail(__FILE__, __LINE__, "block of " + std::to_string(size) + " bytes is grown past its class");
+            CHECK(hasFill(moved, size, 0xA5));
+            curlPoolFree(moved);
+        }
+    }
+
+    void testReuse()
+    {
+        const auto stats = runInThread([]() {
+            // a freed block is given to the next allocation of its class
+            void* first = poolAllocate(1000, PoolOwner::Buffer);
+            poolFree(first);
+            void* second = poolAllocate(getExpectedUsableSize(1000), PoolOwner::Buffer);
+            CHECK(second == first);
+            // a block of the next class is not
+            void* larger = poolAllocate(getExpectedUsableSize(1000) + 1, PoolOwner::Buffer);
+            CHECK(larger != first);
+            poolFree(second);
+            poolFree(larger);
+            // large blocks come from the system each time
+            poolFree(poolAllocate(MAX_POOLED_BLOCK_SIZE, PoolOwner::Buffer));
+            poolFree(poolAllocate(MAX_POOLED_BLOCK_SIZE, PoolOwner::Buffer));
+            // the owners are counted separately
+            curlPoolFree(curlPoolMalloc(10));
+            curlPoolFree(curlPoolMalloc(20));
+        });
+        CHECK_EQUAL(5u, stats.bufferAllocations);
+        CHECK_EQUAL(1u, stats.bufferReused);
+        CHECK_EQUAL(2u, stats.curlAllocations);
+        CHECK_EQUAL(1u, stats.curlReused);
+    }
+
+    void testFreeInAnotherThread()
+    {
+        // the block goes to the cache of the thread that frees it
+        void* block = poolAllocate(300, PoolOwner::Buffer);
+        const auto stats = runInThread([block]() {
+            poolFree(block);
+            void* reused = poolAllocate(300, PoolOwner::Buffer);
+            CHECK(reused == block);
+            poolFree(reused);
+        });
+        CHECK_EQUAL(1u, stats.bufferAllocations);
+        CHECK_EQUAL(1u, stats.bufferReused);
+    }
+
+    void testRealloc()
+    {
+        // realloc of NULL allocates, realloc to 0 keeps the block
+        void* ptr = curlPoolRealloc(nullptr, 10);
+        CHECK(ptr != nullptr);
+        CHECK(curlPoolRealloc(ptr, 0) == ptr);
+        curlPoolFree(ptr);
+
+        const size_t large = MAX_POOLED_BLOCK_SIZE * 2;
+
+        // small to large
+        auto small = static_cast<char*>(curlPoolMalloc(100));
+        std::memset(small, 1, 100);
+        auto grown = static_cast<char*>(curlPoolRealloc(small, large));
+        CHECK(grown != nullptr);
+        CHECK(hasFill(grown, 100, 1));
+        std::memset(grown, 2, large);
+
+        // large to larger keeps the content
+        auto larger = static_cast<char*>(curlPoolRealloc(grown, large * 2));
+        CHECK(larger != nullptr);
+        CHECK(hasFill(larger, large, 2));
+
+        // large to small returns to a size class with the first bytes
+        auto shrunk = static_cast<char*>(curlPoolRealloc(larger, 200));
+        CHECK(shrunk != nullptr);
+        CHECK(hasFill(shrunk, 200, 2));
+        CHECK(curlPoolRealloc(shrunk, getExpectedUsableSize(200)) == shrunk);
+
+        // shrinking a pooled block keeps it
+        CHECK(curlPoolRealloc(shrunk, 1) == shrunk);
+        curlPoolFree(shrunk);
+
+        // a failed realloc keeps the block
+        void* kept = curlPoolMalloc(1);
+        CHECK(curlPoolRealloc(kept, SIZE_MAX) == nullptr);
+        curlPoolFree(kept);
+    }
+
+    void testCallocAndStrdup()
+    {
+        runInThread([]() {
+            // a reused block is cleared
+            void* dirty = curlPoolMalloc(500);
+            std::memset(dirty, 0xFF, 500);
+            curlPoolFree(dirty);
+            void* clean = curlPoolCalloc(5, 100);
+            CHECK(clean == dirty);
+            CHECK(hasFill(clean, 500, 0));
+            curlPoolFree(clean);
+
+            CHECK(curlPoolCalloc(SIZE_MAX / 2, 3) == nullptr);
+            CHECK(curlPoolMalloc(SIZE_MAX) == nullptr);
+            CHECK_THROWS(poolAllocate(SIZE_MAX, PoolOwner::Buffer));
+
+            char* copy = curlPoolStrdup("pooled");
+            CHECK_EQUAL(std::string("pooled"), std::string(copy));
+            curlPoolFree(copy);
+            curlPoolFree(nullptr);
+        });
+    }
+
+    void testPooledBuffer()
+    {
+        PooledBuffer buffer(16384);
+        CHECK_EQUAL(static_cast<size_t>(16384), buffer.size());
+        CHECK(buffer.data() != nullptr);
+        std::memset(buffer.data(), 0, buffer.size());
+    }
+}
+
+int main()
+{
+    RUN_TEST(testClassSizes);
+    RUN_TEST(testUsableSize);
+    RUN_TEST(testReuse);
+    RUN_TEST(testFreeInAnotherThread);
+    RUN_TEST(testRealloc);
+    RUN_TEST(testCallocAndStrdup);
+    RUN_TEST(testPooledBuffer);
+    return test::failures();
+}
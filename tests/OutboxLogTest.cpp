@@ -0,0 +1,239 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			OutboxLogTest.cpp
+ *	DESCRIPTION:	Tests of the records of the outbox log.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Test.h"
+#include "OutboxLog.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+namespace
+{
+    // Appends a record to the log the way the outbox writes it.
+    void appendRecord(std::string& log, uint8_t type, uint64_t id, const std::string& payload)
+    {
+        char header[OUTBOX_RECORD_HEADER_SIZE];
+        encodeOutboxRecordHeader(header, type, id, payload.data(), payload.size());
+        log.append(header, sizeof(header));
+        log += payload;
+        log.resize(static_cast<size_t>(alignOutboxRecord(log.size())), '\0');
+    }
+
+    std::string createLog()
+    {
+        std::string log(OUTBOX_FILE_MAGIC, sizeof(OUTBOX_FILE_MAGIC));
+        log.resize(OUTBOX_HEADER_SIZE, '\0');
+        return log;
+    }
+
+    // IDs of the records read from the start of the log, the offset where they end is returned in end.
+    std::vector<uint64_t> readRecords(const std::string& log, uint64_t& end)
+    {
+        std::vector<uint64_t> ids;
+        uint64_t offset = OUTBOX_HEADER_SIZE;
+        OutboxRecord record;
+        while (readOutboxRecord(log.data(), log.size(), offset, record)) {
+            ids.push_back(record.id);
+            offset += std::min<uint64_t>(record.size, log.size() - offset);
+        }
+        end = offset;
+        return ids;
+    }
+
+    OutboxRequest makeRequest()
+    {
+        OutboxRequest request;
+        request.database = "/data/employee.fdb";
+        request.method = "POST";
+        request.url = "https://example.com/hooks?id=1";
+        request.headers = "X-Key: 1\nX-Trace: abc";
+        request.options = "CURLOPT_TIMEOUT_MS=1000";
+        request.hasBody = true;
+        request.body = std::string("binary\0body\xFF", 12);
+        return request;
+    }
+
+    void testRequestRoundTrip()
+    {
+        const OutboxRequest request = makeRequest();
+        const auto enqueueTime = std::chrono::system_clock::time_point(std::chrono::microseconds(1700000000123456LL));
+        const std::string payload = encodeOutboxRequest(request, enqueueTime);
+
+        std::chrono::system_clock::time_point decodedTime;
+        const OutboxRequest decoded = decodeOutboxRequest(payload.data(), payload.size(), decodedTime);
+        CHECK(decodedTime == enqueueTime);
+        CHECK_EQUAL(request.database, decoded.database);
+        CHECK_EQUAL(request.method, decoded.method);
+        CHECK_EQUAL(request.url, decoded.url);
+        CHECK_EQUAL(request.headers, decoded.headers);
+        CHECK_EQUAL(request.options, decoded.options);
+        CHECK(decoded.hasBody);
+        CHECK_EQUAL(request.body, decoded.body);
+
+        // a request without a body stays without one, an empty body is still a body
+        OutboxRequest noBody = makeRequest();
+        noBody.method = "DELETE";
+        noBody.hasBody = false;
+        noBody.body.clear();
+        const std::string noBodyPayload = encodeOutboxRequest(noBody, enqueueTime);
+        CHECK(!decodeOutboxRequest(noBodyPayload.data(), noBodyPayload.size(), decodedTime).hasBody);
+        OutboxRequest emptyBody = noBody;
+        emptyBody.hasBody = true;
+        const std::string emptyBodyPayload = encodeOutboxRequest(emptyBody, enqueueTime);
+        const OutboxRequest decodedEmpty = decodeOutboxRequest(emptyBodyPayload.data(), emptyBodyPayload.size(), decodedTime);
+        CHECK(decodedEmpty.hasBody);
+        CHECK(decodedEmpty.body.empty());
+    }
+
+    void testInvalidRequestPayload()
+    {
+        const std::string payload = encodeOutboxRequest(makeRequest(), std::chrono::system_clock::now());
+        std::chrono::system_clock::time_point enqueueTime;
+        // every truncation of the payload is detected
+        for (size_t length = 0; length < payload.size(); ++length)
+            CHECK_THROWS(decodeOutboxRequest(payload.data(), length, enqueueTime));
+        // a string length past the end of the payload
+        std::string invalid = payload;
+        invalid[9] = '\xFF';
+        CHECK_THROWS(decodeOutboxRequest(invalid.data(), invalid.size(), enqueueTime));
+    }
+
+    void testRecordFormat()
+    {
+        // the layout is stored on disk, so it must not change: magic, length, CRC-32 of the type,
+        // ID and payload, type, 3 reserved bytes, ID
+        char header[OUTBOX_RECORD_HEADER_SIZE];
+        encodeOutboxRecordHeader(header, OUTBOX_RECORD_REQUEST, 7, "abc", 3);
+        const unsigned char expected[OUTBOX_RECORD_HEADER_SIZE] = {
+            0x4F, 0x58, 0x42, 0x52, 0x03, 0x00, 0x00, 0x00, 0x53, 0x07, 0x2E, 0x03,
+            0x01, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+        };
+        CHECK(memcmp(header, expected, sizeof(expected)) == 0);
+
+        CHECK_EQUAL(24u, alignOutboxRecord(24));
+        CHECK_EQUAL(32u, alignOutboxRecord(25));
+        CHECK_EQUAL(32u, alignOutboxRecord(32));
+
+        const std::string done = encodeOutboxDone(503, false);
+        CHECK_EQUAL(std::string("\xF7\x01\x00\x00\x00", 5), done);
+    }
+
+    void testReadRecords()
+    {
+        std::string log = createLog();
+        const std::string request = encodeOutboxRequest(makeRequest(), std::chrono::system_clock::now());
+        appendRecord(log, OUTBOX_RECORD_REQUEST, 1, request);
+        appendRecord(log, OUTBOX_RECORD_DONE, 1, encodeOutboxDone(200, true));
+        appendRecord(log, OUTBOX_RECORD_REQUEST, 2, std::string());
+        CHECK_EQUAL(0u, log.size() % 8);
+
+        OutboxRecord record;
+        CHECK(readOutboxRecord(log.data(), log.size(), OUTBOX_HEADER_SIZE, record));
+        CHECK_EQUAL(static_cast<int>(OUTBOX_RECORD_REQUEST), static_cast<int>(record.type));
+        CHECK_EQUAL(1u, record.id);
+        CHECK_EQUAL(request.size(), static_cast<size_t>(record.length));
+        CHECK(std::string(record.payload, record.length) == request);
+        CHECK_EQUAL(alignOutboxRecord(OUTBOX_RECORD_HEADER_SIZE + request.size()), record.size);
+
+        uint64_t end = 0;
+        const std::vector<uint64_t> ids = readRecords(log, end);
+        CHECK_EQUAL(3u, ids.size());
+        CHECK_EQUAL(static_cast<uint64_t>(log.size()), end);
+
+        // the records of a mapped file are followed by zeros
+        log.resize(log.size() + 4096, '\0');
+        CHECK_EQUAL(3u, readRecords(log, end).size());
+    }
+
+    void testTornTail()
+    {
+        std::string log = createLog();
+        appendRecord(log, OUTBOX_RECORD_REQUEST, 1, encodeOutboxRequest(makeRequest(), std::chrono::system_clock::now()));
+        const uint64_t lastStart = log.size();
+        const std::string payload = encodeOutboxRequest(makeRequest(), std::chrono::system_clock::now());
+        appendRecord(log, OUTBOX_RECORD_REQUEST, 2, payload);
+        const std::string complete = log;
+
+        // the log cut anywhere before the end of the last payload ends before the last record
+        uint64_t end = 0;
+        const uint64_t payloadEnd = lastStart + OUTBOX_RECORD_HEADER_SIZE + payload.size();
+        for (uint64_t size = lastStart; size < payloadEnd; ++size) {
+            const std::vector<uint64_t> ids = readRecords(complete.substr(0, static_cast<size_t>(size)), end);
+            if (ids.size() != 1 || end != lastStart)
+                test::fail(__FILE__, __LINE__, "a record torn at " + std::to_string(size) + " was read");
+        }
+
+        // a changed byte of the payload, of the type or of the ID does not match the CRC
+        for (const uint64_t position : { payloadEnd - 1, lastStart + 12, lastStart + 16 }) {
+            std::string corrupted = complete;
+            corrupted[static_cast<size_t>(position)] ^= 0x01;
+            CHECK_EQUAL(1u, readRecords(corrupted, end).size());
+            CHECK_EQUAL(lastStart, end);
+        }
+
+        // a record written without its magic yet
+        std::string unfinished = complete;
+        memset(&unfinished[static_cast<size_t>(lastStart)], 0, 4);
+        CHECK_EQUAL(1u, readRecords(unfinished, end).size());
+        CHECK_EQUAL(lastStart, end);
+
+        // a length past the end of the log
+        std::string tooLong = complete;
+        const uint32_t length = 0x7FFFFFFF;
+        memcpy(&tooLong[static_cast<size_t>(lastStart) + 4], &length, 4);
+        CHECK_EQUAL(1u, readRecords(tooLong, end).size());
+
+        CHECK_EQUAL(2u, readRecords(complete, end).size());
+    }
+
+    void testUnalignedEnd()
+    {
+        // the padding of the last record may be missing at the end of the file
+        std::string log = createLog();
+        appendRecord(log, OUTBOX_RECORD_DONE, 5, encodeOutboxDone(200, true));
+        log.resize(static_cast<size_t>(OUTBOX_HEADER_SIZE + OUTBOX_RECORD_HEADER_SIZE + 5));
+        uint64_t end = 0;
+        CHECK_EQUAL(1u, readRecords(log, end).size());
+        CHECK_EQUAL(static_cast<uint64_t>(log.size()), end);
+
+        OutboxRecord record;
+        CHECK(!readOutboxRecord(log.data(), log.size(), log.size(), record));
+        CHECK(!readOutboxRecord(log.data(), log.size(), log.size() + 8, record));
+    }
+}
+
+int main()
+{
+    RUN_TEST(testRequestRoundTrip);
+    RUN_TEST(testInvalidRequestPayload);
+    RUN_TEST(testRecordFormat);
+    RUN_TEST(testReadRecords);
+    RUN_TEST(testTornTail);
+    RUN_TEST(testUnalignedEnd);
+    return test::failures();
+}
@@ -0,0 +1,106 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			PaginationTest.cpp
+ *	DESCRIPTION:	Tests of the parsing of Link headers and of page URLs.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Test.h"
+#include "Pagination.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+    void testNextLink()
+    {
+        CHECK_EQUAL(std::string("https://api.example.com/items?page=3"), findNextLink({
+            "<https://api.example.com/items?page=1>; rel=\"first\", <https://api.example.com/items?page=3>; rel=\"next\""
+        }));
+        // the relation without quotes, in another case and among other parameters
+        CHECK_EQUAL(std::string("/items?page=2"), findNextLink({ "</items?page=2>;title=\"page 2\"; REL=Next" }));
+        // several relation types separated by spaces
+        CHECK_EQUAL(std::string("/b"), findNextLink({ "</a>; rel=\"prev\", </b>; rel=\"last next\"" }));
+        // links of several headers
+        CHECK_EQUAL(std::string("/c"), findNextLink({ "</a>; rel=prev", "</c>; rel=next" }));
+    }
+
+    void testNextLinkSeparatorsInParameters()
+    {
+        // separators inside quoted strings do not end the link
+        CHECK_EQUAL(std::string("/d"), findNextLink({ "</x>; title=\"a, b; rel=next\"; rel=prev, </d>; rel=next" }));
+        CHECK_EQUAL(std::string("/e"), findNextLink({ "</e>; title=\"quote \\\" inside\"; rel=\"next\"" }));
+        // commas inside the URI reference
+        CHECK_EQUAL(std::string("/f?ids=1,2,3"), findNextLink({ "</f?ids=1,2,3>; rel=\"next\"" }));
+    }
+
+    void testNoNextLink()
+    {
+        CHECK_EQUAL(std::string(), findNextLink({}));
+        CHECK_EQUAL(std::string(), findNextLink({ "" }));
+        CHECK_EQUAL(std::string(), findNextLink({ "</a>; rel=\"prev\", </b>; rel=\"last\"" }));
+        // "next" only as a part of another relation or of another parameter
+        CHECK_EQUAL(std::string(), findNextLink({ "</a>; rel=\"nextpage\"; title=next" }));
+        // malformed values
+        CHECK_EQUAL(std::string(), findNextLink({ "https://example.com/a; rel=next" }));
+        CHECK_EQUAL(std::string(), findNextLink({ "<https://example.com/a; rel=next" }));
+        CHECK_EQUAL(std::string(), findNextLink({ "</a>; rel" }));
+    }
+
+    void testResolveUrl()
+    {
+        const std::string base = "https://api.example.com/v1/items?page=1";
+        CHECK_EQUAL(std::string("https://other.example.com/x"), resolveUrl(base, "https://other.example.com/x"));
+        CHECK_EQUAL(std::string("https://api.example.com/v1/items?page=2"), resolveUrl(base, "?page=2"));
+        CHECK_EQUAL(std::string("https://api.example.com/v2/items"), resolveUrl(base, "/v2/items"));
+        CHECK_EQUAL(std::string("https://api.example.com/v1/more"), resolveUrl(base, "more"));
+        CHECK_EQUAL(std::string("https://api.example.com/v0"), resolveUrl(base, "../v0"));
+        CHECK_EQUAL(std::string("https://cdn.example.com/y"), resolveUrl(base, "//cdn.example.com/y"));
+        CHECK_THROWS(resolveUrl("not a url", "/a"));
+    }
+
+    void testSetQueryParameter()
+    {
+        CHECK_EQUAL(std::string("https://example.com/items?page=2"),
+            setQueryParameter("https://example.com/items", "page", "2"));
+        // the existing value is replaced, other parameters are kept in their order
+        CHECK_EQUAL(std::string("https://example.com/items?a=1&b=2&page=3"),
+            setQueryParameter("https://example.com/items?a=1&page=2&b=2", "page", "3"));
+        // a parameter with a longer name is not the same parameter
+        CHECK_EQUAL(std::string("https://example.com/items?pages=9&page=1"),
+            setQueryParameter("https://example.com/items?pages=9", "page", "1"));
+        // the value is encoded
+        CHECK_EQUAL(std::string("https://example.com/items?cursor=a%26b%3dc"),
+            setQueryParameter("https://example.com/items", "cursor", "a&b=c"));
+        CHECK_THROWS(setQueryParameter("not a url", "page", "1"));
+    }
+}
+
+int main()
+{
+    RUN_TEST(testNextLink);
+    RUN_TEST(testNextLinkSeparatorsInParameters);
+    RUN_TEST(testNoNextLink);
+    RUN_TEST(testResolveUrl);
+    RUN_TEST(testSetQueryParameter);
+    return test::failures();
+}
@@ -0,0 +1,116 @@
+/*
+ *	PROGRAM:		Http Client UDR.
+ *	MODULE:			RequestTemplateTest.cpp
+ *	DESCRIPTION:	Tests of the placeholder expansion of request templates.
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "Test.h"
+#include "RequestTemplate.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::string render(const std::string& text, TemplateEscaping escaping, const std::string& parameters)
+    {
+        std::string result;
+        TemplateText(text, escaping).render(TemplateParameters(parameters), result);
+        return result;
+    }
+
+    void testParameterNames()
+    {
+        const TemplateText text("/users/{{ id }}/posts/{{post}}?by={{id}}", TemplateEscaping::Url);
+        CHECK_EQUAL(2u, text.getParameterNames().size());
+        CHECK_EQUAL(std::string("id"), text.getParameterNames()[0]);
+        CHECK_EQUAL(std::string("post"), text.getParameterNames()[1]);
+        CHECK_EQUAL(std::string("/users//posts/?by=").size(), text.getLiteralSize());
+
+        // unclosed braces are literal text
+        const TemplateText unclosed("a {{b", TemplateEscaping::None);
+        CHECK(unclosed.getParameterNames().empty());
+        CHECK_EQUAL(std::string("a {{b"), render("a {{b", TemplateEscaping::None, "{}"));
+
+        CHECK_THROWS(TemplateText("a {{ }} b", TemplateEscaping::None));
+    }
+
+    void testUrlEscaping()
+    {
+        CHECK_EQUAL(std::string("https://example.com/users/10/search?q=a%20b%26c%2F%C3%A9-._~"),
+            render("https://example.com/users/{{id}}/search?q={{q}}", TemplateEscaping::Url,
+                R"({"id": 10, "q": "a b&c/é-._~"})"));
+        // null is an empty string
+        CHECK_EQUAL(std::string("/items?after="), render("/items?after={{cursor}}", TemplateEscaping::Url,
+            R"({"cursor": null})"));
+    }
+
+    void testJsonEscaping()
+    {
+        const std::string body = R"({"name": {{name}}, "text": "Comment from {{name}}: {{text}}", "count": {{count}}})";
+        CHECK_EQUAL(std::string(R"({"name": "John \"J\"", "text": "Comment from John \"J\": line\nnext", "count": 5})"),
+            render(body, TemplateEscaping::Json, R"({"name": "John \"J\"", "text": "line\nnext", "count": 5})"));
+        // objects, arrays and null are inserted as JSON values outside of strings
+        CHECK_EQUAL(std::string(R"({"tags": ["a", 1], "extra": {"k": true}, "none": null, "s": ""})"),
+            render(R"({"tags": {{tags}}, "extra": {{extra}}, "none": {{none}}, "s": "{{none}}"})", TemplateEscaping::Json,
+                R"({"tags": ["a", 1], "extra": {"k": true}, "none": null})"));
+        // an escaped quote does not end the string literal
+        CHECK_EQUAL(std::string(R"({"s": "say \"hi\" to \"Ann\""})"),
+            render(R"({"s": "say \"hi\" to {{who}}"})", TemplateEscaping::Json, R"({"who": "\"Ann\""})"));
+    }
+
+    void testNoEscaping()
+    {
+        CHECK_EQUAL(std::string("id=1&name=a b"), render("id={{id}}&name={{name}}", TemplateEscaping::None,
+            R"({"id": 1, "name": "a b"})"));
+    }
+
+    void testParameters()
+    {
+        // names given with a quoted member name
+        CHECK_EQUAL(std::string("x-y"), render("{{first name}}", TemplateEscaping::None, R"({"first name": "x-y"})"));
+        CHECK_THROWS(render("{{id}}", TemplateEscaping::None, R"({"other": 1})"));
+        CHECK_THROWS(render("{{id}}", TemplateEscaping::None, "[1, 2]"));
+        CHECK_THROWS(render("{{id}}", TemplateEscaping::None, R"({"id": 1} {"id": 2})"));
+        CHECK_THROWS(render("{{id}}", TemplateEscaping::None, R"({"id": )"));
+    }
+
+    void testBodyEscaping()
+    {
+        CHECK(getBodyEscaping("application/json; charset=utf-8") == TemplateEscaping::Json);
+        CHECK(getBodyEscaping("application/vnd.api+JSON") == TemplateEscaping::Json);
+        CHECK(getBodyEscaping("application/x-www-form-urlencoded") == TemplateEscaping::Url);
+        CHECK(getBodyEscaping("text/plain; note=json") == TemplateEscaping::None);
+        CHECK(getBodyEscaping("") == TemplateEscaping::None);
+    }
+}
+
+int main()
+{
+    RUN_TEST(testParameterNames);
+    RUN_TEST(testUrlEscaping);
+    RUN_TEST(testJsonEscaping);
+    RUN_TEST(testNoEscaping);
+    RUN_TEST(testParameters);
+    RUN_TEST(testBodyEscaping);
+    return test::failures();
+}
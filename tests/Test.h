@@ -0,0 +1,109 @@
+#pragma once
+
+#ifndef TEST_H
+#define TEST_H
+
+/*
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.firebirdsql.org/en/initial-developer-s-public-license-version-1-0/.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created by Simonov Denis
+ *  for the open source project "IBSurgeon Http Client UDR".
+ *
+ *  Copyright (c) 2023 Simonov Denis <sim-mail@list.ru>
+ *  and all contributors signed below.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/*
+ * Checks of the unit tests, which run without Firebird. A failed check is reported
+ * with its location and the test goes on, main() returns the number of failures.
+ */
+namespace test
+{
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void fail(const char* file, int line, const std::string& message)
+    {
+        std::cerr << file << ":" << line << ": " << message << std::endl;
+        ++failures();
+    }
+
+    template <typename T>
+    std::string describe(const T& value)
+    {
+        std::ostringstream stream;
+        stream << value;
+        return stream.str();
+    }
+
+    inline std::string describe(const std::string& value)
+    {
+        return "\"" + value + "\"";
+    }
+
+    inline int run(const char* name, void (*function)())
+    {
+        const int before = failures();
+        try {
+            function();
+        }
+        catch (const std::exception& e) {
+            std::cerr << name << ": unexpected exception: " << e.what() << std::endl;
+            ++failures();
+        }
+        std::cout << (failures() == before ? "ok     " : "FAILED ") << name << std::endl;
+        return failures() - before;
+    }
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) \
+            test::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed"); \
+    } while (false)
+
+#define CHECK_EQUAL(expected, actual) \
+    do { \
+        const auto& expectedValue = (expected); \
+        const auto& actualValue = (actual); \
+        if (!(expectedValue == actualValue)) { \
+            test::fail(__FILE__, __LINE__, "CHECK_EQUAL(" #expected ", " #actual ") failed: " + \
+                test::describe(expectedValue) + " != " + test::describe(actualValue)); \
+        } \
+    } while (false)
+
+#define CHECK_THROWS(expression) \
+    do { \
+        bool thrown = false; \
+        try { \
+            (void) (expression); \
+        } \
+        catch (const std::exception&) { \
+            thrown = true; \
+        } \
+        if (!thrown) \
+            test::fail(__FILE__, __LINE__, "CHECK_THROWS(" #expression ") did not throw"); \
+    } while (false)
+
+#define RUN_TEST(function) test::run(#function, function)
+
+#endif // TEST_H